@@ -44,5 +44,8 @@ public class CommonInventory : ModuleRules
 
             }
         );
+
+        // Iris NetSerializers for FCommonItem and FCommonItemStack.
+        SetupIrisSupport(Target);
 	}
 }
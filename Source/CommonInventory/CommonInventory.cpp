@@ -1,9 +1,28 @@
 // Copyright 2025 Ivan Baktenkov. All Rights Reserved.
 
 #include "CommonInventory.h"
+#include "Commands/CommonInventoryCommand.h"
 #include "CommonInventoryLog.h"
 #include "CommonInventoryTrace.h"
 
 DEFINE_LOG_CATEGORY(LogCommonInventory);
 UE_TRACE_CHANNEL_DEFINE(CommonInventoryChannel);
+LLM_DEFINE_TAG(CommonInventory);
 IMPLEMENT_MODULE(FCommonInventoryModule, CommonInventory);
+
+void FCommonInventoryModule::StartupModule()
+{
+	// Modules loaded later, e.g. by game features, might bring new native commands.
+	ModulesChangedHandle = FModuleManager::Get().OnModulesChanged().AddLambda([](FName, EModuleChangeReason InReason)
+		{
+			if (InReason == EModuleChangeReason::ModuleLoaded)
+			{
+				UCommonInventoryCommand::InvalidateCommandTable();
+			}
+		});
+}
+
+void FCommonInventoryModule::ShutdownModule()
+{
+	FModuleManager::Get().OnModulesChanged().Remove(ModulesChangedHandle);
+}
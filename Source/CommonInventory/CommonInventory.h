@@ -9,11 +9,15 @@ class FCommonInventoryModule final : public IModuleInterface
 {
 public:
 	
-	//virtual void StartupModule() override;
-	//virtual void ShutdownModule() override;
+	virtual void StartupModule() override;
+	virtual void ShutdownModule() override;
 
 	virtual bool SupportsDynamicReloading() override
 	{
 		return false;
 	}
+
+private:
+
+	FDelegateHandle ModulesChangedHandle;
 };
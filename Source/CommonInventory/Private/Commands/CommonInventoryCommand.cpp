@@ -2,6 +2,16 @@
 
 #include "Commands/CommonInventoryCommand.h"
 
+#include "CommonInventoryLog.h"
+#include "Components/CommonInventoryComponent.h"
+
+#include "Algo/Sort.h"
+#include "Misc/Crc.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/UObjectHash.h"
+
+#include <atomic>
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryCommand)
 
 UCommonInventoryCommand::UCommonInventoryCommand()
@@ -29,3 +39,144 @@ ECommonInventoryCommandExecutionResult UCommonInventoryCommand::Rollback(FCommon
 {
 	return ECommonInventoryCommandExecutionResult::Failure;
 }
+
+namespace CommonInventory
+{
+	/**
+	 * Native commands keyed by a hash of the class path, so ids don't depend on the set of loaded modules.
+	 * Rebuilt on the game thread once new modules are loaded, while the scheduler workers only read it.
+	 */
+	class FCommandTable
+	{
+	public:
+
+		/** Rebuilds the table if modules have been loaded since. */
+		void ConditionallyRebuild()
+		{
+			if (bIsDirty.load(std::memory_order::relaxed) && IsInGameThread())
+			{
+				Rebuild();
+			}
+		}
+
+		uint32 GetCommandId(const UClass* InCommandClass) const
+		{
+			FReadScopeLock ReadLock(Lock);
+			const uint32* const CommandId = CommandIds.Find(InCommandClass);
+			return CommandId ? *CommandId : 0;
+		}
+
+		const UCommonInventoryCommand* FindCommand(uint32 InCommandId) const
+		{
+			FReadScopeLock ReadLock(Lock);
+			const UCommonInventoryCommand* const* const Command = Commands.Find(InCommandId);
+			return Command ? *Command : nullptr;
+		}
+
+		uint32 GetChecksum() const
+		{
+			FReadScopeLock ReadLock(Lock);
+			return Checksum;
+		}
+
+		void Invalidate()
+		{
+			bIsDirty.store(true, std::memory_order::relaxed);
+		}
+
+	private:
+
+		void Rebuild()
+		{
+			TArray<UClass*> CommandClasses;
+			GetDerivedClasses(UCommonInventoryCommand::StaticClass(), CommandClasses);
+			CommandClasses.RemoveAll([](const UClass* InClass) { return !InClass->HasAnyClassFlags(CLASS_Native) || InClass->HasAnyClassFlags(CLASS_Abstract); });
+
+			// Sorted, so collisions are resolved and the checksum is calculated the same way on both sides.
+			TArray<TPair<uint32, const UClass*>> SortedCommands;
+			SortedCommands.Reserve(CommandClasses.Num());
+
+			for (const UClass* const CommandClass : CommandClasses)
+			{
+				const FString PathName = CommandClass->GetPathName();
+
+				// Zero is reserved for non-native commands sent by class.
+				const uint32 CommandId = FCrc::StrCrc32(*PathName);
+				SortedCommands.Emplace(CommandId != 0 ? CommandId : 1, CommandClass);
+			}
+
+			Algo::Sort(SortedCommands, [](const TPair<uint32, const UClass*>& A, const TPair<uint32, const UClass*>& B)
+				{
+					return A.Key != B.Key ? A.Key < B.Key : A.Value->GetPathName() < B.Value->GetPathName();
+				});
+
+			FWriteScopeLock WriteLock(Lock);
+			Commands.Reset();
+			CommandIds.Reset();
+			Checksum = 0;
+
+			for (const TPair<uint32, const UClass*>& SortedCommand : SortedCommands)
+			{
+				if (const UCommonInventoryCommand* const* const Existing = Commands.Find(SortedCommand.Key))
+				{
+					COMMON_INVENTORY_LOG(Error, "UCommonInventoryCommand: '%s' collides with '%s' and can't be sent. Rename one of the classes.", *SortedCommand.Value->GetPathName(), *(*Existing)->GetClass()->GetPathName());
+					continue;
+				}
+
+				Commands.Add(SortedCommand.Key, SortedCommand.Value->GetDefaultObject<UCommonInventoryCommand>());
+				CommandIds.Add(SortedCommand.Value, SortedCommand.Key);
+				Checksum = FCrc::TypeCrc32(SortedCommand.Key, Checksum);
+			}
+
+			bIsDirty.store(false, std::memory_order::relaxed);
+		}
+
+	private:
+
+		TMap<uint32, const UCommonInventoryCommand*> Commands;
+		TMap<const UClass*, uint32> CommandIds;
+		uint32 Checksum = 0;
+
+		mutable FRWLock Lock;
+		std::atomic<bool> bIsDirty = true;
+	};
+
+	/** Built on the first use on the game thread, since all the native classes of the loaded modules are registered by then. */
+	static FCommandTable& GetCommandTable()
+	{
+		static FCommandTable CommandTable;
+		CommandTable.ConditionallyRebuild();
+		return CommandTable;
+	}
+}
+
+uint32 UCommonInventoryCommand::GetCommandId(const UClass* InCommandClass)
+{
+	return CommonInventory::GetCommandTable().GetCommandId(InCommandClass);
+}
+
+const UCommonInventoryCommand* UCommonInventoryCommand::FindCommandById(uint32 InCommandId)
+{
+	return CommonInventory::GetCommandTable().FindCommand(InCommandId);
+}
+
+uint32 UCommonInventoryCommand::GetCommandTableChecksum()
+{
+	return CommonInventory::GetCommandTable().GetChecksum();
+}
+
+void UCommonInventoryCommand::InvalidateCommandTable()
+{
+	CommonInventory::GetCommandTable().Invalidate();
+}
+
+FCommonInventoryState* UCommonInventoryCommand::GetMutableInventoryState(UCommonInventoryComponent* InComponent)
+{
+	return InComponent ? &InComponent->InventoryState : nullptr;
+}
+
+bool UCommonInventoryCommand::CanAccessInventory(const FCommonInventoryCommandExecutionContext& ExecutionContext, const UCommonInventoryComponent* InComponent)
+{
+	// Commands initiated locally are trusted, clients can reference any component in the bunch.
+	return InComponent && (!ExecutionContext.bIsRemoteRequest || InComponent->CanBeAccessedBy(ExecutionContext.AuthOwner));
+}
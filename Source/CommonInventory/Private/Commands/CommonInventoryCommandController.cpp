@@ -2,12 +2,277 @@
 
 #include "Commands/CommonInventoryCommandController.h"
 
+#include "CommonInventoryLog.h"
+#include "CommonInventorySettings.h"
+#include "Components/CommonInventoryComponent.h"
+
+#include "CoreGlobals.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryCommandController)
 
+const UCommonInventoryCommand* FCommonInventoryCommandBunch::ResolveCommand() const
+{
+	if (CommandId != 0)
+	{
+		return UCommonInventoryCommand::FindCommandById(CommandId);
+	}
+
+	return CommandClass && !CommandClass->HasAnyClassFlags(CLASS_Abstract) ? CommandClass.GetDefaultObject() : nullptr;
+}
+
 FCommonInventoryCommandController::FCommonInventoryCommandController(const AActor* InAuthorizedOwner)
 	: AuthOwner(InAuthorizedOwner)
 {
 	check(AuthOwner);
+	PredictionBuffer.SetNum(PredictionBufferSize);
+}
+
+ECommonInventoryCommandExecutionResult FCommonInventoryCommandController::ExecuteCommand(TSubclassOf<UCommonInventoryCommand> InCommandClass, UCommonInventoryComponent* InSourceComponent, UCommonInventoryComponent* InTargetComponent, FVariadicStruct InPayload)
+{
+	const UCommonInventoryCommand* const Command = InCommandClass.GetDefaultObject();
+
+	if (!Command || InCommandClass->HasAnyClassFlags(CLASS_Abstract))
+	{
+		return ECommonInventoryCommandExecutionResult::Failure;
+	}
+
+	if (AuthOwner->HasAuthority())
+	{
+		FCommonInventoryCommandExecutionContext ExecutionContext = MakeExecutionContext(InSourceComponent, InTargetComponent);
+		ExecutionContext.CommandPayload = MoveTemp(InPayload);
+		return ExecuteCommandInternal(*Command, ExecutionContext);
+	}
+
+	// Only predictive commands can be initiated by autonomous proxies.
+	if (Command->GetExecutionPolicy() != ECommonInventoryCommandExecutionPolicy::Predictive || AuthOwner->GetLocalRole() != ROLE_AutonomousProxy)
+	{
+		return ECommonInventoryCommandExecutionResult::Failure;
+	}
+
+	// Non-native commands fall back to the class reference.
+	const uint32 CommandId = UCommonInventoryCommand::GetCommandId(InCommandClass);
+
+	// The server would disconnect the client for overflowing the queue.
+	if (QueuedCommands.Num() >= UCommonInventorySettings::Get()->CommandQueueLength || NextCmdSeq - LastAckedCmdSeq > PredictionBufferSize)
+	{
+		COMMON_INVENTORY_LOG(Warning, "FCommonInventoryCommandController: Command queue overflow, '%s' is dropped.", *InCommandClass->GetName());
+		return ECommonInventoryCommandExecutionResult::Failure;
+	}
+
+	FPredictedCommand& Prediction = GetPredictedCommand(NextCmdSeq);
+	Prediction.Command = Command;
+	Prediction.SourceComponent = InSourceComponent;
+	Prediction.TargetComponent = InTargetComponent;
+	Prediction.CommandPayload = InPayload;
+
+	// Don't bother the server with commands which fail locally.
+	if (!Predict(Prediction))
+	{
+		return ECommonInventoryCommandExecutionResult::Failure;
+	}
+
+	Prediction.CmdSeq = NextCmdSeq;
+
+	FCommonInventoryCommandBunch& Bunch = QueuedCommands.AddDefaulted_GetRef();
+	Bunch.CommandId = CommandId;
+	Bunch.CommandClass = CommandId == 0 ? InCommandClass : nullptr;
+	Bunch.SourceComponent = InSourceComponent;
+	Bunch.TargetComponent = InTargetComponent;
+	Bunch.CommandPayload = MoveTemp(InPayload);
+	Bunch.Timestamp = AuthOwner->GetWorld() ? AuthOwner->GetWorld()->GetTimeSeconds() : 0.f;
+	Bunch.CmdSeq = NextCmdSeq++;
+	Bunch.CmdFrame = static_cast<uint32>(GFrameCounter);
+
+	if (QueuedCommands.Num() == 1)
+	{
+		OnCommandQueued.ExecuteIfBound();
+	}
+
+	return ECommonInventoryCommandExecutionResult::Queued;
+}
+
+bool FCommonInventoryCommandController::FlushQueuedCommands(FCommonInventoryCommandBatch& OutBatch)
+{
+	if (QueuedCommands.IsEmpty())
+	{
+		return false;
+	}
+
+	OutBatch.FirstCmdSeq = QueuedCommands[0].CmdSeq;
+	OutBatch.Bunches = MoveTemp(QueuedCommands);
+	QueuedCommands.Reset();
+	return true;
+}
+
+bool FCommonInventoryCommandController::ExecuteBatch(const FCommonInventoryCommandBatch& InBatch, FCommonInventoryCommandAck& OutAck)
+{
+	check(AuthOwner->HasAuthority());
+
+	// Reliable RPCs are ordered, so any gap or overflow is a protocol violation.
+	if (InBatch.Bunches.IsEmpty() || InBatch.Bunches.Num() > UCommonInventorySettings::Get()->CommandQueueLength || InBatch.FirstCmdSeq != LastExecutedCmdSeq + 1)
+	{
+		COMMON_INVENTORY_LOG(Warning, "FCommonInventoryCommandController: Invalid command batch received from '%s'.", *AuthOwner->GetName());
+		return false;
+	}
+
+	OutAck.RejectedCmdSeqs.Reset();
+
+	for (int32 Idx = 0; Idx < InBatch.Bunches.Num(); ++Idx)
+	{
+		const FCommonInventoryCommandBunch& Bunch = InBatch.Bunches[Idx];
+		const uint32 CmdSeq = InBatch.FirstCmdSeq + Idx;
+
+		// Unknown ids, e.g. commands from modules the server hasn't loaded, are rejected.
+		const UCommonInventoryCommand* const Command = Bunch.ResolveCommand();
+		bool bIsExecuted = false;
+
+		if (Command && Command->GetExecutionPolicy() == ECommonInventoryCommandExecutionPolicy::Predictive)
+		{
+			FCommonInventoryCommandExecutionContext ExecutionContext = MakeExecutionContext(Bunch.SourceComponent, Bunch.TargetComponent);
+			ExecutionContext.CommandPayload = Bunch.CommandPayload;
+			ExecutionContext.bIsRemoteRequest = true;
+			bIsExecuted = ExecuteCommandInternal(*Command, ExecutionContext) == ECommonInventoryCommandExecutionResult::Success;
+		}
+
+		if (!bIsExecuted)
+		{
+			OutAck.RejectedCmdSeqs.Add(CmdSeq);
+		}
+	}
+
+	LastExecutedCmdSeq = OutAck.LastCmdSeq = InBatch.FirstCmdSeq + InBatch.Bunches.Num() - 1;
+	return true;
 }
 
+void FCommonInventoryCommandController::AcknowledgeCommands(const FCommonInventoryCommandAck& InAck)
+{
+	if (InAck.LastCmdSeq <= LastAckedCmdSeq || InAck.LastCmdSeq >= NextCmdSeq)
+	{
+		return;
+	}
+
+	const uint32 FirstAckedCmdSeq = LastAckedCmdSeq + 1;
+	LastAckedCmdSeq = InAck.LastCmdSeq;
+
+	if (InAck.RejectedCmdSeqs.IsEmpty())
+	{
+		// The common case, all predictions are confirmed.
+		for (uint32 CmdSeq = FirstAckedCmdSeq; CmdSeq <= InAck.LastCmdSeq; ++CmdSeq)
+		{
+			FPredictedCommand& Prediction = GetPredictedCommand(CmdSeq);
+			Prediction.CmdSeq = 0;
+			Prediction.Snapshots.Reset();
+		}
+
+		return;
+	}
+
+	const uint32 FirstRejectedCmdSeq = FMath::Min(InAck.RejectedCmdSeqs);
+	COMMON_INVENTORY_LOG(Verbose, "FCommonInventoryCommandController: %d command(s) have been rejected by the server starting from %u.", InAck.RejectedCmdSeqs.Num(), FirstRejectedCmdSeq);
+
+	// Undo the rejected prediction along with all the later predictions, as they might depend on it.
+	for (uint32 CmdSeq = NextCmdSeq - 1; CmdSeq >= FirstRejectedCmdSeq && CmdSeq >= FirstAckedCmdSeq; --CmdSeq)
+	{
+		if (FPredictedCommand& Prediction = GetPredictedCommand(CmdSeq); Prediction.CmdSeq == CmdSeq)
+		{
+			Undo(Prediction);
+		}
+	}
+
+	// Replay the later predictions on top of the restored state, and release the acknowledged ones.
+	for (uint32 CmdSeq = FirstAckedCmdSeq; CmdSeq < NextCmdSeq; ++CmdSeq)
+	{
+		FPredictedCommand& Prediction = GetPredictedCommand(CmdSeq);
+
+		if (Prediction.CmdSeq != CmdSeq)
+		{
+			continue;
+		}
+
+		const bool bIsRejected = InAck.RejectedCmdSeqs.Contains(CmdSeq);
+
+		if (!bIsRejected && CmdSeq > FirstRejectedCmdSeq)
+		{
+			Predict(Prediction);
+		}
+
+		if (bIsRejected || CmdSeq <= InAck.LastCmdSeq)
+		{
+			Prediction.CmdSeq = 0;
+			Prediction.Snapshots.Reset();
+		}
+	}
+}
+
+bool FCommonInventoryCommandController::Predict(FPredictedCommand& InPrediction)
+{
+	if (!InPrediction.Command)
+	{
+		return false;
+	}
+
+	FCommonInventoryCommandExecutionContext ExecutionContext = MakeExecutionContext(InPrediction.SourceComponent.Get(), InPrediction.TargetComponent.Get());
+	ExecutionContext.CommandPayload = InPrediction.CommandPayload;
+
+	InPrediction.Snapshots.Reset();
+	FCommonInventoryPredictionScope PredictionScope(InPrediction.Snapshots);
 
+	if (ExecuteCommandInternal(*InPrediction.Command, ExecutionContext) != ECommonInventoryCommandExecutionResult::Success)
+	{
+		// Partially executed commands are undone right away.
+		Undo(InPrediction);
+		return false;
+	}
+
+	return true;
+}
+
+void FCommonInventoryCommandController::Undo(FPredictedCommand& InPrediction)
+{
+	const auto FindValidState = [&InPrediction](const FCommonInventoryState* InState)
+		{
+			// Components might have been destroyed while waiting for the server.
+			for (const UCommonInventoryComponent* const Component : { InPrediction.SourceComponent.Get(), InPrediction.TargetComponent.Get() })
+			{
+				if (Component && &Component->GetInventoryState() == InState)
+				{
+					return true;
+				}
+			}
+
+			return false;
+		};
+
+	for (int32 Idx = InPrediction.Snapshots.Num() - 1; Idx >= 0; --Idx)
+	{
+		const FCommonInventoryPredictedSlot& Snapshot = InPrediction.Snapshots[Idx];
+
+		if (FindValidState(Snapshot.State))
+		{
+			Snapshot.State->RestoreSlot(Snapshot);
+		}
+	}
+
+	InPrediction.Snapshots.Reset();
+}
+
+FCommonInventoryCommandExecutionContext FCommonInventoryCommandController::MakeExecutionContext(UCommonInventoryComponent* InSourceComponent, UCommonInventoryComponent* InTargetComponent) const
+{
+	FCommonInventoryCommandExecutionContext ExecutionContext;
+	ExecutionContext.AuthOwner = const_cast<AActor*>(AuthOwner);
+	ExecutionContext.SourceComponent = InSourceComponent;
+	ExecutionContext.TargetComponent = InTargetComponent;
+	return ExecutionContext;
+}
+
+ECommonInventoryCommandExecutionResult FCommonInventoryCommandController::ExecuteCommandInternal(const UCommonInventoryCommand& InCommand, FCommonInventoryCommandExecutionContext& InContext) const
+{
+	if (InCommand.CanExecute(InContext) != ECommonInventoryCommandExecutionResult::Success)
+	{
+		return ECommonInventoryCommandExecutionResult::Failure;
+	}
+
+	return InCommand.Execute(InContext);
+}
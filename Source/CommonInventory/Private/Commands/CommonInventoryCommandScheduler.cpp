@@ -0,0 +1,177 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "Commands/CommonInventoryCommandScheduler.h"
+
+#include "CommonInventorySettings.h"
+#include "CommonInventoryTrace.h"
+#include "Components/CommonInventoryComponent.h"
+
+#include "Async/ParallelFor.h"
+#include "Engine/World.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryCommandScheduler)
+
+bool UCommonInventoryCommandScheduler::ShouldCreateSubsystem(UObject* Outer) const
+{
+	if (const UWorld* const World = static_cast<UWorld*>(Outer))
+	{
+		return (World->IsNetMode(NM_ListenServer) || World->IsNetMode(NM_DedicatedServer)) && Super::ShouldCreateSubsystem(Outer);
+	}
+
+	return false;
+}
+
+bool UCommonInventoryCommandScheduler::DoesSupportWorldType(EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UCommonInventoryCommandScheduler::Deinitialize()
+{
+	QueuedBatches.Empty();
+	Super::Deinitialize();
+}
+
+TStatId UCommonInventoryCommandScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UCommonInventoryCommandScheduler, STATGROUP_Tickables);
+}
+
+void UCommonInventoryCommandScheduler::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	if (!QueuedBatches.IsEmpty())
+	{
+		ExecuteQueuedBatches();
+	}
+}
+
+void UCommonInventoryCommandScheduler::EnqueueBatch(UCommonInventoryComponent* InComponent, const FCommonInventoryCommandBatch& InBatch)
+{
+	QueuedBatches.Add({ InComponent, InBatch });
+}
+
+void UCommonInventoryCommandScheduler::ExecuteQueuedBatches()
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryCommandScheduler::ExecuteQueuedBatches);
+
+	TArray<FQueuedBatch> Batches = MoveTemp(QueuedBatches);
+	QueuedBatches.Reset();
+
+	// Union-find over batches sharing any component.
+	TArray<int32> Parents;
+	Parents.SetNumUninitialized(Batches.Num());
+	TMap<const UCommonInventoryComponent*, int32> ComponentOwners;
+	TBitArray<> GameThreadBatches(false, Batches.Num());
+
+	const auto FindRoot = [&Parents](int32 Idx)
+		{
+			while (Parents[Idx] != Idx)
+			{
+				Idx = Parents[Idx] = Parents[Parents[Idx]];
+			}
+
+			return Idx;
+		};
+
+	const auto Touch = [&](const UCommonInventoryComponent* InComponent, int32 BatchIdx)
+		{
+			if (InComponent)
+			{
+				if (const int32* const OwnerIdx = ComponentOwners.Find(InComponent))
+				{
+					// The lower root keeps the arrival order within the group.
+					const int32 LhsRoot = FindRoot(*OwnerIdx);
+					const int32 RhsRoot = FindRoot(BatchIdx);
+					Parents[FMath::Max(LhsRoot, RhsRoot)] = FMath::Min(LhsRoot, RhsRoot);
+				}
+				else
+				{
+					ComponentOwners.Add(InComponent, BatchIdx);
+				}
+			}
+		};
+
+	for (int32 BatchIdx = 0; BatchIdx < Batches.Num(); ++BatchIdx)
+	{
+		Parents[BatchIdx] = BatchIdx;
+
+		// Resolve weak pointers and lazily created controllers before leaving the game thread.
+		UCommonInventoryComponent* const Component = Batches[BatchIdx].Component.Get();
+		Batches[BatchIdx].Controller = Component ? Component->GetCommandController() : nullptr;
+		Touch(Component, BatchIdx);
+
+		for (const FCommonInventoryCommandBunch& Bunch : Batches[BatchIdx].Batch.Bunches)
+		{
+			Touch(Bunch.SourceComponent, BatchIdx);
+			Touch(Bunch.TargetComponent, BatchIdx);
+
+			if (const UCommonInventoryCommand* const Command = Bunch.ResolveCommand(); Command && Command->RequiresGameThread())
+			{
+				GameThreadBatches[BatchIdx] = true;
+			}
+		}
+	}
+
+	// Groups are ordered by their first batch, and batches within groups keep the arrival order.
+	TArray<TArray<int32, TInlineAllocator<4>>> Groups;
+	TArray<int32> GroupIndices;
+	GroupIndices.Init(INDEX_NONE, Batches.Num());
+	TBitArray<> GameThreadGroups;
+
+	for (int32 BatchIdx = 0; BatchIdx < Batches.Num(); ++BatchIdx)
+	{
+		const int32 Root = FindRoot(BatchIdx);
+
+		if (GroupIndices[Root] == INDEX_NONE)
+		{
+			GroupIndices[Root] = Groups.AddDefaulted();
+			GameThreadGroups.Add(false);
+		}
+
+		Groups[GroupIndices[Root]].Add(BatchIdx);
+		GameThreadGroups[GroupIndices[Root]] |= GameThreadBatches[BatchIdx];
+	}
+
+	const auto ExecuteGroup = [&Batches, &Groups](int32 GroupIdx)
+		{
+			for (const int32 BatchIdx : Groups[GroupIdx])
+			{
+				FQueuedBatch& QueuedBatch = Batches[BatchIdx];
+
+				if (QueuedBatch.Controller)
+				{
+					QueuedBatch.bIsExecuted = QueuedBatch.Controller->ExecuteBatch(QueuedBatch.Batch, QueuedBatch.Ack);
+				}
+			}
+		};
+
+	// Commands that aren't thread safe are executed first, as they might access any state.
+	for (int32 GroupIdx = 0; GroupIdx < Groups.Num(); ++GroupIdx)
+	{
+		if (GameThreadGroups[GroupIdx])
+		{
+			ExecuteGroup(GroupIdx);
+		}
+	}
+
+	const bool bExecuteInParallel = UCommonInventorySettings::Get()->bExecuteCommandsInParallel;
+
+	ParallelFor(TEXT("CommonInventory.ExecuteCommands"), Groups.Num(), /* MinBatchSize */ 1, [&](int32 GroupIdx)
+		{
+			if (!GameThreadGroups[GroupIdx])
+			{
+				ExecuteGroup(GroupIdx);
+			}
+		}, bExecuteInParallel && Groups.Num() > 1 ? EParallelForFlags::None : EParallelForFlags::ForceSingleThread);
+
+	// Commit in the arrival order.
+	for (FQueuedBatch& QueuedBatch : Batches)
+	{
+		if (UCommonInventoryComponent* const Component = QueuedBatch.Component.Get())
+		{
+			Component->CommitCommandBatch(QueuedBatch.bIsExecuted, QueuedBatch.Ack);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "Commands/CommonInventoryCommandController.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "UObject/WeakObjectPtr.h"
+
+#include "CommonInventoryCommandScheduler.generated.h"
+
+class UCommonInventoryComponent;
+
+/**
+ * A server only subsystem which executes command batches received during the frame.
+ * 
+ * Batches are partitioned by the components they touch, and groups of independent batches are executed on task graph workers.
+ * Batches within a group keep the arrival order, and the results are committed on the game thread in the arrival order.
+ */
+UCLASS(MinimalAPI, Hidden)
+class UCommonInventoryCommandScheduler : public UTickableWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+
+	UCommonInventoryCommandScheduler() = default;
+
+	/** Queues the batch for execution at the end of the frame. */
+	void EnqueueBatch(UCommonInventoryComponent* InComponent, const FCommonInventoryCommandBatch& InBatch);
+
+private:
+
+	/** Executes all the queued batches. */
+	void ExecuteQueuedBatches();
+
+	// Overrides
+	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Deinitialize() override;
+	virtual void Tick(float DeltaTime) override;
+	virtual TStatId GetStatId() const override;
+
+private:
+
+	struct FQueuedBatch
+	{
+		TWeakObjectPtr<UCommonInventoryComponent> Component;
+		FCommonInventoryCommandBatch Batch;
+		FCommonInventoryCommandAck Ack;
+		FCommonInventoryCommandController* Controller = nullptr;
+		bool bIsExecuted = false;
+	};
+
+	/** Batches received during the frame in the arrival order. */
+	TArray<FQueuedBatch> QueuedBatches;
+};
@@ -0,0 +1,44 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "Commands/CommonInventorySortCommand.h"
+
+#include "CommonInventoryState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventorySortCommand)
+
+UCommonInventorySortCommand::UCommonInventorySortCommand()
+{
+	ExecutionPolicy = ECommonInventoryCommandExecutionPolicy::Predictive;
+
+	// Only the source state is mutated.
+	bRequiresGameThread = false;
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventorySortCommand::CanExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const
+{
+	return CanAccessInventory(ExecutionContext, ExecutionContext.SourceComponent) ? ECommonInventoryCommandExecutionResult::Success : ECommonInventoryCommandExecutionResult::Failure;
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventorySortCommand::ExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const
+{
+	// The layout is applied at once, so the state is either sorted or untouched.
+	FCommonInventoryState* const InventoryState = GetMutableInventoryState(ExecutionContext.SourceComponent);
+	return InventoryState && InventoryState->SortItems(Payload.bMergeStacks) ? ECommonInventoryCommandExecutionResult::Success : ECommonInventoryCommandExecutionResult::Failure;
+}
+
+void UCommonInventorySortCommand::InitializePayload(FVariadicStruct& OutPayload) const
+{
+	OutPayload = FVariadicStruct::Make(FPayload());
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventorySortCommand::CanExecute(FCommonInventoryCommandExecutionContext& ExecutionContext) const
+{
+	const FPayload* const Payload = ExecutionContext.CommandPayload.GetValuePtr<FPayload>();
+	return CanExecuteTyped(ExecutionContext, Payload ? *Payload : FPayload());
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventorySortCommand::Execute(FCommonInventoryCommandExecutionContext& ExecutionContext) const
+{
+	const FPayload* const Payload = ExecutionContext.CommandPayload.GetValuePtr<FPayload>();
+	return ExecuteTyped(ExecutionContext, Payload ? *Payload : FPayload());
+}
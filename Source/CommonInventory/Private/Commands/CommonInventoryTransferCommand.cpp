@@ -0,0 +1,57 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "Commands/CommonInventoryTransferCommand.h"
+
+#include "CommonInventoryState.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryTransferCommand)
+
+UCommonInventoryTransferCommand::UCommonInventoryTransferCommand()
+{
+	ExecutionPolicy = ECommonInventoryCommandExecutionPolicy::Predictive;
+
+	// Both states are mutated through the context components only.
+	bRequiresGameThread = false;
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventoryTransferCommand::CanExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const
+{
+	if (!CanAccessInventory(ExecutionContext, ExecutionContext.SourceComponent) || !CanAccessInventory(ExecutionContext, ExecutionContext.TargetComponent))
+	{
+		return ECommonInventoryCommandExecutionResult::Failure;
+	}
+
+	if (Payload.SourceSlots.IsEmpty() || (!Payload.Amounts.IsEmpty() && Payload.Amounts.Num() != Payload.SourceSlots.Num()))
+	{
+		return ECommonInventoryCommandExecutionResult::Failure;
+	}
+
+	// The full validation is done by Execute(), which plans the transfer anyway.
+	return ECommonInventoryCommandExecutionResult::Success;
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventoryTransferCommand::ExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const
+{
+	FCommonInventoryState* const SourceState = GetMutableInventoryState(ExecutionContext.SourceComponent);
+	FCommonInventoryState* const TargetState = GetMutableInventoryState(ExecutionContext.TargetComponent);
+
+	// Both states are validated before any change, so a failed transfer leaves them untouched.
+	return SourceState && TargetState && SourceState->TransferItems(*TargetState, Payload.SourceSlots, Payload.Amounts) ? ECommonInventoryCommandExecutionResult::Success : ECommonInventoryCommandExecutionResult::Failure;
+}
+
+void UCommonInventoryTransferCommand::InitializePayload(FVariadicStruct& OutPayload) const
+{
+	OutPayload = FVariadicStruct::Make(FPayload());
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventoryTransferCommand::CanExecute(FCommonInventoryCommandExecutionContext& ExecutionContext) const
+{
+	const FPayload* const Payload = ExecutionContext.CommandPayload.GetValuePtr<FPayload>();
+	return Payload ? CanExecuteTyped(ExecutionContext, *Payload) : ECommonInventoryCommandExecutionResult::Failure;
+}
+
+ECommonInventoryCommandExecutionResult UCommonInventoryTransferCommand::Execute(FCommonInventoryCommandExecutionContext& ExecutionContext) const
+{
+	const FPayload* const Payload = ExecutionContext.CommandPayload.GetValuePtr<FPayload>();
+	return Payload ? ExecuteTyped(ExecutionContext, *Payload) : ECommonInventoryCommandExecutionResult::Failure;
+}
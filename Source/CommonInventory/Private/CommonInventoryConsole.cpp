@@ -20,20 +20,12 @@ static void ExecDumpRegistry(const TArray<FString>& InArgs)
 		{
 			for (const FString& Arg : InArgs)
 			{
-				const FCommonInventoryRegistryRecord* FoundRecord = nullptr;
+				TArray<const FCommonInventoryRegistryRecord*> FoundRecords;
+				Registry->GetRegistryState().FindRecordsByNameSubstring(Arg, FoundRecords, /* MaxResults */ 1);
 
-				for (const FCommonInventoryRegistryRecord& Record : Registry->GetRegistryRecords())
+				if (!FoundRecords.IsEmpty())
 				{
-					if (Record.GetPrimaryAssetName().ToString().Find(Arg, ESearchCase::IgnoreCase) != INDEX_NONE)
-					{
-						FoundRecord = &Record;
-						break;
-					}
-				}
-
-				if (FoundRecord)
-				{
-					FoundRecord->Dump();
+					FoundRecords[0]->Dump();
 				}
 				else
 				{
@@ -51,6 +43,51 @@ static FAutoConsoleCommand CVarRegistryDump(
 	ECVF_Cheat
 );
 
+static void ExecMemReport()
+{
+	if (const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
+	{
+		const FCommonInventoryRegistryState::FMemoryStats Stats = Registry->GetRegistryState().GetMemoryStats();
+
+		COMMON_INVENTORY_LOG(Display, "Registry memory: %.2f KiB in %d records.", Stats.GetTotalBytes() / 1024.f, Registry->GetRegistryState().GetRecordsNum());
+		COMMON_INVENTORY_LOG(Display, "  Records: %.2f KiB.", Stats.DataContainerBytes / 1024.f);
+		COMMON_INVENTORY_LOG(Display, "  CustomData: %.2f KiB.", Stats.CustomDataBytes / 1024.f);
+		COMMON_INVENTORY_LOG(Display, "  Lookups: %.2f KiB.", Stats.LookupBytes / 1024.f);
+		COMMON_INVENTORY_LOG(Display, "  Indices: %.2f KiB.", Stats.IndexBytes / 1024.f);
+		COMMON_INVENTORY_LOG(Display, "  Payloads: %d inline, %d heap.", Stats.NumInlinePayloads, Stats.NumHeapPayloads);
+
+		TArray<TPair<FPrimaryAssetType, SIZE_T>> ArchetypeBytes = Stats.ArchetypeBytes.Array();
+		ArchetypeBytes.Sort([](const TPair<FPrimaryAssetType, SIZE_T>& Lhs, const TPair<FPrimaryAssetType, SIZE_T>& Rhs)
+			{
+				return Lhs.Value > Rhs.Value;
+			});
+
+		for (const auto& [Archetype, Bytes] : ArchetypeBytes)
+		{
+			COMMON_INVENTORY_LOG(Display, "  Archetype '%s': %.2f KiB.", *Archetype.ToString(), Bytes / 1024.f);
+		}
+
+		COMMON_INVENTORY_LOG(Display, "Redirects: %.2f KiB.", FCommonInventoryRedirects::Get().GetAllocatedSize() / 1024.f);
+		COMMON_INVENTORY_LOG(Display, "Snapshots: %.2f KiB.", Registry->GetSnapshotsAllocatedSize() / 1024.f);
+
+		if (const SIZE_T PeakRefreshBytes = Registry->GetPeakRefreshBytes(); PeakRefreshBytes > 0)
+		{
+			COMMON_INVENTORY_LOG(Display, "Peak during refresh: %.2f KiB.", PeakRefreshBytes / 1024.f);
+		}
+		else
+		{
+			COMMON_INVENTORY_LOG(Display, "Peak during refresh: not tracked. Enable CommonInventory.TrackRefreshMemory and refresh the registry.");
+		}
+	}
+}
+
+static FAutoConsoleCommand CVarRegistryMemReport(
+	TEXT("CommonInventory.MemReport"),
+	TEXT("Reports memory used by the registry state, redirects and snapshots."),
+	FConsoleCommandDelegate::CreateStatic(ExecMemReport),
+	ECVF_Cheat
+);
+
 static void ExecForceRefreshRegistry()
 {
 	if (UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
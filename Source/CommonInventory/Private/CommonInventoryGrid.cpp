@@ -0,0 +1,184 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "CommonInventoryGrid.h"
+
+#include "InventoryRegistry/CommonInventoryRegistry.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryGrid)
+
+/************************************************************************/
+/* FCommonInventoryFootprint                                            */
+/************************************************************************/
+
+FCommonInventoryFootprint FCommonInventoryFootprint::FindForItem(FPrimaryAssetId InPrimaryAssetId)
+{
+	if (const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
+	{
+		if (const FCommonInventoryRegistryRecord* const Record = Registry->GetRegistryRecord(InPrimaryAssetId))
+		{
+			if (const FCommonInventoryFootprint* const Footprint = Record->CustomData.GetPtr<const FCommonInventoryFootprint>(); Footprint && Footprint->IsValid())
+			{
+				return *Footprint;
+			}
+		}
+	}
+
+	return FCommonInventoryFootprint();
+}
+
+bool FCommonInventoryFootprint::IsValid() const
+{
+	return Width >= 1 && Width <= MaxExtent && Height >= 1 && Height <= MaxExtent && (GetBits() & 1) != 0;
+}
+
+uint64 FCommonInventoryFootprint::GetBits() const
+{
+	const uint64 RowMask = (uint64(1) << FMath::Min<int32>(Width, MaxExtent)) - 1;
+	uint64 RectBits = 0;
+
+	for (int32 Row = 0; Row < FMath::Min<int32>(Height, MaxExtent); ++Row)
+	{
+		RectBits |= RowMask << (Row * MaxExtent);
+	}
+
+	return Shape != 0 ? Shape & RectBits : RectBits;
+}
+
+/************************************************************************/
+/* FCommonInventoryGrid                                                 */
+/************************************************************************/
+
+void FCommonInventoryGrid::Initialize(int32 InWidth, int32 InHeight)
+{
+	checkf(InWidth > 0 && InWidth <= MaxWidth && InHeight >= 0, TEXT("FCommonInventoryGrid: Invalid grid size %dx%d."), InWidth, InHeight);
+
+	Width = InWidth;
+	Height = InHeight;
+	Reset();
+}
+
+void FCommonInventoryGrid::Reset()
+{
+	// Bits beyond the width are set, so shifted free masks never report them.
+	const uint64 OutOfBoundsBits = Width >= MaxWidth ? 0 : ~((uint64(1) << Width) - 1);
+
+	Rows.Init(OutOfBoundsBits, Height);
+	Anchors.Init(INDEX_NONE, Width * Height);
+	NumFreeCells = Width * Height;
+}
+
+bool FCommonInventoryGrid::IsWithinBounds(const FCommonInventoryFootprint& InFootprint, int32 InCell) const
+{
+	return Anchors.IsValidIndex(InCell) && InCell % Width + InFootprint.Width <= Width && InCell / Width + InFootprint.Height <= Height;
+}
+
+bool FCommonInventoryGrid::CanPlace(const FCommonInventoryFootprint& InFootprint, int32 InCell, int32 InIgnoredAnchor /* = INDEX_NONE */) const
+{
+	if (!InFootprint.IsValid() || !IsWithinBounds(InFootprint, InCell))
+	{
+		return false;
+	}
+
+	const int32 Column = InCell % Width;
+	const int32 FirstRow = InCell / Width;
+
+	for (int32 Row = 0; Row < InFootprint.Height; ++Row)
+	{
+		// Bits beyond the width are never overlapped, as the footprint is within bounds.
+		for (uint64 OverlapBits = Rows[FirstRow + Row] & GetRowMask(InFootprint, Row, Column); OverlapBits != 0; OverlapBits &= OverlapBits - 1)
+		{
+			if (InIgnoredAnchor == INDEX_NONE || Anchors[(FirstRow + Row) * Width + FMath::CountTrailingZeros64(OverlapBits)] != InIgnoredAnchor)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+int32 FCommonInventoryGrid::FindFirstFit(const FCommonInventoryFootprint& InFootprint) const
+{
+	if (!InFootprint.IsValid() || InFootprint.Width > Width || InFootprint.Height > Height || InFootprint.GetNumCells() > NumFreeCells)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 NumColumns = Width - InFootprint.Width + 1;
+	const uint64 ColumnsMask = NumColumns >= MaxWidth ? ~uint64(0) : (uint64(1) << NumColumns) - 1;
+
+	for (int32 FirstRow = 0; FirstRow + InFootprint.Height <= Height; ++FirstRow)
+	{
+		uint64 Candidates = ColumnsMask;
+
+		// A column remains a candidate only if each cell of the footprint is free when anchored at it.
+		for (int32 Row = 0; Row < InFootprint.Height && Candidates != 0; ++Row)
+		{
+			const uint64 FreeBits = ~Rows[FirstRow + Row];
+
+			for (uint32 RowBits = InFootprint.GetRowBits(Row); RowBits != 0; RowBits &= RowBits - 1)
+			{
+				Candidates &= FreeBits >> FMath::CountTrailingZeros(RowBits);
+			}
+		}
+
+		if (Candidates != 0)
+		{
+			return FirstRow * Width + static_cast<int32>(FMath::CountTrailingZeros64(Candidates));
+		}
+	}
+
+	return INDEX_NONE;
+}
+
+void FCommonInventoryGrid::Place(const FCommonInventoryFootprint& InFootprint, int32 InCell)
+{
+	check(CanPlace(InFootprint, InCell));
+
+	const int32 Column = InCell % Width;
+	const int32 FirstRow = InCell / Width;
+
+	for (int32 Row = 0; Row < InFootprint.Height; ++Row)
+	{
+		Rows[FirstRow + Row] |= GetRowMask(InFootprint, Row, Column);
+	}
+
+	NumFreeCells -= InFootprint.GetNumCells();
+	SetAnchors(InFootprint, InCell, InCell);
+}
+
+void FCommonInventoryGrid::Remove(int32 InAnchor)
+{
+	if (!Anchors.IsValidIndex(InAnchor) || Anchors[InAnchor] != InAnchor)
+	{
+		return;
+	}
+
+	const int32 Column = InAnchor % Width;
+	const int32 FirstRow = InAnchor / Width;
+
+	// Footprints never exceed the extent, so only the bounding rectangle is scanned.
+	for (int32 Row = FirstRow; Row < FMath::Min(FirstRow + FCommonInventoryFootprint::MaxExtent, Height); ++Row)
+	{
+		for (int32 Col = Column; Col < FMath::Min(Column + FCommonInventoryFootprint::MaxExtent, Width); ++Col)
+		{
+			if (int32& Anchor = Anchors[Row * Width + Col]; Anchor == InAnchor)
+			{
+				Anchor = INDEX_NONE;
+				Rows[Row] &= ~(uint64(1) << Col);
+				++NumFreeCells;
+			}
+		}
+	}
+}
+
+void FCommonInventoryGrid::SetAnchors(const FCommonInventoryFootprint& InFootprint, int32 InCell, int32 InAnchor)
+{
+	for (int32 Row = 0; Row < InFootprint.Height; ++Row)
+	{
+		for (uint32 RowBits = InFootprint.GetRowBits(Row); RowBits != 0; RowBits &= RowBits - 1)
+		{
+			Anchors[InCell + Row * Width + FMath::CountTrailingZeros(RowBits)] = InAnchor;
+		}
+	}
+}
@@ -2,10 +2,18 @@
 
 #include "CommonInventoryReplication.h"
 
+#include "Commands/CommonInventoryCommand.h"
+#include "CommonInventoryLog.h"
+#include "CommonInventorySettings.h"
+#include "CommonInventoryTrace.h"
+#include "Components/CommonInventoryComponent.h"
+#include "InventoryRegistry/CommonInventoryRegistry.h"
+
+#include "Algo/Sort.h"
 #include "Engine/World.h"
+#include "TimerManager.h"
 #include "GameFramework/GameModeBase.h"
 #include "GameFramework/PlayerController.h"
-#include "GameFramework/PlayerState.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryReplication)
 
@@ -28,36 +36,391 @@ void UCommonInventoryReplication::Initialize(FSubsystemCollectionBase& Collectio
 {
 	Super::Initialize(Collection);
 
-	// Automatically assign a unique listen group for each player based on PlayerId.
+	// Automatically assign a compact listener id for each player.
 	FGameModeEvents::OnGameModePostLoginEvent().AddUObject(this, &ThisClass::OnPostLogin);
 	FGameModeEvents::OnGameModeLogoutEvent().AddUObject(this, &ThisClass::OnLogout);
+
+	const UClass* const PrefetcherClass = UCommonInventorySettings::Get()->PrefetcherClassName.TryLoadClass<UCommonInventoryPrefetcher>();
+	Prefetcher = NewObject<UCommonInventoryPrefetcher>(this, PrefetcherClass ? PrefetcherClass : UCommonInventoryPrefetcher::StaticClass());
+}
+
+void UCommonInventoryReplication::OnWorldBeginPlay(UWorld& InWorld)
+{
+	Super::OnWorldBeginPlay(InWorld);
+
+	InWorld.GetTimerManager().SetTimer(PrefetchTimerHandle, FTimerDelegate::CreateUObject(this, &ThisClass::UpdatePrefetching), UCommonInventorySettings::Get()->PrefetchUpdateInterval, /* bLoop */ true);
 }
 
 void UCommonInventoryReplication::Deinitialize()
 {
 	Super::Deinitialize();
 
+	GetWorld()->GetTimerManager().ClearTimer(PrefetchTimerHandle);
+
 	FGameModeEvents::OnGameModePostLoginEvent().RemoveAll(this);
 	FGameModeEvents::OnGameModeLogoutEvent().RemoveAll(this);
 }
 
-FName UCommonInventoryReplication::GetInventoryNetGroupForPlayer(const APlayerController* InPlayerController) const
+int32 UCommonInventoryReplication::GetListenerId(const APlayerController* InPlayerController) const
+{
+	return ListenerIds.FindRef(InPlayerController, INDEX_NONE);
+}
+
+APlayerController* UCommonInventoryReplication::GetListener(int32 InListenerId) const
+{
+	return Listeners.IsValidIndex(InListenerId) ? Listeners[InListenerId].PlayerController.Get() : nullptr;
+}
+
+void UCommonInventoryReplication::AddListenedInventory(int32 InListenerId, UCommonInventoryComponent* InComponent)
+{
+	Listeners[InListenerId].Inventories.Add(InComponent);
+}
+
+void UCommonInventoryReplication::RemoveListenedInventory(int32 InListenerId, UCommonInventoryComponent* InComponent)
+{
+	Listeners[InListenerId].Inventories.RemoveSingleSwap(InComponent, EAllowShrinking::No);
+}
+
+void UCommonInventoryReplication::UpdatePrefetching()
 {
-	return NetGroups.FindRef(InPlayerController, NAME_None);
+	Prefetcher->UpdatePrefetching(GetWorld()->GetTimerManager().GetTimerRate(PrefetchTimerHandle));
 }
 
 void UCommonInventoryReplication::OnPostLogin(AGameModeBase*, APlayerController* InPlayerController)
 {
-	if (InPlayerController && InPlayerController->PlayerState)
+	if (InPlayerController)
+	{
+		// Assign a compact listener id, which indexes listener bitsets of inventories.
+		const int32 ListenerId = FreeListenerIds.IsEmpty() ? Listeners.AddDefaulted() : FreeListenerIds.Pop(EAllowShrinking::No);
+		Listeners[ListenerId].PlayerController = InPlayerController;
+		ListenerIds.Add(InPlayerController, ListenerId);
+
+		Prefetcher->AddPlayer(InPlayerController);
+	}
+
+#if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+	// Verify the registry state once per connection instead of sending a checksum with each item.
+	if (InPlayerController && !InPlayerController->IsLocalController())
 	{
-		InPlayerController->IncludeInNetConditionGroup(NetGroups.Emplace(InPlayerController, FName(PlayerNetGroup, InPlayerController->PlayerState->GetPlayerId())));
+		UCommonInventoryRegistryHandshake* const Handshake = NewObject<UCommonInventoryRegistryHandshake>(InPlayerController);
+		Handshake->RegisterComponent();
 	}
+#endif
 }
 
 void UCommonInventoryReplication::OnLogout(AGameModeBase*, AController* InController)
 {
 	if (APlayerController* const PlayerController = Cast<APlayerController>(InController))
 	{
-		PlayerController->RemoveFromNetConditionGroup(NetGroups.FindAndRemoveChecked(PlayerController));
+		Prefetcher->RemovePlayer(PlayerController);
+
+		if (const int32 ListenerId = GetListenerId(PlayerController); ListenerId != INDEX_NONE)
+		{
+			// The id might be reused by the next player, so clear it from all the inventories.
+			const TArray<TWeakObjectPtr<UCommonInventoryComponent>> Inventories = MoveTemp(Listeners[ListenerId].Inventories);
+
+			for (const TWeakObjectPtr<UCommonInventoryComponent>& Inventory : Inventories)
+			{
+				if (UCommonInventoryComponent* const Component = Inventory.Get())
+				{
+					Component->UnregisterInventoryListener(PlayerController);
+				}
+			}
+
+			Listeners[ListenerId] = FListener();
+			FreeListenerIds.Add(ListenerId);
+			ListenerIds.Remove(PlayerController);
+		}
+	}
+}
+
+/************************************************************************/
+/* UCommonInventoryRegistryHandshake                                    */
+/************************************************************************/
+
+UCommonInventoryRegistryHandshake::UCommonInventoryRegistryHandshake()
+{
+	SetIsReplicatedByDefault(true);
+}
+
+void UCommonInventoryRegistryHandshake::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// Only the owning client reports its registry state.
+	if (const APlayerController* const PlayerController = Cast<APlayerController>(GetOwner()); PlayerController && PlayerController->IsLocalController() && GetNetMode() == NM_Client)
+	{
+		UCommonInventoryRegistry::CallOrRegister_OnInventoryRegistryInitialized(FSimpleMulticastDelegate::FDelegate::CreateWeakLambda(this, [this]()
+			{
+				SendRegistryChecksums();
+			}));
+	}
+}
+
+void UCommonInventoryRegistryHandshake::SendRegistryChecksums()
+{
+	const FCommonInventoryRegistryState& RegistryState = UCommonInventoryRegistry::Get().GetRegistryState();
+
+	TArray<FPrimaryAssetType, TInlineAllocator<16>> Archetypes;
+	RegistryState.GetArchetypes(Archetypes);
+
+	TArray<FCommonInventoryArchetypeChecksum> ArchetypeChecksums;
+	ArchetypeChecksums.Reserve(Archetypes.Num());
+
+	for (const FPrimaryAssetType Archetype : Archetypes)
+	{
+		ArchetypeChecksums.Add({ Archetype, RegistryState.GetArchetypeChecksum(Archetype) });
+	}
+
+	ServerVerifyRegistry(ArchetypeChecksums, UCommonInventoryCommand::GetCommandTableChecksum());
+}
+
+void UCommonInventoryRegistryHandshake::ServerVerifyRegistry_Implementation(const TArray<FCommonInventoryArchetypeChecksum>& InArchetypeChecksums, uint32 InCommandTableChecksum)
+{
+	// Reject repeated reports.
+	if (bHasVerifiedRegistry)
+	{
+		return;
+	}
+
+	const FCommonInventoryRegistryState& RegistryState = UCommonInventoryRegistry::Get().GetRegistryState();
+
+	TArray<FPrimaryAssetType, TInlineAllocator<16>> Archetypes;
+	RegistryState.GetArchetypes(Archetypes);
+
+	for (const FPrimaryAssetType Archetype : Archetypes)
+	{
+		const FCommonInventoryArchetypeChecksum* const RemoteChecksum = InArchetypeChecksums.FindByPredicate([Archetype](const FCommonInventoryArchetypeChecksum& Item)
+			{
+				return Item.PrimaryAssetType == Archetype;
+			});
+
+		if (!RemoteChecksum || RemoteChecksum->Checksum != RegistryState.GetArchetypeChecksum(Archetype))
+		{
+			MismatchedArchetypes.Add(Archetype);
+		}
+	}
+
+	// Archetypes unknown to the server.
+	for (const FCommonInventoryArchetypeChecksum& RemoteChecksum : InArchetypeChecksums)
+	{
+		if (!Archetypes.Contains(RemoteChecksum.PrimaryAssetType))
+		{
+			MismatchedArchetypes.AddUnique(RemoteChecksum.PrimaryAssetType);
+		}
+	}
+
+	bHasVerifiedRegistry = true;
+
+	// Commands unknown to the other side are rejected, which would look like mispredictions.
+	if ((bHasMatchingCommandTable = InCommandTableChecksum == UCommonInventoryCommand::GetCommandTableChecksum()) == false)
+	{
+		COMMON_INVENTORY_LOG(Warning, "Command table mismatch for '%s': Local(%#x), Remote(%#x). Make sure both sides load the same modules with commands.", *GetNameSafe(GetOwner()), UCommonInventoryCommand::GetCommandTableChecksum(), InCommandTableChecksum);
+	}
+
+	if (!MismatchedArchetypes.IsEmpty())
+	{
+		const FString PlayerName = GetOwner() ? GetOwner()->GetName() : FString();
+		const FString ArchetypesStr = FString::JoinBy(MismatchedArchetypes, TEXT(", "), [](FPrimaryAssetType Archetype) { return Archetype.ToString(); });
+		COMMON_INVENTORY_LOG(Warning, "Registry handshake failed for '%s'. Mismatched archetypes: %s.", *PlayerName, *ArchetypesStr);
+	}
+}
+
+/************************************************************************/
+/* UCommonInventoryPrefetcher                                           */
+/************************************************************************/
+
+void UCommonInventoryPrefetcher::RegisterInventory(UCommonInventoryComponent* InComponent)
+{
+	if (InComponent)
+	{
+		Inventories.AddUnique(InComponent);
 	}
 }
+
+void UCommonInventoryPrefetcher::UnregisterInventory(UCommonInventoryComponent* InComponent)
+{
+	Inventories.RemoveSwap(InComponent);
+
+	for (TPair<TWeakObjectPtr<APlayerController>, FPlayerData>& Player : Players)
+	{
+		if (Player.Value.PrefetchedInventories.Remove(InComponent) > 0)
+		{
+			InComponent->UnregisterInventoryListener(Player.Key.Get());
+		}
+
+		Player.Value.Interactions.Remove(InComponent);
+	}
+}
+
+void UCommonInventoryPrefetcher::AddPlayer(APlayerController* InPlayerController)
+{
+	// Local players don't need any replication.
+	if (InPlayerController && !InPlayerController->IsLocalController())
+	{
+		Players.FindOrAdd(InPlayerController).AvailableBudget = UCommonInventorySettings::Get()->PrefetchBandwidthBudget;
+	}
+}
+
+void UCommonInventoryPrefetcher::RemovePlayer(APlayerController* InPlayerController)
+{
+	FPlayerData PlayerData;
+
+	if (Players.RemoveAndCopyValue(InPlayerController, PlayerData))
+	{
+		for (const TPair<TWeakObjectPtr<UCommonInventoryComponent>, double>& Prefetched : PlayerData.PrefetchedInventories)
+		{
+			if (UCommonInventoryComponent* const Component = Prefetched.Key.Get())
+			{
+				Component->UnregisterInventoryListener(InPlayerController);
+			}
+		}
+	}
+}
+
+void UCommonInventoryPrefetcher::NotifyInteraction(const APlayerController* InPlayerController, const UCommonInventoryComponent* InComponent)
+{
+	if (FPlayerData* const PlayerData = Players.Find(const_cast<APlayerController*>(InPlayerController)); PlayerData && InComponent)
+	{
+		PlayerData->Interactions.Add(InComponent, GetWorld()->GetTimeSeconds());
+	}
+}
+
+void UCommonInventoryPrefetcher::UpdatePrefetching(float DeltaTime)
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryPrefetcher::UpdatePrefetching);
+
+	Inventories.RemoveAllSwap([](const TWeakObjectPtr<UCommonInventoryComponent>& Component)
+		{
+			return !Component.IsValid();
+		});
+
+	for (auto It = Players.CreateIterator(); It; ++It)
+	{
+		if (APlayerController* const PlayerController = It.Key().Get())
+		{
+			UpdatePlayer(PlayerController, It.Value(), DeltaTime);
+		}
+		else
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void UCommonInventoryPrefetcher::UpdatePlayer(APlayerController* InPlayerController, FPlayerData& InPlayerData, float DeltaTime)
+{
+	const UCommonInventorySettings* const Settings = UCommonInventorySettings::Get();
+
+	FCommonInventoryPrefetchContext Context;
+	Context.PlayerController = InPlayerController;
+	Context.Interactions = &InPlayerData.Interactions;
+	Context.Time = GetWorld()->GetTimeSeconds();
+
+	FRotator ViewRotation;
+	InPlayerController->GetPlayerViewPoint(Context.ViewLocation, ViewRotation);
+	Context.ViewDirection = ViewRotation.Vector();
+
+	// Forget old interactions.
+	for (auto It = InPlayerData.Interactions.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().IsValid() || Context.Time - It.Value() > Settings->PrefetchInteractionMemory)
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Gather the best candidates.
+	TArray<TPair<float, UCommonInventoryComponent*>, TInlineAllocator<32>> Candidates;
+
+	for (const TWeakObjectPtr<UCommonInventoryComponent>& WeakComponent : Inventories)
+	{
+		UCommonInventoryComponent* const Component = WeakComponent.Get();
+
+		if (const float Score = ScoreInventory(Context, Component); Score > 0.f)
+		{
+			Candidates.Emplace(Score, Component);
+		}
+	}
+
+	Algo::SortBy(Candidates, &TPair<float, UCommonInventoryComponent*>::Key, TGreater<>());
+	Candidates.SetNum(FMath::Min(Candidates.Num(), Settings->MaxPrefetchedInventories), EAllowShrinking::No);
+
+	// Refill the budget with at most one second worth of bandwidth to bound bursts.
+	InPlayerData.AvailableBudget = FMath::Min(InPlayerData.AvailableBudget + Settings->PrefetchBandwidthBudget * DeltaTime, static_cast<float>(Settings->PrefetchBandwidthBudget));
+
+	for (const TPair<float, UCommonInventoryComponent*>& Candidate : Candidates)
+	{
+		if (double* const LastRelevantTime = InPlayerData.PrefetchedInventories.Find(Candidate.Value))
+		{
+			*LastRelevantTime = Context.Time;
+			continue;
+		}
+
+		// Inventories exceeding the whole budget are still prefetched once the budget is full.
+		const int32 Cost = EstimateInventoryCost(Candidate.Value);
+
+		if (Cost > InPlayerData.AvailableBudget && InPlayerData.AvailableBudget < Settings->PrefetchBandwidthBudget)
+		{
+			// Keep the priority order instead of letting cheaper inventories through.
+			break;
+		}
+
+		InPlayerData.AvailableBudget -= Cost;
+		InPlayerData.PrefetchedInventories.Add(Candidate.Value, Context.Time);
+		Candidate.Value->RegisterInventoryListener(InPlayerController);
+	}
+
+	// Evict inventories which haven't been relevant for a while.
+	for (auto It = InPlayerData.PrefetchedInventories.CreateIterator(); It; ++It)
+	{
+		if (UCommonInventoryComponent* const Component = It.Key().Get())
+		{
+			if (Context.Time - It.Value() > Settings->PrefetchEvictionDelay)
+			{
+				Component->UnregisterInventoryListener(InPlayerController);
+				It.RemoveCurrent();
+			}
+		}
+		else
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+float UCommonInventoryPrefetcher::ScoreInventory(const FCommonInventoryPrefetchContext& InContext, const UCommonInventoryComponent* InComponent) const
+{
+	const UCommonInventorySettings* const Settings = UCommonInventorySettings::Get();
+	const AActor* const Owner = InComponent ? InComponent->GetOwner() : nullptr;
+
+	if (!Owner)
+	{
+		return 0.f;
+	}
+
+	float Score = 0.f;
+
+	if (const double* const InteractionTime = InContext.Interactions->Find(InComponent))
+	{
+		Score += 1.f - FMath::Clamp((InContext.Time - *InteractionTime) / FMath::Max(Settings->PrefetchInteractionMemory, UE_KINDA_SMALL_NUMBER), 0.f, 1.f);
+	}
+
+	const FVector ToInventory = Owner->GetActorLocation() - InContext.ViewLocation;
+	const double Distance = ToInventory.Size();
+
+	if (Distance < Settings->PrefetchRadius)
+	{
+		// Inventories in front of the player are more likely to be interacted with.
+		const double CosAngle = Distance > UE_KINDA_SMALL_NUMBER ? (ToInventory / Distance) | InContext.ViewDirection : 1.0;
+		const float ViewScore = CosAngle >= FMath::Cos(FMath::DegreesToRadians(Settings->PrefetchViewConeAngle)) ? 1.f : .25f;
+		Score += (1.f - Distance / Settings->PrefetchRadius) * ViewScore;
+	}
+
+	return Score;
+}
+
+int32 UCommonInventoryPrefetcher::EstimateInventoryCost(const UCommonInventoryComponent* InComponent) const
+{
+	return FMath::Max(InComponent->GetInventoryState().Num(), 1) * UCommonInventorySettings::Get()->PrefetchBytesPerItem;
+}
@@ -2,12 +2,17 @@
 
 #pragma once
 
+#include "Components/ActorComponent.h"
+#include "Engine/TimerHandle.h"
 #include "Subsystems/WorldSubsystem.h"
+#include "UObject/PrimaryAssetId.h"
 #include "CommonInventoryReplication.generated.h"
 
 class APlayerController;
 class AGameModeBase;
 class AController;
+class UCommonInventoryComponent;
+class UCommonInventoryPrefetcher;
 
 /**
  * A server only subsystem for managing replication specifics.
@@ -19,16 +24,25 @@ class UCommonInventoryReplication : public UWorldSubsystem
 
 	UCommonInventoryReplication() = default;
 
-	/** The default name template for the player NetGroup specialization. */
-	static inline const FName PlayerNetGroup = FName(TEXT("CommonInventoryPlayerNetGroup"));
-
 public:
 
-	// Returns the NetGroup for the provided player.
-	COMMONINVENTORY_API FName GetInventoryNetGroupForPlayer(const APlayerController* InPlayerController) const;
+	// Returns the compact id of the player used to index listener bitsets of inventories, or INDEX_NONE.
+	COMMONINVENTORY_API int32 GetListenerId(const APlayerController* InPlayerController) const;
+
+	// Returns the player assigned to the listener id.
+	COMMONINVENTORY_API APlayerController* GetListener(int32 InListenerId) const;
+
+	// Tracks inventories of the listener, so they can be released on logout.
+	void AddListenedInventory(int32 InListenerId, UCommonInventoryComponent* InComponent);
+	void RemoveListenedInventory(int32 InListenerId, UCommonInventoryComponent* InComponent);
+
+	// Returns the prefetcher responsible for inventories with ECommonInventoryReplicationMode::Auto.
+	UCommonInventoryPrefetcher* GetPrefetcher() const { return Prefetcher; }
 
 private:
 
+	void UpdatePrefetching();
+
 	void OnPostLogin(AGameModeBase*, APlayerController* InPlayerController);
 	void OnLogout(AGameModeBase*, AController* InController);
 
@@ -36,21 +50,163 @@ private:
 	virtual bool DoesSupportWorldType(EWorldType::Type WorldType) const override;
 	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
 	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void OnWorldBeginPlay(UWorld& InWorld) override;
 	virtual void Deinitialize() override;
 
 private:
 
-	TMap<const APlayerController*, FName, TInlineSetAllocator<8>> NetGroups;
+	struct FListener
+	{
+		TWeakObjectPtr<APlayerController> PlayerController;
+		TArray<TWeakObjectPtr<UCommonInventoryComponent>> Inventories;
+	};
+
+	/** Listeners indexed by their ids. Released ids are reused to keep bitsets compact. */
+	TArray<FListener> Listeners;
+	TArray<int32> FreeListenerIds;
+
+	TMap<const APlayerController*, int32, TInlineSetAllocator<8>> ListenerIds;
+
+	UPROPERTY()
+	TObjectPtr<UCommonInventoryPrefetcher> Prefetcher;
+
+	FTimerHandle PrefetchTimerHandle;
+};
+
+/** Checksum of records of the same archetype used in the registry handshake. */
+USTRUCT()
+struct FCommonInventoryArchetypeChecksum
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FPrimaryAssetType PrimaryAssetType;
+
+	UPROPERTY()
+	uint32 Checksum = 0;
 };
 
 /**
- * Excerpt from Satisfactory:
- * This all works very well at the moment, but there is always more we can do.
- * In the future we could work to prefetch inventory data, trying to predict potential targets before you interact with them and fetch them just in case,
- * minimizing or even removing latency. But that is work for another update and can cause serious data spikes if we are not careful.
+ * Verifies the registry state once per connection in builds with COMMON_INVENTORY_WITH_NETWORK_CHECKSUM.
+ * The owning client reports its archetype checksums and the server logs any mismatched archetypes,
+ * which allows items to replicate without a checksum or with a sampled one.
  */
-UCLASS(Abstract, Hidden)
+UCLASS(MinimalAPI, Hidden)
+class UCommonInventoryRegistryHandshake : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+
+	UCommonInventoryRegistryHandshake();
+
+	/** Whether the client has reported its registry state. */
+	bool HasVerifiedRegistry() const { return bHasVerifiedRegistry; }
+
+	/** Returns archetypes which don't match between the server and the client. */
+	TConstArrayView<FPrimaryAssetType> GetMismatchedArchetypes() const { return MismatchedArchetypes; }
+
+	/** Whether the client knows the same native commands, see UCommonInventoryCommand::GetCommandTableChecksum(). */
+	bool HasMatchingCommandTable() const { return bHasMatchingCommandTable; }
+
+protected:
+
+	virtual void BeginPlay() override;
+
+	UFUNCTION(Server, Reliable)
+	void ServerVerifyRegistry(const TArray<FCommonInventoryArchetypeChecksum>& InArchetypeChecksums, uint32 InCommandTableChecksum);
+
+private:
+
+	void SendRegistryChecksums();
+
+private:
+
+	TArray<FPrimaryAssetType> MismatchedArchetypes;
+
+	bool bHasVerifiedRegistry = false;
+
+	bool bHasMatchingCommandTable = false;
+};
+
+/** Player specifics provided to UCommonInventoryPrefetcher for scoring inventories. */
+struct FCommonInventoryPrefetchContext
+{
+	/** The player the inventories are scored for. */
+	const APlayerController* PlayerController = nullptr;
+
+	/** The player viewpoint. */
+	FVector ViewLocation = FVector::ZeroVector;
+	FVector ViewDirection = FVector::ForwardVector;
+
+	/** Recent interactions of the player with inventories and the time they occurred. */
+	const TMap<TWeakObjectPtr<const UCommonInventoryComponent>, double>* Interactions = nullptr;
+
+	/** The current world time. */
+	double Time = 0.0;
+};
+
+/**
+ * Registers connections to inventories with ECommonInventoryReplicationMode::Auto ahead of interaction.
+ * Inventories are scored per player by distance, the view cone and recent interactions, and the best ones
+ * are registered within the per connection bandwidth budget to avoid data spikes. Stale inventories are evicted after a delay.
+ */
+UCLASS(Hidden)
 class COMMONINVENTORY_API UCommonInventoryPrefetcher : public UObject
 {
 	GENERATED_BODY()
+
+public:
+
+	UCommonInventoryPrefetcher() = default;
+
+	/** [Server] Starts tracking the inventory. */
+	void RegisterInventory(UCommonInventoryComponent* InComponent);
+
+	/** [Server] Stops tracking the inventory and unregisters it from all players. */
+	void UnregisterInventory(UCommonInventoryComponent* InComponent);
+
+	/** [Server] Starts prefetching for the player. */
+	void AddPlayer(APlayerController* InPlayerController);
+
+	/** [Server] Stops prefetching for the player and unregisters all the prefetched inventories. */
+	void RemovePlayer(APlayerController* InPlayerController);
+
+	/** [Server] Records the interaction, which boosts the inventory score for the player. */
+	void NotifyInteraction(const APlayerController* InPlayerController, const UCommonInventoryComponent* InComponent);
+
+	/** [Server] Re-scores inventories and updates registrations of all players. */
+	void UpdatePrefetching(float DeltaTime);
+
+protected:
+
+	/** Returns the inventory score for the player. Inventories with non-positive scores aren't prefetched. */
+	virtual float ScoreInventory(const FCommonInventoryPrefetchContext& InContext, const UCommonInventoryComponent* InComponent) const;
+
+	/** Returns the estimated number of bytes for the initial replication of the inventory. */
+	virtual int32 EstimateInventoryCost(const UCommonInventoryComponent* InComponent) const;
+
+private:
+
+	struct FPlayerData
+	{
+		/** Prefetched inventories and the last time they were relevant. */
+		TMap<TWeakObjectPtr<UCommonInventoryComponent>, double> PrefetchedInventories;
+
+		/** Recent interactions and the time they occurred. */
+		TMap<TWeakObjectPtr<const UCommonInventoryComponent>, double> Interactions;
+
+		/** Available bandwidth budget in bytes, refilled over time. */
+		float AvailableBudget = 0.f;
+	};
+
+	void UpdatePlayer(APlayerController* InPlayerController, FPlayerData& InPlayerData, float DeltaTime);
+
+private:
+
+	/** All tracked inventories. */
+	TArray<TWeakObjectPtr<UCommonInventoryComponent>> Inventories;
+
+	/** Prefetching state of each player. */
+	TMap<TWeakObjectPtr<APlayerController>, FPlayerData> Players;
 };
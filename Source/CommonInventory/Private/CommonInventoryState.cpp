@@ -2,7 +2,22 @@
 
 #include "CommonInventoryState.h"
 
+#include "CommonInventoryLog.h"
+#include "CommonInventorySettings.h"
+#include "CommonInventoryTrace.h"
 #include "InventoryRegistry/CommonInventoryRegistry.h"
+#include "Net/CommonInventoryNetProfiler.h"
+
+#include "Algo/Find.h"
+#include "Algo/ForEach.h"
+#include "Algo/Sort.h"
+#include "Algo/StableSort.h"
+#include "CoreGlobals.h"
+#include "Misc/Optional.h"
+#include "Misc/ScopeExit.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "UObject/UnrealType.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryState)
 
@@ -12,12 +27,66 @@
 
 bool FCommonInventoryItem::Serialize(FArchive& Ar)
 {
-	return false;
+	bool bIsEmpty = IsEmpty();
+	Ar.SerializeBits(&bIsEmpty, 1);
+
+	if (bIsEmpty)
+	{
+		if (Ar.IsLoading())
+		{
+			Empty();
+		}
+
+		return true;
+	}
+
+	Ar << StackSize;
+
+	if (UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
+	{
+		Registry->SerializeItem(Ar, PrimaryAssetId, ItemPayload);
+
+#if WITH_EDITOR
+		FCommonInventoryDefaultsPropagator::Get().RecordItemReference(Ar, PrimaryAssetId);
+#endif
+	}
+	else
+	{
+		ItemPayload.Serialize(Ar << PrimaryAssetId);
+	}
+
+	// The item might have been removed from the registry.
+	if (Ar.IsLoading() && IsEmpty())
+	{
+		Empty();
+	}
+
+	return true;
 }
 
-bool FCommonInventoryItem::NetSerialize(FArchive& Ar, UPackageMap*, bool& bOutSuccess)
+bool FCommonInventoryItem::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
 {
-	bOutSuccess = false;
+	// UInventoryRegistry interface will set bOutSuccess and do logging for us.
+	const UCommonInventoryRegistry& Registry = UCommonInventoryRegistry::Get();
+	auto Context = Registry.NetSerializeItem(Ar, PrimaryAssetId, bOutSuccess, Map);
+	Registry.NetSerializeItemPayload(Ar, ItemPayload, Context);
+
+	// Empty slots don't replicate the free list link. The writer decides, as the reader might fail to resolve the item.
+	bool bIsOccupied = !IsEmpty();
+	Ar.SerializeBits(&bIsOccupied, 1);
+
+	if (bIsOccupied)
+	{
+		uint32 PackedStackSize = static_cast<uint32>(StackSize);
+		Ar.SerializeIntPacked(PackedStackSize);
+		StackSize = static_cast<int32>(PackedStackSize);
+	}
+
+	if (Ar.IsLoading() && (!bIsOccupied || IsEmpty()))
+	{
+		StackSize = 0;
+	}
+
 	return true;
 }
 
@@ -25,22 +94,1973 @@ bool FCommonInventoryItem::NetSerialize(FArchive& Ar, UPackageMap*, bool& bOutSu
 /* FCommonInventoryState                                                */
 /************************************************************************/
 
-void FCommonInventoryState::Initialize(uint32 InInitialCapacity)
+void FCommonInventoryState::Initialize(uint32 InInitialCapacity, ECommonInventoryStateFlags InFlags)
+{
+	Items.Reset();
+	Size = 0;
+	Capacity = 0;
+	FreeSlot = INDEX_NONE;
+	SlotIndex.Reset();
+	IndexedSlotIds.Reset();
+	InternalFlags = InFlags & ~ECommonInventoryStateFlags::Spatial;
+	Grid = FCommonInventoryGrid();
+	LastSnapshot.Reset();
+	DirtySnapshotChunks.Reset();
+
+	Grow(static_cast<int32>(InInitialCapacity));
+	RebuildAggregates();
+}
+
+void FCommonInventoryState::InitializeSpatial(int32 InWidth, int32 InHeight, ECommonInventoryStateFlags InFlags)
+{
+	checkf(InWidth > 0 && InWidth <= FCommonInventoryGrid::MaxWidth && InHeight > 0, TEXT("FCommonInventoryState: Invalid grid size %dx%d."), InWidth, InHeight);
+
+	// The layout is fixed, so the grid can't grow.
+	Initialize(0, InFlags & ~ECommonInventoryStateFlags::Automatic);
+	InternalFlags |= ECommonInventoryStateFlags::Spatial;
+	Grid.Initialize(InWidth, InHeight);
+	Grow(InWidth * InHeight);
+}
+
+void FCommonInventoryState::Deinitialize()
+{
+	Items.Empty();
+	Size = 0;
+	Capacity = 0;
+	FreeSlot = INDEX_NONE;
+	SlotIndex.Empty();
+	IndexedSlotIds.Empty();
+	Grid = FCommonInventoryGrid();
+	LastSnapshot.Reset();
+	DirtySnapshotChunks.Empty();
+	RebuildAggregates();
+	MarkArrayDirty();
+}
+
+int32 FCommonInventoryState::FindItem(FPrimaryAssetId InPrimaryAssetId) const
+{
+	const auto* const Slots = SlotIndex.Find(InPrimaryAssetId);
+	return Slots ? (*Slots)[0] : INDEX_NONE;
+}
+
+TConstArrayView<int32> FCommonInventoryState::FindItems(FPrimaryAssetId InPrimaryAssetId) const
+{
+	const auto* const Slots = SlotIndex.Find(InPrimaryAssetId);
+	return Slots ? TConstArrayView<int32>(*Slots) : TConstArrayView<int32>();
+}
+
+int32 FCommonInventoryState::FindNonFullStack(FPrimaryAssetId InPrimaryAssetId) const
+{
+	const TConstArrayView<int32> Slots = FindItems(InPrimaryAssetId);
+
+	if (Slots.IsEmpty() || EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::StackUnlimited))
+	{
+		return Slots.IsEmpty() ? INDEX_NONE : Slots[0];
+	}
+
+	const int32 MaxStackSize = UCommonInventoryRegistry::Get().GetMaxStackSize(InPrimaryAssetId);
+	const int32* const FoundSlot = Algo::FindByPredicate(Slots, [this, MaxStackSize](int32 Slot)
+		{
+			return Items[Slot].StackSize < MaxStackSize;
+		});
+
+	return FoundSlot ? *FoundSlot : INDEX_NONE;
+}
+
+int32 FCommonInventoryState::AddItem(const FCommonItem& InItem, int32 InStackSize)
+{
+	if (IsSpatial())
+	{
+		return AddItemAt(InItem, InStackSize, FindFirstFit(InItem.GetPrimaryAssetId()));
+	}
+
+	if (!InItem.IsValid() || InStackSize <= 0)
+	{
+		return INDEX_NONE;
+	}
+
+	if (EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::NoDuplicates) && ContainsItem(InItem.GetPrimaryAssetId()))
+	{
+		return INDEX_NONE;
+	}
+
+	if (FreeSlot == INDEX_NONE)
+	{
+		const int32 CapacityLimit = UCommonInventorySettings::Get()->InventoryCapacityLimit;
+
+		if (!EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::Automatic) || Items.Num() >= CapacityLimit)
+		{
+			return INDEX_NONE;
+		}
+
+		Grow(FMath::Min(FMath::Max(Items.Num() * 2, 4), CapacityLimit));
+	}
+
+	const int32 Slot = FreeSlot;
+	FCommonInventoryPredictionScope::CaptureSlot(*this, Slot);
+	FCommonInventoryItem& Item = Items[Slot];
+	FreeSlot = Item.GetNextFreeSlot();
+
+	Item.PrimaryAssetId = InItem.GetPrimaryAssetId();
+	Item.ItemPayload = InItem.GetPayload();
+	Item.StackSize = InStackSize;
+	AddToSlotIndex(Item.PrimaryAssetId, Slot);
+	++Size;
+
+	// Only the slot itself is dirtied, other slots keep their replication keys.
+	MarkItemDirty(Item);
+	NotifySlotChanged(Slot);
+	return Slot;
+}
+
+bool FCommonInventoryState::RemoveItem(int32 InSlot)
+{
+	if (!Items.IsValidIndex(InSlot) || Items[InSlot].IsEmpty())
+	{
+		return false;
+	}
+
+	FCommonInventoryPredictionScope::CaptureSlot(*this, InSlot);
+	FCommonInventoryItem& Item = Items[InSlot];
+	RemoveFromSlotIndex(Item.PrimaryAssetId, InSlot);
+	Item.Empty();
+	PushFreeSlot(InSlot);
+	Grid.Remove(InSlot);
+	--Size;
+
+	MarkItemDirty(Item);
+	NotifySlotChanged(InSlot);
+	return true;
+}
+
+bool FCommonInventoryState::SetStackSize(int32 InSlot, int32 InStackSize)
+{
+	if (!Items.IsValidIndex(InSlot) || Items[InSlot].IsEmpty())
+	{
+		return false;
+	}
+
+	if (InStackSize <= 0)
+	{
+		return RemoveItem(InSlot);
+	}
+
+	FCommonInventoryItem& Item = Items[InSlot];
+
+	if (Item.StackSize != InStackSize)
+	{
+		FCommonInventoryPredictionScope::CaptureSlot(*this, InSlot);
+		Item.StackSize = InStackSize;
+		MarkItemDirty(Item);
+		NotifySlotChanged(InSlot);
+	}
+
+	return true;
+}
+
+bool FCommonInventoryState::SortItems(bool bMergeStacks /* = true */)
 {
-	Items.AddDefaulted(InInitialCapacity);
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::SortItems);
+
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	if (!Registry)
+	{
+		return false;
+	}
+
+	// Unknown items go last.
+	constexpr int32 UnknownRecordIndex = MAX_int32;
+
+	struct FSortEntry
+	{
+		int32 Slot = INDEX_NONE;
+		int32 RecordIndex = UnknownRecordIndex;
+		int32 MaxStackSize = 0;
+		int32 Group = INDEX_NONE;
+	};
+
+	TArray<FSortEntry, TInlineAllocator<64>> Entries;
+	TArray<FPrimaryAssetId, TInlineAllocator<64>> PrimaryAssetIds;
 
 	for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
 	{
-		Items[Idx].SetOffset(Idx);
+		if (!Items[Idx].IsEmpty())
+		{
+			Entries.Add({ Idx });
+			PrimaryAssetIds.Add(Items[Idx].PrimaryAssetId);
+		}
+	}
+
+	// Resolve the sort keys with a single registry lookup per item.
+	{
+		TArray<int32, TInlineAllocator<64>> RecordIndices;
+		TArray<int32, TInlineAllocator<64>> MaxStackSizes;
+		RecordIndices.SetNumUninitialized(Entries.Num());
+		MaxStackSizes.SetNumUninitialized(Entries.Num());
+		Registry->GetRecordIndices(PrimaryAssetIds, RecordIndices, MaxStackSizes);
+
+		for (int32 Idx = 0; Idx < Entries.Num(); ++Idx)
+		{
+			Entries[Idx].RecordIndex = RecordIndices[Idx] != INDEX_NONE ? RecordIndices[Idx] : UnknownRecordIndex;
+			Entries[Idx].MaxStackSize = EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::StackUnlimited) ? MAX_int32 : MaxStackSizes[Idx];
+		}
+	}
+
+	// Records are stored in the archetype and name order, so the record index is the primary key.
+	Algo::Sort(Entries, [](const FSortEntry& Lhs, const FSortEntry& Rhs)
+		{
+			return Lhs.RecordIndex != Rhs.RecordIndex ? Lhs.RecordIndex < Rhs.RecordIndex : Lhs.Slot < Rhs.Slot;
+		});
+
+	// Group identical payloads of the same item by the first occurrence.
+	for (int32 RunBegin = 0, RunEnd = 0; RunBegin < Entries.Num(); RunBegin = RunEnd)
+	{
+		for (RunEnd = RunBegin + 1; RunEnd < Entries.Num() && Entries[RunEnd].RecordIndex == Entries[RunBegin].RecordIndex && Entries[RunBegin].RecordIndex != UnknownRecordIndex; ++RunEnd);
+
+		for (int32 Idx = RunBegin; Idx < RunEnd; ++Idx)
+		{
+			const FVariadicStruct& Payload = Items[Entries[Idx].Slot].ItemPayload;
+			Entries[Idx].Group = Idx;
+
+			for (int32 GroupIdx = RunBegin; GroupIdx < Idx; ++GroupIdx)
+			{
+				if (Entries[GroupIdx].Group == GroupIdx && Items[Entries[GroupIdx].Slot].ItemPayload.Identical(&Payload, PPF_None))
+				{
+					Entries[Idx].Group = GroupIdx;
+					break;
+				}
+			}
+		}
+	}
+
+	Algo::StableSort(Entries, [](const FSortEntry& Lhs, const FSortEntry& Rhs) { return Lhs.Group < Rhs.Group; });
+
+	// The target layout refers to the source slots, as payloads of merged stacks are identical.
+	struct FTarget
+	{
+		int32 SourceSlot = INDEX_NONE;
+		int32 StackSize = 0;
+	};
+
+	TArray<FTarget, TInlineAllocator<64>> Targets;
+	Targets.Reserve(Entries.Num());
+
+	for (int32 GroupBegin = 0, GroupEnd = 0; GroupBegin < Entries.Num(); GroupBegin = GroupEnd)
+	{
+		for (GroupEnd = GroupBegin + 1; GroupEnd < Entries.Num() && Entries[GroupEnd].Group == Entries[GroupBegin].Group; ++GroupEnd);
+
+		const int32 MaxStackSize = Entries[GroupBegin].MaxStackSize;
+		int64 TotalStackSize = 0;
+
+		for (int32 Idx = GroupBegin; Idx < GroupEnd; ++Idx)
+		{
+			TotalStackSize += Items[Entries[Idx].Slot].StackSize;
+		}
+
+		// Oversized stacks are kept as is rather than split into more slots.
+		const int64 NumMergedStacks = MaxStackSize > 0 ? (TotalStackSize + MaxStackSize - 1) / MaxStackSize : MAX_int64;
+
+		if (bMergeStacks && NumMergedStacks <= GroupEnd - GroupBegin)
+		{
+			for (int32 Idx = GroupBegin; TotalStackSize > 0; ++Idx)
+			{
+				const int32 StackSize = static_cast<int32>(FMath::Min<int64>(TotalStackSize, MaxStackSize));
+				Targets.Add({ Entries[Idx].Slot, StackSize });
+				TotalStackSize -= StackSize;
+			}
+		}
+		else
+		{
+			for (int32 Idx = GroupBegin; Idx < GroupEnd; ++Idx)
+			{
+				Targets.Add({ Entries[Idx].Slot, Items[Entries[Idx].Slot].StackSize });
+			}
+		}
+	}
+
+	// Assign the target slots.
+	TArray<FTarget, TInlineAllocator<64>> Layout;
+	Layout.SetNum(Items.Num());
+
+	if (IsSpatial())
+	{
+		FCommonInventoryGrid NewGrid;
+		NewGrid.Initialize(Grid.GetWidth(), Grid.GetHeight());
+
+		for (const FTarget& Target : Targets)
+		{
+			const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(Items[Target.SourceSlot].PrimaryAssetId);
+			const int32 Cell = NewGrid.FindFirstFit(Footprint);
+
+			if (Cell == INDEX_NONE)
+			{
+				return false;
+			}
+
+			NewGrid.Place(Footprint, Cell);
+			Layout[Cell] = Target;
+		}
+	}
+	else
+	{
+		for (int32 Idx = 0; Idx < Targets.Num(); ++Idx)
+		{
+			Layout[Idx] = Targets[Idx];
+		}
+	}
+
+	// Copy the changed slots before writing, as their sources might be overwritten.
+	TArray<TPair<int32, FCommonInventoryItem>, TInlineAllocator<64>> Writes;
+
+	for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+	{
+		const FTarget& Target = Layout[Idx];
+		const FCommonInventoryItem& Item = Items[Idx];
+
+		if (Target.SourceSlot == INDEX_NONE)
+		{
+			if (!Item.IsEmpty())
+			{
+				Writes.Emplace(Idx, FCommonInventoryItem());
+			}
+
+			continue;
+		}
+
+		const FCommonInventoryItem& SourceItem = Items[Target.SourceSlot];
+		const bool bIsSameItem = Target.SourceSlot == Idx || (Item.PrimaryAssetId == SourceItem.PrimaryAssetId && Item.ItemPayload.Identical(&SourceItem.ItemPayload, PPF_None));
+
+		if (!bIsSameItem || Item.StackSize != Target.StackSize)
+		{
+			FCommonInventoryItem& NewItem = Writes.Emplace_GetRef(Idx, FCommonInventoryItem()).Value;
+			NewItem.StackSize = Target.StackSize;
+			NewItem.PrimaryAssetId = SourceItem.PrimaryAssetId;
+			NewItem.ItemPayload = SourceItem.ItemPayload;
+		}
+	}
+
+	if (Writes.IsEmpty())
+	{
+		return true;
+	}
+
+	for (TPair<int32, FCommonInventoryItem>& Write : Writes)
+	{
+		FCommonInventoryPredictionScope::CaptureSlot(*this, Write.Key);
+
+		// Replication keys stay with the slots.
+		FCommonInventoryItem& Item = Items[Write.Key];
+		Item.StackSize = Write.Value.StackSize;
+		Item.PrimaryAssetId = Write.Value.PrimaryAssetId;
+		Item.ItemPayload = MoveTemp(Write.Value.ItemPayload);
+
+		MarkItemDirty(Item);
+		NotifySlotChanged(Write.Key);
 	}
+
+	// Most of the slots might have moved, so the derived data is rebuilt at once.
+	RebuildSlots();
+	return true;
 }
 
-void FCommonInventoryState::Deinitialize()
+bool FCommonInventoryState::CanTransferItems(const FCommonInventoryState& InTarget, TConstArrayView<int32> InSourceSlots, TConstArrayView<int32> InAmounts) const
+{
+	FTransferPlan Plan;
+	return PlanTransfer(InTarget, InSourceSlots, InAmounts, Plan);
+}
+
+bool FCommonInventoryState::TransferItems(FCommonInventoryState& InTarget, TConstArrayView<int32> InSourceSlots, TConstArrayView<int32> InAmounts)
 {
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::TransferItems);
+
+	FTransferPlan Plan;
+
+	if (!PlanTransfer(InTarget, InSourceSlots, InAmounts, Plan))
+	{
+		return false;
+	}
+
+	// Each growth marks the whole array dirty, so the target grows once instead of doubling per item.
+	if (Plan.RequiredCapacity > InTarget.GetCapacity())
+	{
+		InTarget.Grow(Plan.RequiredCapacity);
+	}
+
+	TArray<int32, TInlineAllocator<16>> NewStackSlots;
+	NewStackSlots.Init(INDEX_NONE, Plan.NewStackCells.Num());
+
+	for (const FTransferStep& Step : Plan.Steps)
+	{
+		const FCommonInventoryItem& SourceItem = Items[Step.SourceSlot];
+		const int32 TargetSlot = Step.NewStack != INDEX_NONE ? NewStackSlots[Step.NewStack] : Step.TargetSlot;
+
+		if (TargetSlot != INDEX_NONE)
+		{
+			verify(InTarget.SetStackSize(TargetSlot, InTarget.Items[TargetSlot].StackSize + Step.Amount));
+			continue;
+		}
+
+		FCommonItem NewItem(SourceItem.PrimaryAssetId, FCommonItem::DeferPayloadInit);
+		NewItem.GetMutablePayload() = SourceItem.ItemPayload;
+
+		const int32 Cell = Plan.NewStackCells[Step.NewStack];
+		NewStackSlots[Step.NewStack] = Cell != INDEX_NONE ? InTarget.AddItemAt(NewItem, Step.Amount, Cell) : InTarget.AddItem(NewItem, Step.Amount);
+		check(NewStackSlots[Step.NewStack] != INDEX_NONE);
+	}
 
+	// Sources are reduced last, as new stacks copy their payloads.
+	for (int32 Idx = 0; Idx < InSourceSlots.Num(); ++Idx)
+	{
+		const int32 Slot = InSourceSlots[Idx];
+		SetStackSize(Slot, InAmounts.IsEmpty() ? 0 : Items[Slot].StackSize - InAmounts[Idx]);
+	}
+
+	return true;
 }
 
-bool FCommonInventoryState::Serialize(FArchive& Ar)
+bool FCommonInventoryState::PlanTransfer(const FCommonInventoryState& InTarget, TConstArrayView<int32> InSourceSlots, TConstArrayView<int32> InAmounts, FTransferPlan& OutPlan) const
+{
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	if (!Registry || &InTarget == this || InSourceSlots.IsEmpty() || (!InAmounts.IsEmpty() && InAmounts.Num() != InSourceSlots.Num()))
+	{
+		return false;
+	}
+
+	TArray<FPrimaryAssetId, TInlineAllocator<64>> PrimaryAssetIds;
+	TBitArray<> VisitedSlots(false, Items.Num());
+
+	for (int32 Idx = 0; Idx < InSourceSlots.Num(); ++Idx)
+	{
+		const int32 Slot = InSourceSlots[Idx];
+
+		if (!Items.IsValidIndex(Slot) || Items[Slot].IsEmpty() || VisitedSlots[Slot])
+		{
+			return false;
+		}
+
+		if (!InAmounts.IsEmpty() && (InAmounts[Idx] <= 0 || InAmounts[Idx] > Items[Slot].StackSize))
+		{
+			return false;
+		}
+
+		VisitedSlots[Slot] = true;
+		PrimaryAssetIds.Add(Items[Slot].PrimaryAssetId);
+	}
+
+	TArray<int32, TInlineAllocator<64>> RecordIndices;
+	TArray<int32, TInlineAllocator<64>> MaxStackSizes;
+	RecordIndices.SetNumUninitialized(PrimaryAssetIds.Num());
+	MaxStackSizes.SetNumUninitialized(PrimaryAssetIds.Num());
+	Registry->GetRecordIndices(PrimaryAssetIds, RecordIndices, MaxStackSizes);
+
+	const bool bIsTargetStackUnlimited = EnumHasAnyFlags(InTarget.InternalFlags, ECommonInventoryStateFlags::StackUnlimited);
+	const bool bIsTargetNoDuplicates = EnumHasAnyFlags(InTarget.InternalFlags, ECommonInventoryStateFlags::NoDuplicates);
+
+	// Planned sizes of the existing target stacks.
+	TMap<int32, int32, TInlineSetAllocator<16>> TargetStackSizes;
+
+	struct FNewStack
+	{
+		int32 SourceSlot = INDEX_NONE;
+		int32 StackSize = 0;
+	};
+
+	TArray<FNewStack, TInlineAllocator<16>> NewStacks;
+
+	// New stacks of the spatial target are placed on a copy of its grid.
+	TOptional<FCommonInventoryGrid> TargetGrid;
+
+	if (InTarget.IsSpatial())
+	{
+		TargetGrid.Emplace(InTarget.Grid);
+	}
+
+	OutPlan.Steps.Reset();
+	OutPlan.NewStackCells.Reset();
+	OutPlan.RequiredCapacity = InTarget.GetCapacity();
+
+	for (int32 Idx = 0; Idx < InSourceSlots.Num(); ++Idx)
+	{
+		const int32 Slot = InSourceSlots[Idx];
+		const FCommonInventoryItem& Item = Items[Slot];
+		const int32 MaxStackSize = bIsTargetStackUnlimited ? MAX_int32 : MaxStackSizes[Idx];
+
+		if (RecordIndices[Idx] == INDEX_NONE || MaxStackSize <= 0)
+		{
+			return false;
+		}
+
+		int32 Remaining = InAmounts.IsEmpty() ? Item.StackSize : InAmounts[Idx];
+
+		// Fill the existing stacks first.
+		for (const int32 TargetSlot : InTarget.FindItems(Item.PrimaryAssetId))
+		{
+			if (Remaining == 0)
+			{
+				break;
+			}
+
+			const FCommonInventoryItem& TargetItem = InTarget.Items[TargetSlot];
+
+			if (TargetItem.ItemPayload.Identical(&Item.ItemPayload, PPF_None))
+			{
+				int32& StackSize = TargetStackSizes.FindOrAdd(TargetSlot, TargetItem.StackSize);
+
+				if (const int32 Amount = FMath::Min(Remaining, MaxStackSize - StackSize); Amount > 0)
+				{
+					OutPlan.Steps.Add({ Slot, Amount, TargetSlot, INDEX_NONE });
+					StackSize += Amount;
+					Remaining -= Amount;
+				}
+			}
+		}
+
+		bool bHasNewStack = false;
+
+		// Then the stacks created by the previous items.
+		for (int32 NewStackIdx = 0; NewStackIdx < NewStacks.Num() && Remaining > 0; ++NewStackIdx)
+		{
+			FNewStack& NewStack = NewStacks[NewStackIdx];
+
+			if (const FCommonInventoryItem& NewStackItem = Items[NewStack.SourceSlot]; NewStackItem.PrimaryAssetId == Item.PrimaryAssetId)
+			{
+				bHasNewStack = true;
+
+				if (NewStackItem.ItemPayload.Identical(&Item.ItemPayload, PPF_None))
+				{
+					if (const int32 Amount = FMath::Min(Remaining, MaxStackSize - NewStack.StackSize); Amount > 0)
+					{
+						OutPlan.Steps.Add({ Slot, Amount, INDEX_NONE, NewStackIdx });
+						NewStack.StackSize += Amount;
+						Remaining -= Amount;
+					}
+				}
+			}
+		}
+
+		// The rest goes into new stacks.
+		while (Remaining > 0)
+		{
+			if (bIsTargetNoDuplicates && (InTarget.ContainsItem(Item.PrimaryAssetId) || bHasNewStack))
+			{
+				return false;
+			}
+
+			int32 Cell = INDEX_NONE;
+
+			if (TargetGrid.IsSet())
+			{
+				const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(Item.PrimaryAssetId);
+
+				if ((Cell = TargetGrid->FindFirstFit(Footprint)) == INDEX_NONE)
+				{
+					return false;
+				}
+
+				TargetGrid->Place(Footprint, Cell);
+			}
+
+			const int32 Amount = FMath::Min(Remaining, MaxStackSize);
+			OutPlan.Steps.Add({ Slot, Amount, INDEX_NONE, NewStacks.Num() });
+			OutPlan.NewStackCells.Add(Cell);
+			NewStacks.Add({ Slot, Amount });
+			Remaining -= Amount;
+			bHasNewStack = true;
+		}
+	}
+
+	// Spatial targets are validated by the grid.
+	if (!InTarget.IsSpatial())
+	{
+		const int32 NumFreeSlots = InTarget.GetCapacity() - InTarget.Num();
+
+		if (NewStacks.Num() > NumFreeSlots)
+		{
+			OutPlan.RequiredCapacity = InTarget.GetCapacity() + NewStacks.Num() - NumFreeSlots;
+
+			if (!EnumHasAnyFlags(InTarget.InternalFlags, ECommonInventoryStateFlags::Automatic) || OutPlan.RequiredCapacity > UCommonInventorySettings::Get()->InventoryCapacityLimit)
+			{
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void FCommonInventoryState::Reserve(int32 InCapacity)
+{
+	// The size of spatial states is fixed by the grid.
+	if (InCapacity > Items.Num() && !IsSpatial())
+	{
+		Grow(InCapacity);
+	}
+}
+
+void FCommonInventoryState::RestoreSlot(const FCommonInventoryPredictedSlot& InSnapshot)
+{
+	const int32 Slot = InSnapshot.Slot;
+
+	if (!Items.IsValidIndex(Slot))
+	{
+		return;
+	}
+
+	// The slot holds the server item already, while later snapshots are restored first and were captured after the update.
+	if (ReplicatedSlotRevisions.IsValidIndex(Slot) && ReplicatedSlotRevisions[Slot] > InSnapshot.ReplicationRevision)
+	{
+		return;
+	}
+
+	FCommonInventoryItem& Item = Items[Slot];
+	const FCommonInventoryItem& RestoredItem = InSnapshot.Item;
+
+	// The captured link of an empty slot is stale, so an empty slot stays linked as is.
+	if (Item.IsEmpty() && RestoredItem.IsEmpty())
+	{
+		return;
+	}
+
+	if (Item.IsEmpty())
+	{
+		UnlinkFreeSlot(Slot);
+	}
+	else
+	{
+		RemoveFromSlotIndex(Item.PrimaryAssetId, Slot);
+		Grid.Remove(Slot);
+		--Size;
+	}
+
+	if (RestoredItem.IsEmpty())
+	{
+		Item.Empty();
+		PushFreeSlot(Slot);
+	}
+	else
+	{
+		Item.StackSize = RestoredItem.StackSize;
+		Item.PrimaryAssetId = RestoredItem.PrimaryAssetId;
+		Item.ItemPayload = RestoredItem.ItemPayload;
+		AddToSlotIndex(Item.PrimaryAssetId, Slot);
+		++Size;
+
+		if (IsSpatial())
+		{
+			if (const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(Item.PrimaryAssetId); Grid.CanPlace(Footprint, Slot))
+			{
+				Grid.Place(Footprint, Slot);
+			}
+			else
+			{
+				COMMON_INVENTORY_LOG(Warning, "FCommonInventoryState: Restored item '%s' in slot %d overlaps other items or exceeds the grid.", *Item.PrimaryAssetId.ToString(), Slot);
+			}
+		}
+	}
+
+	NotifySlotChanged(Slot);
+}
+
+void FCommonInventoryState::Grow(int32 InCapacity)
 {
-	return false;
+	const int32 OldCapacity = Items.Num();
+
+	if (InCapacity <= OldCapacity)
+	{
+		return;
+	}
+
+	LLM_SCOPE_BYTAG(CommonInventory);
+
+	Items.SetNum(InCapacity);
+	Capacity = static_cast<uint32>(InCapacity);
+
+	// Push in the reverse order, so lower slots are allocated first.
+	for (int32 Idx = InCapacity - 1; Idx >= OldCapacity; --Idx)
+	{
+		Items[Idx].SetOffset(Idx);
+		PushFreeSlot(Idx);
+	}
+
+	// New slots have to be replicated, but existing slots remain untouched.
+	MarkArrayDirty();
+}
+
+void FCommonInventoryState::PushFreeSlot(int32 InSlot)
+{
+	// Spatial states are allocated through the grid.
+	if (IsSpatial())
+	{
+		return;
+	}
+
+	Items[InSlot].SetNextFreeSlot(FreeSlot);
+	FreeSlot = InSlot;
+}
+
+void FCommonInventoryState::UnlinkFreeSlot(int32 InSlot)
+{
+	if (IsSpatial())
+	{
+		return;
+	}
+
+	// Undone removals pushed the slot last, so it's usually the head.
+	for (int32* Link = &FreeSlot; *Link != INDEX_NONE; Link = &Items[*Link].StackSize)
+	{
+		if (*Link == InSlot)
+		{
+			*Link = Items[InSlot].GetNextFreeSlot();
+			return;
+		}
+	}
+}
+
+void FCommonInventoryState::StampReplicatedSlots(TConstArrayView<int32> InSlots, int32 InFinalSize)
+{
+	++ReplicationRevision;
+	ReplicatedSlotRevisions.SetNumZeroed(InFinalSize, EAllowShrinking::No);
+
+	for (const int32 Slot : InSlots)
+	{
+		if (ReplicatedSlotRevisions.IsValidIndex(Slot))
+		{
+			ReplicatedSlotRevisions[Slot] = ReplicationRevision;
+		}
+	}
+}
+
+void FCommonInventoryState::NotifySlotChanged(int32 InSlot)
+{
+	if (ChangeTracker)
+	{
+		ChangeTracker->MarkSlotDirty(InSlot);
+	}
+
+	if (Aggregates)
+	{
+		Aggregates->UpdateSlot(*this, InSlot);
+	}
+
+	if (const int32 Chunk = InSlot / FCommonInventoryStateSnapshot::ChunkSize; DirtySnapshotChunks.IsValidIndex(Chunk))
+	{
+		DirtySnapshotChunks[Chunk] = true;
+	}
+}
+
+void FCommonInventoryState::SetAggregates(FCommonInventoryAggregates* InAggregates)
+{
+	Aggregates = InAggregates;
+	RebuildAggregates();
+}
+
+void FCommonInventoryState::RebuildAggregates()
+{
+	bIsAggregatesDirty = false;
+
+	if (Aggregates)
+	{
+		Aggregates->Rebuild(*this);
+	}
+}
+
+void FCommonInventoryState::AddToSlotIndex(FPrimaryAssetId InPrimaryAssetId, int32 InSlot)
+{
+	SlotIndex.FindOrAdd(InPrimaryAssetId).Add(InSlot);
+
+	if (InSlot >= IndexedSlotIds.Num())
+	{
+		IndexedSlotIds.SetNum(FMath::Max(InSlot + 1, Items.Num()));
+	}
+
+	IndexedSlotIds[InSlot] = InPrimaryAssetId;
+}
+
+void FCommonInventoryState::RemoveFromSlotIndex(FPrimaryAssetId InPrimaryAssetId, int32 InSlot)
+{
+	if (IndexedSlotIds.IsValidIndex(InSlot))
+	{
+		IndexedSlotIds[InSlot] = FPrimaryAssetId();
+	}
+
+	if (auto* const Slots = SlotIndex.Find(InPrimaryAssetId))
+	{
+		Slots->RemoveSingleSwap(InSlot, EAllowShrinking::No);
+
+		if (Slots->IsEmpty())
+		{
+			SlotIndex.Remove(InPrimaryAssetId);
+		}
+	}
+}
+
+void FCommonInventoryState::RebuildSlots()
+{
+	Size = 0;
+	Capacity = static_cast<uint32>(Items.Num());
+	SlotIndex.Reset();
+	IndexedSlotIds.Reset();
+	IndexedSlotIds.SetNum(Items.Num());
+	bIsSlotsDirty = false;
+
+	for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+	{
+		if (!Items[Idx].IsEmpty())
+		{
+			AddToSlotIndex(Items[Idx].PrimaryAssetId, Idx);
+			++Size;
+		}
+	}
+
+	RebuildFreeList();
+
+	if (IsSpatial())
+	{
+		RebuildGrid();
+	}
+}
+
+void FCommonInventoryState::RebuildFreeList()
+{
+	FreeSlot = INDEX_NONE;
+
+	// Pushed backwards, so the lowest empty slot is allocated first.
+	for (int32 Idx = Items.Num() - 1; Idx >= 0; --Idx)
+	{
+		if (Items[Idx].IsEmpty())
+		{
+			PushFreeSlot(Idx);
+		}
+	}
+}
+
+void FCommonInventoryState::UpdateReplicatedSlots()
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::UpdateReplicatedSlots);
+
+	Capacity = static_cast<uint32>(Items.Num());
+	IndexedSlotIds.SetNum(Items.Num());
+
+	// Empty slots don't replicate the free list link, so any empty slot in the update breaks the list.
+	bool bIsFreeListDirty = false;
+
+	// Vacate all the changed anchors first, so items moved within the update don't overlap their old cells.
+	if (IsSpatial())
+	{
+		for (const int32 Slot : PendingReplicatedSlots)
+		{
+			if (Items.IsValidIndex(Slot) && IndexedSlotIds[Slot].IsValid() && IndexedSlotIds[Slot] != Items[Slot].PrimaryAssetId)
+			{
+				Grid.Remove(Slot);
+			}
+		}
+	}
+
+	for (const int32 Slot : PendingReplicatedSlots)
+	{
+		if (!Items.IsValidIndex(Slot))
+		{
+			continue;
+		}
+
+		const FCommonInventoryItem& Item = Items[Slot];
+		const FPrimaryAssetId IndexedId = IndexedSlotIds[Slot];
+		bIsFreeListDirty |= Item.IsEmpty() || !IndexedId.IsValid();
+
+		// Stack and payload updates don't affect the index.
+		if (IndexedId == Item.PrimaryAssetId)
+		{
+			continue;
+		}
+
+		if (IndexedId.IsValid())
+		{
+			RemoveFromSlotIndex(IndexedId, Slot);
+			--Size;
+		}
+
+		if (!Item.IsEmpty())
+		{
+			AddToSlotIndex(Item.PrimaryAssetId, Slot);
+			++Size;
+
+			if (IsSpatial() && Slot < Grid.Num())
+			{
+				if (const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(Item.PrimaryAssetId); Grid.CanPlace(Footprint, Slot))
+				{
+					Grid.Place(Footprint, Slot);
+				}
+				else
+				{
+					COMMON_INVENTORY_LOG(Warning, "FCommonInventoryState: Item '%s' in slot %d overlaps other items or exceeds the grid.", *Item.PrimaryAssetId.ToString(), Slot);
+				}
+			}
+		}
+	}
+
+	PendingReplicatedSlots.Reset();
+
+	if (bIsFreeListDirty)
+	{
+		RebuildFreeList();
+	}
+}
+
+void FCommonInventoryState::RebuildGrid()
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::RebuildGrid);
+
+	Grid.Reset();
+
+	for (int32 Idx = 0; Idx < FMath::Min(Items.Num(), Grid.Num()); ++Idx)
+	{
+		if (const FCommonInventoryItem& Item = Items[Idx]; !Item.IsEmpty())
+		{
+			if (const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(Item.PrimaryAssetId); Grid.CanPlace(Footprint, Idx))
+			{
+				Grid.Place(Footprint, Idx);
+			}
+			else
+			{
+				COMMON_INVENTORY_LOG(Warning, "FCommonInventoryState: Item '%s' in slot %d overlaps other items or exceeds the grid.", *Item.PrimaryAssetId.ToString(), Idx);
+			}
+		}
+	}
+}
+
+bool FCommonInventoryState::CanPlaceItem(FPrimaryAssetId InPrimaryAssetId, int32 InCell, int32 InIgnoredSlot /* = INDEX_NONE */) const
+{
+	return IsSpatial() && Grid.CanPlace(FCommonInventoryFootprint::FindForItem(InPrimaryAssetId), InCell, InIgnoredSlot);
+}
+
+int32 FCommonInventoryState::FindFirstFit(FPrimaryAssetId InPrimaryAssetId) const
+{
+	return IsSpatial() ? Grid.FindFirstFit(FCommonInventoryFootprint::FindForItem(InPrimaryAssetId)) : INDEX_NONE;
+}
+
+int32 FCommonInventoryState::AddItemAt(const FCommonItem& InItem, int32 InStackSize, int32 InCell)
+{
+	if (!IsSpatial() || !InItem.IsValid() || InStackSize <= 0)
+	{
+		return INDEX_NONE;
+	}
+
+	if (EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::NoDuplicates) && ContainsItem(InItem.GetPrimaryAssetId()))
+	{
+		return INDEX_NONE;
+	}
+
+	const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(InItem.GetPrimaryAssetId());
+
+	if (!Grid.CanPlace(Footprint, InCell))
+	{
+		return INDEX_NONE;
+	}
+
+	FCommonInventoryPredictionScope::CaptureSlot(*this, InCell);
+	FCommonInventoryItem& Item = Items[InCell];
+	Item.PrimaryAssetId = InItem.GetPrimaryAssetId();
+	Item.ItemPayload = InItem.GetPayload();
+	Item.StackSize = InStackSize;
+	AddToSlotIndex(Item.PrimaryAssetId, InCell);
+	Grid.Place(Footprint, InCell);
+	++Size;
+
+	// Covered cells remain empty, so only the anchor is replicated.
+	MarkItemDirty(Item);
+	NotifySlotChanged(InCell);
+	return InCell;
+}
+
+bool FCommonInventoryState::MoveItem(int32 InSlot, int32 InCell)
+{
+	if (!IsSpatial() || !Items.IsValidIndex(InSlot) || Items[InSlot].IsEmpty())
+	{
+		return false;
+	}
+
+	if (InSlot == InCell)
+	{
+		return true;
+	}
+
+	const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(Items[InSlot].PrimaryAssetId);
+
+	if (!Grid.CanPlace(Footprint, InCell, /* InIgnoredAnchor */ InSlot))
+	{
+		return false;
+	}
+
+	FCommonInventoryPredictionScope::CaptureSlot(*this, InSlot);
+	FCommonInventoryPredictionScope::CaptureSlot(*this, InCell);
+
+	FCommonInventoryItem& SourceItem = Items[InSlot];
+	FCommonInventoryItem& TargetItem = Items[InCell];
+
+	// Replication keys stay with the slots.
+	TargetItem.StackSize = SourceItem.StackSize;
+	TargetItem.PrimaryAssetId = SourceItem.PrimaryAssetId;
+	TargetItem.ItemPayload = MoveTemp(SourceItem.ItemPayload);
+	RemoveFromSlotIndex(TargetItem.PrimaryAssetId, InSlot);
+	AddToSlotIndex(TargetItem.PrimaryAssetId, InCell);
+	SourceItem.Empty();
+
+	Grid.Remove(InSlot);
+	Grid.Place(Footprint, InCell);
+
+	MarkItemDirty(SourceItem);
+	MarkItemDirty(TargetItem);
+	NotifySlotChanged(InSlot);
+	NotifySlotChanged(InCell);
+	return true;
+}
+
+bool FCommonInventoryState::CompactGrid()
+{
+	if (!IsSpatial())
+	{
+		return false;
+	}
+
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::CompactGrid);
+
+	struct FPlacement
+	{
+		FCommonInventoryFootprint Footprint;
+		int32 Slot = INDEX_NONE;
+		int32 NewSlot = INDEX_NONE;
+		int32 NumCells = 0;
+	};
+
+	TArray<FPlacement, TInlineAllocator<64>> Placements;
+
+	for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+	{
+		if (!Items[Idx].IsEmpty())
+		{
+			const FCommonInventoryFootprint Footprint = FCommonInventoryFootprint::FindForItem(Items[Idx].PrimaryAssetId);
+			Placements.Add({ Footprint, Idx, INDEX_NONE, Footprint.GetNumCells() });
+		}
+	}
+
+	// Larger footprints first, ties are broken by slots to keep the layout deterministic.
+	Algo::Sort(Placements, [](const FPlacement& Lhs, const FPlacement& Rhs)
+		{
+			return Lhs.NumCells != Rhs.NumCells ? Lhs.NumCells > Rhs.NumCells : Lhs.Slot < Rhs.Slot;
+		});
+
+	FCommonInventoryGrid NewGrid;
+	NewGrid.Initialize(Grid.GetWidth(), Grid.GetHeight());
+
+	for (FPlacement& Placement : Placements)
+	{
+		Placement.NewSlot = NewGrid.FindFirstFit(Placement.Footprint);
+
+		if (Placement.NewSlot == INDEX_NONE)
+		{
+			return false;
+		}
+
+		NewGrid.Place(Placement.Footprint, Placement.NewSlot);
+	}
+
+	// Lift moved items first, as their new slots might be still held by items which haven't moved yet.
+	TArray<FCommonInventoryItem, TInlineAllocator<64>> MovedItems;
+
+	for (const FPlacement& Placement : Placements)
+	{
+		if (Placement.NewSlot != Placement.Slot)
+		{
+			FCommonInventoryPredictionScope::CaptureSlot(*this, Placement.Slot);
+			FCommonInventoryItem& Item = Items[Placement.Slot];
+			FCommonInventoryItem& MovedItem = MovedItems.AddDefaulted_GetRef();
+			MovedItem.StackSize = Item.StackSize;
+			MovedItem.PrimaryAssetId = Item.PrimaryAssetId;
+			MovedItem.ItemPayload = MoveTemp(Item.ItemPayload);
+			RemoveFromSlotIndex(Item.PrimaryAssetId, Placement.Slot);
+			Item.Empty();
+			MarkItemDirty(Item);
+			NotifySlotChanged(Placement.Slot);
+		}
+	}
+
+	int32 MovedIdx = 0;
+
+	for (const FPlacement& Placement : Placements)
+	{
+		if (Placement.NewSlot != Placement.Slot)
+		{
+			FCommonInventoryPredictionScope::CaptureSlot(*this, Placement.NewSlot);
+			FCommonInventoryItem& MovedItem = MovedItems[MovedIdx++];
+			FCommonInventoryItem& Item = Items[Placement.NewSlot];
+			Item.StackSize = MovedItem.StackSize;
+			Item.PrimaryAssetId = MovedItem.PrimaryAssetId;
+			Item.ItemPayload = MoveTemp(MovedItem.ItemPayload);
+			AddToSlotIndex(Item.PrimaryAssetId, Placement.NewSlot);
+			MarkItemDirty(Item);
+			NotifySlotChanged(Placement.NewSlot);
+		}
+	}
+
+	Grid = MoveTemp(NewGrid);
+	return true;
+}
+
+void FCommonInventoryState::PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize)
+{
+	PendingReplicatedSlots.Append(AddedIndices);
+	StampReplicatedSlots(AddedIndices, FinalSize);
+	Algo::ForEach(AddedIndices, [this](int32 Idx) { NotifySlotChanged(Idx); });
+}
+
+void FCommonInventoryState::PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize)
+{
+	// Removed items are still in place and the remaining ones are about to be swapped, so the contributions are reevaluated after the update.
+	bIsSlotsDirty = true;
+	bIsAggregatesDirty = true;
+	Algo::ForEach(RemovedIndices, [this](int32 Idx) { NotifySlotChanged(Idx); });
+}
+
+void FCommonInventoryState::PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize)
+{
+	PendingReplicatedSlots.Append(ChangedIndices);
+	StampReplicatedSlots(ChangedIndices, FinalSize);
+	Algo::ForEach(ChangedIndices, [this](int32 Idx) { NotifySlotChanged(Idx); });
+}
+
+void FCommonInventoryState::PostReplicatedReceive(FFastArraySerializer::FPostReplicatedReceiveParameters PostReceivedParameters)
+{
+	// Removals shift the remaining slots, so only added and changed slots are updated in place.
+	if (bIsSlotsDirty)
+	{
+		PendingReplicatedSlots.Reset();
+		RebuildSlots();
+	}
+	else if (!PendingReplicatedSlots.IsEmpty())
+	{
+		UpdateReplicatedSlots();
+	}
+
+	if (bIsAggregatesDirty)
+	{
+		RebuildAggregates();
+	}
+}
+
+struct FInventoryStateArchiveVersion
+{
+	FInventoryStateArchiveVersion() = delete;
+
+	// Set in the serialized flags, which are limited by ECommonInventoryStateFlags::All. Legacy archives never have it.
+	static constexpr uint16 BulkArchiveFlag = 1 << 15;
+
+	enum Type : uint8
+	{
+		// A table of unique items followed by rows of packed table indices, stack sizes and payload deltas.
+		InitialVersion = 0,
+
+		// -----<new versions can be added above this line>-----
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+};
+
+bool FCommonInventoryState::Serialize(FArchive& Ar)
+{
+	LLM_SCOPE_BYTAG(CommonInventory);
+
+	// Archives which only visit properties, e.g. the defaults propagation, go through the per item serialization.
+	const bool bCanWriteBulkArchive = Ar.IsSaving() && !Ar.IsLoading() && UCommonInventoryRegistry::GetPtr() != nullptr;
+
+	uint16 SerializedFlags = static_cast<uint16>(InternalFlags) | (bCanWriteBulkArchive ? FInventoryStateArchiveVersion::BulkArchiveFlag : 0);
+	Ar << SerializedFlags;
+	InternalFlags = static_cast<ECommonInventoryStateFlags>(SerializedFlags & ~FInventoryStateArchiveVersion::BulkArchiveFlag);
+
+	// The number of rows is derived from the number of slots.
+	uint16 GridWidth = static_cast<uint16>(Grid.GetWidth());
+
+	if (IsSpatial())
+	{
+		Ar << GridWidth;
+	}
+
+	if (SerializedFlags & FInventoryStateArchiveVersion::BulkArchiveFlag)
+	{
+		if (!SerializeBulk(Ar))
+		{
+			Ar.SetError();
+			return true;
+		}
+	}
+	else
+	{
+		int32 NumItems = Items.Num();
+		Ar << NumItems;
+
+		if (Ar.IsLoading())
+		{
+			if (NumItems < 0)
+			{
+				Ar.SetError();
+				return true;
+			}
+
+			Items.Reset();
+			Items.SetNum(NumItems);
+		}
+
+		for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+		{
+			Items[Idx].Serialize(Ar);
+		}
+
+		// The defaults propagation rewrites payloads and redirects ids in place, bypassing NotifySlotChanged().
+		if (!Ar.IsLoading() && FCommonInventoryDefaultsPropagator::Get().GetContextFromArchive(Ar))
+		{
+			RebuildSlots();
+			MarkSnapshotDirty();
+		}
+	}
+
+	if (Ar.IsLoading())
+	{
+		PostLoadItems(Ar, GridWidth);
+	}
+
+	return true;
+}
+
+void FCommonInventoryState::PostLoadItems(FArchive& Ar, uint16 InGridWidth)
+{
+	for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+	{
+		Items[Idx].SetOffset(Idx);
+	}
+
+	if (IsSpatial())
+	{
+		if (InGridWidth > 0 && InGridWidth <= FCommonInventoryGrid::MaxWidth && Items.Num() % InGridWidth == 0)
+		{
+			Grid.Initialize(InGridWidth, Items.Num() / InGridWidth);
+		}
+		else
+		{
+			COMMON_INVENTORY_LOG(Error, "FCommonInventoryState: Unable to load a spatial inventory of %d slots with grid width %u.", Items.Num(), InGridWidth);
+			InternalFlags &= ~ECommonInventoryStateFlags::Spatial;
+			Grid = FCommonInventoryGrid();
+			Ar.SetError();
+		}
+	}
+
+	RebuildSlots();
+	RebuildAggregates();
+	MarkArrayDirty();
+	LastSnapshot.Reset();
+	DirtySnapshotChunks.Reset();
+}
+
+bool FCommonInventoryState::SaveHandoff(TArray<uint8>& OutData, uint32 InTargetChecksum) const
+{
+	LLM_SCOPE_BYTAG(CommonInventory);
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::SaveHandoff);
+
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	if (!Registry)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryState: Unable to save an inventory handoff without InventoryRegistry.");
+		return false;
+	}
+
+	// Persistent, so the name-based fallback resolves redirects on the destination.
+	FMemoryWriter Ar(OutData, /* bIsPersistent */ true);
+
+	uint8 Version = FInventoryStateArchiveVersion::LatestVersion;
+	uint16 SerializedFlags = static_cast<uint16>(InternalFlags);
+	uint16 GridWidth = static_cast<uint16>(Grid.GetWidth());
+	int32 NumItems = Items.Num();
+	Ar << Version << SerializedFlags << GridWidth << NumItems;
+
+	// Saving doesn't mutate items, the item serialization just isn't const.
+	const auto GetMutableItem = [this](int32 InSlot) -> FCommonInventoryItem&
+		{
+			return const_cast<FCommonInventoryItem&>(Items[InSlot]);
+		};
+
+	return SerializeBulkRows(Ar, *Registry, NumItems, GetMutableItem, &InTargetChecksum);
+}
+
+bool FCommonInventoryState::LoadHandoff(TConstArrayView<uint8> InData)
+{
+	LLM_SCOPE_BYTAG(CommonInventory);
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::LoadHandoff);
+
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	if (!Registry)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryState: Unable to load an inventory handoff without InventoryRegistry.");
+		return false;
+	}
+
+	FMemoryReaderView Ar(InData, /* bIsPersistent */ true);
+
+	uint8 Version = 0;
+	uint16 SerializedFlags = 0;
+	uint16 GridWidth = 0;
+	int32 NumItems = 0;
+	Ar << Version << SerializedFlags << GridWidth << NumItems;
+
+	if (Ar.IsError() || Version > FInventoryStateArchiveVersion::LatestVersion || NumItems < 0 || (SerializedFlags & ~static_cast<uint16>(ECommonInventoryStateFlags::All)) != 0)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryState: Unable to load an inventory handoff with version %u.", Version);
+		return false;
+	}
+
+	InternalFlags = static_cast<ECommonInventoryStateFlags>(SerializedFlags);
+	Items.Reset();
+	Items.SetNum(NumItems);
+
+	const uint32 HandoffChecksum = 0;
+	const bool bIsLoaded = SerializeBulkRows(Ar, *Registry, NumItems, [this](int32 InSlot) -> FCommonInventoryItem& { return Items[InSlot]; }, &HandoffChecksum);
+
+	// Leave the state consistent even if the handoff is truncated.
+	if (!bIsLoaded)
+	{
+		for (FCommonInventoryItem& Item : Items)
+		{
+			Item.Empty();
+		}
+	}
+
+	PostLoadItems(Ar, GridWidth);
+
+	// Unlike loading from saves, the handoff replaces the live state.
+	if (ChangeTracker)
+	{
+		for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+		{
+			ChangeTracker->MarkSlotDirty(Idx);
+		}
+	}
+
+	return bIsLoaded && !Ar.IsError();
+}
+
+bool FCommonInventoryState::SerializeBulk(FArchive& Ar)
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::SerializeBulk);
+
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	if (!Registry)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryState: Unable to serialize an inventory archive without InventoryRegistry.");
+		return false;
+	}
+
+	uint8 Version = FInventoryStateArchiveVersion::LatestVersion;
+	Ar << Version;
+
+	if (Ar.IsLoading() && Version > FInventoryStateArchiveVersion::LatestVersion)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryState: Unable to load an inventory archive with a newer version %u.", Version);
+		return false;
+	}
+
+	int32 NumItems = Items.Num();
+	Ar << NumItems;
+
+	if (Ar.IsLoading())
+	{
+		if (NumItems < 0)
+		{
+			return false;
+		}
+
+		Items.Reset();
+		Items.SetNum(NumItems);
+	}
+
+	return SerializeBulkRows(Ar, *Registry, NumItems, [this](int32 InSlot) -> FCommonInventoryItem& { return Items[InSlot]; });
+}
+
+bool FCommonInventoryState::SerializeBulkRows(FArchive& Ar, const UCommonInventoryRegistry& InRegistry, int32 InNumItems, TFunctionRef<FCommonInventoryItem&(int32)> InGetItem, const uint32* InHandoffChecksum /* = nullptr */)
+{
+	// Local ids are 1-based table indices, zero marks an empty slot.
+	TArray<FPrimaryAssetId> ItemTable;
+	TArray<uint32> LocalIds;
+
+	if (Ar.IsSaving())
+	{
+		TMap<FPrimaryAssetId, uint32> LocalIdMap;
+		LocalIds.SetNumUninitialized(InNumItems);
+
+		for (int32 Idx = 0; Idx < InNumItems; ++Idx)
+		{
+			const FCommonInventoryItem& Item = InGetItem(Idx);
+
+			if (Item.IsEmpty())
+			{
+				LocalIds[Idx] = 0;
+			}
+			else if (const uint32* const LocalId = LocalIdMap.Find(Item.PrimaryAssetId))
+			{
+				LocalIds[Idx] = *LocalId;
+			}
+			else
+			{
+				LocalIds[Idx] = ItemTable.Add(Item.PrimaryAssetId) + 1;
+				LocalIdMap.Add(Item.PrimaryAssetId, LocalIds[Idx]);
+			}
+		}
+	}
+
+	const auto SerializeRows = [&Ar, &ItemTable, &LocalIds, InNumItems, &InGetItem](TConstArrayView<FConstStructView> InDefaults)
+		{
+			for (int32 Idx = 0; Idx < InNumItems && !Ar.IsError(); ++Idx)
+			{
+				FCommonInventoryItem& Item = InGetItem(Idx);
+				uint32 LocalId = Ar.IsSaving() ? LocalIds[Idx] : 0;
+
+				// Entries might have been removed from the registry.
+				if (Ar.IsSaving() && LocalId != 0 && !ItemTable[LocalId - 1].IsValid())
+				{
+					LocalId = 0;
+				}
+
+				Ar.SerializeIntPacked(LocalId);
+
+				if (LocalId == 0)
+				{
+					if (Ar.IsLoading())
+					{
+						Item.Empty();
+					}
+
+					continue;
+				}
+
+				if (LocalId > static_cast<uint32>(ItemTable.Num()))
+				{
+					Ar.SetError();
+					return;
+				}
+
+				uint32 PackedStackSize = static_cast<uint32>(Item.StackSize);
+				Ar.SerializeIntPacked(PackedStackSize);
+				Item.StackSize = static_cast<int32>(PackedStackSize);
+
+				if (Ar.IsLoading())
+				{
+					Item.PrimaryAssetId = ItemTable[LocalId - 1];
+				}
+
+				Item.ItemPayload.Serialize(Ar, &InDefaults[LocalId - 1]);
+
+				// The item might have been removed from the registry.
+				if (Ar.IsLoading() && Item.IsEmpty())
+				{
+					Item.Empty();
+				}
+			}
+		};
+
+	const bool bIsTableSerialized = InHandoffChecksum
+		? InRegistry.SerializeHandoffItemTable(Ar, ItemTable, *InHandoffChecksum, SerializeRows)
+		: InRegistry.SerializeItemTable(Ar, ItemTable, SerializeRows);
+
+	if (!bIsTableSerialized)
+	{
+		return false;
+	}
+
+#if WITH_EDITOR
+	for (const FPrimaryAssetId& PrimaryAssetId : ItemTable)
+	{
+		FCommonInventoryDefaultsPropagator::Get().RecordItemReference(Ar, PrimaryAssetId);
+	}
+#endif
+
+	return !Ar.IsError();
+}
+
+TSharedRef<const FCommonInventoryStateSnapshot, ESPMode::ThreadSafe> FCommonInventoryState::MakeSnapshot() const
+{
+	check(IsInGameThread());
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::MakeSnapshot);
+
+	constexpr int32 ChunkSize = FCommonInventoryStateSnapshot::ChunkSize;
+	const FCommonInventoryStateSnapshot* const PrevSnapshot = LastSnapshot.Get();
+
+	// Nothing has changed since the previous snapshot.
+	if (PrevSnapshot && PrevSnapshot->NumItems == Items.Num() && PrevSnapshot->InternalFlags == InternalFlags && PrevSnapshot->GridWidth == Grid.GetWidth() && DirtySnapshotChunks.Find(true) == INDEX_NONE)
+	{
+		return LastSnapshot.ToSharedRef();
+	}
+
+	const TSharedRef<FCommonInventoryStateSnapshot, ESPMode::ThreadSafe> Snapshot = MakeShared<FCommonInventoryStateSnapshot, ESPMode::ThreadSafe>();
+	Snapshot->NumItems = Items.Num();
+	Snapshot->InternalFlags = InternalFlags;
+	Snapshot->GridWidth = Grid.GetWidth();
+
+	const int32 NumChunks = FMath::DivideAndRoundUp(Items.Num(), ChunkSize);
+	Snapshot->Chunks.Reserve(NumChunks);
+
+	for (int32 ChunkIdx = 0; ChunkIdx < NumChunks; ++ChunkIdx)
+	{
+		const int32 FirstSlot = ChunkIdx * ChunkSize;
+		const int32 NumSlots = FMath::Min(ChunkSize, Items.Num() - FirstSlot);
+
+		// Share the chunk if it covers the same slots and none of them have changed.
+		if (PrevSnapshot && PrevSnapshot->Chunks.IsValidIndex(ChunkIdx) && PrevSnapshot->Chunks[ChunkIdx]->Num() == NumSlots && !DirtySnapshotChunks[ChunkIdx])
+		{
+			Snapshot->Chunks.Add(PrevSnapshot->Chunks[ChunkIdx]);
+		}
+		else
+		{
+			Snapshot->Chunks.Add(MakeShared<FCommonInventoryStateSnapshot::FChunk, ESPMode::ThreadSafe>(Items.GetData() + FirstSlot, NumSlots));
+		}
+	}
+
+	LastSnapshot = Snapshot;
+	DirtySnapshotChunks.Init(false, NumChunks);
+	return Snapshot;
+}
+
+// The window of the connection being written. Replication might run on multiple threads.
+static thread_local const FCommonInventoryItem* InitialSyncWindowBegin = nullptr;
+static thread_local const FCommonInventoryItem* InitialSyncWindowEnd = nullptr;
+
+bool FCommonInventoryState::IsWithinInitialSyncWindow(const FCommonInventoryItem& InItem)
+{
+	return !InitialSyncWindowBegin || (&InItem >= InitialSyncWindowBegin && &InItem < InitialSyncWindowEnd);
+}
+
+bool FCommonInventoryState::NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CommonInventory_NetDeltaSerialize);
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryState::NetDeltaSerialize);
+
+#if COMMON_INVENTORY_WITH_NET_PROFILER
+	// Items are serialized into the same archive, so they are measured through the registered scope.
+	const CommonInventory::Net::FScopedBitArchive BitArchive(DeltaParms.Writer, DeltaParms.Reader);
+	const int64 StartBits = BitArchive.GetPosBits();
+
+	ON_SCOPE_EXIT
+	{
+		if (DeltaParms.Writer || DeltaParms.Reader)
+		{
+			CommonInventory::Net::RecordStateDelta(BitArchive.GetPosBits() - StartBits);
+		}
+	};
+#endif
+
+	// Lets clients know how many slots to expect even while the initial sync is in progress.
+	int32 NumSlots = Items.Num();
+
+	if (DeltaParms.Writer)
+	{
+		DeltaParms.Writer->SerializeIntPacked(reinterpret_cast<uint32&>(NumSlots));
+
+		const UCommonInventorySettings* const Settings = UCommonInventorySettings::Get();
+		const int32 ItemsPerUpdate = Settings->InitialSyncItemsPerUpdate;
+
+		// Sending large states at once saturates the connection, so new connections receive slots in chunks.
+		// Replays record through internal acks and their checkpoints must contain the full state, so they're never paced.
+		if (ItemsPerUpdate > 0 && !DeltaParms.bIsWritingOnClient && !DeltaParms.bInternalAck && DeltaParms.Map && (DeltaParms.OldState == nullptr || !InitialSyncCursors.IsEmpty()))
+		{
+			const TObjectKey<UPackageMap> ConnectionKey(DeltaParms.Map);
+			FInitialSyncCursor* Cursor = InitialSyncCursors.Find(ConnectionKey);
+
+			if (!Cursor && DeltaParms.OldState == nullptr && Items.Num() > ItemsPerUpdate)
+			{
+				Cursor = &InitialSyncCursors.Add(ConnectionKey, { 0, FPlatformTime::Seconds() });
+			}
+
+			if (Cursor)
+			{
+				// Speed up to finish within the latency budget regardless of the update rate.
+				const double Elapsed = FPlatformTime::Seconds() - Cursor->StartTime;
+				const int32 NumSlotsByBudget = Settings->InitialSyncLatencyBudget > 0.f ? FMath::CeilToInt32(Items.Num() * Elapsed / Settings->InitialSyncLatencyBudget) : 0;
+				Cursor->NumSyncedSlots = FMath::Min(FMath::Max(Cursor->NumSyncedSlots + ItemsPerUpdate, NumSlotsByBudget), Items.Num());
+
+				InitialSyncWindowBegin = Items.GetData();
+				InitialSyncWindowEnd = Items.GetData() + Cursor->NumSyncedSlots;
+
+				const bool bIsComplete = Cursor->NumSyncedSlots == Items.Num();
+				const bool bHasChanges = FFastArraySerializer::FastArrayDeltaSerialize<FCommonInventoryItem, FCommonInventoryState>(Items, DeltaParms, *this);
+
+				InitialSyncWindowBegin = nullptr;
+				InitialSyncWindowEnd = nullptr;
+
+				if (bIsComplete)
+				{
+					InitialSyncCursors.Remove(ConnectionKey);
+
+					// Drops item counts cached while the window was applied.
+					if (InitialSyncCursors.IsEmpty())
+					{
+						FFastArraySerializer::MarkArrayDirty();
+					}
+				}
+				else
+				{
+					// Skipped slots aren't a part of the new base state, so a new array key is enough for the next update to pick them up.
+					// Item keys are kept, so synced connections don't resend them. PreReplication() keeps the property dirty meanwhile.
+					IncrementArrayReplicationKey();
+				}
+
+				// Forget closed connections.
+				for (auto It = InitialSyncCursors.CreateIterator(); It; ++It)
+				{
+					if (!It.Key().ResolveObjectPtr())
+					{
+						It.RemoveCurrent();
+					}
+				}
+
+				return bHasChanges;
+			}
+		}
+	}
+	else if (DeltaParms.Reader)
+	{
+		DeltaParms.Reader->SerializeIntPacked(reinterpret_cast<uint32&>(NumSlots));
+		NumSyncedSlotsExpected = NumSlots;
+	}
+
+	return FFastArraySerializer::FastArrayDeltaSerialize<FCommonInventoryItem, FCommonInventoryState>(Items, DeltaParms, *this);
+}
+
+/************************************************************************/
+/* FCommonInventoryPredictionScope                                      */
+/************************************************************************/
+
+static FCommonInventoryPredictionScope* ActivePredictionScope = nullptr;
+
+FCommonInventoryPredictionScope::FCommonInventoryPredictionScope(TArray<FCommonInventoryPredictedSlot>& InSnapshots)
+	: Snapshots(InSnapshots)
+	, PreviousScope(ActivePredictionScope)
+{
+	check(IsInGameThread());
+	ActivePredictionScope = this;
+}
+
+FCommonInventoryPredictionScope::~FCommonInventoryPredictionScope()
+{
+	ActivePredictionScope = PreviousScope;
+}
+
+void FCommonInventoryPredictionScope::CaptureSlot(FCommonInventoryState& InState, int32 InSlot)
+{
+	if (FCommonInventoryPredictionScope* const Scope = ActivePredictionScope)
+	{
+		// Only the state before the first mutation matters.
+		const bool bIsCaptured = Scope->Snapshots.ContainsByPredicate([&InState, InSlot](const FCommonInventoryPredictedSlot& Snapshot)
+			{
+				return Snapshot.State == &InState && Snapshot.Slot == InSlot;
+			});
+
+		if (!bIsCaptured)
+		{
+			Scope->Snapshots.Add({ &InState, InSlot, InState.GetItem(InSlot), InState.GetReplicationRevision() });
+		}
+	}
+}
+
+/************************************************************************/
+/* FCommonInventoryStateChangeTracker                                   */
+/************************************************************************/
+
+void FCommonInventoryStateChangeTracker::MarkSlotDirty(int32 InSlot)
+{
+	check(InSlot >= 0);
+
+	if (InSlot >= DirtySlotsMask.Num())
+	{
+		DirtySlotsMask.Add(false, InSlot + 1 - DirtySlotsMask.Num());
+	}
+
+	if (!DirtySlotsMask[InSlot])
+	{
+		DirtySlotsMask[InSlot] = true;
+		DirtySlots.Add(InSlot);
+
+		if (DirtySlots.Num() == 1)
+		{
+			OnChangesPending.ExecuteIfBound();
+		}
+	}
+}
+
+void FCommonInventoryStateChangeTracker::Flush(const FCommonInventoryState& InState)
+{
+	if (DirtySlots.IsEmpty())
+	{
+		return;
+	}
+
+	const TConstArrayView<FCommonInventoryItem> Items = InState.GetItems();
+
+	if (OccupiedSlots.Num() < Items.Num())
+	{
+		OccupiedSlots.Add(false, Items.Num() - OccupiedSlots.Num());
+	}
+
+	DirtySlots.Sort();
+	Journal.Reset();
+
+	for (const int32 Slot : DirtySlots)
+	{
+		DirtySlotsMask[Slot] = false;
+
+		// Slots might be released by the replication.
+		const bool bWasOccupied = OccupiedSlots.IsValidIndex(Slot) && OccupiedSlots[Slot];
+		const bool bIsOccupied = Items.IsValidIndex(Slot) && !Items[Slot].IsEmpty();
+
+		if (OccupiedSlots.IsValidIndex(Slot))
+		{
+			OccupiedSlots[Slot] = bIsOccupied;
+		}
+
+		// Added and removed within the same batch.
+		if (!bWasOccupied && !bIsOccupied)
+		{
+			continue;
+		}
+
+		const ECommonInventoryStateEventType EventType = !bWasOccupied ? ECommonInventoryStateEventType::ItemAdded
+			: !bIsOccupied ? ECommonInventoryStateEventType::ItemRemoved : ECommonInventoryStateEventType::ItemUpdated;
+
+		// Extend the previous range if possible.
+		if (FCommonInventoryStateChangeRange* const LastRange = Journal.IsEmpty() ? nullptr : &Journal.Last(); LastRange && LastRange->EventType == EventType && LastRange->FirstSlot + LastRange->NumSlots == Slot)
+		{
+			++LastRange->NumSlots;
+		}
+		else
+		{
+			Journal.Add({ EventType, Slot, 1 });
+		}
+	}
+
+	DirtySlots.Reset();
+
+	if (!Journal.IsEmpty())
+	{
+		OnStateChangedDelegate.Broadcast(FCommonInventoryStateChangeTrackerContext{ InState, Journal });
+	}
+}
+
+void FCommonInventoryStateChangeTracker::Reset()
+{
+	DirtySlots.Empty();
+	DirtySlotsMask.Empty();
+	OccupiedSlots.Empty();
+	Journal.Empty();
+}
+
+/************************************************************************/
+/* FCommonInventoryAggregates                                           */
+/************************************************************************/
+
+int32 FCommonInventoryAggregates::Register(const FCommonInventoryState& InState, FCommonInventoryAggregateEvaluator&& InEvaluator)
+{
+	if (!InEvaluator)
+	{
+		return INDEX_NONE;
+	}
+
+	const int32 AggregateId = Aggregates.Add(FAggregate{ MoveTemp(InEvaluator) });
+	FAggregate& Aggregate = Aggregates[AggregateId];
+
+	const TConstArrayView<FCommonInventoryItem> Items = InState.GetItems();
+	Aggregate.SlotValues.SetNumZeroed(Items.Num());
+
+	if (const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
+	{
+		for (int32 Slot = 0; Slot < Items.Num(); ++Slot)
+		{
+			if (const FCommonInventoryRegistryRecord* const Record = Items[Slot].IsEmpty() ? nullptr : Registry->GetRegistryRecord(Items[Slot].PrimaryAssetId))
+			{
+				Aggregate.SlotValues[Slot] = Evaluate(Aggregate, Items[Slot], *Record);
+				Aggregate.Value += Aggregate.SlotValues[Slot];
+			}
+		}
+	}
+
+	return AggregateId;
+}
+
+void FCommonInventoryAggregates::Unregister(int32 InAggregateId)
+{
+	if (Aggregates.IsValidIndex(InAggregateId))
+	{
+		Aggregates.RemoveAt(InAggregateId);
+	}
+}
+
+void FCommonInventoryAggregates::UpdateSlot(const FCommonInventoryState& InState, int32 InSlot)
+{
+	check(InSlot >= 0);
+
+	if (Aggregates.IsEmpty())
+	{
+		return;
+	}
+
+	// Slots might be released by the replication.
+	const TConstArrayView<FCommonInventoryItem> Items = InState.GetItems();
+	const FCommonInventoryItem* const Item = Items.IsValidIndex(InSlot) && !Items[InSlot].IsEmpty() ? &Items[InSlot] : nullptr;
+	const UCommonInventoryRegistry* const Registry = Item ? UCommonInventoryRegistry::GetPtr() : nullptr;
+	const FCommonInventoryRegistryRecord* const Record = Registry ? Registry->GetRegistryRecord(Item->PrimaryAssetId) : nullptr;
+
+	for (FAggregate& Aggregate : Aggregates)
+	{
+		if (InSlot >= Aggregate.SlotValues.Num())
+		{
+			Aggregate.SlotValues.AddZeroed(InSlot + 1 - Aggregate.SlotValues.Num());
+		}
+
+		const int64 NewValue = Record ? Evaluate(Aggregate, *Item, *Record) : 0;
+		Aggregate.Value += NewValue - Aggregate.SlotValues[InSlot];
+		Aggregate.SlotValues[InSlot] = NewValue;
+	}
+}
+
+void FCommonInventoryAggregates::Rebuild(const FCommonInventoryState& InState)
+{
+	if (Aggregates.IsEmpty())
+	{
+		return;
+	}
+
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryAggregates::Rebuild);
+
+	const TConstArrayView<FCommonInventoryItem> Items = InState.GetItems();
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	for (FAggregate& Aggregate : Aggregates)
+	{
+		Aggregate.SlotValues.Reset();
+		Aggregate.SlotValues.SetNumZeroed(Items.Num());
+		Aggregate.Value = 0;
+	}
+
+	if (!Registry)
+	{
+		return;
+	}
+
+	// Slots are visited once, so each record is looked up once for all the aggregates.
+	for (int32 Slot = 0; Slot < Items.Num(); ++Slot)
+	{
+		if (const FCommonInventoryRegistryRecord* const Record = Items[Slot].IsEmpty() ? nullptr : Registry->GetRegistryRecord(Items[Slot].PrimaryAssetId))
+		{
+			for (FAggregate& Aggregate : Aggregates)
+			{
+				Aggregate.SlotValues[Slot] = Evaluate(Aggregate, Items[Slot], *Record);
+				Aggregate.Value += Aggregate.SlotValues[Slot];
+			}
+		}
+	}
+}
+
+FCommonInventoryAggregateEvaluator FCommonInventoryAggregates::CountItem(FPrimaryAssetId InPrimaryAssetId)
+{
+	return [InPrimaryAssetId](const FCommonInventoryItem& InItem, const FCommonInventoryRegistryRecord&)
+		{
+			return InItem.PrimaryAssetId == InPrimaryAssetId ? static_cast<double>(InItem.StackSize) : 0.0;
+		};
+}
+
+FCommonInventoryAggregateEvaluator FCommonInventoryAggregates::CountArchetype(FPrimaryAssetType InArchetype)
+{
+	return [InArchetype](const FCommonInventoryItem& InItem, const FCommonInventoryRegistryRecord&)
+		{
+			return InItem.PrimaryAssetId.PrimaryAssetType == InArchetype ? static_cast<double>(InItem.StackSize) : 0.0;
+		};
+}
+
+FCommonInventoryAggregateEvaluator FCommonInventoryAggregates::CountTag(FGameplayTag InTag)
+{
+	return [InTag](const FCommonInventoryItem& InItem, const FCommonInventoryRegistryRecord& InRecord)
+		{
+			return InRecord.SharedData.GameplayTags.HasTag(InTag) ? static_cast<double>(InItem.StackSize) : 0.0;
+		};
+}
+
+FCommonInventoryAggregateEvaluator FCommonInventoryAggregates::SumCustomDataField(const UScriptStruct* InCustomDataType, FName InPropertyName)
+{
+	// The property is resolved once, so the evaluation is a single offset read.
+	const FNumericProperty* const Property = InCustomDataType ? CastField<FNumericProperty>(InCustomDataType->FindPropertyByName(InPropertyName)) : nullptr;
+
+	if (!Property || Property->IsEnum())
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryAggregates: '%s' isn't a numeric property of '%s'.", *InPropertyName.ToString(), *GetNameSafe(InCustomDataType));
+		return FCommonInventoryAggregateEvaluator();
+	}
+
+	return [InCustomDataType, Property](const FCommonInventoryItem& InItem, const FCommonInventoryRegistryRecord& InRecord)
+		{
+			const UScriptStruct* const CustomDataType = InRecord.CustomData.GetScriptStruct();
+
+			if (!CustomDataType || !CustomDataType->IsChildOf(InCustomDataType))
+			{
+				return 0.0;
+			}
+
+			const void* const Value = Property->ContainerPtrToValuePtr<void>(InRecord.CustomData.GetMemory());
+			const double FieldValue = Property->IsFloatingPoint() ? Property->GetFloatingPointPropertyValue(Value) : static_cast<double>(Property->GetSignedIntPropertyValue(Value));
+			return FieldValue * InItem.StackSize;
+		};
+}
+
+/************************************************************************/
+/* FCommonInventoryStateSnapshot                                        */
+/************************************************************************/
+
+bool FCommonInventoryStateSnapshot::Serialize(FArchive& Ar) const
+{
+	check(Ar.IsSaving() && !Ar.IsLoading());
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryStateSnapshot::Serialize);
+
+	// Saving doesn't mutate items, the item serialization just isn't const.
+	const auto GetMutableItem = [this](int32 InSlot) -> FCommonInventoryItem&
+		{
+			return const_cast<FCommonInventoryItem&>(GetItem(InSlot));
+		};
+
+	// Off the game thread, the registry state is pinned through its published snapshot.
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	uint16 SerializedFlags = static_cast<uint16>(InternalFlags) | (Registry ? FInventoryStateArchiveVersion::BulkArchiveFlag : 0);
+	Ar << SerializedFlags;
+
+	if (EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::Spatial))
+	{
+		uint16 SerializedGridWidth = static_cast<uint16>(GridWidth);
+		Ar << SerializedGridWidth;
+	}
+
+	int32 NumSlots = NumItems;
+
+	if (!Registry)
+	{
+		Ar << NumSlots;
+
+		for (int32 Idx = 0; Idx < NumItems; ++Idx)
+		{
+			GetMutableItem(Idx).Serialize(Ar);
+		}
+
+		return !Ar.IsError();
+	}
+
+	uint8 Version = FInventoryStateArchiveVersion::LatestVersion;
+	Ar << Version << NumSlots;
+
+	return FCommonInventoryState::SerializeBulkRows(Ar, *Registry, NumItems, GetMutableItem);
 }
@@ -58,6 +58,17 @@ FSoftObjectPath FCommonItem::GetAssetPath() const
 	return FSoftObjectPath();
 }
 
+const FCommonInventoryRegistryRecord* FCommonItem::GetRegistryRecord(FCommonItemHandle& InOutHandle) const
+{
+	if (PrimaryAssetId.IsValid())
+	{
+		return UCommonInventoryRegistry::Get().ResolveItemHandle(InOutHandle, PrimaryAssetId);
+	}
+
+	InOutHandle.Reset();
+	return nullptr;
+}
+
 void FCommonItem::ResetItem()
 {
 	if (PrimaryAssetId.IsValid())
@@ -85,6 +96,25 @@ bool FCommonItem::ValidateItem() const
 	}
 }
 
+FAssetIdentifier FCommonItem::MakeSearchableName(FPrimaryAssetId InPrimaryAssetId)
+{
+	return FAssetIdentifier(FCommonItem::StaticStruct(), FindSearchableName(InPrimaryAssetId));
+}
+
+FName FCommonItem::FindSearchableName(FPrimaryAssetId InPrimaryAssetId)
+{
+	// Registered items use names cached by the registry, which avoids building strings and contending on the name table.
+	if (const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
+	{
+		if (const FName SearchableName = Registry->GetSearchableName(InPrimaryAssetId); !SearchableName.IsNone())
+		{
+			return SearchableName;
+		}
+	}
+
+	return FName(InPrimaryAssetId.ToString());
+}
+
 void FCommonItem::SynchronizeItem()
 {
 	if (PrimaryAssetId.IsValid())
@@ -106,14 +136,21 @@ bool FCommonItem::Serialize(FArchive& Ar)
 	// Mark the name as searchable, so we can later find out dependencies through the IAssetRegistry.
 	if (Ar.IsSaving() && PrimaryAssetId.IsValid())
 	{
-		Ar.MarkSearchableName(FCommonItem::StaticStruct(), FName(PrimaryAssetId.ToString()));
+		Ar.MarkSearchableName(FCommonItem::StaticStruct(), FindSearchableName(PrimaryAssetId));
 	}
 #endif
 
 	if (UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
 	{
 		// It's not thread safe to access SharedData as defaults.
-		return Registry->SerializeItem(Ar, PrimaryAssetId, Payload);
+		const bool bResult = Registry->SerializeItem(Ar, PrimaryAssetId, Payload);
+
+#if WITH_EDITOR
+		// Let the defaults propagation reach the item without walking whole packages.
+		FCommonInventoryDefaultsPropagator::Get().RecordItemReference(Ar, PrimaryAssetId);
+#endif
+
+		return bResult;
 	}
 	else if ((Ar.IsObjectReferenceCollector() || Ar.IsSerializingDefaults()))
 	{
@@ -123,11 +160,11 @@ bool FCommonItem::Serialize(FArchive& Ar)
 	return false;
 }
 
-bool FCommonItem::NetSerialize(FArchive& Ar, UPackageMap*, bool& bOutSuccess)
+bool FCommonItem::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
 {
 	// UInventoryRegistry interface will set bOutSuccess and do logging for us.
 	const UCommonInventoryRegistry& Registry = UCommonInventoryRegistry::Get();
-	auto Context = Registry.NetSerializeItem(Ar, PrimaryAssetId, bOutSuccess);
+	auto Context = Registry.NetSerializeItem(Ar, PrimaryAssetId, bOutSuccess, Map);
 	Registry.NetSerializeItemPayload(Ar, Payload, Context);
 
 	return true;
@@ -137,9 +174,9 @@ bool FCommonItem::NetSerialize(FArchive& Ar, UPackageMap*, bool& bOutSuccess)
 /* FCommonItemStack                                                     */
 /************************************************************************/
 
-bool FCommonItemStack::NetSerialize(FArchive& Ar, UPackageMap*, bool& bOutSuccess)
+bool FCommonItemStack::NetSerialize(FArchive& Ar, UPackageMap* Map, bool& bOutSuccess)
 {
-	CommonItem.NetSerialize(Ar, nullptr, bOutSuccess);
+	CommonItem.NetSerialize(Ar, Map, bOutSuccess);
 
 	if (Ar.IsSaving())
 	{
@@ -5,9 +5,16 @@
 #include "CommonInventoryTypes.h"
 #include "InventoryRegistry/CommonInventoryRegistryTypes.h"
 
+#include "AssetRegistry/ARFilter.h"
 #include "AssetRegistry/AssetData.h"
 #include "AssetRegistry/IAssetRegistry.h"
 #include "Containers/UnrealString.h"
+#include "Hash/xxhash.h"
+#include "Misc/EngineVersionComparison.h"
+#include "Misc/StringBuilder.h"
+#include "UObject/EnumProperty.h"
+#include "UObject/TextProperty.h"
+#include "UObject/UnrealType.h"
 #include "UObject/UObjectBaseUtility.h"
 #include "UObject/UObjectThreadContext.h"
 
@@ -27,6 +34,152 @@ FString CommonInventory::GetSerializedObjectPath()
 	return FString(TEXT("None"));
 }
 
+// Hashes the string as UTF-8, since TCHAR width differs across platforms.
+static void HashString(FXxHash64Builder& InOutBuilder, FStringView InString, bool bIgnoreCase = false)
+{
+	TStringBuilder<256> LowerString;
+
+	if (bIgnoreCase)
+	{
+		for (const TCHAR Char : InString)
+		{
+			LowerString.AppendChar(FChar::ToLower(Char));
+		}
+
+		InString = LowerString.ToView();
+	}
+
+	const FTCHARToUTF8 Utf8String(InString.GetData(), InString.Len());
+	const int32 Length = Utf8String.Length();
+	InOutBuilder.Update(&Length, sizeof(Length));
+	InOutBuilder.Update(Utf8String.Get(), Length);
+}
+
+// FName comparison is case-insensitive, and the display string depends on the first registration within the process.
+static void HashName(FXxHash64Builder& InOutBuilder, FName InName)
+{
+	TStringBuilder<FName::StringBufferSize> NameString;
+	InName.AppendString(NameString);
+	HashString(InOutBuilder, NameString.ToView(), /* bIgnoreCase */ true);
+}
+
+static void HashPropertyValue(FXxHash64Builder& InOutBuilder, const FProperty* InProperty, const void* InValue)
+{
+	if (const FBoolProperty* const BoolProperty = CastField<FBoolProperty>(InProperty))
+	{
+		const uint8 bValue = BoolProperty->GetPropertyValue(InValue);
+		InOutBuilder.Update(&bValue, sizeof(bValue));
+	}
+	else if (const FEnumProperty* const EnumProperty = CastField<FEnumProperty>(InProperty))
+	{
+		HashPropertyValue(InOutBuilder, EnumProperty->GetUnderlyingProperty(), InValue);
+	}
+	else if (InProperty->IsA<FNumericProperty>())
+	{
+		// All supported platforms are little-endian.
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+		InOutBuilder.Update(InValue, InProperty->ElementSize);
+#else
+		InOutBuilder.Update(InValue, InProperty->GetElementSize());
+#endif
+	}
+	else if (InProperty->IsA<FNameProperty>())
+	{
+		HashName(InOutBuilder, *static_cast<const FName*>(InValue));
+	}
+	else if (InProperty->IsA<FStrProperty>())
+	{
+		HashString(InOutBuilder, *static_cast<const FString*>(InValue));
+	}
+	else if (InProperty->IsA<FTextProperty>())
+	{
+		// The display string depends on the current culture.
+		HashString(InOutBuilder, static_cast<const FText*>(InValue)->BuildSourceString());
+	}
+	else if (const FStructProperty* const StructProperty = CastField<FStructProperty>(InProperty))
+	{
+		CommonInventory::HashScriptStruct(InOutBuilder, StructProperty->Struct, InValue);
+	}
+	else if (const FArrayProperty* const ArrayProperty = CastField<FArrayProperty>(InProperty))
+	{
+		FScriptArrayHelper ArrayHelper(ArrayProperty, InValue);
+		const int32 Num = ArrayHelper.Num();
+		InOutBuilder.Update(&Num, sizeof(Num));
+
+		for (int32 Idx = 0; Idx < Num; ++Idx)
+		{
+			HashPropertyValue(InOutBuilder, ArrayProperty->Inner, ArrayHelper.GetRawPtr(Idx));
+		}
+	}
+	else if (const FSetProperty* const SetProperty = CastField<FSetProperty>(InProperty))
+	{
+		FScriptSetHelper SetHelper(SetProperty, InValue);
+		const int32 Num = SetHelper.Num();
+		InOutBuilder.Update(&Num, sizeof(Num));
+
+		for (FScriptSetHelper::FIterator It(SetHelper); It; ++It)
+		{
+			HashPropertyValue(InOutBuilder, SetProperty->ElementProp, SetHelper.GetElementPtr(It));
+		}
+	}
+	else if (const FMapProperty* const MapProperty = CastField<FMapProperty>(InProperty))
+	{
+		FScriptMapHelper MapHelper(MapProperty, InValue);
+		const int32 Num = MapHelper.Num();
+		InOutBuilder.Update(&Num, sizeof(Num));
+
+		for (FScriptMapHelper::FIterator It(MapHelper); It; ++It)
+		{
+			HashPropertyValue(InOutBuilder, MapProperty->KeyProp, MapHelper.GetKeyPtr(It));
+			HashPropertyValue(InOutBuilder, MapProperty->ValueProp, MapHelper.GetValuePtr(It));
+		}
+	}
+	else
+	{
+		// Object references and other exotic properties fall back to the text representation.
+		FString ExportedValue;
+		InProperty->ExportTextItem_Direct(ExportedValue, InValue, /* DefaultValue */ nullptr, /* Parent */ nullptr, PPF_None);
+		HashString(InOutBuilder, ExportedValue);
+	}
+}
+
+void CommonInventory::HashScriptStruct(FXxHash64Builder& InOutBuilder, const UScriptStruct* InScriptStruct, const void* InStructMemory)
+{
+	if (!InScriptStruct || !InStructMemory)
+	{
+		constexpr uint8 NoneMarker = 0;
+		InOutBuilder.Update(&NoneMarker, sizeof(NoneMarker));
+		return;
+	}
+
+	const FTopLevelAssetPath StructPath = InScriptStruct->GetStructPathName();
+	HashName(InOutBuilder, StructPath.GetPackageName());
+	HashName(InOutBuilder, StructPath.GetAssetName());
+
+	// Natively exported structs might hide their state from reflection.
+	if (InScriptStruct->StructFlags & STRUCT_ExportTextItemNative)
+	{
+		FString ExportedValue;
+		InScriptStruct->ExportText(ExportedValue, InStructMemory, /* Defaults */ nullptr, /* OwnerObject */ nullptr, PPF_None, /* ExportRootScope */ nullptr);
+		HashString(InOutBuilder, ExportedValue);
+		return;
+	}
+
+	for (TFieldIterator<FProperty> It(InScriptStruct); It; ++It)
+	{
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+		const int32 ArrayDim = It->ArrayDim;
+#else
+		const int32 ArrayDim = It->GetArrayDim();
+#endif
+
+		for (int32 ArrayIdx = 0; ArrayIdx < ArrayDim; ++ArrayIdx)
+		{
+			HashPropertyValue(InOutBuilder, *It, It->ContainerPtrToValuePtr<void>(InStructMemory, ArrayIdx));
+		}
+	}
+}
+
 bool CommonInventory::HasReferencers(FPrimaryAssetId InPrimaryAssetId, bool bRecursively, bool bUnloadedOnly)
 {
 	TArray<FAssetData> Referencers;
@@ -73,6 +226,87 @@ bool CommonInventory::GetReferencers(FPrimaryAssetId InPrimaryAssetId, TArray<FA
 	return !OutReferencers.IsEmpty();
 }
 
+bool CommonInventory::GetReferencers(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TMap<FPrimaryAssetId, TArray<FAssetData>>& OutReferencers, bool bRecursively, bool bUnloadedOnly)
+{
+	const IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+
+	// Indices of the requested ids, which might share permutations.
+	using FOwners = TArray<int32, TInlineAllocator<1>>;
+	TMap<FAssetIdentifier, FOwners> SearchableNames;
+	SearchableNames.Reserve(InPrimaryAssetIds.Num());
+
+	for (int32 Idx = 0; Idx < InPrimaryAssetIds.Num(); ++Idx)
+	{
+		SearchableNames.FindOrAdd(FCommonItem::MakeSearchableName(InPrimaryAssetIds[Idx])).AddUnique(Idx);
+
+		if (bRecursively)
+		{
+			FCommonInventoryRedirects::Get().TraversePermutations(InPrimaryAssetIds[Idx], [&SearchableNames, Idx](FPrimaryAssetId Permutation)
+			{
+				return (SearchableNames.FindOrAdd(FCommonItem::MakeSearchableName(Permutation)).AddUnique(Idx), true); // Continue.
+			});
+		}
+	}
+
+	// Packages referencing any of the searchable names, which are resolved into assets once.
+	TMap<FName, FOwners> Packages;
+	TArray<FAssetIdentifier> Referencers;
+
+	for (const TPair<FAssetIdentifier, FOwners>& SearchableName : SearchableNames)
+	{
+		Referencers.Reset();
+		AssetRegistry.GetReferencers(SearchableName.Key, Referencers, UE::AssetRegistry::EDependencyCategory::SearchableName);
+
+		for (const FAssetIdentifier& Referencer : Referencers)
+		{
+			FOwners& Owners = Packages.FindOrAdd(Referencer.PackageName);
+
+			for (const int32 Owner : SearchableName.Value)
+			{
+				Owners.AddUnique(Owner);
+			}
+		}
+	}
+
+	if (Packages.IsEmpty())
+	{
+		return false;
+	}
+
+	FARFilter Filter;
+	Packages.GenerateKeyArray(Filter.PackageNames);
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssets(Filter, Assets);
+
+	bool bResult = false;
+
+	for (const FAssetData& AssetData : Assets)
+	{
+		if (bUnloadedOnly && AssetData.IsAssetLoaded())
+		{
+			continue;
+		}
+
+		for (const int32 Owner : Packages.FindChecked(AssetData.PackageName))
+		{
+			OutReferencers.FindOrAdd(InPrimaryAssetIds[Owner]).Add(AssetData);
+			bResult = true;
+		}
+	}
+
+	return bResult;
+}
+
+bool CommonInventory::HasReferencers(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TArray<FPrimaryAssetId>& OutReferencedIds, bool bRecursively, bool bUnloadedOnly)
+{
+	TMap<FPrimaryAssetId, TArray<FAssetData>> Referencers;
+	const bool bResult = GetReferencers(InPrimaryAssetIds, Referencers, bRecursively, bUnloadedOnly);
+
+	Referencers.GenerateKeyArray(OutReferencedIds);
+	return bResult;
+}
+
 #if WITH_EDITOR
 
 bool CommonInventory::ValidateNamingConvention(const FString& InName, FText* OutErrorMessage /* = nullptr */)
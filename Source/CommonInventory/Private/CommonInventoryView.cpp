@@ -2,4 +2,215 @@
 
 #include "CommonInventoryView.h"
 
+#include "Algo/BinarySearch.h"
+#include "Algo/Sort.h"
+#include "Components/CommonInventoryComponent.h"
+
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryView)
+
+/************************************************************************/
+/* FCommonInventoryTraversingParams                                     */
+/************************************************************************/
+
+bool FCommonInventoryTraversingParams::PassesFilter(const FCommonInventoryItem& InItem) const
+{
+	if (InItem.IsEmpty())
+	{
+		return bIncludeEmptyItems;
+	}
+
+	if (InItem.IsRedirector())
+	{
+		return bIncludeRedirects;
+	}
+
+	if (!ArchetypesFilter.IsEmpty() && !ArchetypesFilter.Contains(InItem.PrimaryAssetId.PrimaryAssetType))
+	{
+		return false;
+	}
+
+	if (PayloadFilter)
+	{
+		const UScriptStruct* const ScriptStruct = InItem.ItemPayload.GetScriptStruct();
+		return ScriptStruct && ScriptStruct->IsChildOf(PayloadFilter);
+	}
+
+	return true;
+}
+
+/************************************************************************/
+/* FCommonInventoryView                                                 */
+/************************************************************************/
+
+FCommonInventoryView::FCommonInventoryView(const UCommonInventoryComponent* InComponent, const FCommonInventoryTraversingParams& InParams)
+{
+	if (InComponent)
+	{
+		SharedState = MakeShared<FStateData>();
+		SharedState->OriginalComponent = InComponent;
+		SharedState->Params = InParams;
+
+		// The view is refreshed lazily, so only changed slots are recorded.
+		SharedState->OnStateChangedHandle = const_cast<UCommonInventoryComponent*>(InComponent)->Register_OnInventoryChanged(
+			FCommonInventoryStateChangeTracker::FOnStateChanged::FDelegate::CreateSP(SharedState.ToSharedRef(), &FStateData::OnStateChanged));
+	}
+}
+
+TConstArrayView<int32> FCommonInventoryView::GetSlots() const
+{
+	if (IsValid())
+	{
+		SharedState->Refresh();
+		return SharedState->Permutation;
+	}
+
+	return TConstArrayView<int32>();
+}
+
+const FCommonInventoryItem& FCommonInventoryView::GetItem(int32 InIndex) const
+{
+	const TConstArrayView<int32> Slots = GetSlots();
+	return SharedState->OriginalComponent->GetInventoryState().GetItem(Slots[InIndex]);
+}
+
+void FCommonInventoryView::Invalidate()
+{
+	if (SharedState.IsValid())
+	{
+		SharedState->bNeedsRebuild = true;
+	}
+}
+
+FCommonInventoryView::FStateData::~FStateData()
+{
+	if (UCommonInventoryComponent* const Component = const_cast<UCommonInventoryComponent*>(OriginalComponent.Get()))
+	{
+		Component->Unregister_OnInventoryChanged(OnStateChangedHandle);
+	}
+}
+
+void FCommonInventoryView::FStateData::OnStateChanged(const FCommonInventoryStateChangeTrackerContext& InContext)
+{
+	if (bNeedsRebuild)
+	{
+		return;
+	}
+
+	for (const FCommonInventoryStateChangeRange& Range : InContext.Ranges)
+	{
+		for (int32 Slot = Range.FirstSlot; Slot < Range.FirstSlot + Range.NumSlots; ++Slot)
+		{
+			if (Slot >= PendingSlotsMask.Num())
+			{
+				PendingSlotsMask.Add(false, Slot + 1 - PendingSlotsMask.Num());
+			}
+
+			if (!PendingSlotsMask[Slot])
+			{
+				PendingSlotsMask[Slot] = true;
+				PendingSlots.Add(Slot);
+			}
+		}
+	}
+}
+
+void FCommonInventoryView::FStateData::Refresh()
+{
+	// Changes are batched until the next tick, so a read right after a mutation flushes them to stay current.
+	// Listeners notified by the flush may read the view again, which is fine because the tracker is reset before broadcasting.
+	if (IsInGameThread())
+	{
+		const_cast<UCommonInventoryComponent*>(OriginalComponent.Get())->FlushPendingInventoryChanges();
+	}
+
+	const FCommonInventoryState& State = OriginalComponent->GetInventoryState();
+
+	// Growth doesn't produce events, but empty slots might be included.
+	if (CachedCapacity != State.GetCapacity())
+	{
+		bNeedsRebuild = true;
+	}
+
+	// A full rebuild is cheaper than a lot of ordered insertions.
+	if (bNeedsRebuild || PendingSlots.Num() > FMath::Max(Permutation.Num() / 4, 8))
+	{
+		Rebuild(State);
+		return;
+	}
+
+	if (PendingSlots.IsEmpty())
+	{
+		return;
+	}
+
+	// Remove the changed slots in a single pass, then reinsert the ones that still pass.
+	Permutation.RemoveAll([this](int32 Slot)
+		{
+			return PendingSlotsMask.IsValidIndex(Slot) && PendingSlotsMask[Slot];
+		});
+
+	for (const int32 Slot : PendingSlots)
+	{
+		PendingSlotsMask[Slot] = false;
+
+		if (Slot < State.GetCapacity() && Params.PassesFilter(State.GetItem(Slot)))
+		{
+			InsertSlot(State, Slot);
+		}
+	}
+
+	PendingSlots.Reset();
+}
+
+void FCommonInventoryView::FStateData::Rebuild(const FCommonInventoryState& InState)
+{
+	Permutation.Reset();
+	PendingSlots.Reset();
+	PendingSlotsMask.Init(false, PendingSlotsMask.Num());
+	CachedCapacity = InState.GetCapacity();
+	bNeedsRebuild = false;
+
+	for (int32 Slot = 0; Slot < CachedCapacity; ++Slot)
+	{
+		if (Params.PassesFilter(InState.GetItem(Slot)))
+		{
+			Permutation.Add(Slot);
+		}
+	}
+
+	// Slots are already in the ascending order.
+	if (Params.SortPredicate)
+	{
+		Algo::StableSort(Permutation, [&InState, this](int32 Lhs, int32 Rhs)
+			{
+				return Params.SortPredicate(InState.GetItem(Lhs), InState.GetItem(Rhs));
+			});
+	}
+}
+
+void FCommonInventoryView::FStateData::InsertSlot(const FCommonInventoryState& InState, int32 InSlot)
+{
+	// Ties are resolved by slots to match the stable sort.
+	const int32 InsertIndex = Algo::UpperBound(Permutation, InSlot, [&InState, this](int32 Lhs, int32 Rhs)
+		{
+			if (Params.SortPredicate)
+			{
+				const FCommonInventoryItem& LhsItem = InState.GetItem(Lhs);
+				const FCommonInventoryItem& RhsItem = InState.GetItem(Rhs);
+
+				if (Params.SortPredicate(LhsItem, RhsItem))
+				{
+					return true;
+				}
+
+				if (Params.SortPredicate(RhsItem, LhsItem))
+				{
+					return false;
+				}
+			}
+
+			return Lhs < Rhs;
+		});
+
+	Permutation.Insert(InSlot, InsertIndex);
+}
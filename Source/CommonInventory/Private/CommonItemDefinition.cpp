@@ -2,6 +2,12 @@
 
 #include "CommonItemDefinition.h"
 
+#include "Misc/Base64.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "UObject/AssetRegistryTagsContext.h"
+
 #if WITH_EDITOR
 #include "CommonInventoryUtility.h"
 #include "InventoryRegistry/CommonInventoryRegistry.h"
@@ -26,6 +32,91 @@ void UCommonItemDefinition::PostInitProperties()
 	}
 }
 
+/************************************************************************/
+/* Registry Tags                                                        */
+/************************************************************************/
+
+const FName UCommonItemDefinition::RegistryDataTagName = FName("CommonInventoryRegistryData");
+
+namespace CommonInventory
+{
+	// Bump to invalidate all the exported tags, so they are refreshed by loading assets.
+	static constexpr uint32 REGISTRY_DATA_TAG_VERSION = 1;
+
+	// Returns false if any of the payload types failed to resolve.
+	static bool SerializeRegistryData(FArchive& Ar, FCommonItemSharedData& SharedData, FInstancedStruct& DefaultItemPayload, FInstancedStruct& RegistryCustomData)
+	{
+		bool bHasDefaultItemPayload = DefaultItemPayload.IsValid();
+		bool bHasRegistryCustomData = RegistryCustomData.IsValid();
+		Ar << bHasDefaultItemPayload << bHasRegistryCustomData;
+
+		FCommonItemSharedData::StaticStruct()->SerializeItem(Ar, &SharedData, /* Defaults */ nullptr);
+		FInstancedStruct::StaticStruct()->SerializeItem(Ar, &DefaultItemPayload, /* Defaults */ nullptr);
+		FInstancedStruct::StaticStruct()->SerializeItem(Ar, &RegistryCustomData, /* Defaults */ nullptr);
+
+		return bHasDefaultItemPayload == DefaultItemPayload.IsValid() && bHasRegistryCustomData == RegistryCustomData.IsValid();
+	}
+}
+
+FString UCommonItemDefinition::ExportRegistryDataTag() const
+{
+	TArray<uint8> Buffer;
+	FMemoryWriter MemoryWriter(Buffer, /* bIsPersistent */ true);
+	FObjectAndNameAsStringProxyArchive Writer(MemoryWriter, /* bInLoadIfFindFails */ false);
+
+	uint32 Version = CommonInventory::REGISTRY_DATA_TAG_VERSION;
+	Writer << Version;
+
+	FCommonItemSharedData SharedDataCopy = SharedData;
+	SharedDataCopy.PrimaryAssetId = GetPrimaryAssetId();
+	CommonInventory::SerializeRegistryData(Writer, SharedDataCopy, const_cast<FInstancedStruct&>(DefaultItemPayload), const_cast<FInstancedStruct&>(RegistryCustomData));
+
+	return FBase64::Encode(Buffer);
+}
+
+bool UCommonItemDefinition::ImportRegistryDataTag(const FString& InTagValue, FCommonItemSharedData& OutSharedData, FInstancedStruct& OutDefaultItemPayload, FInstancedStruct& OutRegistryCustomData)
+{
+	TArray<uint8> Buffer;
+
+	if (InTagValue.IsEmpty() || !FBase64::Decode(InTagValue, Buffer))
+	{
+		return false;
+	}
+
+	FMemoryReader MemoryReader(Buffer, /* bIsPersistent */ true);
+	FObjectAndNameAsStringProxyArchive Reader(MemoryReader, IsInGameThread()); // Load UUserDefinedStruct* if needed, which is only safe on the game thread.
+
+	uint32 Version = 0;
+	Reader << Version;
+
+	if (Version != CommonInventory::REGISTRY_DATA_TAG_VERSION || Reader.IsError())
+	{
+		return false;
+	}
+
+	// Payload types might have been removed since the tag was exported.
+	const bool bHasResolvedTypes = CommonInventory::SerializeRegistryData(Reader, OutSharedData, OutDefaultItemPayload, OutRegistryCustomData);
+	return bHasResolvedTypes && Reader.AtEnd() && !Reader.IsError() && OutSharedData.PrimaryAssetId.IsValid();
+}
+
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+
+void UCommonItemDefinition::GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const
+{
+	Super::GetAssetRegistryTags(OutTags);
+	OutTags.Emplace(RegistryDataTagName, ExportRegistryDataTag(), FAssetRegistryTag::TT_Hidden);
+}
+
+#else
+
+void UCommonItemDefinition::GetAssetRegistryTags(FAssetRegistryTagsContext Context) const
+{
+	Super::GetAssetRegistryTags(Context);
+	Context.AddTag(FAssetRegistryTag(RegistryDataTagName, ExportRegistryDataTag(), FAssetRegistryTag::TT_Hidden));
+}
+
+#endif // UE_VERSION_OLDER_THAN(5, 4, 0)
+
 #if WITH_EDITOR
 
 void UCommonItemDefinition::PreSave(FObjectPreSaveContext ObjectSaveContext)
@@ -3,12 +3,20 @@
 #include "Components/CommonInventoryComponent.h"
 
 #include "Commands/CommonInventoryCommandController.h"
+#include "Commands/CommonInventoryCommandScheduler.h"
 #include "CommonInventoryLog.h"
 #include "CommonInventoryReplication.h"
+#include "CommonInventorySettings.h"
+#include "InventoryRegistry/CommonInventoryRegistry.h"
 
+#include "Async/Async.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "Net/UnrealNetwork.h"
 #include "Net/Subsystems/NetworkSubsystem.h"
+#include "Engine/NetConnection.h"
 #include "Engine/World.h"
+#include "GameFramework/PlayerController.h"
+#include "TimerManager.h"
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryComponent)
 
@@ -31,22 +39,154 @@ void UCommonInventoryComponent::InitializeComponent()
 		SetIsReplicated(true);
 	}
 
-	InventoryState.Initialize(DefaultCapacity);
+	// Coalesce changes of the frame into a single batch.
+	ChangeTracker.OnChangesPending.BindWeakLambda(this, [this]()
+		{
+			// Commands might be executed on workers by UCommonInventoryCommandScheduler.
+			if (IsInGameThread())
+			{
+				GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(this, &ThisClass::FlushInventoryChanges));
+			}
+			else
+			{
+				AsyncTask(ENamedThreads::GameThread, [WeakThis = TWeakObjectPtr<ThisClass>(this)]()
+					{
+						if (ThisClass* const This = WeakThis.Get())
+						{
+							This->GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(This, &ThisClass::FlushInventoryChanges));
+						}
+					});
+			}
+		});
+
+	InventoryState.SetChangeTracker(&ChangeTracker);
+	InventoryState.SetAggregates(&Aggregates);
+
+	// Contributions are evaluated from the records, which are only complete once the registry and its patch are loaded, and change with each refresh.
+	UCommonInventoryRegistry::CallOrRegister_OnInventoryRegistryInitialized(FSimpleMulticastDelegate::FDelegate::CreateWeakLambda(this, [this]()
+		{
+			if (UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr(); Registry && !RegistryPostRefreshHandle.IsValid())
+			{
+				Aggregates.Rebuild(InventoryState);
+				RegistryPostRefreshHandle = Registry->Register_OnPostRefresh(FSimpleMulticastDelegate::FDelegate::CreateWeakLambda(this, [this]()
+					{
+						Aggregates.Rebuild(InventoryState);
+					}));
+			}
+		}));
+
+	// Push-model dirtying isn't thread safe, so mutations on workers are forwarded to the game thread once.
+	InventoryState.SetOnReplicationDirty(FSimpleDelegate::CreateWeakLambda(this, [this]()
+		{
+			if (IsInGameThread())
+			{
+				MarkInventoryStateDirty();
+			}
+			else if (!bHasPendingStateDirty.exchange(true))
+			{
+				AsyncTask(ENamedThreads::GameThread, [WeakThis = TWeakObjectPtr<ThisClass>(this)]()
+					{
+						if (ThisClass* const This = WeakThis.Get())
+						{
+							This->bHasPendingStateDirty = false;
+							This->MarkInventoryStateDirty();
+						}
+					});
+			}
+		}));
+
+	if (GridSize.X > 0 && GridSize.Y > 0)
+	{
+		InventoryState.InitializeSpatial(FMath::Min(GridSize.X, FCommonInventoryGrid::MaxWidth), GridSize.Y);
+	}
+	else
+	{
+		InventoryState.Initialize(DefaultCapacity, bIsAutomatic ? ECommonInventoryStateFlags::Automatic : ECommonInventoryStateFlags::NoFlags);
+	}
 }
 
 void UCommonInventoryComponent::UninitializeComponent()
 {
 	InventoryState.Deinitialize();
+	InventoryState.SetChangeTracker(nullptr);
+	InventoryState.SetAggregates(nullptr);
+	InventoryState.SetOnReplicationDirty(FSimpleDelegate());
+
+	if (UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr(); Registry && RegistryPostRefreshHandle.IsValid())
+	{
+		Registry->Unregister_OnPostRefresh(RegistryPostRefreshHandle);
+	}
+
+	RegistryPostRefreshHandle.Reset();
+	ChangeTracker.OnChangesPending.Unbind();
+	ChangeTracker.Reset();
 	Super::UninitializeComponent();
 }
 
 void UCommonInventoryComponent::BeginPlay()
 {
 	Super::BeginPlay();
+
+	if ((ReplicationMode == ECommonInventoryReplicationMode::Protected || ReplicationMode == ECommonInventoryReplicationMode::Auto) && GetOwnerRole() == ROLE_Authority)
+	{
+		// A dedicated group per inventory instead of a group per player keeps condition checks independent of the number of listeners.
+		ListenersNetGroup = FName(ListenersNetGroupName, GetUniqueID());
+
+		if (UNetworkSubsystem* const NetworkSubsystem = GetWorld()->GetSubsystem<UNetworkSubsystem>())
+		{
+			NetworkSubsystem->GetNetConditionGroupManager().RegisterSubObjectInGroup(this, ListenersNetGroup);
+		}
+
+		for (const TWeakObjectPtr<const APlayerController>& PendingListener : PendingListeners)
+		{
+			RegisterInventoryListener(PendingListener.Get());
+		}
+	}
+
+	PendingListeners.Empty();
+
+	if (bDormantWhileIdle && GetOwnerRole() == ROLE_Authority && GetIsReplicated())
+	{
+		WakeOwnerFromDormancy();
+	}
+
+	// Connections to automatic inventories are managed by the prefetcher.
+	if (ReplicationMode == ECommonInventoryReplicationMode::Auto && GetOwnerRole() == ROLE_Authority)
+	{
+		if (const UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+		{
+			InventoryReplication->GetPrefetcher()->RegisterInventory(this);
+		}
+	}
 }
 
 void UCommonInventoryComponent::EndPlay(EEndPlayReason::Type EndPlayReason)
 {
+	if (UWorld* const World = GetWorld())
+	{
+		World->GetTimerManager().ClearTimer(DormancyHandle);
+	}
+
+	if (ReplicationMode == ECommonInventoryReplicationMode::Auto && GetOwnerRole() == ROLE_Authority)
+	{
+		if (const UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+		{
+			InventoryReplication->GetPrefetcher()->UnregisterInventory(this);
+		}
+	}
+
+	if (!ListenersNetGroup.IsNone())
+	{
+		UnregisterAllInventoryListeners();
+
+		if (UNetworkSubsystem* const NetworkSubsystem = GetWorld()->GetSubsystem<UNetworkSubsystem>())
+		{
+			NetworkSubsystem->GetNetConditionGroupManager().UnregisterSubObjectFromGroup(this, ListenersNetGroup);
+		}
+
+		ListenersNetGroup = NAME_None;
+	}
+
 	Super::EndPlay(EndPlayReason);
 }
 
@@ -61,6 +201,17 @@ void UCommonInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimePrope
 	DOREPLIFETIME_WITH_PARAMS_FAST(ThisClass, InventoryState, Params);
 }
 
+void UCommonInventoryComponent::PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker)
+{
+	Super::PreReplication(ChangedPropertyTracker);
+
+	// Keep the paced initial sync going without changes in the state.
+	if (InventoryState.HasPendingInitialSync())
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, InventoryState, this);
+	}
+}
+
 ELifetimeCondition UCommonInventoryComponent::GetReplicationCondition() const
 {
 	switch (ReplicationMode)
@@ -79,9 +230,77 @@ bool UCommonInventoryComponent::GetComponentClassCanReplicate() const
 	return GetReplicationCondition() != COND_Never;
 }
 
+void UCommonInventoryComponent::FlushInventoryChanges()
+{
+	ChangeTracker.Flush(InventoryState);
+}
+
+void UCommonInventoryComponent::MarkInventoryStateDirty()
+{
+	// Predictions on autonomous proxies mutate the state as well.
+	if (GetOwnerRole() == ROLE_Authority)
+	{
+		MARK_PROPERTY_DIRTY_FROM_NAME(ThisClass, InventoryState, this);
+		WakeOwnerFromDormancy();
+	}
+}
+
+void UCommonInventoryComponent::WakeOwnerFromDormancy()
+{
+	if (!bDormantWhileIdle || !HasBegunPlay())
+	{
+		return;
+	}
+
+	LastMutationTime = GetWorld()->GetTimeSeconds();
+
+	if (AActor* const Owner = GetOwner(); Owner->NetDormancy != DORM_Awake)
+	{
+		Owner->SetNetDormancy(DORM_Awake);
+	}
+
+	// The timer isn't restarted per mutation, UpdateOwnerDormancy() checks the last one.
+	if (!GetWorld()->GetTimerManager().IsTimerActive(DormancyHandle))
+	{
+		GetWorld()->GetTimerManager().SetTimer(DormancyHandle, FTimerDelegate::CreateUObject(this, &ThisClass::UpdateOwnerDormancy), FMath::Max(DormancyIdleDelay, UE_KINDA_SMALL_NUMBER), /* bLoop */ false);
+	}
+}
+
+void UCommonInventoryComponent::UpdateOwnerDormancy()
+{
+	const double IdleTime = GetWorld()->GetTimeSeconds() - LastMutationTime;
+
+	// The paced initial sync is driven by PreReplication(), which isn't called for dormant actors.
+	if (IdleTime < DormancyIdleDelay || InventoryState.HasPendingInitialSync())
+	{
+		const float Delay = FMath::Max(IdleTime < DormancyIdleDelay ? static_cast<float>(DormancyIdleDelay - IdleTime) : DormancyIdleDelay, UE_KINDA_SMALL_NUMBER);
+		GetWorld()->GetTimerManager().SetTimer(DormancyHandle, FTimerDelegate::CreateUObject(this, &ThisClass::UpdateOwnerDormancy), Delay, /* bLoop */ false);
+		return;
+	}
+
+	GetOwner()->SetNetDormancy(DORM_DormantAll);
+}
+
+bool UCommonInventoryComponent::LoadInventoryHandoff(TConstArrayView<uint8> Data)
+{
+	if (!ensureMsgf(GetOwnerRole() == ROLE_Authority, TEXT("Unauthorized inventory handoff.")))
+	{
+		return false;
+	}
+
+	// Loading marks the whole array dirty, which dirties the push model and wakes the owner up.
+	if (!InventoryState.LoadHandoff(Data))
+	{
+		COMMON_INVENTORY_LOG(Error, "UCommonInventoryComponent: Failed to load the inventory handoff of '%s'.", *GetPathNameSafe(GetOwner()));
+		return false;
+	}
+
+	return true;
+}
+
 FCommonInventoryView UCommonInventoryComponent::MakeInventoryView(const FCommonInventoryTraversingParams& TraversingParams) const
 {
-	return FCommonInventoryView();
+	return FCommonInventoryView(this, TraversingParams);
 }
 
 void UCommonInventoryComponent::RegisterInventoryListener(const APlayerController* InPlayerController)
@@ -90,13 +309,35 @@ void UCommonInventoryComponent::RegisterInventoryListener(const APlayerControlle
 	{
 		if (ensureMsgf(GetOwnerRole() == ROLE_Authority, TEXT("Unauthorized listener registration.")))
 		{
-			if (const UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+			// The NetGroup is named in BeginPlay.
+			if (!HasBegunPlay())
 			{
-				const FName NetGroup = InventoryReplication->GetInventoryNetGroupForPlayer(InPlayerController);
+				if (InPlayerController)
+				{
+					PendingListeners.AddUnique(InPlayerController);
+				}
+
+				return;
+			}
 
-				if (UNetworkSubsystem* const NetworkSubsystem = GetWorld()->GetSubsystem<UNetworkSubsystem>())
+			if (UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+			{
+				const int32 ListenerId = InventoryReplication->GetListenerId(InPlayerController);
+
+				if (ListenerId != INDEX_NONE && !IsInventoryListenerId(ListenerId))
 				{
-					NetworkSubsystem->GetNetConditionGroupManager().RegisterSubObjectInGroup(this, NetGroup);
+					if (Listeners.Num() <= ListenerId)
+					{
+						Listeners.Add(false, ListenerId + 1 - Listeners.Num());
+					}
+
+					// The new listener has to receive the state.
+					WakeOwnerFromDormancy();
+
+					// The inventory is the only member of its group, so relevancy is a single lookup on the connection side.
+					Listeners[ListenerId] = true;
+					const_cast<APlayerController*>(InPlayerController)->IncludeInNetConditionGroup(ListenersNetGroup);
+					InventoryReplication->AddListenedInventory(ListenerId, this);
 				}
 			}
 		}
@@ -109,25 +350,150 @@ void UCommonInventoryComponent::UnregisterInventoryListener(const APlayerControl
 	{
 		if (ensureMsgf(GetOwnerRole() == ROLE_Authority, TEXT("Unauthorized listener registration.")))
 		{
-			if (const UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+			PendingListeners.Remove(InPlayerController);
+
+			if (UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
 			{
-				const FName NetGroup = InventoryReplication->GetInventoryNetGroupForPlayer(InPlayerController);
+				const int32 ListenerId = InventoryReplication->GetListenerId(InPlayerController);
 
-				if (UNetworkSubsystem* const NetworkSubsystem = GetWorld()->GetSubsystem<UNetworkSubsystem>())
+				if (ListenerId != INDEX_NONE && IsInventoryListenerId(ListenerId))
 				{
-					NetworkSubsystem->GetNetConditionGroupManager().UnregisterSubObjectFromGroup(this, NetGroup);
+					Listeners[ListenerId] = false;
+					const_cast<APlayerController*>(InPlayerController)->RemoveFromNetConditionGroup(ListenersNetGroup);
+					InventoryReplication->RemoveListenedInventory(ListenerId, this);
 				}
 			}
 		}
 	}
 }
 
+bool UCommonInventoryComponent::IsInventoryListener(const APlayerController* InPlayerController) const
+{
+	if (const UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+	{
+		return IsInventoryListenerId(InventoryReplication->GetListenerId(InPlayerController));
+	}
+
+	return false;
+}
+
+void UCommonInventoryComponent::UnregisterAllInventoryListeners()
+{
+	if (const UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+	{
+		const TBitArray<> RegisteredListeners = Listeners;
+
+		for (TConstSetBitIterator<> It(RegisteredListeners); It; ++It)
+		{
+			UnregisterInventoryListener(InventoryReplication->GetListener(It.GetIndex()));
+		}
+	}
+
+	Listeners.Empty();
+}
+
+bool UCommonInventoryComponent::CanBeAccessedBy(const AActor* InAuthOwner) const
+{
+	if (!InAuthOwner)
+	{
+		return false;
+	}
+
+	const AActor* const Owner = GetOwner();
+	const AActor* const NetOwner = InAuthOwner->GetNetOwner();
+
+	if (Owner == InAuthOwner || (NetOwner && Owner->GetNetOwner() == NetOwner))
+	{
+		return true;
+	}
+
+	// E.g. containers the player has been granted to interact with.
+	const APlayerController* const PlayerController = Cast<APlayerController>(NetOwner);
+	return PlayerController && IsInventoryListener(PlayerController);
+}
+
 FCommonInventoryCommandController* UCommonInventoryComponent::GetCommandController() const
 {
 	if (CommandController == nullptr && GetOwnerRole() > ROLE_SimulatedProxy)
 	{
 		CommandController = MakeUnique<FCommonInventoryCommandController>(GetOwner());
+
+		// Accumulate commands in between flushes.
+		CommandController->OnCommandQueued.BindWeakLambda(const_cast<UCommonInventoryComponent*>(this), [this]()
+			{
+				const float FlushRate = UCommonInventorySettings::Get()->CommandQueueFlushRate;
+				UCommonInventoryComponent* const MutableThis = const_cast<UCommonInventoryComponent*>(this);
+
+				if (FlushRate > 0.f)
+				{
+					GetWorld()->GetTimerManager().SetTimer(MutableThis->CommandQueueFlushHandle, FTimerDelegate::CreateUObject(MutableThis, &ThisClass::FlushCommandQueue), FlushRate, /* bLoop */ false);
+				}
+				else
+				{
+					GetWorld()->GetTimerManager().SetTimerForNextTick(FTimerDelegate::CreateUObject(MutableThis, &ThisClass::FlushCommandQueue));
+				}
+			});
 	}
 
 	return CommandController.Get();
 }
+
+void UCommonInventoryComponent::FlushCommandQueue()
+{
+	if (CommandController)
+	{
+		if (FCommonInventoryCommandBatch Batch; CommandController->FlushQueuedCommands(Batch))
+		{
+			ServerExecuteCommands(Batch);
+		}
+	}
+}
+
+void UCommonInventoryComponent::ServerExecuteCommands_Implementation(const FCommonInventoryCommandBatch& Batch)
+{
+	// Interactions keep the involved inventories prefetched.
+	if (const UCommonInventoryReplication* const InventoryReplication = GetWorld()->GetSubsystem<UCommonInventoryReplication>())
+	{
+		if (const UNetConnection* const NetConnection = GetOwner()->GetNetConnection())
+		{
+			for (const FCommonInventoryCommandBunch& Bunch : Batch.Bunches)
+			{
+				InventoryReplication->GetPrefetcher()->NotifyInteraction(NetConnection->PlayerController, Bunch.SourceComponent);
+				InventoryReplication->GetPrefetcher()->NotifyInteraction(NetConnection->PlayerController, Bunch.TargetComponent);
+			}
+		}
+	}
+
+	// Batches of the frame are executed together, so independent inventories can be processed in parallel.
+	if (UCommonInventoryCommandScheduler* const CommandScheduler = GetWorld()->GetSubsystem<UCommonInventoryCommandScheduler>())
+	{
+		CommandScheduler->EnqueueBatch(this, Batch);
+	}
+	else
+	{
+		FCommonInventoryCommandController* const Controller = GetCommandController();
+		FCommonInventoryCommandAck Ack;
+		CommitCommandBatch(Controller && Controller->ExecuteBatch(Batch, Ack), Ack);
+	}
+}
+
+void UCommonInventoryComponent::CommitCommandBatch(bool bIsExecuted, const FCommonInventoryCommandAck& Ack)
+{
+	if (bIsExecuted)
+	{
+		ClientAcknowledgeCommands(Ack);
+	}
+	else if (UNetConnection* const NetConnection = GetOwner()->GetNetConnection())
+	{
+		// Violating the command protocol results in the player being disconnected.
+		NetConnection->Close();
+	}
+}
+
+void UCommonInventoryComponent::ClientAcknowledgeCommands_Implementation(const FCommonInventoryCommandAck& Ack)
+{
+	if (CommandController)
+	{
+		CommandController->AcknowledgeCommands(Ack);
+	}
+}
@@ -5,23 +5,33 @@
 #include "CommonInventoryLog.h"
 #include "CommonInventorySettings.h"
 #include "CommonInventoryTrace.h"
+#include "Net/CommonInventoryNetProfiler.h"
 
-#include "Async/UniqueLock.h"
+#include "Algo/Count.h"
 #include "CoreGlobals.h"
 #include "Engine/AssetManager.h"
+#include "Engine/DemoNetDriver.h"
 #include "Engine/Engine.h"
-#include "Engine/NetDriver.h"
-#include "Engine/World.h"
+#include "Engine/NetConnection.h"
+#include "Engine/PackageMapClient.h"
 #include "HAL/FileManager.h"
+#include "HAL/IConsoleManager.h"
+#include "HAL/PlatformProcess.h"
 #include "HAL/PlatformProperties.h"
+#include "Misc/Base64.h"
 #include "Misc/Commandline.h"
 #include "Misc/CoreDelegates.h"
 #include "Misc/CoreMisc.h"
+#include "Misc/EngineVersionComparison.h"
 #include "Misc/Parse.h"
 #include "Misc/Paths.h"
-#include "Misc/ScopeLock.h"
+#include "Misc/ScopeRWLock.h"
 #include "Net/RepLayout.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
 #include "Templates/UnrealTemplate.h"
+#include "UObject/EnumProperty.h"
+#include "UObject/UnrealType.h"
 
 #include <atomic>
 
@@ -33,11 +43,46 @@ static std::atomic<UCommonInventoryRegistry*> RegistryInstance = nullptr;
 // Delegate to broadcast on initialization complete.
 static FSimpleMulticastDelegate OnInventoryRegistryInitializedDelegate;
 
-// Kind of RWLock where the game thread requires a lock only for writes.
-static UE::TDynamicUniqueLock<FCriticalSection> AcquireCriticalSectionForRead(FCriticalSection& InCriticalSection)
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+// Gathering memory stats walks all the records, so the refresh peak is only tracked on demand.
+static bool bTrackRefreshMemory = false;
+static FAutoConsoleVariableRef CVarTrackRefreshMemory(
+	TEXT("CommonInventory.TrackRefreshMemory"),
+	bTrackRefreshMemory,
+	TEXT("Whether to track the peak memory held by the registry states during refreshes. Use CommonInventory.MemReport to print the result."),
+	ECVF_Cheat
+);
+#endif
+
+// Provides access to the registry state from any thread. The game thread owns the live state, while other threads pin the published snapshot.
+class FRegistryStateReadScope
 {
-	return IsInGameThread() ? UE::TDynamicUniqueLock(InCriticalSection, UE::DeferLock) : UE::TDynamicUniqueLock(InCriticalSection);
-}
+public:
+
+	explicit FRegistryStateReadScope(const UCommonInventoryRegistry& InRegistry)
+	{
+		if (IsInGameThread())
+		{
+			RegistryState = &InRegistry.GetRegistryState();
+		}
+		else if ((Snapshot = InRegistry.PinRegistrySnapshot()).IsValid())
+		{
+			RegistryState = &Snapshot->RegistryState;
+		}
+		else
+		{
+			static const FCommonInventoryRegistryState EmptyRegistryState;
+			RegistryState = &EmptyRegistryState;
+		}
+	}
+
+	const FCommonInventoryRegistryState* operator->() const { return RegistryState; }
+
+private:
+
+	TRefCountPtr<const FCommonInventoryRegistrySnapshot> Snapshot;
+	const FCommonInventoryRegistryState* RegistryState = nullptr;
+};
 
 /************************************************************************/
 /* Inventory Registry                                                   */
@@ -72,6 +117,32 @@ void UCommonInventoryRegistry::CallOrRegister_OnInventoryRegistryInitialized(FSi
 	}
 }
 
+bool UCommonInventoryRegistry::WaitUntilInitialized()
+{
+	check(IsInGameThread());
+
+	if (!IsInitialized() && GEngine)
+	{
+		if (UCommonInventoryRegistry* const Registry = GEngine->GetEngineSubsystem<UCommonInventoryRegistry>())
+		{
+			if (Registry->AsyncLoadTickerHandle.IsValid())
+			{
+				// PostInitialize() is waiting for the load to complete.
+				FTSTicker::GetCoreTicker().RemoveTicker(Registry->AsyncLoadTickerHandle);
+				Registry->AsyncLoadTickerHandle.Reset();
+				Registry->CompleteInitialization();
+			}
+			else
+			{
+				// PostInitialize() will complete the initialization later.
+				Registry->CompleteAsyncLoad();
+			}
+		}
+	}
+
+	return IsInitialized();
+}
+
 FString UCommonInventoryRegistry::GetRegistryFilename()
 {
 	return FPaths::Combine(FPaths::ProjectDir(), TEXT("InventoryRegistry.bin"));
@@ -82,6 +153,16 @@ FString UCommonInventoryRegistry::GetDevelopmentRegistryFilename()
 	return FPaths::Combine(FPaths::ProjectIntermediateDir(), TEXT("DevelopmentInventoryRegistry.bin"));
 }
 
+FString UCommonInventoryRegistry::GetRegistryPatchFilename()
+{
+	return GetRegistryPatchFilename(GetRegistryFilename());
+}
+
+FString UCommonInventoryRegistry::GetRegistryPatchFilename(const FString& InRegistryFilename)
+{
+	return FPaths::Combine(FPaths::GetPath(InRegistryFilename), TEXT("InventoryRegistryPatch.bin"));
+}
+
 bool UCommonInventoryRegistry::ShouldCreateSubsystem(UObject* Outer) const
 {
 	// It's unsafe to startup without asset scanning.
@@ -93,6 +174,7 @@ void UCommonInventoryRegistry::Initialize(FSubsystemCollectionBase& Collection)
 	Super::Initialize(Collection);
 
 	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::Initialize);
+	LLM_SCOPE_BYTAG(CommonInventory);
 
 	if (UClass* const DataSourceClass = UCommonInventorySettings::Get()->DataSourceClassName.ResolveClass())
 	{
@@ -100,9 +182,14 @@ void UCommonInventoryRegistry::Initialize(FSubsystemCollectionBase& Collection)
 		DataSourceTraits = DataSourceClass->GetDefaultObject<UCommonInventoryRegistryDataSource>()->GetTraits();
 
 		// Try to load the registry state.
-		if ((bWasLoaded = TryLoadFromFile()) == true)
+		if (ShouldLoadAsynchronously())
+		{
+			BeginAsyncLoad();
+		}
+		else if ((bWasLoaded = TryLoadFromFile(RegistryState)) == true)
 		{
 			ConditionallyUpdateNetworkChecksum();
+			PublishRegistrySnapshot();
 		}
 
 		if ((DataSource = NewObject<UCommonInventoryRegistryDataSource>(this, DataSourceClass, FName("InventoryRegistryDataSource"), RF_Transient)))
@@ -115,6 +202,15 @@ void UCommonInventoryRegistry::Initialize(FSubsystemCollectionBase& Collection)
 
 	// Give the data source some time to complete initialization.
 	FCoreDelegates::OnPostEngineInit.AddUObject(this, &ThisClass::PostInitialize);
+
+	RegisterReplayDelegates();
+
+#if WITH_EDITOR
+	if (GIsEditor && !IsRunningCommandlet())
+	{
+		FCommonInventoryDefaultsPropagator::Get().StartReferenceIndexing();
+	}
+#endif
 }
 
 void UCommonInventoryRegistry::PostInitialize()
@@ -124,6 +220,33 @@ void UCommonInventoryRegistry::PostInitialize()
 	// Initialize redirects.
 	FCommonInventoryRedirects::Get();
 
+	// Defer the initialization until the state is loaded.
+	if (AsyncLoadTask.IsValid() && !AsyncLoadTask.IsCompleted())
+	{
+		AsyncLoadTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float)
+			{
+				if (AsyncLoadTask.IsCompleted())
+				{
+					AsyncLoadTickerHandle.Reset();
+					CompleteInitialization();
+					return false;
+				}
+
+				return true;
+			}));
+
+		return;
+	}
+
+	CompleteInitialization();
+}
+
+void UCommonInventoryRegistry::CompleteInitialization()
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::CompleteInitialization);
+
+	CompleteAsyncLoad();
+
 	// Complete the initialization of persistent data sources.
 	DataSource->PostInitialize();
 
@@ -135,9 +258,36 @@ void UCommonInventoryRegistry::PostInitialize()
 void UCommonInventoryRegistry::Deinitialize()
 {
 	Super::Deinitialize();
+
+	// The worker might be still reading the file.
+	FTSTicker::GetCoreTicker().RemoveTicker(AsyncLoadTickerHandle);
+	if (AsyncLoadTask.IsValid())
+	{
+		AsyncLoadTask.Wait();
+		AsyncLoadTask = {};
+	}
+
+	UnregisterReplayDelegates();
+
 	DataSource->Deinitialize();
 	RegistryInstance.store(nullptr, std::memory_order::relaxed);
 
+#if WITH_EDITOR
+	if (GIsEditor && !IsRunningCommandlet())
+	{
+		FCommonInventoryDefaultsPropagator::Get().StopReferenceIndexing();
+	}
+#endif
+
+	// Other threads must be done with the registry by now.
+	FTSTicker::GetCoreTicker().RemoveTicker(PublishSnapshotTickerHandle);
+	PublishSnapshotTickerHandle.Reset();
+
+	{
+		FWriteScopeLock WriteLock(CurrentSnapshotLock);
+		CurrentSnapshot.SafeRelease();
+	}
+
 #if WITH_EDITOR
 	if (GIsEditor && !IsRunningCommandlet())
 	{
@@ -154,26 +304,96 @@ void UCommonInventoryRegistry::Deinitialize()
 #endif
 }
 
-bool UCommonInventoryRegistry::TryLoadFromFile()
+bool UCommonInventoryRegistry::TryLoadFromFile(FCommonInventoryRegistryState& OutRegistryState) const
 {
 	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::TryLoadFromFile);
 
 #if WITH_EDITOR
 	if (DataSourceTraits.bSupportsDevelopmentCooking && GIsEditor && !IsRunningCommandlet())
 	{
-		return RegistryState.LoadFromFile(GetDevelopmentRegistryFilename(), /* bIsCooked */ false);
+		return OutRegistryState.LoadFromFile(GetDevelopmentRegistryFilename(), /* bIsCooked */ false);
 	}
 #else
 	// Try to load the registry state from disk if requested.
 	if (DataSourceTraits.bSupportsCooking && FPlatformProperties::RequiresCookedData() && (IsRunningGame() || IsRunningDedicatedServer()))
 	{
-		return RegistryState.LoadFromFile(GetRegistryFilename(), /* bIsCooked */ true);
+		if (!OutRegistryState.LoadFromFile(GetRegistryFilename(), /* bIsCooked */ true))
+		{
+			return false;
+		}
+
+		// Live patches ship only the changed records on top of the base state.
+		if (const FString PatchFilename = GetRegistryPatchFilename(); IFileManager::Get().FileExists(*PatchFilename))
+		{
+			OutRegistryState.ApplyDeltaFromFile(PatchFilename);
+		}
+
+		return true;
 	}
 #endif
 
 	return false;
 }
 
+bool UCommonInventoryRegistry::ShouldLoadAsynchronously() const
+{
+#if WITH_EDITOR
+	return false; // The development state is relatively small and kept synchronous.
+#else
+	return UCommonInventorySettings::Get()->bLoadRegistryAsynchronously && FPlatformProcess::SupportsMultithreading();
+#endif
+}
+
+void UCommonInventoryRegistry::BeginAsyncLoad()
+{
+	check(IsInGameThread() && !AsyncLoadTask.IsValid());
+
+	AsyncLoadTask = UE::Tasks::Launch(UE_SOURCE_LOCATION, [this]()
+		{
+			LLM_SCOPE_BYTAG(CommonInventory);
+
+			TUniquePtr<FCommonInventoryRegistryState> LoadedState = MakeUnique<FCommonInventoryRegistryState>();
+
+			if (!TryLoadFromFile(*LoadedState))
+			{
+				LoadedState.Reset();
+			}
+
+			return LoadedState;
+		});
+}
+
+void UCommonInventoryRegistry::CompleteAsyncLoad()
+{
+	check(IsInGameThread());
+
+	if (AsyncLoadTask.IsValid())
+	{
+		COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::CompleteAsyncLoad);
+
+		TUniquePtr<FCommonInventoryRegistryState> LoadedState = MoveTemp(AsyncLoadTask.GetResult());
+		AsyncLoadTask = {};
+
+		if (LoadedState)
+		{
+			RegistryState = MoveTemp(*LoadedState);
+			RegistryState.RefreshRepLayouts();
+			bWasLoaded = true;
+		}
+		else
+		{
+			// Payload types that require loading can only be resolved on the game thread.
+			bWasLoaded = TryLoadFromFile(RegistryState);
+		}
+
+		if (bWasLoaded)
+		{
+			ConditionallyUpdateNetworkChecksum();
+			PublishRegistrySnapshot();
+		}
+	}
+}
+
 void UCommonInventoryRegistry::ForceRefresh(bool bSynchronous)
 {
 	if (DataSource)
@@ -188,6 +408,12 @@ void UCommonInventoryRegistry::FlushPendingRefresh()
 	{
 		DataSource->FlushPendingRefresh();
 	}
+
+	// Readers on other threads are about to see the refreshed state as well.
+	if (PublishSnapshotTickerHandle.IsValid())
+	{
+		PublishRegistrySnapshot();
+	}
 }
 
 void UCommonInventoryRegistry::CancelPendingRefresh()
@@ -208,11 +434,61 @@ bool UCommonInventoryRegistry::IsRefreshing() const
 	return DataSource && DataSource->IsRefreshing();
 }
 
+TRefCountPtr<const FCommonInventoryRegistrySnapshot> UCommonInventoryRegistry::PinRegistrySnapshot() const
+{
+	// The reference is added under the lock, so the snapshot can't be released in between. Readers don't block each other.
+	FReadScopeLock ReadLock(CurrentSnapshotLock);
+	return CurrentSnapshot;
+}
+
+void UCommonInventoryRegistry::PublishRegistrySnapshot()
+{
+	check(IsInGameThread());
+
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::PublishRegistrySnapshot);
+	LLM_SCOPE_BYTAG(CommonInventory);
+
+	FTSTicker::GetCoreTicker().RemoveTicker(PublishSnapshotTickerHandle);
+	PublishSnapshotTickerHandle.Reset();
+
+	// The copy is made outside of the lock, readers only wait for the swap.
+	TRefCountPtr<const FCommonInventoryRegistrySnapshot> NewSnapshot = new FCommonInventoryRegistrySnapshot(RegistryState);
+
+	{
+		FWriteScopeLock WriteLock(CurrentSnapshotLock);
+		Swap(CurrentSnapshot, NewSnapshot);
+	}
+
+	// The previous snapshot is released here, unless it's still pinned by readers.
+}
+
+void UCommonInventoryRegistry::SchedulePublishRegistrySnapshot()
+{
+	check(IsInGameThread());
+
+	// Refreshes of a frame, e.g. editor asset events, are published with a single copy.
+	if (!PublishSnapshotTickerHandle.IsValid())
+	{
+		PublishSnapshotTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float)
+			{
+				PublishSnapshotTickerHandle.Reset();
+				PublishRegistrySnapshot();
+				return false;
+			}));
+	}
+}
+
+SIZE_T UCommonInventoryRegistry::GetSnapshotsAllocatedSize() const
+{
+	check(IsInGameThread());
+	return CurrentSnapshot.IsValid() ? CurrentSnapshot->RegistryState.GetMemoryStats().GetTotalBytes() : 0;
+}
+
 bool UCommonInventoryRegistry::ResetItem(FPrimaryAssetId InPrimaryAssetId, FVariadicStruct& InPayload) const
 {
-	UE::TDynamicUniqueLock ScopeLock{ AcquireCriticalSectionForRead(CriticalSection) };
+	const FRegistryStateReadScope State{ *this };
 
-	if (const FCommonInventoryRegistryRecord* const RegistryRecord = GetRegistryRecord(InPrimaryAssetId))
+	if (const FCommonInventoryRegistryRecord* const RegistryRecord = State->GetRecordPtr(InPrimaryAssetId))
 	{
 		InPayload.InitializeAs(RegistryRecord->DefaultPayload.GetScriptStruct(), RegistryRecord->DefaultPayload.GetMemory());
 		return true;
@@ -221,11 +497,99 @@ bool UCommonInventoryRegistry::ResetItem(FPrimaryAssetId InPrimaryAssetId, FVari
 	return false;
 }
 
+void UCommonInventoryRegistry::MakeItems(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TArrayView<FCommonItem> OutItems) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::MakeItems);
+	check(InPrimaryAssetIds.Num() == OutItems.Num());
+
+	const FRegistryStateReadScope State{ *this };
+	const TArrayView<const FCommonInventoryRegistryRecord> Records = State->GetRecords();
+
+	FPrimaryAssetId LastPrimaryAssetId;
+	int32 LastRecordIdx = INDEX_NONE;
+
+	for (int32 Idx = 0; Idx < InPrimaryAssetIds.Num(); ++Idx)
+	{
+		// Loot tends to repeat items, so runs of the same item are resolved once.
+		if (Idx == 0 || InPrimaryAssetIds[Idx] != LastPrimaryAssetId)
+		{
+			LastPrimaryAssetId = InPrimaryAssetIds[Idx];
+			LastRecordIdx = State->GetRecordIndex(LastPrimaryAssetId);
+		}
+
+		if (LastRecordIdx != INDEX_NONE)
+		{
+			const FConstStructView DefaultPayload = Records[LastRecordIdx].DefaultPayload;
+			OutItems[Idx] = FCommonItem(LastPrimaryAssetId, FCommonItem::DeferPayloadInit);
+			OutItems[Idx].GetMutablePayload().InitializeAs(DefaultPayload.GetScriptStruct(), DefaultPayload.GetMemory());
+		}
+		else
+		{
+			OutItems[Idx] = FCommonItem();
+		}
+	}
+}
+
+void UCommonInventoryRegistry::MakeItemStacks(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TConstArrayView<int32> InAmounts, TArray<FCommonItemStack>& OutItemStacks) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::MakeItemStacks);
+	check(InPrimaryAssetIds.Num() == InAmounts.Num());
+
+	const FRegistryStateReadScope State{ *this };
+	const TArrayView<const FCommonInventoryRegistryRecord> Records = State->GetRecords();
+	const TConstArrayView<int32> MaxStackSizes = State->GetMaxStackSizes();
+
+	OutItemStacks.Reserve(OutItemStacks.Num() + InPrimaryAssetIds.Num());
+
+	for (int32 Idx = 0; Idx < InPrimaryAssetIds.Num(); ++Idx)
+	{
+		const int32 RecordIdx = State->GetRecordIndex(InPrimaryAssetIds[Idx]);
+
+		if (RecordIdx == INDEX_NONE || InAmounts[Idx] <= 0)
+		{
+			continue;
+		}
+
+		const FConstStructView DefaultPayload = Records[RecordIdx].DefaultPayload;
+		const int32 MaxStackSize = FMath::Max(MaxStackSizes[RecordIdx], 1);
+
+		for (int32 RemainingAmount = InAmounts[Idx]; RemainingAmount > 0; RemainingAmount -= MaxStackSize)
+		{
+			FCommonItemStack& ItemStack = OutItemStacks.AddDefaulted_GetRef();
+			ItemStack.CommonItem = FCommonItem(InPrimaryAssetIds[Idx], FCommonItem::DeferPayloadInit);
+			ItemStack.CommonItem.GetMutablePayload().InitializeAs(DefaultPayload.GetScriptStruct(), DefaultPayload.GetMemory());
+			ItemStack.StackSize = FMath::Min(RemainingAmount, MaxStackSize);
+		}
+	}
+}
+
+void UCommonInventoryRegistry::GetRecordIndices(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TArrayView<int32> OutRecordIndices, TArrayView<int32> OutMaxStackSizes) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::GetRecordIndices);
+	check(InPrimaryAssetIds.Num() == OutRecordIndices.Num() && InPrimaryAssetIds.Num() == OutMaxStackSizes.Num());
+
+	const FRegistryStateReadScope State{ *this };
+	const TConstArrayView<int32> MaxStackSizes = State->GetMaxStackSizes();
+
+	for (int32 Idx = 0; Idx < InPrimaryAssetIds.Num(); ++Idx)
+	{
+		const int32 RecordIdx = State->GetRecordIndex(InPrimaryAssetIds[Idx]);
+		OutRecordIndices[Idx] = RecordIdx;
+		OutMaxStackSizes[Idx] = RecordIdx != INDEX_NONE ? MaxStackSizes[RecordIdx] : 0;
+	}
+}
+
+FName UCommonInventoryRegistry::GetSearchableName(FPrimaryAssetId InPrimaryAssetId) const
+{
+	const FRegistryStateReadScope State{ *this };
+	return State->GetSearchableName(InPrimaryAssetId);
+}
+
 bool UCommonInventoryRegistry::ValidateItem(FPrimaryAssetId InPrimaryAssetId, const FVariadicStruct& InPayload) const
 {
-	UE::TDynamicUniqueLock ScopeLock{ AcquireCriticalSectionForRead(CriticalSection) };
+	const FRegistryStateReadScope State{ *this };
 
-	if (const FCommonInventoryRegistryRecord* const RegistryRecord = GetRegistryRecord(InPrimaryAssetId))
+	if (const FCommonInventoryRegistryRecord* const RegistryRecord = State->GetRecordPtr(InPrimaryAssetId))
 	{
 		return InPayload.GetScriptStruct() == RegistryRecord->DefaultPayload.GetScriptStruct();
 	}
@@ -235,15 +599,15 @@ bool UCommonInventoryRegistry::ValidateItem(FPrimaryAssetId InPrimaryAssetId, co
 
 bool UCommonInventoryRegistry::SynchronizeItem(FPrimaryAssetId& InPrimaryAssetId, FVariadicStruct& InPayload) const
 {
-	UE::TDynamicUniqueLock ScopeLock{ AcquireCriticalSectionForRead(CriticalSection) };
+	const FRegistryStateReadScope State{ *this };
 
 	// Try to redirect if possible.
-	if (InPrimaryAssetId.IsValid() && !ContainsRecord(InPrimaryAssetId))
+	if (InPrimaryAssetId.IsValid() && !State->ContainsRecord(InPrimaryAssetId))
 	{
 		FCommonInventoryRedirects::Get().TryRedirect(InPrimaryAssetId);
 	}
 
-	if (const FCommonInventoryRegistryRecord* const RegistryRecord = GetRegistryRecord(InPrimaryAssetId))
+	if (const FCommonInventoryRegistryRecord* const RegistryRecord = State->GetRecordPtr(InPrimaryAssetId))
 	{
 		if (RegistryRecord->DefaultPayload.GetScriptStruct() != InPayload.GetScriptStruct())
 		{
@@ -269,10 +633,10 @@ bool UCommonInventoryRegistry::SerializeItem(FArchive& Ar, FPrimaryAssetId& InPr
 	}
 	else
 	{
-		UE::TDynamicUniqueLock ScopeLock{ AcquireCriticalSectionForRead(CriticalSection) };
+		const FRegistryStateReadScope State{ *this };
 
 		// Just in case the defaults propagation was unable to reach the item.
-		if (Ar.IsSaving() && InPrimaryAssetId.IsValid() && !ContainsRecord(InPrimaryAssetId))
+		if (Ar.IsSaving() && InPrimaryAssetId.IsValid() && !State->ContainsRecord(InPrimaryAssetId))
 		{
 			if (!FCommonInventoryRedirects::Get().TryRedirect(InPrimaryAssetId))
 			{
@@ -296,21 +660,202 @@ bool UCommonInventoryRegistry::SerializeItem(FArchive& Ar, FPrimaryAssetId& InPr
 			}
 		}
 
-		FConstStructView Defaults;
+		FConstStructView Defaults;
+
+		if (const FCommonInventoryRegistryRecord* const RegistryRecord = State->GetRecordPtr(InPrimaryAssetId))
+		{
+			Defaults = RegistryRecord->DefaultPayload;
+		}
+		else
+		{
+			InPrimaryAssetId = FPrimaryAssetId();
+		}
+
+		InPayload.Serialize(Ar, &Defaults);
+	}
+
+	return true;
+}
+
+bool UCommonInventoryRegistry::SerializeItemTable(FArchive& Ar, TArray<FPrimaryAssetId>& InItemTable, TFunctionRef<void(TConstArrayView<FConstStructView>)> InSerializeRows) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::SerializeItemTable);
+
+#if WITH_EDITOR
+	checkf(!DataSourceTraits.bSupportsCooking || !Ar.IsCooking() || bIsCooking, TEXT("InventoryRegistry must be in the same cooking state as FArchive."));
+#endif
+
+	// The state is pinned once for the whole table and all the rows.
+	const FRegistryStateReadScope State{ *this };
+
+	// Just in case the defaults propagation was unable to reach the items.
+	if (Ar.IsSaving())
+	{
+		for (FPrimaryAssetId& PrimaryAssetId : InItemTable)
+		{
+			if (PrimaryAssetId.IsValid() && !State->ContainsRecord(PrimaryAssetId) && !FCommonInventoryRedirects::Get().TryRedirect(PrimaryAssetId))
+			{
+				PrimaryAssetId = FPrimaryAssetId();
+			}
+		}
+	}
+
+	int32 NumEntries = InItemTable.Num();
+	Ar << NumEntries;
+
+	if (Ar.IsLoading())
+	{
+		if (NumEntries < 0)
+		{
+			Ar.SetError();
+			return false;
+		}
+
+		InItemTable.Reset();
+		InItemTable.SetNum(NumEntries);
+	}
+
+	for (FPrimaryAssetId& PrimaryAssetId : InItemTable)
+	{
+		Ar << PrimaryAssetId;
+	}
+
+	if (Ar.IsError())
+	{
+		return false;
+	}
+
+	// Editor and client-side saved data might be outdated. Redirects are resolved once per entry rather than per item.
+	if (Ar.IsLoading() && Ar.IsPersistent())
+	{
+		const bool bIsCookedPackage = Ar.IsLoadingFromCookedPackage() && DataSourceTraits.bIsPersistent;
+		const bool bIsDuplicating = (Ar.GetPortFlags() & (PPF_DuplicateForPIE | PPF_Duplicate)) != 0;
+
+		for (FPrimaryAssetId& PrimaryAssetId : InItemTable)
+		{
+			if (!PrimaryAssetId.IsValid())
+			{
+				continue;
+			}
+
+			if (bIsCookedPackage)
+			{
+				// We assume that the data was properly synchronized during the cook.
+				checkf(!FCommonInventoryRedirects::Get().IsStale(PrimaryAssetId), TEXT("Failed to validate FCommonItem during loading. Make sure to re-cook relevant packages."));
+			}
+			else if (!bIsDuplicating)
+			{
+				FCommonInventoryRedirects::Get().TryRedirect(PrimaryAssetId);
+			}
+		}
+	}
+
+	TArray<FConstStructView, TInlineAllocator<16>> Defaults;
+	Defaults.SetNum(InItemTable.Num());
+
+	for (int32 Idx = 0; Idx < InItemTable.Num(); ++Idx)
+	{
+		if (const FCommonInventoryRegistryRecord* const RegistryRecord = State->GetRecordPtr(InItemTable[Idx]))
+		{
+			Defaults[Idx] = RegistryRecord->DefaultPayload;
+		}
+		else
+		{
+			InItemTable[Idx] = FPrimaryAssetId();
+		}
+	}
+
+	InSerializeRows(Defaults);
+	return !Ar.IsError();
+}
+
+uint32 UCommonInventoryRegistry::GetHandoffChecksum() const
+{
+	const FRegistryStateReadScope State{ *this };
+	return State->GetChecksum();
+}
+
+bool UCommonInventoryRegistry::SerializeHandoffItemTable(FArchive& Ar, TArray<FPrimaryAssetId>& InItemTable, uint32 InTargetChecksum, TFunctionRef<void(TConstArrayView<FConstStructView>)> InSerializeRows) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::SerializeHandoffItemTable);
+
+	// The state is pinned once for the whole table and all the rows.
+	const FRegistryStateReadScope State{ *this };
+
+	uint32 Checksum = State->GetChecksum();
+	Ar << Checksum;
+
+	bool bIsRepIndexEncoded = Ar.IsSaving() && InTargetChecksum == Checksum;
+	Ar.SerializeBits(&bIsRepIndexEncoded, 1);
+
+	if (!bIsRepIndexEncoded)
+	{
+		return SerializeItemTable(Ar, InItemTable, InSerializeRows);
+	}
+
+	// RepIndices are only meaningful for the registry state they were assigned by.
+	if (Ar.IsLoading() && Checksum != State->GetChecksum())
+	{
+		COMMON_INVENTORY_LOG(Error, "InventoryRegistry: Unable to load a handoff encoded with another registry state: Local(%#x), Remote(%#x).", State->GetChecksum(), Checksum);
+		Ar.SetError();
+		return false;
+	}
+
+	int32 NumEntries = InItemTable.Num();
+	Ar << NumEntries;
+
+	if (Ar.IsLoading())
+	{
+		if (NumEntries < 0)
+		{
+			Ar.SetError();
+			return false;
+		}
+
+		InItemTable.Reset();
+		InItemTable.SetNum(NumEntries);
+	}
+
+	TArray<FConstStructView, TInlineAllocator<16>> Defaults;
+	Defaults.SetNum(InItemTable.Num());
+
+	for (int32 Idx = 0; Idx < InItemTable.Num() && !Ar.IsError(); ++Idx)
+	{
+		FPrimaryAssetId& PrimaryAssetId = InItemTable[Idx];
+		const FCommonInventoryRegistryRecord* RegistryRecord = Ar.IsSaving() ? State->GetRecordPtr(PrimaryAssetId) : nullptr;
+
+		// Just in case the defaults propagation was unable to reach the item.
+		if (Ar.IsSaving() && !RegistryRecord && PrimaryAssetId.IsValid() && FCommonInventoryRedirects::Get().TryRedirect(PrimaryAssetId))
+		{
+			RegistryRecord = State->GetRecordPtr(PrimaryAssetId);
+		}
+
+		uint32 RepIndex = RegistryRecord ? RegistryRecord->RepIndex : CommonInventory::INVALID_REPLICATION_INDEX;
+		Ar.SerializeBits(&RepIndex, State->GetRepIndexEncodingBitsNum());
 
-		if (const FCommonInventoryRegistryRecord* const RegistryRecord = GetRegistryRecord(InPrimaryAssetId))
+		if (Ar.IsLoading())
 		{
-			Defaults = RegistryRecord->DefaultPayload;
+			RegistryRecord = State->GetRecordFromReplication(RepIndex);
+		}
+
+		if (RegistryRecord)
+		{
+			PrimaryAssetId = RegistryRecord->GetPrimaryAssetId();
+			Defaults[Idx] = RegistryRecord->DefaultPayload;
 		}
 		else
 		{
-			InPrimaryAssetId = FPrimaryAssetId();
+			PrimaryAssetId = FPrimaryAssetId();
 		}
+	}
 
-		InPayload.Serialize(Ar, &Defaults);
+	if (Ar.IsError())
+	{
+		return false;
 	}
 
-	return true;
+	InSerializeRows(Defaults);
+	return !Ar.IsError();
 }
 
 void UCommonInventoryRegistry::PropagateItemDefaults(const FCommonInventoryDefaultsPropagator::FContext& InContext, FPrimaryAssetId& InPrimaryAssetId, FVariadicStruct& InPayload) const
@@ -380,11 +925,37 @@ void UCommonInventoryRegistry::PropagateItemDefaults(const FCommonInventoryDefau
 	}
 }
 
-FCommonInventoryRegistryNetSerializationContext UCommonInventoryRegistry::NetSerializeItem(FArchive& Ar, FPrimaryAssetId& InPrimaryAssetId, bool& bOutSuccess) const
+#if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+
+bool CommonInventory::ShouldSampleNetworkChecksum()
+{
+	static std::atomic<uint32> SampleCounter = 0;
+	const int32 SamplingInterval = UCommonInventorySettings::Get()->NetworkChecksumSamplingInterval;
+	return SamplingInterval > 0 && SampleCounter.fetch_add(1, std::memory_order_relaxed) % static_cast<uint32>(SamplingInterval) == 0;
+}
+
+#endif // COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+
+// Whether the package map belongs to a connection of a replay.
+static bool IsReplayPackageMap(UPackageMap* InPackageMap)
+{
+	UPackageMapClient* const PackageMapClient = Cast<UPackageMapClient>(InPackageMap);
+	const UNetConnection* const Connection = PackageMapClient ? PackageMapClient->GetConnection() : nullptr;
+	return Connection && Connection->IsReplay();
+}
+
+FCommonInventoryRegistryNetSerializationContext UCommonInventoryRegistry::NetSerializeItem(FArchive& Ar, FPrimaryAssetId& InPrimaryAssetId, bool& bOutSuccess, UPackageMap* InPackageMap /* = nullptr */) const
 {
+	SCOPE_CYCLE_COUNTER(STAT_CommonInventory_NetSerializeItem);
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::NetSerializeItem);
+
 	FCommonInventoryRegistryNetSerializationContext OutContext{ InPrimaryAssetId, bOutSuccess };
 	uint32 RepIndex = CommonInventory::INVALID_REPLICATION_INDEX;
 	[[maybe_unused]] uint32 Checksum = 0;
+	[[maybe_unused]] bool bHasChecksum = false;
+
+	// Replays recorded with another registry state are encoded with their own RepIndex table.
+	const bool bIsReplayRemapped = Ar.IsLoading() && !ReplayItemTable.IsEmpty() && IsReplayPackageMap(InPackageMap);
 
 	if (Ar.IsSaving())
 	{
@@ -393,22 +964,54 @@ FCommonInventoryRegistryNetSerializationContext UCommonInventoryRegistry::NetSer
 			RepIndex = OutContext.RegistryRecord->RepIndex;
 
 #if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
-			Checksum = OutContext.RegistryRecord->GetChecksum();
+			// Archetypes are verified by UCommonInventoryRegistryHandshake, so only a sample of items carry the record checksum.
+			if ((bHasChecksum = CommonInventory::ShouldSampleNetworkChecksum()) == true)
+			{
+				Checksum = OutContext.RegistryRecord->GetChecksum();
+			}
 #endif
 		}
 	}
 
-	Ar.SerializeBits(&RepIndex, RegistryState.GetRepIndexEncodingBitsNum());
+#if COMMON_INVENTORY_WITH_NET_PROFILER
+	const int64 StartBits = CommonInventory::Net::GetArchivePosBits(Ar);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+#endif
+
+	Ar.SerializeBits(&RepIndex, bIsReplayRemapped ? ReplayRepIndexEncodingBitsNum : RegistryState.GetRepIndexEncodingBitsNum());
+
+#if COMMON_INVENTORY_WITH_NET_PROFILER
+	const int64 RepIndexEndBits = CommonInventory::Net::GetArchivePosBits(Ar);
+#endif
 
 #if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
-	Ar << Checksum;
+	Ar.SerializeBits(&bHasChecksum, 1);
+
+	if (bHasChecksum)
+	{
+		Ar << Checksum;
+	}
+#endif
+
+#if COMMON_INVENTORY_WITH_NET_PROFILER
+	const int64 ChecksumBits = CommonInventory::Net::GetArchivePosBits(Ar) - RepIndexEndBits;
 #endif
 
 	if (Ar.IsLoading())
 	{
 		[[maybe_unused]] uint32 LocalChecksum = 0;
 
-		if ((OutContext.RegistryRecord = RegistryState.GetRecordFromReplication(RepIndex)) != nullptr)
+		if (bIsReplayRemapped)
+		{
+			const int32 TableIndex = static_cast<int32>(RepIndex) - /* Invalid */ 1;
+			OutContext.RegistryRecord = ReplayItemTable.IsValidIndex(TableIndex) ? RegistryState.GetRecordPtr(ReplayItemTable[TableIndex]) : nullptr;
+		}
+		else
+		{
+			OutContext.RegistryRecord = RegistryState.GetRecordFromReplication(RepIndex);
+		}
+
+		if (OutContext.RegistryRecord != nullptr)
 		{
 			InPrimaryAssetId = OutContext.RegistryRecord->GetPrimaryAssetId();
 
@@ -428,19 +1031,118 @@ FCommonInventoryRegistryNetSerializationContext UCommonInventoryRegistry::NetSer
 		}
 
 #if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
-		// This is not a critical error yet until we try to serialize the payload.
-		if (!ensureMsgf(Checksum == LocalChecksum, TEXT("Network checksum mismatch encountered for '%s': Local(%#x), Remote(%#x)."), *InPrimaryAssetId.ToString(), LocalChecksum, Checksum))
+		// This is not a critical error yet until we try to serialize the payload. Records of remapped replays are expected to differ.
+		if (bHasChecksum && !bIsReplayRemapped && !ensureMsgf(Checksum == LocalChecksum, TEXT("Network checksum mismatch encountered for '%s': Local(%#x), Remote(%#x)."), *InPrimaryAssetId.ToString(), LocalChecksum, Checksum))
 		{
 			OutContext.bOutSuccess = false;
 		}
 #endif
 	}
 
+#if COMMON_INVENTORY_WITH_NET_PROFILER
+	CommonInventory::Net::RecordItemIdentity(Ar, InPrimaryAssetId.PrimaryAssetType, RepIndexEndBits - StartBits, ChecksumBits, FPlatformTime::Cycles64() - StartCycles);
+#endif
+
 	return OutContext;
 }
 
+#if COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING
+
+// Whether the payload property can be net serialized on its own without UPackageMap.
+static bool CanNetSerializePayloadProperty(const FProperty* InProperty)
+{
+	if (const FStructProperty* const StructProperty = CastField<FStructProperty>(InProperty))
+	{
+		return (StructProperty->Struct->StructFlags & STRUCT_NetSerializeNative) != 0;
+	}
+
+	return InProperty->IsA<FNumericProperty>() || InProperty->IsA<FBoolProperty>() || InProperty->IsA<FEnumProperty>() || InProperty->IsA<FNameProperty>() || InProperty->IsA<FStrProperty>();
+}
+
+// Net serializes only the properties changed against the defaults. Returns false if the payload requires a full serialization.
+static bool NetSerializePayloadDelta(FArchive& Ar, const UScriptStruct* InScriptStruct, uint8* InMemory, const uint8* InDefaultMemory, bool& bOutSuccess)
+{
+	bool bIsDeltaEncoded = true;
+
+	if (Ar.IsSaving())
+	{
+		for (TFieldIterator<const FProperty> It(InScriptStruct); It && bIsDeltaEncoded; ++It)
+		{
+			if (!It->HasAnyPropertyFlags(CPF_RepSkip) && !CanNetSerializePayloadProperty(*It))
+			{
+				bIsDeltaEncoded = It->Identical_InContainer(InMemory, InDefaultMemory, /* ArrayIndex */ 0, PPF_None);
+
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+				const int32 ArrayDim = It->ArrayDim;
+#else
+				const int32 ArrayDim = It->GetArrayDim();
+#endif
+
+				for (int32 Idx = 1; Idx < ArrayDim && bIsDeltaEncoded; ++Idx)
+				{
+					bIsDeltaEncoded = It->Identical_InContainer(InMemory, InDefaultMemory, Idx, PPF_None);
+				}
+			}
+		}
+	}
+
+	Ar.SerializeBits(&bIsDeltaEncoded, 1);
+
+	if (!bIsDeltaEncoded)
+	{
+		return false;
+	}
+
+	if (Ar.IsLoading())
+	{
+		InScriptStruct->CopyScriptStruct(InMemory, InDefaultMemory);
+	}
+
+	// Per-property changed mask followed by the changed values. Unsupported properties are guaranteed to be identical to the defaults.
+	for (TFieldIterator<const FProperty> It(InScriptStruct); It; ++It)
+	{
+		if (It->HasAnyPropertyFlags(CPF_RepSkip) || !CanNetSerializePayloadProperty(*It))
+		{
+			continue;
+		}
+
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+		const int32 ArrayDim = It->ArrayDim;
+#else
+		const int32 ArrayDim = It->GetArrayDim();
+#endif
+
+		bool bIsChanged = false;
+
+		if (Ar.IsSaving())
+		{
+			for (int32 Idx = 0; Idx < ArrayDim && !bIsChanged; ++Idx)
+			{
+				bIsChanged = !It->Identical_InContainer(InMemory, InDefaultMemory, Idx, PPF_None);
+			}
+		}
+
+		Ar.SerializeBits(&bIsChanged, 1);
+
+		if (bIsChanged)
+		{
+			for (int32 Idx = 0; Idx < ArrayDim; ++Idx)
+			{
+				bOutSuccess &= It->NetSerializeItem(Ar, /* Map */ nullptr, It->ContainerPtrToValuePtr<void>(InMemory, Idx));
+			}
+		}
+	}
+
+	return true;
+}
+
+#endif // COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING
+
 void UCommonInventoryRegistry::NetSerializeItemPayload(FArchive& Ar, FVariadicStruct& InPayload, FCommonInventoryRegistryNetSerializationContext& InContext) const
 {
+	SCOPE_CYCLE_COUNTER(STAT_CommonInventory_NetSerializeItemPayload);
+	COMMON_INVENTORY_NET_PROFILE_PAYLOAD(Ar, InContext.RegistryRecord ? InContext.RegistryRecord->GetPrimaryAssetType() : FPrimaryAssetType());
+
 	bool bHasPayload = InContext.RegistryRecord && InContext.RegistryRecord->DefaultPayload.IsValid();
 	Ar.SerializeBits(&bHasPayload, 1);
 
@@ -455,10 +1157,12 @@ void UCommonInventoryRegistry::NetSerializeItemPayload(FArchive& Ar, FVariadicSt
 			return;
 		}
 
+		const FConstStructView DefaultPayload = InContext.RegistryRecord->DefaultPayload;
+
 		// Synchronize the type without copying the defaults.
-		if (InPayload.GetScriptStruct() != InContext.RegistryRecord->DefaultPayload.GetScriptStruct())
+		if (InPayload.GetScriptStruct() != DefaultPayload.GetScriptStruct())
 		{
-			InPayload.InitializeAs(InContext.RegistryRecord->DefaultPayload.GetScriptStruct(), /* InStructMemory */ nullptr);
+			InPayload.InitializeAs(DefaultPayload.GetScriptStruct(), /* InStructMemory */ nullptr);
 		}
 
 		// Net serialize the actual value.
@@ -466,22 +1170,45 @@ void UCommonInventoryRegistry::NetSerializeItemPayload(FArchive& Ar, FVariadicSt
 		{
 			uint8* const Memory = InPayload.GetMutableMemory();
 
+#if COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING
+			// Most of the items are never modified, so the defaults are reduced to a single bit.
+			bool bIsDefaultPayload = Ar.IsSaving() && ScriptStruct->CompareScriptStruct(Memory, DefaultPayload.GetMemory(), PPF_None);
+			Ar.SerializeBits(&bIsDefaultPayload, 1);
+
+			if (bIsDefaultPayload)
+			{
+				COMMON_INVENTORY_NET_PROFILE_PAYLOAD_PATH(Default);
+
+				if (Ar.IsLoading())
+				{
+					ScriptStruct->CopyScriptStruct(Memory, DefaultPayload.GetMemory());
+				}
+
+				return;
+			}
+#endif // COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING
+
 			// Use native serialization if possible.
 			if (ScriptStruct->StructFlags & STRUCT_NetSerializeNative)
 			{
+				COMMON_INVENTORY_NET_PROFILE_PAYLOAD_PATH(Native);
 				ScriptStruct->GetCppStructOps()->NetSerialize(Ar, /* Map */ nullptr, InContext.bOutSuccess, Memory);
 			}
+#if COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING
+			else if (NetSerializePayloadDelta(Ar, ScriptStruct, Memory, DefaultPayload.GetMemory(), InContext.bOutSuccess))
+			{
+				// Only the changed properties were serialized.
+				COMMON_INVENTORY_NET_PROFILE_PAYLOAD_PATH(Delta);
+			}
+#endif // COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING
 			else
 			{
-				check(GEngine);
-
 				// UPackageMap is nullptr because of net shared serialization.
-				if (UWorld* const CurrentWorld = GEngine->GetCurrentPlayWorld())
+				if (const TSharedPtr<FRepLayout>& RepLayout = InContext.RegistryRecord->PayloadRepLayout)
 				{
+					COMMON_INVENTORY_NET_PROFILE_PAYLOAD_PATH(RepLayout);
 					bool bHasUnmapped = false;
-					UScriptStruct* const MutableScriptStruct = const_cast<UScriptStruct*>(ScriptStruct);
-					const TSharedRef<FRepLayout> RepLayout = CurrentWorld->GetNetDriver()->GetStructRepLayout(MutableScriptStruct).ToSharedRef();
-					RepLayout->SerializePropertiesForStruct(MutableScriptStruct, static_cast<FBitArchive&>(Ar), nullptr, Memory, bHasUnmapped);
+					RepLayout->SerializePropertiesForStruct(const_cast<UScriptStruct*>(ScriptStruct), static_cast<FBitArchive&>(Ar), nullptr, Memory, bHasUnmapped);
 				}
 				else
 				{
@@ -510,80 +1237,68 @@ void UCommonInventoryRegistry::CheckDataSourceContractViolation() const
 }
 
 int32 UCommonInventoryRegistry::AppendRecords(TConstArrayView<FCommonInventoryRegistryRecord> InRecords)
+{
+	return ApplyRecords(InRecords, /* InRemoves */ {}).NumAdded;
+}
+
+int32 UCommonInventoryRegistry::RemoveRecords(TConstArrayView<FPrimaryAssetId> InRecordIds)
+{
+	return ApplyRecords(/* InUpserts */ {}, InRecordIds).NumRemoved;
+}
+
+FCommonInventoryRegistryState::FDeltaStats UCommonInventoryRegistry::ApplyRecords(TConstArrayView<FCommonInventoryRegistryRecord> InUpserts, TConstArrayView<FPrimaryAssetId> InRemoves)
 {
 	CheckDataSourceContractViolation();
-	
+	LLM_SCOPE_BYTAG(CommonInventory);
+
 	FCommonInventoryDefaultsPropagationContext PropagationContext;
-	
-	// Copy existing data for further propagation if needed.
-	for (const FCommonInventoryRegistryRecord& Record : InRecords)
-	{
-		if (const FCommonInventoryRegistryRecord* const OriginalRecord = GetRegistryRecord(Record.GetPrimaryAssetId()))
-		{
-			PropagationContext.OriginalRegistryState.AppendData(*OriginalRecord);
-		}
-	}
+	TArray<FCommonInventoryRegistryRecord> OriginalRecords;
+	OriginalRecords.Reserve(InUpserts.Num() + InRemoves.Num());
 
-	const int32 NumAdded = InRecords.Num() - PropagationContext.OriginalRegistryState.GetRecordsNum();
+	// Records might be both removed and upserted, so each one is copied once.
+	TSet<FPrimaryAssetId> OriginalRecordIds;
+	OriginalRecordIds.Reserve(InUpserts.Num() + InRemoves.Num());
 
-	if (!InRecords.IsEmpty())
-	{
+	const auto CopyOriginalRecord = [this, &OriginalRecords, &OriginalRecordIds](FPrimaryAssetId InRecordId)
 		{
-			FScopeLock Lock(&CriticalSection);
+			bool bIsAlreadyCopied = false;
+			OriginalRecordIds.Add(InRecordId, &bIsAlreadyCopied);
 
-			for (const FCommonInventoryRegistryRecord& Record : InRecords)
+			if (const FCommonInventoryRegistryRecord* const RegistryRecord = GetRegistryRecord(InRecordId); RegistryRecord && !bIsAlreadyCopied)
 			{
-				RegistryState.AppendData(Record);
+				OriginalRecords.Emplace(*RegistryRecord);
 			}
-		}
+		};
 
-		OnPostRefresh(PropagationContext);
+	// Copy existing data for further propagation.
+	for (const FPrimaryAssetId RecordId : InRemoves)
+	{
+		CopyOriginalRecord(RecordId);
 	}
 
-	return NumAdded;
-}
-
-int32 UCommonInventoryRegistry::RemoveRecords(TConstArrayView<FPrimaryAssetId> InRecordIds)
-{
-	CheckDataSourceContractViolation();
-
-	FCommonInventoryDefaultsPropagationContext PropagationContext;
-
-	// Copy existing data for further propagation.
-	for (const FPrimaryAssetId RecordId : InRecordIds)
+	for (const FCommonInventoryRegistryRecord& Record : InUpserts)
 	{
-		if (const FCommonInventoryRegistryRecord* const RegistryRecord = GetRegistryRecord(RecordId))
-		{
-			PropagationContext.OriginalRegistryState.AppendData(*RegistryRecord);
-		}
+		CopyOriginalRecord(Record.GetPrimaryAssetId());
 	}
 
-	int32 NumRemoves = 0;
+	FCommonInventoryRegistryState::FDeltaStats DeltaStats;
 
-	if (PropagationContext.OriginalRegistryState.HasRecords())
+	// Removing unknown records is a no-op.
+	if (!InUpserts.IsEmpty() || !OriginalRecords.IsEmpty())
 	{
-		{
-			FScopeLock Lock(&CriticalSection);
-
-			for (const FPrimaryAssetId RecordId : InRecordIds)
-			{
-				// Remove the records.
-				if (RegistryState.RemoveData(RecordId))
-				{
-					++NumRemoves;
-				}
-			}
-		}
+		PropagationContext.OriginalRegistryState.ApplyDelta(OriginalRecords);
+		DeltaStats = RegistryState.ApplyDelta(InUpserts, InRemoves);
 
 		OnPostRefresh(PropagationContext);
 	}
 
-	return NumRemoves;
+	return DeltaStats;
 }
 
 void UCommonInventoryRegistry::ResetRecords(TConstArrayView<FCommonInventoryRegistryRecord> InRecords)
 {
 	CheckDataSourceContractViolation();
+	LLM_SCOPE_BYTAG(CommonInventory);
 
 	FCommonInventoryDefaultsPropagationContext PropagationContext;
 
@@ -594,11 +1309,7 @@ void UCommonInventoryRegistry::ResetRecords(TConstArrayView<FCommonInventoryRegi
 		PropagationContext.bWasReset = true;
 	}
 
-	{
-		FScopeLock Lock(&CriticalSection);
-		RegistryState.Reset(InRecords);
-	}
-
+	RegistryState.Reset(InRecords);
 	OnPostRefresh(PropagationContext);
 }
 
@@ -612,6 +1323,18 @@ void UCommonInventoryRegistry::OnPostRefresh(FCommonInventoryDefaultsPropagation
 	// Try update the checksum before diffing so it can use a faster comparator.
 	ConditionallyUpdateNetworkChecksum();
 
+	// Make the new state visible to other threads.
+	SchedulePublishRegistrySnapshot();
+
+#if !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
+	// The previous state is held until the propagation completes, along with the snapshots.
+	if (bTrackRefreshMemory)
+	{
+		const SIZE_T RefreshBytes = RegistryState.GetMemoryStats().GetTotalBytes() + InPropagationContext.OriginalRegistryState.GetMemoryStats().GetTotalBytes() + GetSnapshotsAllocatedSize();
+		PeakRefreshBytes = FMath::Max(PeakRefreshBytes, RefreshBytes);
+	}
+#endif
+
 	// Leave only the actual changes.
 	InPropagationContext.OriginalRegistryState.DiffRecords(RegistryState);
 
@@ -628,7 +1351,7 @@ void UCommonInventoryRegistry::OnPostRefresh(FCommonInventoryDefaultsPropagation
 void UCommonInventoryRegistry::ConditionallyUpdateNetworkChecksum()
 {
 	// Register a custom network version for validating network compatibility.
-	// Network replays might require additional serialization of the registry state.
+	// Network replays carry their own RepIndex table, see WriteReplayHeader().
 	if (DataSourceTraits.bIsPersistent && UCommonInventorySettings::Get()->bRegisterNetworkCustomVersion)
 	{
 		constexpr FGuid NetworkVersionGuid{ 0x06A2707A, 0xF79A93F9, 0x49E576A9, 0x9EA1B0FA };
@@ -646,6 +1369,159 @@ void UCommonInventoryRegistry::ConditionallyUpdateNetworkChecksum()
 	}
 }
 
+// Key of the registry entry in the game specific data of replay headers.
+static const TCHAR* ReplayHeaderKey = TEXT("CommonInventoryRegistry=");
+
+// Version of the registry entry in replay headers.
+static constexpr uint8 ReplayHeaderVersion = 0;
+
+// The game specific header delegate is single-cast, so the one bound before the registry is chained.
+static FOnProcessGameSpecificDemoHeader PreviousProcessReplayHeaderDelegate;
+
+void UCommonInventoryRegistry::RegisterReplayDelegates()
+{
+	WriteReplayHeaderHandle = FNetworkReplayDelegates::OnWriteGameSpecificDemoHeader.AddUObject(this, &ThisClass::WriteReplayHeader);
+
+	PreviousProcessReplayHeaderDelegate = FNetworkReplayDelegates::OnProcessGameSpecificDemoHeader;
+	FNetworkReplayDelegates::OnProcessGameSpecificDemoHeader.BindWeakLambda(this, [this](const TArray<FString>& InGameSpecificData, FString& OutError)
+		{
+			return ProcessReplayHeader(InGameSpecificData, OutError) && (!PreviousProcessReplayHeaderDelegate.IsBound() || PreviousProcessReplayHeaderDelegate.Execute(InGameSpecificData, OutError));
+		});
+}
+
+void UCommonInventoryRegistry::UnregisterReplayDelegates()
+{
+	FNetworkReplayDelegates::OnWriteGameSpecificDemoHeader.Remove(WriteReplayHeaderHandle);
+	WriteReplayHeaderHandle.Reset();
+
+	if (FNetworkReplayDelegates::OnProcessGameSpecificDemoHeader.IsBoundToObject(this))
+	{
+		FNetworkReplayDelegates::OnProcessGameSpecificDemoHeader = MoveTemp(PreviousProcessReplayHeaderDelegate);
+	}
+
+	PreviousProcessReplayHeaderDelegate.Unbind();
+	ReplayItemTable.Empty();
+	ReplayRepIndexEncodingBitsNum = 0;
+}
+
+void UCommonInventoryRegistry::WriteReplayHeader(TArray<FString>& OutGameSpecificData) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::WriteReplayHeader);
+
+	TArray<uint8> Data;
+	FMemoryWriter Writer(Data);
+
+	uint8 Version = ReplayHeaderVersion;
+	uint32 Checksum = RegistryState.GetChecksum();
+	int32 NumRecords = RegistryState.GetRecords().Num();
+	Writer << Version << Checksum << NumRecords;
+
+	// RepIndex is dense, so the table is just the records in their order, grouped into runs of the same archetype.
+	const TArrayView<const FCommonInventoryRegistryRecord> Records = RegistryState.GetRecords();
+
+	for (int32 RunStart = 0; RunStart < Records.Num();)
+	{
+		FPrimaryAssetType Archetype = Records[RunStart].GetPrimaryAssetType();
+		int32 RunEnd = RunStart + 1;
+
+		while (RunEnd < Records.Num() && Records[RunEnd].GetPrimaryAssetType() == Archetype)
+		{
+			++RunEnd;
+		}
+
+		int32 NumNames = RunEnd - RunStart;
+		Writer << Archetype << NumNames;
+
+		for (; RunStart < RunEnd; ++RunStart)
+		{
+			FName PrimaryAssetName = Records[RunStart].GetPrimaryAssetName();
+			Writer << PrimaryAssetName;
+		}
+	}
+
+	OutGameSpecificData.Add(ReplayHeaderKey + FBase64::Encode(Data));
+}
+
+bool UCommonInventoryRegistry::ProcessReplayHeader(const TArray<FString>& InGameSpecificData, FString& OutError)
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::ProcessReplayHeader);
+
+	ReplayItemTable.Reset();
+	ReplayRepIndexEncodingBitsNum = 0;
+
+	const FString* const Entry = InGameSpecificData.FindByPredicate([](const FString& InEntry) { return InEntry.StartsWith(ReplayHeaderKey, ESearchCase::CaseSensitive); });
+
+	// Replays recorded without the registry entry are played against the local state as is.
+	if (!Entry)
+	{
+		return true;
+	}
+
+	TArray<uint8> Data;
+
+	if (!FBase64::Decode(Entry->RightChop(FCString::Strlen(ReplayHeaderKey)), Data))
+	{
+		OutError = TEXT("CommonInventoryRegistry: Failed to decode the replay header.");
+		return false;
+	}
+
+	FMemoryReader Reader(Data);
+
+	uint8 Version = 0;
+	uint32 Checksum = 0;
+	int32 NumRecords = 0;
+	Reader << Version << Checksum << NumRecords;
+
+	if (Reader.IsError() || Version > ReplayHeaderVersion || NumRecords < 0 || NumRecords > Data.Num())
+	{
+		OutError = FString::Printf(TEXT("CommonInventoryRegistry: Unsupported replay header of version %u."), Version);
+		return false;
+	}
+
+	// The same state maps RepIndex onto the same records.
+	if (Checksum == RegistryState.GetChecksum())
+	{
+		return true;
+	}
+
+	TArray<FPrimaryAssetId> ItemTable;
+	ItemTable.Reserve(NumRecords);
+
+	while (ItemTable.Num() < NumRecords && !Reader.IsError())
+	{
+		FPrimaryAssetType Archetype;
+		int32 NumNames = 0;
+		Reader << Archetype << NumNames;
+
+		if (NumNames <= 0 || NumNames > NumRecords - ItemTable.Num())
+		{
+			Reader.SetError();
+			break;
+		}
+
+		for (int32 Idx = 0; Idx < NumNames && !Reader.IsError(); ++Idx)
+		{
+			FName PrimaryAssetName;
+			Reader << PrimaryAssetName;
+			ItemTable.Emplace(Archetype, PrimaryAssetName);
+		}
+	}
+
+	if (Reader.IsError() || ItemTable.Num() != NumRecords)
+	{
+		OutError = TEXT("CommonInventoryRegistry: Failed to read the replay RepIndex table.");
+		return false;
+	}
+
+	// Items which are gone from the local registry can't be deserialized, but the replay might never reference them.
+	const int32 NumMissing = Algo::CountIf(ItemTable, [this](FPrimaryAssetId InPrimaryAssetId) { return !RegistryState.ContainsRecord(InPrimaryAssetId); });
+	COMMON_INVENTORY_LOG(Log, "UCommonInventoryRegistry: The replay was recorded with another registry state (%#x, local %#x), resolving %d items through the replay table, %d of which are missing.", Checksum, RegistryState.GetChecksum(), NumRecords, NumMissing);
+
+	ReplayItemTable = MoveTemp(ItemTable);
+	ReplayRepIndexEncodingBitsNum = FMath::CeilLogTwo(ReplayItemTable.Num() + /* Invalid */ 1);
+	return true;
+}
+
 #if WITH_EDITOR
 
 void UCommonInventoryRegistry::OnCookStarted()
@@ -685,53 +1561,95 @@ void UCommonInventoryRegistry::WriteForCook(const ITargetPlatform* InTargetPlatf
 		// It's much safer to generate the state at runtime if some assumptions were failed.
 		if (DataSource->VerifyAssumptionsForCook(InTargetPlatform))
 		{
+			// The full state is always written, so the build stays loadable without the patch.
 			if (!RegistryState.SaveToFile(InFilename, /* bIsCooking */ true))
 			{
 				COMMON_INVENTORY_LOG(Warning, "InventoryRegistry: Failed to write the state into '%s' during the cook.", *InFilename);
 			}
+
+			// Patches against a released base only carry the changed records.
+			if (FString BaseFilename; FParse::Value(FCommandLine::Get(), TEXT("InventoryRegistryPatchBase="), BaseFilename))
+			{
+				const FString PatchFilename = GetRegistryPatchFilename(InFilename);
+				FCommonInventoryRegistryState BaseState;
+
+				if (!BaseState.LoadFromFile(BaseFilename, /* bIsCooked */ true) || !RegistryState.SaveDeltaToFile(PatchFilename, BaseState))
+				{
+					COMMON_INVENTORY_LOG(Warning, "InventoryRegistry: Failed to write the delta against '%s' into '%s' during the cook.", *BaseFilename, *PatchFilename);
+				}
+			}
 		}
 	}
 }
 
 void UCommonInventoryRegistry::ReportInvariantViolation() const
 {
-	const TArrayView RecordsView = GetRegistryRecords();
+	COMMON_INVENTORY_SCOPED_TRACE(UCommonInventoryRegistry::ReportInvariantViolation);
+
+	const TConstArrayView<FCommonInventoryRegistryRecord> RecordsView = GetRegistryRecords();
+
+	// Redirect targets are matched against a set instead of scanning the records per redirect.
+	TSet<FName> RecordNames;
+	RecordNames.Reserve(RecordsView.Num());
+
+	for (const FCommonInventoryRegistryRecord& Record : RecordsView)
+	{
+		RecordNames.Add(Record.GetPrimaryAssetName());
+	}
 
 	// Report stale name redirects.
 	for (const auto [OldName, NewName] : FCommonInventoryRedirects::Get().GetNameRedirects())
 	{
-		if (!RecordsView.ContainsByPredicate([NewName](const FCommonInventoryRegistryRecord& InRecord) { return InRecord.GetPrimaryAssetName() == NewName; }))
+		if (!RecordNames.Contains(NewName))
 		{
 			COMMON_INVENTORY_LOG(Warning, "Inventory Registry contains a stale name redirect: '%s' -> '%s'.", *OldName.ToString(), *NewName.ToString());
 		}
 	}
 
-	// Report stale type redirects.
+	// Report stale type redirects. Archetypes are already indexed.
 	for (const auto [OldType, NewType] : FCommonInventoryRedirects::Get().GetTypeRedirects())
 	{
-		if (!RecordsView.ContainsByPredicate([NewType](const FCommonInventoryRegistryRecord& InRecord) { return InRecord.GetPrimaryAssetType() == NewType; }))
+		if (!RegistryState.ContainsArchetype(NewType))
 		{
 			COMMON_INVENTORY_LOG(Warning, "Inventory Registry contains a stale type redirect: '%s' -> '%s'.", *OldType.ToString(), *NewType.ToString());
 		}
 	}
 
+	// Whether the payload type has object references, which is evaluated once per type rather than per record.
+	TMap<const UScriptStruct*, bool> PayloadTypes;
 	TArray<const FStructProperty*> EncounteredStructProps;
 
-	// Check for object references in DefaultPayload.
-	for (const FCommonInventoryRegistryRecord& Record : GetRegistryRecords())
-	{
-		if (Record.DefaultPayload.IsValid())
+	const auto ContainsObjectReference = [&EncounteredStructProps](const UScriptStruct* InScriptStruct)
 		{
-			for (TFieldIterator<FProperty> It{ Record.DefaultPayload.GetScriptStruct() }; It; ++It)
+			for (TFieldIterator<FProperty> It{ InScriptStruct }; It; ++It)
 			{
 				// Function is recursive and will handle nested types for us.
 				if (It->ContainsObjectReference(EncounteredStructProps, EPropertyObjectReferenceType::Strong | EPropertyObjectReferenceType::Weak))
 				{
-					COMMON_INVENTORY_LOG(Error, "InventoryRegistry: Encountered DefaultPayload with object references in %s ('%s'), which is not allowed.",
-										 *Record.GetPrimaryAssetId().ToString(), *Record.AssetPath.ToString());
-					break;
+					return true;
 				}
 			}
+
+			return false;
+		};
+
+	// Check for object references in DefaultPayload.
+	for (const FCommonInventoryRegistryRecord& Record : RecordsView)
+	{
+		if (const UScriptStruct* const PayloadType = Record.DefaultPayload.GetScriptStruct())
+		{
+			bool* bHasObjectReferences = PayloadTypes.Find(PayloadType);
+
+			if (!bHasObjectReferences)
+			{
+				bHasObjectReferences = &PayloadTypes.Add(PayloadType, ContainsObjectReference(PayloadType));
+			}
+
+			if (*bHasObjectReferences)
+			{
+				COMMON_INVENTORY_LOG(Error, "InventoryRegistry: Encountered DefaultPayload with object references in %s ('%s'), which is not allowed.",
+									 *Record.GetPrimaryAssetId().ToString(), *Record.AssetPath.ToString());
+			}
 		}
 	}
 }
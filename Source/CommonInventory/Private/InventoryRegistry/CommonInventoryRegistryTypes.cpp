@@ -4,37 +4,53 @@
 
 #include "CommonInventoryLog.h"
 #include "CommonInventorySettings.h"
+#include "CommonInventoryState.h"
 #include "CommonInventoryTrace.h"
 #include "CommonInventoryUtility.h"
 
+#include "Algo/AllOf.h"
 #include "Algo/BinarySearch.h"
 #include "Algo/ForEach.h"
 #include "Algo/IsSorted.h"
+#include "Algo/Sort.h"
+#include "Algo/StableSort.h"
 #include "AssetRegistry/AssetData.h"
 #include "AssetRegistry/IAssetRegistry.h"
+#include "Async/MappedFileHandle.h"
 #include "CoreGlobals.h"
 #include "Engine/Engine.h"
 #include "Engine/GameInstance.h"
 #include "Engine/World.h"
 #include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Hash/xxhash.h"
 #include "Serialization/ArchiveUObject.h"
 #include "Serialization/BufferArchive.h"
 #include "Serialization/CustomVersion.h"
 #include "Serialization/LargeMemoryReader.h"
 #include "Serialization/ObjectAndNameAsStringProxyArchive.h"
+#include "Serialization/StructuredArchiveAdapters.h"
 #include "Templates/UniquePtr.h"
 #include "Templates/UnrealTemplate.h"
 #include "Misc/Crc.h"
+#include "Misc/ScopeRWLock.h"
 #include "Misc/EngineVersionComparison.h"
 #include "Misc/EnumerateRange.h"
 #include "Misc/Guid.h"
+#include "Net/RepLayout.h"
+#include "UObject/PropertyOptional.h"
 #include "UObject/UObjectGlobals.h"
  
 #if WITH_EDITOR
+#include "GameFramework/Actor.h"
 #include "Misc/ScopeLock.h"
 #include "Misc/SpinLock.h"
+#include "Misc/TransactionObjectEvent.h"
+#include "UObject/Package.h"
+#include "UObject/UObjectThreadContext.h"
 #endif
 
+#include <atomic>
 #include <type_traits>
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryRegistryTypes)
@@ -77,10 +93,22 @@ uint32 FCommonInventoryRegistryRecord::GetChecksum() const
 {
 	if (Checksum == 0)
 	{
+#if COMMON_INVENTORY_WITH_BINARY_CHECKSUM
+		FXxHash64Builder Builder;
+		CommonInventory::HashScriptStruct(Builder, FConstStructView::Make(SharedData));
+		CommonInventory::HashScriptStruct(Builder, DefaultPayload);
+		CommonInventory::HashScriptStruct(Builder, CustomData);
+		CommonInventory::HashScriptStruct(Builder, FConstStructView::Make(AssetPath));
+
+		// Zero is reserved for the invalidated checksum.
+		const uint64 Hash = Builder.Finalize().Hash;
+		Checksum = FMath::Max(static_cast<uint32>(Hash ^ (Hash >> 32)), 1u);
+#else
 		Checksum = FCrc::StrCrc32(*CommonInventory::ExportScriptStruct(FConstStructView::Make(SharedData)), Checksum);
 		Checksum = FCrc::StrCrc32(*CommonInventory::ExportScriptStruct(DefaultPayload), Checksum);
 		Checksum = FCrc::StrCrc32(*CommonInventory::ExportScriptStruct(CustomData), Checksum);
 		Checksum = FCrc::StrCrc32(*AssetPath.GetAssetPathString(), Checksum);
+#endif // COMMON_INVENTORY_WITH_BINARY_CHECKSUM
 	}
 
 	return Checksum;
@@ -100,6 +128,31 @@ void FCommonInventoryRegistryRecord::Dump() const
 /* FCommonInventoryRegistryState                                        */
 /************************************************************************/
 
+FCommonInventoryRegistryState::FCommonInventoryRegistryState(const FCommonInventoryRegistryState& Other)
+{
+	*this = Other;
+}
+
+FCommonInventoryRegistryState& FCommonInventoryRegistryState::operator=(const FCommonInventoryRegistryState& Other)
+{
+	if (this != &Other)
+	{
+		DataContainer = Other.DataContainer;
+		CustomDataContainer = Other.CustomDataContainer;
+		FreeCustomData = Other.FreeCustomData;
+		NumFreeCustomData = Other.NumFreeCustomData;
+		Archetypes = Other.Archetypes;
+		RepLayouts = Other.RepLayouts;
+
+		// Rebuild mappings and views over the copied container.
+		FixupDependencies(/* bMigrateArchetypeChecksum */ true);
+		Checksum = Other.Checksum;
+		FileChecksum = Other.FileChecksum;
+	}
+
+	return *this;
+}
+
 #if UE_VERSION_OLDER_THAN(5, 5, 0)
 
 COMMON_INVENTORY_IMPLEMENT_GET_PRIVATE_MEMBER(FInstancedStructContainer, NumItems, int32);
@@ -111,14 +164,27 @@ FCommonInventoryRegistryState& FCommonInventoryRegistryState::operator=(FCommonI
 
 		DataContainer = MoveTemp(Other.DataContainer);
 		CustomDataContainer = MoveTemp(Other.CustomDataContainer);
+		FreeCustomData = MoveTemp(Other.FreeCustomData);
+		MaxStackSizes = MoveTemp(Other.MaxStackSizes);
+		DefaultPayloadTypes = MoveTemp(Other.DefaultPayloadTypes);
+		TagIndex = MoveTemp(Other.TagIndex);
 		Archetypes = MoveTemp(Other.Archetypes);
 		DataMap = MoveTemp(Other.DataMap);
-		ReplicationMap = MoveTemp(Other.ReplicationMap);
+		NameMap = MoveTemp(Other.NameMap);
+		NameSearchIndex = MoveTemp(Other.NameSearchIndex);
+#if WITH_EDITOR
+		SearchableNames = MoveTemp(Other.SearchableNames);
+#endif
+		RepLayouts = MoveTemp(Other.RepLayouts);
 
 		RepIndexEncodingBitsNum = Other.RepIndexEncodingBitsNum;
+		NumFreeCustomData = Other.NumFreeCustomData;
+		Generation = Other.Generation;
 		Checksum = Other.Checksum;
+		FileChecksum = Other.FileChecksum;
 
 		Other.RepIndexEncodingBitsNum = 0;
+		Other.NumFreeCustomData = 0;
 		Other.Checksum = 0;
 
 		COMMON_INVENTORY_GET_PRIVATE_MEMBER(FInstancedStructContainer, CustomDataContainer, NumItems) = CustomDataOriginalNum;
@@ -129,6 +195,21 @@ FCommonInventoryRegistryState& FCommonInventoryRegistryState::operator=(FCommonI
 
 #endif // UE_VERSION_OLDER_THAN(5, 5, 0)
 
+// Rebuilds the container from views, which are allowed to point into the container itself.
+static void CompactCustomDataContainer(FInstancedStructContainer& InOutContainer, TConstArrayView<FConstStructView> InCustomData)
+{
+	FInstancedStructContainer CompactedContainer;
+	CompactedContainer.Append(InCustomData);
+
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+	const int32 CompactedNum = CompactedContainer.Num();
+	InOutContainer = MoveTemp(CompactedContainer);
+	COMMON_INVENTORY_GET_PRIVATE_MEMBER(FInstancedStructContainer, InOutContainer, NumItems) = CompactedNum;
+#else
+	InOutContainer = MoveTemp(CompactedContainer);
+#endif // UE_VERSION_OLDER_THAN(5, 5, 0)
+}
+
 void FCommonInventoryRegistryState::Reset(TConstArrayView<FCommonInventoryRegistryRecord> InRegistryData)
 {
 	DataContainer.Reset(InRegistryData.Num());
@@ -149,6 +230,8 @@ void FCommonInventoryRegistryState::Reset(TConstArrayView<FCommonInventoryRegist
 
 	CustomDataContainer.Reset();
 	CustomDataContainer.Append(CustomData);
+	FreeCustomData.Reset();
+	NumFreeCustomData = 0;
 
 	// Invalidate cached checksums just in case.
 	Algo::ForEach(DataContainer, &FCommonInventoryRegistryRecord::InvalidateChecksum);
@@ -162,7 +245,16 @@ bool FCommonInventoryRegistryState::AppendData(const FCommonInventoryRegistryRec
 	// Try to update existing data.
 	if (ContainsRecord(InRecord.GetPrimaryAssetId()))
 	{
-		FCommonInventoryRegistryRecord& ExistingRecord = DataContainer[DataMap.FindChecked(InRecord.GetPrimaryAssetId())];
+		const int32 ExistingIndex = DataMap.FindChecked(InRecord.GetPrimaryAssetId());
+		FCommonInventoryRegistryRecord& ExistingRecord = DataContainer[ExistingIndex];
+
+		// Record indices don't change, so only the tags of the record have to be reindexed.
+		if (ExistingRecord.SharedData.GameplayTags != InRecord.SharedData.GameplayTags)
+		{
+			IndexRecordTags(ExistingIndex, ExistingRecord.SharedData.GameplayTags, /* bIsIndexed */ false);
+			IndexRecordTags(ExistingIndex, InRecord.SharedData.GameplayTags, /* bIsIndexed */ true);
+		}
+
 		ExistingRecord.SharedData = InRecord.SharedData;
 		ExistingRecord.AssetPath = InRecord.AssetPath;
 
@@ -186,8 +278,7 @@ bool FCommonInventoryRegistryState::AppendData(const FCommonInventoryRegistryRec
 
 				if (InStructView.IsValid())
 				{
-					TargetIndex = CustomDataContainer.Num();
-					CustomDataContainer.Append({ InStructView });
+					TargetIndex = AddCustomData(InStructView);
 					ExistingStructView = CustomDataContainer[TargetIndex];
 				}
 				else
@@ -200,6 +291,8 @@ bool FCommonInventoryRegistryState::AppendData(const FCommonInventoryRegistryRec
 
 		RefreshCustomData(InRecord.DefaultPayload, ExistingRecord.DefaultPayload, ExistingRecord.DefaultPayloadIndex);
 		RefreshCustomData(InRecord.CustomData, ExistingRecord.CustomData, ExistingRecord.CustomDataIndex);
+		RefreshHotColumns(ExistingIndex);
+		ConditionalCompactCustomData();
 		
 		// Invalidate the entire checksum chain.
 		FindArchetypeGroup(ExistingRecord.GetPrimaryAssetType())->Checksum = 0;
@@ -227,8 +320,7 @@ bool FCommonInventoryRegistryState::AppendData(const FCommonInventoryRegistryRec
 			if (InStructView.IsValid())
 			{
 				// FixupDependencies() will update views.
-				OutIndex = CustomDataContainer.Num();
-				CustomDataContainer.Append({ InStructView });
+				OutIndex = AddCustomData(InStructView);
 			}
 			else
 			{
@@ -267,6 +359,7 @@ bool FCommonInventoryRegistryState::RemoveData(FPrimaryAssetId PrimaryAssetId)
 		// Finally, remove record and fixup secondary data.
 		const int32 Idx = DataMap.FindChecked(RegistryRecord->GetPrimaryAssetId());
 		DataContainer.RemoveAt(Idx, EAllowShrinking::No);
+		ConditionalCompactCustomData();
 		FixupDependencies(/* bMigrateArchetypeChecksum */ true);
 
 		return true;
@@ -275,13 +368,182 @@ bool FCommonInventoryRegistryState::RemoveData(FPrimaryAssetId PrimaryAssetId)
 	return false;
 }
 
-void FCommonInventoryRegistryState::FixupDependencies(bool bMigrateArchetypeChecksum /* = false */)
+FCommonInventoryRegistryState::FDeltaStats FCommonInventoryRegistryState::ApplyDelta(TConstArrayView<FCommonInventoryRegistryRecord> InUpserts, TConstArrayView<FPrimaryAssetId> InRemoves)
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::ApplyDelta);
+
+	FDeltaStats Stats;
+
+	if (InUpserts.IsEmpty() && InRemoves.IsEmpty())
+	{
+		return Stats;
+	}
+
+	// Sort upserts once. The stable sort keeps the last duplicate at the end of its range.
+	TArray<const FCommonInventoryRegistryRecord*, TInlineAllocator<128>> SortedUpserts;
+	SortedUpserts.Reserve(InUpserts.Num());
+
+	for (const FCommonInventoryRegistryRecord& Upsert : InUpserts)
+	{
+		if (ensureMsgf(Upsert.IsValid(), TEXT("FCommonInventoryRegistryState: Attempt to upsert a record with invalid FPrimaryAssetId.")))
+		{
+			SortedUpserts.Emplace(&Upsert);
+		}
+	}
+
+	Algo::StableSort(SortedUpserts, [](const FCommonInventoryRegistryRecord* Lhs, const FCommonInventoryRegistryRecord* Rhs) { return *Lhs < *Rhs; });
+
+	TSet<FPrimaryAssetId> PendingRemoves;
+	PendingRemoves.Append(InRemoves);
+
+	TArray<FCommonInventoryRegistryRecord> MergedContainer;
+	MergedContainer.Reserve(DataContainer.Num() + SortedUpserts.Num());
+
+	TArray<FConstStructView, TInlineAllocator<128>> CustomData;
+	CustomData.Reserve(CustomDataContainer.Num() + SortedUpserts.Num() * 2);
+
+	// FixupDependencies() will update DefaultPayload and CustomData views.
+	auto CollectCustomData = [&CustomData](FCommonInventoryRegistryRecord& InRecord)
+		{
+			InRecord.DefaultPayloadIndex = InRecord.DefaultPayload.IsValid() ? CustomData.Emplace(InRecord.DefaultPayload) : INDEX_NONE;
+			InRecord.CustomDataIndex = InRecord.CustomData.IsValid() ? CustomData.Emplace(InRecord.CustomData) : INDEX_NONE;
+		};
+
+	auto InvalidateArchetypeChecksum = [this](FPrimaryAssetType InPrimaryAssetType)
+		{
+			if (FArchetypeGroup* const Archetype = FindArchetypeGroup(InPrimaryAssetType))
+			{
+				Archetype->Checksum = 0;
+			}
+		};
+
+	// Both ranges are sorted, so a single merge pass is enough.
+	for (int32 ExistingIdx = 0, UpsertIdx = 0; ExistingIdx < DataContainer.Num() || UpsertIdx < SortedUpserts.Num();)
+	{
+		const FCommonInventoryRegistryRecord* const Existing = DataContainer.IsValidIndex(ExistingIdx) ? &DataContainer[ExistingIdx] : nullptr;
+		const FCommonInventoryRegistryRecord* const Upsert = SortedUpserts.IsValidIndex(UpsertIdx) ? SortedUpserts[UpsertIdx] : nullptr;
+
+		// Skip duplicated upserts, the last one wins.
+		if (Upsert && SortedUpserts.IsValidIndex(UpsertIdx + 1) && SortedUpserts[UpsertIdx + 1]->GetPrimaryAssetId() == Upsert->GetPrimaryAssetId())
+		{
+			++UpsertIdx;
+			continue;
+		}
+
+		if (Existing && (!Upsert || *Existing < *Upsert))
+		{
+			++ExistingIdx;
+
+			if (PendingRemoves.Contains(Existing->GetPrimaryAssetId()))
+			{
+				InvalidateArchetypeChecksum(Existing->GetPrimaryAssetType());
+				++Stats.NumRemoved;
+				continue;
+			}
+
+			// Keep the record along with its cached checksum.
+			CollectCustomData(MergedContainer.Add_GetRef(*Existing));
+		}
+		else
+		{
+			// The records are equal if neither is less than the other.
+			if (Existing && !(*Upsert < *Existing))
+			{
+				++ExistingIdx;
+				++Stats.NumUpdated;
+			}
+			else
+			{
+				++Stats.NumAdded;
+			}
+
+			++UpsertIdx;
+			InvalidateArchetypeChecksum(Upsert->GetPrimaryAssetType());
+
+			FCommonInventoryRegistryRecord& NewRecord = MergedContainer.Add_GetRef(*Upsert);
+			NewRecord.InvalidateChecksum();
+			CollectCustomData(NewRecord);
+		}
+	}
+
+	if (Stats.NumAdded > 0 || Stats.NumUpdated > 0 || Stats.NumRemoved > 0)
+	{
+		// Compact the shared storage once. Views are copied before the previous storage is released.
+		CompactCustomDataContainer(CustomDataContainer, CustomData);
+		FreeCustomData.Reset();
+		NumFreeCustomData = 0;
+		DataContainer = MoveTemp(MergedContainer);
+		FixupDependencies(/* bMigrateArchetypeChecksum */ true);
+	}
+
+	return Stats;
+}
+
+void FCommonInventoryRegistryState::RefreshRepLayouts()
+{
+	// FRepLayout walks reflection data and net field exports, which isn't safe outside of the game thread.
+	check(IsInGameThread());
+
+#if WITH_EDITOR
+	// Payload types might be recompiled in place, e.g. user defined structs.
+	RepLayouts.Reset();
+#endif
+
+	// Keep RepLayouts to avoid rebuilding them for the same types.
+	TMap<const UScriptStruct*, TSharedPtr<FRepLayout>> CachedRepLayouts = MoveTemp(RepLayouts);
+
+	for (FCommonInventoryRegistryRecord& RegistryData : DataContainer)
+	{
+		// Refresh RepLayout to avoid looking it up from the net driver during replication.
+		RegistryData.PayloadRepLayout.Reset();
+
+		if (const UScriptStruct* const PayloadStruct = RegistryData.DefaultPayload.GetScriptStruct(); PayloadStruct && !(PayloadStruct->StructFlags & STRUCT_NetSerializeNative))
+		{
+			TSharedPtr<FRepLayout>& RepLayout = RepLayouts.FindOrAdd(PayloadStruct);
+
+			if (!RepLayout.IsValid())
+			{
+				if (const TSharedPtr<FRepLayout>* const CachedRepLayout = CachedRepLayouts.Find(PayloadStruct))
+				{
+					RepLayout = *CachedRepLayout;
+				}
+				else
+				{
+					RepLayout = FRepLayout::CreateFromStruct(const_cast<UScriptStruct*>(PayloadStruct), /* ServerConnection */ nullptr);
+				}
+			}
+
+			RegistryData.PayloadRepLayout = RepLayout;
+		}
+	}
+}
+
+// Shared between all states, so handles never resolve against a different state.
+static std::atomic<uint32> RegistryStateGeneration = 0;
+
+void FCommonInventoryRegistryState::FixupDependencies(bool bMigrateArchetypeChecksum /* = false */, bool bKeepTagIndex /* = false */)
 {
 	check(Algo::IsSorted(DataContainer));
 
+	// Invalidate all the handles, as record indices might have changed.
+	Generation = ++RegistryStateGeneration;
+
 	RepIndexEncodingBitsNum = FMath::CeilLogTwo(DataContainer.Num() + /* Invalid */ 1);
-	ReplicationMap.Empty(DataContainer.Num());
+	MaxStackSizes.SetNumUninitialized(DataContainer.Num(), EAllowShrinking::No);
+	DefaultPayloadTypes.SetNumUninitialized(DataContainer.Num(), EAllowShrinking::No);
+
+	if (!bKeepTagIndex)
+	{
+		TagIndex.Reset();
+	}
+
 	DataMap.Empty(DataContainer.Num());
+	NameMap.Empty(DataContainer.Num());
+	NameSearchIndex.Reset();
+
+#if WITH_EDITOR
+	SearchableNames.Reset(DataContainer.Num());
+#endif
 	
 	// Keep archetype data to migrate checksum later.
 	TArray<FArchetypeGroup, TInlineAllocator<12>> CachedArchetypes = MoveTemp(Archetypes);
@@ -293,10 +555,15 @@ void FCommonInventoryRegistryState::FixupDependencies(bool bMigrateArchetypeChec
 	{
 		checkf(!DataMap.Contains(RegistryData->GetPrimaryAssetId()), TEXT("FInventoryRegistryState: Found duplicated FPrimaryAssetId."));
 
-		// Refresh mappings.
+		// Refresh mappings. RepIndex must stay dense, see GetRecordFromReplication().
 		RegistryData->RepIndex = RegistryData.GetIndex() + /* Invalid */ 1;
-		ReplicationMap.Add(RegistryData->RepIndex, RegistryData.GetIndex());
 		DataMap.Add(RegistryData->GetPrimaryAssetId(), RegistryData.GetIndex());
+		NameMap.FindOrAdd(RegistryData->GetPrimaryAssetName(), RegistryData.GetIndex());
+
+#if WITH_EDITOR
+		// See FCommonItem::MakeSearchableName().
+		SearchableNames.Emplace(RegistryData->GetPrimaryAssetId().ToString());
+#endif
 
 		auto RefreshViewData = [this](FConstStructView& OutStructView, int32 InIndex)
 			{
@@ -314,6 +581,13 @@ void FCommonInventoryRegistryState::FixupDependencies(bool bMigrateArchetypeChec
 		RefreshViewData(RegistryData->DefaultPayload, RegistryData->DefaultPayloadIndex);
 		RefreshViewData(RegistryData->CustomData, RegistryData->CustomDataIndex);
 
+		RefreshHotColumns(RegistryData.GetIndex());
+
+		if (!bKeepTagIndex)
+		{
+			IndexRecordTags(RegistryData.GetIndex(), RegistryData->SharedData.GameplayTags, /* bIsIndexed */ true);
+		}
+
 		// Refresh archetype groups.
 		if (!ArchetypeIterator || ArchetypeIterator->PrimaryAssetType != RegistryData->GetPrimaryAssetType())
 		{
@@ -323,6 +597,12 @@ void FCommonInventoryRegistryState::FixupDependencies(bool bMigrateArchetypeChec
 		++ArchetypeIterator->Offset;
 	}
 
+	// States loaded on workers build them once handed over to the game thread, see UCommonInventoryRegistry::CompleteAsyncLoad().
+	if (IsInGameThread())
+	{
+		RefreshRepLayouts();
+	}
+
 	Checksum = 0; // Invalidate the top-level checksum.
 
 	if (bMigrateArchetypeChecksum)
@@ -337,29 +617,196 @@ void FCommonInventoryRegistryState::FixupDependencies(bool bMigrateArchetypeChec
 	}
 }
 
+void FCommonInventoryRegistryState::RefreshHotColumns(int32 InRecordIndex)
+{
+	const FCommonInventoryRegistryRecord& Record = DataContainer[InRecordIndex];
+	MaxStackSizes[InRecordIndex] = Record.SharedData.MaxStackSize;
+	DefaultPayloadTypes[InRecordIndex] = Record.DefaultPayload.GetScriptStruct();
+}
+
+void FCommonInventoryRegistryState::IndexRecordTags(int32 InRecordIndex, const FGameplayTagContainer& InTags, bool bIsIndexed)
+{
+	if (InTags.IsEmpty())
+	{
+		return;
+	}
+
+	const int32 WordIndex = InRecordIndex / 64;
+	const uint64 BitMask = uint64(1) << (InRecordIndex % 64);
+	const int32 WordsNum = FMath::DivideAndRoundUp(DataContainer.Num(), 64);
+
+	// Parents are indexed as well to match FGameplayTagContainer::HasTag().
+	for (const FGameplayTag& Tag : InTags.GetGameplayTagParents())
+	{
+		TArray<uint64>& Bitset = TagIndex.FindOrAdd(Tag);
+		Bitset.SetNumZeroed(WordsNum, EAllowShrinking::No);
+
+		if (bIsIndexed)
+		{
+			Bitset[WordIndex] |= BitMask;
+		}
+		else
+		{
+			Bitset[WordIndex] &= ~BitMask;
+		}
+	}
+}
+
+void FCommonInventoryRegistryState::FindRecordsByTags(const FGameplayTagContainer& InRequiredTags, const FGameplayTagContainer& InExcludedTags, TArray<int32>& OutRecordIndices) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::FindRecordsByTags);
+
+	const int32 WordsNum = FMath::DivideAndRoundUp(DataContainer.Num(), 64);
+
+	if (WordsNum == 0)
+	{
+		return;
+	}
+
+	TArray<uint64, TInlineAllocator<64>> Matches;
+	Matches.Init(~uint64(0), WordsNum);
+
+	// Mask out bits past the last record.
+	if (const int32 TailBitsNum = DataContainer.Num() % 64)
+	{
+		Matches.Last() = (uint64(1) << TailBitsNum) - 1;
+	}
+
+	// Plain word-wise loops, which compilers vectorize.
+	for (const FGameplayTag& Tag : InRequiredTags)
+	{
+		const TArray<uint64>* const Bitset = TagIndex.Find(Tag);
+
+		if (!Bitset)
+		{
+			return;
+		}
+
+		const uint64* const Words = Bitset->GetData();
+
+		for (int32 WordIdx = 0; WordIdx < WordsNum; ++WordIdx)
+		{
+			Matches[WordIdx] &= Words[WordIdx];
+		}
+	}
+
+	for (const FGameplayTag& Tag : InExcludedTags)
+	{
+		if (const TArray<uint64>* const Bitset = TagIndex.Find(Tag))
+		{
+			const uint64* const Words = Bitset->GetData();
+
+			for (int32 WordIdx = 0; WordIdx < WordsNum; ++WordIdx)
+			{
+				Matches[WordIdx] &= ~Words[WordIdx];
+			}
+		}
+	}
+
+	for (int32 WordIdx = 0; WordIdx < WordsNum; ++WordIdx)
+	{
+		for (uint64 Word = Matches[WordIdx]; Word != 0; Word &= Word - 1)
+		{
+			OutRecordIndices.Add(WordIdx * 64 + static_cast<int32>(FMath::CountTrailingZeros64(Word)));
+		}
+	}
+}
+
+// Free slots are compacted once they exceed both thresholds.
+static constexpr int32 CUSTOM_DATA_COMPACTION_MIN_FREE_SLOTS = 64;
+static constexpr int32 CUSTOM_DATA_COMPACTION_FREE_SLOTS_PERCENT = 25;
+
+int32 FCommonInventoryRegistryState::AddCustomData(FConstStructView InStructView)
+{
+	check(InStructView.IsValid());
+
+	// Reuse a free slot of the same type, so the container stays intact.
+	if (TArray<int32>* const FreeSlots = FreeCustomData.Find(InStructView.GetScriptStruct()); FreeSlots && !FreeSlots->IsEmpty())
+	{
+		const int32 SlotIndex = FreeSlots->Pop(EAllowShrinking::No);
+		InStructView.GetScriptStruct()->CopyScriptStruct(CustomDataContainer[SlotIndex].GetMemory(), InStructView.GetMemory());
+		--NumFreeCustomData;
+		return SlotIndex;
+	}
+
+	const uint8* const PreviousMemory = CustomDataContainer.IsEmpty() ? nullptr : CustomDataContainer[0].GetMemory();
+	const int32 SlotIndex = CustomDataContainer.Num();
+	CustomDataContainer.Append({ InStructView });
+
+	// Growing might have relocated the storage.
+	if (PreviousMemory && PreviousMemory != CustomDataContainer[0].GetMemory())
+	{
+		RefreshCustomDataViews();
+	}
+
+	return SlotIndex;
+}
+
 void FCommonInventoryRegistryState::RemoveCustomData(int32 InCustomDataIndex)
 {
 	if (CustomDataContainer.IsValidIndex(InCustomDataIndex))
 	{
-		CustomDataContainer.RemoveAt(InCustomDataIndex, /* Count */ 1);
+		const FStructView SlotView = CustomDataContainer[InCustomDataIndex];
+
+		// Release any resources held by the data, but keep the slot typed for reuse.
+		SlotView.GetScriptStruct()->ClearScriptStruct(SlotView.GetMemory());
+		FreeCustomData.FindOrAdd(SlotView.GetScriptStruct()).Add(InCustomDataIndex);
+		++NumFreeCustomData;
+	}
+}
+
+void FCommonInventoryRegistryState::CompactCustomData()
+{
+	if (NumFreeCustomData == 0)
+	{
+		return;
+	}
+
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::CompactCustomData);
+
+	TArray<FConstStructView, TInlineAllocator<128>> CustomData;
+	CustomData.Reserve(CustomDataContainer.Num() - NumFreeCustomData);
+
+	for (FCommonInventoryRegistryRecord& Record : DataContainer)
+	{
+		Record.DefaultPayloadIndex = Record.DefaultPayload.IsValid() ? CustomData.Emplace(Record.DefaultPayload) : INDEX_NONE;
+		Record.CustomDataIndex = Record.CustomData.IsValid() ? CustomData.Emplace(Record.CustomData) : INDEX_NONE;
+	}
+
+	// Views are copied before the previous storage is released.
+	CompactCustomDataContainer(CustomDataContainer, CustomData);
+	FreeCustomData.Reset();
+	NumFreeCustomData = 0;
 
-		// Shift subsequent indices and update cached views.
-		if (CustomDataContainer.IsValidIndex(InCustomDataIndex))
+	RefreshCustomDataViews();
+}
+
+void FCommonInventoryRegistryState::ConditionalCompactCustomData()
+{
+	if (NumFreeCustomData >= CUSTOM_DATA_COMPACTION_MIN_FREE_SLOTS && NumFreeCustomData * 100 >= CustomDataContainer.Num() * CUSTOM_DATA_COMPACTION_FREE_SLOTS_PERCENT)
+	{
+		CompactCustomData();
+	}
+}
+
+void FCommonInventoryRegistryState::RefreshCustomDataViews()
+{
+	auto RefreshViewData = [this](FConstStructView& OutStructView, int32 InIndex)
 		{
-			// DefaultPayload and CustomData shares the same container.
-			for (FCommonInventoryRegistryRecord& RegistryRecord : DataContainer)
+			if (CustomDataContainer.IsValidIndex(InIndex))
 			{
-				if (RegistryRecord.DefaultPayloadIndex > InCustomDataIndex)
-				{
-					RegistryRecord.DefaultPayload = CustomDataContainer[--RegistryRecord.DefaultPayloadIndex];
-				}
-
-				if (RegistryRecord.CustomDataIndex > InCustomDataIndex)
-				{
-					RegistryRecord.CustomData = CustomDataContainer[--RegistryRecord.CustomDataIndex];
-				}
+				OutStructView = CustomDataContainer[InIndex];
 			}
-		}
+			else
+			{
+				OutStructView.Reset();
+			}
+		};
+
+	for (FCommonInventoryRegistryRecord& Record : DataContainer)
+	{
+		RefreshViewData(Record.DefaultPayload, Record.DefaultPayloadIndex);
+		RefreshViewData(Record.CustomData, Record.CustomDataIndex);
 	}
 }
 
@@ -384,6 +831,15 @@ uint32 FCommonInventoryRegistryState::GetChecksum() const
 	return Checksum;
 }
 
+uint32 FCommonInventoryRegistryState::GetArchetypeChecksum(FPrimaryAssetType InArchetype) const
+{
+	// Calculates checksums of all archetypes along the way.
+	GetChecksum();
+
+	const FArchetypeGroup* const ArchetypeGroup = FindArchetypeGroup(InArchetype);
+	return ArchetypeGroup ? ArchetypeGroup->Checksum : 0;
+}
+
 struct FInventoryRegistryHeaderVersion
 {
 	FInventoryRegistryHeaderVersion() = delete;
@@ -395,6 +851,12 @@ struct FInventoryRegistryHeaderVersion
 	{
 		InitialVersion = 0,
 
+		// Cooked states use a name table with fixed-layout records, which can be read directly from the mapped file.
+		MappedLayout,
+
+		// Cooked states carry TagIndex and the final checksums, so they are loaded as-is.
+		DerivedIndices,
+
 		// -----<new versions can be added above this line>-----
 		VersionPlusOne,
 		LatestVersion = VersionPlusOne - 1
@@ -446,45 +908,197 @@ public:
 
 		return !Ar.IsError();
 	}
-};
 
-bool FCommonInventoryRegistryState::SaveToFile(const FString& Filename, bool bIsCooking)
-{
-	if (TUniquePtr<FArchive> Writer{ IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_EvenIfReadOnly) })
+	bool Validate(bool bInIsCooked) const
 	{
-		FNameAsStringProxyArchive ProxyWriter(*Writer);
-		return SaveState(ProxyWriter, bIsCooking);
-	}
+		if (Version > FInventoryRegistryHeaderVersion::LatestVersion)
+		{
+			COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Unable to load InventoryRegistry.bin with a newer version.");
+			return false;
+		}
 
-	return false;
-}
+		if (DataSourceClass != UCommonInventorySettings::Get()->DataSourceClassName)
+		{
+			COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Unable to load InventoryRegistry.bin with different data source.");
+			return false;
+		}
 
-bool FCommonInventoryRegistryState::SaveState(FArchive& Ar, bool bIsCooking)
+		if (bIsCooked != bInIsCooked)
+		{
+			COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Unable to load InventoryRegistry.bin with unexpected cooking state.");
+			return false;
+		}
+
+		return true;
+	}
+};
+
+// Header of a delta patch, which is applied on top of the state loaded from the file with BaseChecksum.
+struct FInventoryRegistryDeltaHeader
 {
-	check(Ar.IsSaving());
+	static inline const FName ArchiveName = TEXT("InventoryRegistryDeltaArchive");
 
-	// In-memory storage for serialized state.
-	FBufferArchive64 BufferArchive(/* bIsPersistent */ true, FInventoryRegistryHeader::ArchiveName);
-	BufferArchive.SetWantBinaryPropertySerialization(bIsCooking);
-	FObjectAndNameAsStringProxyArchive Writer(BufferArchive, false);
-	Writer.SetFilterEditorOnly(bIsCooking);
-	
-	// Write the actual state.
-	StaticStruct()->SerializeItem(Writer, this, nullptr);
+	// "Inventory Delta!" little endian hex representation.
+	static constexpr FGuid Magic{ 0x65766E49, 0x726F746E, 0x65442079, 0x2161746C };
 
-	if (BufferArchive.IsError())
+	enum EVersion : uint32
+	{
+		InitialVersion = 0,
+
+		// -----<new versions can be added above this line>-----
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	/** Header version. */
+	EVersion Version = LatestVersion;
+
+	/** The associated data source class. */
+	FSoftClassPath DataSourceClass;
+
+	/** List of custom versions registered during saving. */
+	FCustomVersionContainer VersionContainer;
+
+	/** FInventoryRegistryHeader::Checksum of the base file. */
+	uint32 BaseChecksum = 0;
+
+	/** Final checksum of the data, excluding the header. */
+	uint32 Checksum = 0;
+
+public:
+
+	bool Serialize(FArchive& Ar)
+	{
+		FGuid MagicValue = Magic;
+		Ar << MagicValue;
+
+		if (Ar.IsLoading() && MagicValue != Magic)
+		{
+			return false;
+		}
+
+		std::underlying_type_t<EVersion> VersionValue = Version;
+		Ar << VersionValue << BaseChecksum << Checksum;
+		DataSourceClass.SerializePathWithoutFixup(Ar);
+		VersionContainer.Serialize(Ar);
+		Version = static_cast<EVersion>(VersionValue);
+
+		return !Ar.IsError();
+	}
+};
+
+// Describes blocks of the mapped layout. All offsets are relative to the beginning of the serialized state.
+struct FMappedRegistryLayout
+{
+	int64 StringTableOffset = 0;
+	int64 RecordsOffset = 0;
+	int64 TagsOffset = 0;
+	int64 PayloadsOffset = 0;
+	int64 PayloadsSize = 0;
+	int32 NumStrings = 0;
+	int32 NumRecords = 0;
+	int32 NumTags = 0;
+	int32 Padding = 0;
+};
+
+// Fixed-layout representation of FCommonInventoryRegistryRecord. Must be kept in sync with FCommonItemSharedData.
+struct FMappedRegistryRecord
+{
+	int32 TypeIndex = INDEX_NONE;
+	int32 NameIndex = INDEX_NONE;
+	int32 AssetPackageIndex = INDEX_NONE;
+	int32 AssetNameIndex = INDEX_NONE;
+	int32 AssetSubPathIndex = INDEX_NONE;
+	int32 FirstTagIndex = 0;
+	int32 NumTags = 0;
+	int32 MaxStackSize = 0;
+	int32 DefaultPayloadIndex = INDEX_NONE;
+	int32 CustomDataIndex = INDEX_NONE;
+};
+
+// Describes blocks of derived data, which directly follows FMappedRegistryLayout since DerivedIndices.
+struct FMappedDerivedLayout
+{
+	int64 RecordChecksumsOffset = 0;
+	int64 ArchetypesOffset = 0;
+	int64 IndexedTagsOffset = 0;
+	int64 TagWordsOffset = 0;
+	int32 NumArchetypes = 0;
+	int32 NumIndexedTags = 0;
+	uint32 Checksum = 0;
+	int32 Padding = 0;
+};
+
+// Fixed-layout representation of FArchetypeGroup.
+struct FMappedArchetype
+{
+	int32 TypeIndex = INDEX_NONE;
+	int32 Begin = INDEX_NONE;
+	int32 Offset = 0;
+	uint32 Checksum = 0;
+};
+
+// The layout is read directly from memory, so it relies on the same endianness, which is true for all supported platforms.
+static_assert(std::is_trivially_copyable_v<FMappedRegistryLayout> && std::is_trivially_copyable_v<FMappedRegistryRecord>);
+static_assert(std::is_trivially_copyable_v<FMappedDerivedLayout> && std::is_trivially_copyable_v<FMappedArchetype>);
+static_assert(alignof(FMappedRegistryRecord) <= alignof(FMappedRegistryLayout) && sizeof(FMappedRegistryLayout) % alignof(FMappedDerivedLayout) == 0);
+
+static void AlignArchive(FArchive& Ar, int64 InAlignment)
+{
+	uint8 Zeros[16] = {};
+	check(InAlignment <= UE_ARRAY_COUNT(Zeros));
+	Ar.Serialize(Zeros, Align(Ar.Tell(), InAlignment) - Ar.Tell());
+}
+
+bool FCommonInventoryRegistryState::SaveToFile(const FString& Filename, bool bIsCooking)
+{
+	if (TUniquePtr<FArchive> Writer{ IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_EvenIfReadOnly) })
+	{
+		FNameAsStringProxyArchive ProxyWriter(*Writer);
+		return SaveState(ProxyWriter, bIsCooking);
+	}
+
+	return false;
+}
+
+bool FCommonInventoryRegistryState::SaveState(FArchive& Ar, bool bIsCooking)
+{
+	check(Ar.IsSaving());
+
+	// Free slots aren't referenced by records and shouldn't end up on disk.
+	CompactCustomData();
+
+	// In-memory storage for serialized state.
+	FBufferArchive64 BufferArchive(/* bIsPersistent */ true, FInventoryRegistryHeader::ArchiveName);
+	FCustomVersionContainer VersionContainer;
+
+	if (bIsCooking)
+	{
+		SaveMappedState(BufferArchive, VersionContainer);
+	}
+	else
+	{
+		FObjectAndNameAsStringProxyArchive Writer(BufferArchive, false);
+
+		// Write the actual state.
+		StaticStruct()->SerializeItem(Writer, this, nullptr);
+		VersionContainer = Writer.GetCustomVersions(); // Copy all registered custom versions.
+	}
+
+	if (BufferArchive.IsError())
 	{
 		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to serialize state.");
 		return false;
 	}
 
 	// Fill header information.
+	FileChecksum = FCrc::MemCrc32(BufferArchive.GetData(), BufferArchive.Num());
 	FInventoryRegistryHeader Header
 	{
-		.Version = FInventoryRegistryHeaderVersion::LatestVersion,
+		.Version = bIsCooking ? FInventoryRegistryHeaderVersion::LatestVersion : FInventoryRegistryHeaderVersion::InitialVersion,
 		.DataSourceClass = UCommonInventorySettings::Get()->DataSourceClassName,
-		.VersionContainer = Writer.GetCustomVersions(), // Copy all registered custom versions.
-		.Checksum = FCrc::MemCrc32(BufferArchive.GetData(), BufferArchive.Num()), // xxhash
+		.VersionContainer = MoveTemp(VersionContainer),
+		.Checksum = FileChecksum, // xxhash
 		.bIsCooked = bIsCooking
 	};
 
@@ -494,6 +1108,12 @@ bool FCommonInventoryRegistryState::SaveState(FArchive& Ar, bool bIsCooking)
 		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to serialize header.");
 		return false;
 	}
+
+	// The mapped layout is aligned relative to the beginning of the serialized state, so the state must be aligned in the file as well.
+	if (bIsCooking)
+	{
+		AlignArchive(Ar, alignof(FMappedRegistryLayout));
+	}
 	
 	// Stage the serialized state on disk. Compression is performed as part of the .pak file.
 	Ar.Serialize(BufferArchive.GetData(), BufferArchive.Num());
@@ -501,10 +1121,169 @@ bool FCommonInventoryRegistryState::SaveState(FArchive& Ar, bool bIsCooking)
 	return !Ar.IsError();
 }
 
+void FCommonInventoryRegistryState::SaveMappedState(FArchive& Ar, FCustomVersionContainer& OutVersionContainer)
+{
+	TArray<FString> StringTable;
+	TMap<FString, int32> StringIndices;
+
+	auto AddString = [&](FString&& InString)
+		{
+			if (const int32* const Idx = StringIndices.Find(InString))
+			{
+				return *Idx;
+			}
+
+			const int32 NewIdx = StringTable.Add(InString);
+			StringIndices.Add(MoveTemp(InString), NewIdx);
+			return NewIdx;
+		};
+
+	TArray<FMappedRegistryRecord> MappedRecords;
+	MappedRecords.Reserve(DataContainer.Num());
+	TArray<int32> MappedTags;
+
+	for (const FCommonInventoryRegistryRecord& Record : DataContainer)
+	{
+		FMappedRegistryRecord& MappedRecord = MappedRecords.AddDefaulted_GetRef();
+		MappedRecord.TypeIndex = AddString(Record.GetPrimaryAssetType().ToString());
+		MappedRecord.NameIndex = AddString(Record.GetPrimaryAssetName().ToString());
+		MappedRecord.AssetPackageIndex = AddString(Record.AssetPath.GetLongPackageFName().ToString());
+		MappedRecord.AssetNameIndex = AddString(Record.AssetPath.GetAssetFName().ToString());
+		MappedRecord.AssetSubPathIndex = AddString(FString(Record.AssetPath.GetSubPathString()));
+		MappedRecord.FirstTagIndex = MappedTags.Num();
+		MappedRecord.NumTags = Record.SharedData.GameplayTags.Num();
+		MappedRecord.MaxStackSize = Record.SharedData.MaxStackSize;
+		MappedRecord.DefaultPayloadIndex = Record.DefaultPayloadIndex;
+		MappedRecord.CustomDataIndex = Record.CustomDataIndex;
+
+		for (const FGameplayTag& Tag : Record.SharedData.GameplayTags)
+		{
+			MappedTags.Add(AddString(Tag.ToString()));
+		}
+	}
+
+	// Derived data is cooked as well, so cooked builds don't index tags and calculate checksums at startup.
+	FMappedDerivedLayout DerivedLayout;
+	DerivedLayout.Checksum = GetChecksum();
+
+	TArray<uint32> RecordChecksums;
+	RecordChecksums.Reserve(DataContainer.Num());
+	Algo::Transform(DataContainer, RecordChecksums, [](const FCommonInventoryRegistryRecord& InRecord) { return InRecord.GetChecksum(); });
+
+	TArray<FMappedArchetype> MappedArchetypes;
+	MappedArchetypes.Reserve(Archetypes.Num());
+
+	for (const FArchetypeGroup& Archetype : Archetypes)
+	{
+		MappedArchetypes.Add({ AddString(Archetype.PrimaryAssetType.ToString()), Archetype.Begin, Archetype.Offset, Archetype.Checksum });
+	}
+
+	const int32 WordsNum = FMath::DivideAndRoundUp(DataContainer.Num(), 64);
+	TArray<int32> IndexedTags;
+	TArray<uint64> TagWords;
+	IndexedTags.Reserve(TagIndex.Num());
+	TagWords.Reserve(TagIndex.Num() * WordsNum);
+
+	for (const TPair<FGameplayTag, TArray<uint64>>& TagBitset : TagIndex)
+	{
+		// Bitsets of rarely used tags might be shorter than the container.
+		IndexedTags.Add(AddString(TagBitset.Key.ToString()));
+		const int32 FirstWord = TagWords.AddZeroed(WordsNum);
+		FMemory::Memcpy(TagWords.GetData() + FirstWord, TagBitset.Value.GetData(), FMath::Min(TagBitset.Value.Num(), WordsNum) * sizeof(uint64));
+	}
+
+	DerivedLayout.NumArchetypes = MappedArchetypes.Num();
+	DerivedLayout.NumIndexedTags = IndexedTags.Num();
+
+	FMappedRegistryLayout Layout;
+	Layout.NumStrings = StringTable.Num();
+	Layout.NumRecords = MappedRecords.Num();
+	Layout.NumTags = MappedTags.Num();
+
+	// Reserve space for the layouts, which are patched at the end.
+	const int64 LayoutOffset = Ar.Tell();
+	Ar.Serialize(&Layout, sizeof(Layout));
+	Ar.Serialize(&DerivedLayout, sizeof(DerivedLayout));
+
+	Layout.StringTableOffset = Ar.Tell();
+	Ar << StringTable;
+
+	AlignArchive(Ar, alignof(FMappedRegistryRecord));
+	Layout.RecordsOffset = Ar.Tell();
+	Ar.Serialize(MappedRecords.GetData(), MappedRecords.Num() * sizeof(FMappedRegistryRecord));
+
+	Layout.TagsOffset = Ar.Tell();
+	Ar.Serialize(MappedTags.GetData(), MappedTags.Num() * sizeof(int32));
+
+	// Payloads still rely on the property serialization.
+	{
+		Layout.PayloadsOffset = Ar.Tell();
+		Ar.SetWantBinaryPropertySerialization(true);
+		FObjectAndNameAsStringProxyArchive Writer(Ar, false);
+		Writer.SetFilterEditorOnly(true);
+		CustomDataContainer.Serialize(Writer);
+		OutVersionContainer = Writer.GetCustomVersions();
+		Layout.PayloadsSize = Ar.Tell() - Layout.PayloadsOffset;
+	}
+
+	AlignArchive(Ar, alignof(uint64));
+	DerivedLayout.TagWordsOffset = Ar.Tell();
+	Ar.Serialize(TagWords.GetData(), TagWords.Num() * sizeof(uint64));
+
+	DerivedLayout.RecordChecksumsOffset = Ar.Tell();
+	Ar.Serialize(RecordChecksums.GetData(), RecordChecksums.Num() * sizeof(uint32));
+
+	DerivedLayout.ArchetypesOffset = Ar.Tell();
+	Ar.Serialize(MappedArchetypes.GetData(), MappedArchetypes.Num() * sizeof(FMappedArchetype));
+
+	DerivedLayout.IndexedTagsOffset = Ar.Tell();
+	Ar.Serialize(IndexedTags.GetData(), IndexedTags.Num() * sizeof(int32));
+
+	const int64 EndOffset = Ar.Tell();
+	Ar.Seek(LayoutOffset);
+	Ar.Serialize(&Layout, sizeof(Layout));
+	Ar.Serialize(&DerivedLayout, sizeof(DerivedLayout));
+	Ar.Seek(EndOffset);
+}
+
 bool FCommonInventoryRegistryState::LoadFromFile(const FString& Filename, bool bIsCooked)
 {
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::LoadFromFile);
+
 	if (IFileManager::Get().FileExists(*Filename))
 	{
+		// Try to read the cooked state directly from the mapped file.
+		if (bIsCooked)
+		{
+			if (TUniquePtr<IMappedFileHandle> MappedFile{ FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*Filename) })
+			{
+				if (TUniquePtr<IMappedFileRegion> MappedRegion{ MappedFile->MapRegion(/* Offset */ 0, MappedFile->GetFileSize()) })
+				{
+					FLargeMemoryReader MappedReader(MappedRegion->GetMappedPtr(), MappedRegion->GetMappedSize(), ELargeMemoryReaderFlags::None, FInventoryRegistryHeader::ArchiveName);
+					FNameAsStringProxyArchive ProxyReader(MappedReader);
+					FInventoryRegistryHeader Header;
+
+					if (!Header.Serialize(ProxyReader))
+					{
+						COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to read header in InventoryRegistry.bin.");
+						return false;
+					}
+
+					if (!Header.Validate(bIsCooked))
+					{
+						return false;
+					}
+
+					// Older versions are read through the regular path.
+					if (const int64 StateOffset = Align(MappedReader.Tell(), alignof(FMappedRegistryLayout)); Header.Version >= FInventoryRegistryHeaderVersion::MappedLayout && StateOffset <= MappedRegion->GetMappedSize())
+					{
+						const TConstArrayView64<uint8> SerializedState(MappedRegion->GetMappedPtr() + StateOffset, MappedRegion->GetMappedSize() - StateOffset);
+						return LoadSerializedState(SerializedState, Header.VersionContainer, Header.Checksum, Header.Version, bIsCooked);
+					}
+				}
+			}
+		}
+
 		if (TUniquePtr<FArchive> Reader{ IFileManager::Get().CreateFileReader(*Filename, FILEREAD_None) })
 		{
 			FNameAsStringProxyArchive ProxyReader(*Reader);
@@ -528,22 +1307,14 @@ bool FCommonInventoryRegistryState::LoadState(FArchive& Ar, bool bIsCooked)
 		return false;
 	}
 
-	if (Header.Version > FInventoryRegistryHeaderVersion::LatestVersion)
+	if (!Header.Validate(bIsCooked))
 	{
-		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Unable to load InventoryRegistry.bin with a newer version.");
 		return false;
 	}
 
-	if (Header.DataSourceClass != UCommonInventorySettings::Get()->DataSourceClassName)
+	if (Header.Version >= FInventoryRegistryHeaderVersion::MappedLayout)
 	{
-		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Unable to load InventoryRegistry.bin with different data source.");
-		return false;
-	}
-
-	if (Header.bIsCooked != bIsCooked)
-	{
-		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Unable to load InventoryRegistry.bin with unexpected cooking state.");
-		return false;
+		Ar.Seek(Align(Ar.Tell(), alignof(FMappedRegistryLayout)));
 	}
 
 	// Load the remaining file into memory.
@@ -557,27 +1328,46 @@ bool FCommonInventoryRegistryState::LoadState(FArchive& Ar, bool bIsCooked)
 		return false;
 	}
 
-	const uint32 DataChecksum = FCrc::MemCrc32(SerializedState.GetData(), SerializedState.Num());
+	return LoadSerializedState(SerializedState, Header.VersionContainer, Header.Checksum, Header.Version, bIsCooked);
+}
+
+bool FCommonInventoryRegistryState::LoadSerializedState(TConstArrayView64<uint8> InSerializedState, const FCustomVersionContainer& InVersionContainer, uint32 InChecksum, uint32 InVersion, bool bIsCooked)
+{
+	const uint32 DataChecksum = FCrc::MemCrc32(InSerializedState.GetData(), InSerializedState.Num());
 
-	if (DataChecksum != Header.Checksum)
+	if (DataChecksum != InChecksum)
 	{
 		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to verify data integrity for InventoryRegistry.bin.");
 		return false;
 	}
 
-	FLargeMemoryReader MemoryReader(SerializedState.GetData(), SerializedState.Num(), ELargeMemoryReaderFlags::Persistent, FInventoryRegistryHeader::ArchiveName);
-	MemoryReader.SetCustomVersions(Header.VersionContainer);
-	MemoryReader.SetWantBinaryPropertySerialization(bIsCooked);
-	FObjectAndNameAsStringProxyArchive Reader(MemoryReader, true); // Load UUserDefinedStruct* if needed.
-	Reader.SetFilterEditorOnly(bIsCooked);
-
-	StaticStruct()->SerializeItem(Reader, this, /* Defaults */ nullptr);
+	uint32 CookedChecksum = 0;
 
-	if (!Reader.AtEnd() || Reader.IsError())
+	if (InVersion >= FInventoryRegistryHeaderVersion::MappedLayout)
 	{
-		Reset();
-		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to read data from InventoryRegistry.bin.");
-		return false;
+		if (!LoadMappedState(InSerializedState, InVersionContainer, InVersion, CookedChecksum))
+		{
+			Reset();
+			COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to read data from InventoryRegistry.bin.");
+			return false;
+		}
+	}
+	else
+	{
+		FLargeMemoryReader MemoryReader(InSerializedState.GetData(), InSerializedState.Num(), ELargeMemoryReaderFlags::Persistent, FInventoryRegistryHeader::ArchiveName);
+		MemoryReader.SetCustomVersions(InVersionContainer);
+		MemoryReader.SetWantBinaryPropertySerialization(bIsCooked);
+		FObjectAndNameAsStringProxyArchive Reader(MemoryReader, IsInGameThread()); // Load UUserDefinedStruct* if needed, which is only safe on the game thread.
+		Reader.SetFilterEditorOnly(bIsCooked);
+
+		StaticStruct()->SerializeItem(Reader, this, /* Defaults */ nullptr);
+
+		if (!Reader.AtEnd() || Reader.IsError())
+		{
+			Reset();
+			COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to read data from InventoryRegistry.bin.");
+			return false;
+		}
 	}
 
 	for (const FConstStructView CustomData : CustomDataContainer)
@@ -590,25 +1380,332 @@ bool FCommonInventoryRegistryState::LoadState(FArchive& Ar, bool bIsCooked)
 		}
 	}
 
-	// Restore secondary data.
-	FixupDependencies();
+	// Loaded containers are always compact.
+	FreeCustomData.Reset();
+	NumFreeCustomData = 0;
+
+	FileChecksum = InChecksum;
+
+	// Restore secondary data. Cooked indices and checksums are kept as-is, archetype checksums migrate onto the rebuilt groups.
+	const bool bHasCookedIndices = CookedChecksum != 0;
+	FixupDependencies(/* bMigrateArchetypeChecksum */ bHasCookedIndices, /* bKeepTagIndex */ bHasCookedIndices);
+
+	if (bHasCookedIndices)
+	{
+		Checksum = CookedChecksum;
+	}
 
 	return true;
 }
 
-void FCommonInventoryRegistryState::DiffRecords(const FCommonInventoryRegistryState& InBaseState)
+bool FCommonInventoryRegistryState::LoadMappedState(TConstArrayView64<uint8> InSerializedState, const FCustomVersionContainer& InVersionContainer, uint32 InVersion, uint32& OutCookedChecksum)
 {
-	if (HasRecords() && InBaseState.HasRecords())
+	OutCookedChecksum = 0;
+
+	FMappedRegistryLayout Layout;
+
+	if (InSerializedState.Num() < int64(sizeof(Layout)))
 	{
-		const FCommonInventoryRegistryState* FirstState = this;
-		const FCommonInventoryRegistryState* SecondState = &InBaseState;
+		return false;
+	}
 
-		// Enumerate the registry with fewer records.
-		if (FirstState->GetRecordsNum() > SecondState->GetRecordsNum())
+	FMemory::Memcpy(&Layout, InSerializedState.GetData(), sizeof(Layout));
+
+	auto IsValidBlock = [&InSerializedState](int64 InOffset, int64 InSize, int64 InAlignment)
 		{
-			Swap(FirstState, SecondState);
+			return InOffset >= 0 && InSize >= 0 && InOffset % InAlignment == 0 && InOffset + InSize <= InSerializedState.Num();
+		};
+
+	if (Layout.NumStrings < 0 || Layout.NumRecords < 0 || Layout.NumTags < 0
+		|| !IsValidBlock(Layout.StringTableOffset, Layout.RecordsOffset - Layout.StringTableOffset, 1)
+		|| !IsValidBlock(Layout.RecordsOffset, Layout.NumRecords * int64(sizeof(FMappedRegistryRecord)), alignof(FMappedRegistryRecord))
+		|| !IsValidBlock(Layout.TagsOffset, Layout.NumTags * int64(sizeof(int32)), alignof(int32))
+		|| !IsValidBlock(Layout.PayloadsOffset, Layout.PayloadsSize, 1))
+	{
+		return false;
+	}
+
+	FMappedDerivedLayout DerivedLayout;
+	const bool bHasDerivedLayout = InVersion >= FInventoryRegistryHeaderVersion::DerivedIndices;
+	const int32 WordsNum = FMath::DivideAndRoundUp(Layout.NumRecords, 64);
+
+	if (bHasDerivedLayout)
+	{
+		if (!IsValidBlock(sizeof(Layout), sizeof(DerivedLayout), alignof(FMappedDerivedLayout)))
+		{
+			return false;
 		}
 
+		FMemory::Memcpy(&DerivedLayout, InSerializedState.GetData() + sizeof(Layout), sizeof(DerivedLayout));
+
+		if (DerivedLayout.NumArchetypes < 0 || DerivedLayout.NumIndexedTags < 0
+			|| !IsValidBlock(DerivedLayout.RecordChecksumsOffset, Layout.NumRecords * int64(sizeof(uint32)), alignof(uint32))
+			|| !IsValidBlock(DerivedLayout.ArchetypesOffset, DerivedLayout.NumArchetypes * int64(sizeof(FMappedArchetype)), alignof(FMappedArchetype))
+			|| !IsValidBlock(DerivedLayout.IndexedTagsOffset, DerivedLayout.NumIndexedTags * int64(sizeof(int32)), alignof(int32))
+			|| !IsValidBlock(DerivedLayout.TagWordsOffset, DerivedLayout.NumIndexedTags * int64(WordsNum) * int64(sizeof(uint64)), alignof(uint64)))
+		{
+			return false;
+		}
+	}
+
+	// Names are carried as strings only once.
+	TArray<FString> StringTable;
+	{
+		FLargeMemoryReader StringsReader(InSerializedState.GetData() + Layout.StringTableOffset, Layout.RecordsOffset - Layout.StringTableOffset);
+		StringsReader << StringTable;
+
+		if (StringsReader.IsError() || StringTable.Num() != Layout.NumStrings)
+		{
+			return false;
+		}
+	}
+
+	TArray<FName> NameTable;
+	NameTable.Reserve(StringTable.Num());
+	Algo::Transform(StringTable, NameTable, [](const FString& InString) { return FName(InString); });
+
+	// Fixed-layout blocks are used in-place.
+	const TConstArrayView<FMappedRegistryRecord> MappedRecords(reinterpret_cast<const FMappedRegistryRecord*>(InSerializedState.GetData() + Layout.RecordsOffset), Layout.NumRecords);
+	const TConstArrayView<int32> MappedTags(reinterpret_cast<const int32*>(InSerializedState.GetData() + Layout.TagsOffset), Layout.NumTags);
+
+	auto IsValidString = [&NameTable](int32 InIndex) { return NameTable.IsValidIndex(InIndex); };
+
+	DataContainer.Reset(MappedRecords.Num());
+
+	for (const FMappedRegistryRecord& MappedRecord : MappedRecords)
+	{
+		if (!IsValidString(MappedRecord.TypeIndex) || !IsValidString(MappedRecord.NameIndex) || !IsValidString(MappedRecord.AssetPackageIndex)
+			|| !IsValidString(MappedRecord.AssetNameIndex) || !IsValidString(MappedRecord.AssetSubPathIndex)
+			|| MappedRecord.FirstTagIndex < 0 || MappedRecord.NumTags < 0 || MappedRecord.FirstTagIndex + MappedRecord.NumTags > MappedTags.Num())
+		{
+			return false;
+		}
+
+		FCommonInventoryRegistryRecord& Record = DataContainer.AddDefaulted_GetRef();
+		Record.SharedData.PrimaryAssetId = FPrimaryAssetId(FPrimaryAssetType(NameTable[MappedRecord.TypeIndex]), NameTable[MappedRecord.NameIndex]);
+		Record.SharedData.MaxStackSize = MappedRecord.MaxStackSize;
+		Record.AssetPath = FSoftObjectPath(FTopLevelAssetPath(NameTable[MappedRecord.AssetPackageIndex], NameTable[MappedRecord.AssetNameIndex]), StringTable[MappedRecord.AssetSubPathIndex]);
+		Record.DefaultPayloadIndex = MappedRecord.DefaultPayloadIndex;
+		Record.CustomDataIndex = MappedRecord.CustomDataIndex;
+
+		for (const int32 TagIndex : MappedTags.Slice(MappedRecord.FirstTagIndex, MappedRecord.NumTags))
+		{
+			if (!IsValidString(TagIndex))
+			{
+				return false;
+			}
+
+			Record.SharedData.GameplayTags.AddTag(FGameplayTag::RequestGameplayTag(NameTable[TagIndex], /* ErrorIfNotFound */ false));
+		}
+	}
+
+	if (bHasDerivedLayout)
+	{
+		const uint32* const RecordChecksums = reinterpret_cast<const uint32*>(InSerializedState.GetData() + DerivedLayout.RecordChecksumsOffset);
+		const TConstArrayView<FMappedArchetype> MappedArchetypes(reinterpret_cast<const FMappedArchetype*>(InSerializedState.GetData() + DerivedLayout.ArchetypesOffset), DerivedLayout.NumArchetypes);
+		const TConstArrayView<int32> IndexedTags(reinterpret_cast<const int32*>(InSerializedState.GetData() + DerivedLayout.IndexedTagsOffset), DerivedLayout.NumIndexedTags);
+		const uint64* const TagWords = reinterpret_cast<const uint64*>(InSerializedState.GetData() + DerivedLayout.TagWordsOffset);
+
+		for (TEnumerateRef<FCommonInventoryRegistryRecord> Record : EnumerateRange(DataContainer))
+		{
+			Record->Checksum = RecordChecksums[Record.GetIndex()];
+		}
+
+		// Checksums are migrated onto the groups rebuilt by FixupDependencies().
+		Archetypes.Reset();
+
+		for (const FMappedArchetype& MappedArchetype : MappedArchetypes)
+		{
+			if (!IsValidString(MappedArchetype.TypeIndex))
+			{
+				return false;
+			}
+
+			Archetypes.Add({ FPrimaryAssetType(NameTable[MappedArchetype.TypeIndex]), MappedArchetype.Begin, MappedArchetype.Offset, MappedArchetype.Checksum });
+		}
+
+		TagIndex.Reset();
+		TagIndex.Reserve(IndexedTags.Num());
+
+		for (TConstEnumerateRef<int32> IndexedTag : EnumerateRange(IndexedTags))
+		{
+			if (!IsValidString(*IndexedTag))
+			{
+				return false;
+			}
+
+			// Tags removed from the project are dropped from records as well.
+			if (const FGameplayTag Tag = FGameplayTag::RequestGameplayTag(NameTable[*IndexedTag], /* ErrorIfNotFound */ false); Tag.IsValid())
+			{
+				TagIndex.Add(Tag, TArray<uint64>(TagWords + IndexedTag.GetIndex() * int64(WordsNum), WordsNum));
+			}
+		}
+
+		OutCookedChecksum = DerivedLayout.Checksum;
+	}
+
+	// Payloads are deserialized directly from the provided memory.
+	FLargeMemoryReader MemoryReader(InSerializedState.GetData() + Layout.PayloadsOffset, Layout.PayloadsSize, ELargeMemoryReaderFlags::Persistent, FInventoryRegistryHeader::ArchiveName);
+	MemoryReader.SetCustomVersions(InVersionContainer);
+	MemoryReader.SetWantBinaryPropertySerialization(true);
+	FObjectAndNameAsStringProxyArchive Reader(MemoryReader, IsInGameThread()); // Load UUserDefinedStruct* if needed, which is only safe on the game thread.
+	Reader.SetFilterEditorOnly(true);
+
+	CustomDataContainer.Serialize(Reader);
+
+	return Reader.AtEnd() && !Reader.IsError();
+}
+
+bool FCommonInventoryRegistryState::SaveDeltaToFile(const FString& Filename, const FCommonInventoryRegistryState& InBaseState) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::SaveDeltaToFile);
+
+	if (InBaseState.GetFileChecksum() == 0)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Unable to make a delta against a state which wasn't loaded from a file.");
+		return false;
+	}
+
+	TArray<FCommonInventoryRegistryRecord> Upserts;
+	TArray<FPrimaryAssetId> Removes;
+
+	// Both containers are sorted, so a single merge pass is enough.
+	for (int32 Idx = 0, BaseIdx = 0; Idx < DataContainer.Num() || BaseIdx < InBaseState.DataContainer.Num();)
+	{
+		const FCommonInventoryRegistryRecord* const Record = DataContainer.IsValidIndex(Idx) ? &DataContainer[Idx] : nullptr;
+		const FCommonInventoryRegistryRecord* const BaseRecord = InBaseState.DataContainer.IsValidIndex(BaseIdx) ? &InBaseState.DataContainer[BaseIdx] : nullptr;
+
+		if (BaseRecord && (!Record || *BaseRecord < *Record))
+		{
+			Removes.Add(BaseRecord->GetPrimaryAssetId());
+			++BaseIdx;
+		}
+		else if (!BaseRecord || *Record < *BaseRecord)
+		{
+			Upserts.Add(*Record);
+			++Idx;
+		}
+		else
+		{
+			if (!Record->HasIdenticalData(*BaseRecord))
+			{
+				Upserts.Add(*Record);
+			}
+
+			++Idx;
+			++BaseIdx;
+		}
+	}
+
+	// Upserts own their payloads, so they are serialized as a regular state.
+	FCommonInventoryRegistryState DeltaState;
+	DeltaState.Reset(Upserts);
+
+	FBufferArchive64 BufferArchive(/* bIsPersistent */ true, FInventoryRegistryDeltaHeader::ArchiveName);
+	BufferArchive.SetWantBinaryPropertySerialization(true);
+	FObjectAndNameAsStringProxyArchive Writer(BufferArchive, false);
+	Writer.SetFilterEditorOnly(true);
+	StaticStruct()->SerializeItem(Writer, &DeltaState, nullptr);
+	Writer << Removes;
+
+	if (Writer.IsError())
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to serialize delta.");
+		return false;
+	}
+
+	FInventoryRegistryDeltaHeader Header;
+	Header.DataSourceClass = UCommonInventorySettings::Get()->DataSourceClassName;
+	Header.VersionContainer = Writer.GetCustomVersions();
+	Header.BaseChecksum = InBaseState.GetFileChecksum();
+	Header.Checksum = FCrc::MemCrc32(BufferArchive.GetData(), BufferArchive.Num());
+
+	if (TUniquePtr<FArchive> FileWriter{ IFileManager::Get().CreateFileWriter(*Filename, FILEWRITE_EvenIfReadOnly) })
+	{
+		FNameAsStringProxyArchive ProxyWriter(*FileWriter);
+
+		if (Header.Serialize(ProxyWriter))
+		{
+			ProxyWriter.Serialize(BufferArchive.GetData(), BufferArchive.Num());
+			COMMON_INVENTORY_LOG(Log, "FCommonInventoryRegistryState: Saved delta with %d upsert(s) and %d removal(s) into '%s'.", Upserts.Num(), Removes.Num(), *Filename);
+			return !ProxyWriter.IsError();
+		}
+	}
+
+	return false;
+}
+
+bool FCommonInventoryRegistryState::ApplyDeltaFromFile(const FString& Filename)
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::ApplyDeltaFromFile);
+
+	TUniquePtr<FArchive> FileReader{ IFileManager::Get().CreateFileReader(*Filename, FILEREAD_None) };
+
+	if (!FileReader)
+	{
+		return false;
+	}
+
+	FNameAsStringProxyArchive ProxyReader(*FileReader);
+	FInventoryRegistryDeltaHeader Header;
+
+	if (!Header.Serialize(ProxyReader) || Header.Version > FInventoryRegistryDeltaHeader::LatestVersion)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to read header in '%s'.", *Filename);
+		return false;
+	}
+
+	// Patches are only valid on top of the exact base they were made against.
+	if (Header.BaseChecksum != FileChecksum || Header.DataSourceClass != UCommonInventorySettings::Get()->DataSourceClassName)
+	{
+		COMMON_INVENTORY_LOG(Warning, "FCommonInventoryRegistryState: Skipping '%s' made against a different state: Base(%#x), Loaded(%#x).", *Filename, Header.BaseChecksum, FileChecksum);
+		return false;
+	}
+
+	TArray64<uint8> SerializedDelta;
+	SerializedDelta.SetNumUninitialized(ProxyReader.TotalSize() - ProxyReader.Tell());
+	ProxyReader.Serialize(SerializedDelta.GetData(), SerializedDelta.Num());
+
+	if (ProxyReader.IsError() || FCrc::MemCrc32(SerializedDelta.GetData(), SerializedDelta.Num()) != Header.Checksum)
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to verify data integrity for '%s'.", *Filename);
+		return false;
+	}
+
+	FCommonInventoryRegistryState DeltaState;
+	TArray<FPrimaryAssetId> Removes;
+
+	FLargeMemoryReader MemoryReader(SerializedDelta.GetData(), SerializedDelta.Num(), ELargeMemoryReaderFlags::None, FInventoryRegistryDeltaHeader::ArchiveName);
+	MemoryReader.SetCustomVersions(Header.VersionContainer);
+	MemoryReader.SetWantBinaryPropertySerialization(true);
+	FObjectAndNameAsStringProxyArchive Reader(MemoryReader, IsInGameThread()); // Load UUserDefinedStruct* if needed, which is only safe on the game thread.
+	Reader.SetFilterEditorOnly(true);
+
+	StaticStruct()->SerializeItem(Reader, &DeltaState, /* Defaults */ nullptr);
+	Reader << Removes;
+
+	if (!Reader.AtEnd() || Reader.IsError() || !Algo::AllOf(DeltaState.CustomDataContainer, [](FConstStructView InCustomData) { return InCustomData.IsValid(); }))
+	{
+		COMMON_INVENTORY_LOG(Error, "FCommonInventoryRegistryState: Failed to read data from '%s'.", *Filename);
+		return false;
+	}
+
+	// Refresh views of the upserts before they are merged.
+	DeltaState.FixupDependencies();
+
+	// Unchanged records keep their cached checksums, so only the patched archetypes are hashed again.
+	const FDeltaStats Stats = ApplyDelta(DeltaState.DataContainer, Removes);
+	COMMON_INVENTORY_LOG(Log, "FCommonInventoryRegistryState: Applied '%s': %d added, %d updated, %d removed.", *Filename, Stats.NumAdded, Stats.NumUpdated, Stats.NumRemoved);
+
+	return true;
+}
+
+void FCommonInventoryRegistryState::DiffRecords(const FCommonInventoryRegistryState& InBaseState)
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::DiffRecords);
+
+	if (HasRecords() && InBaseState.HasRecords())
+	{
 		bool (FCommonInventoryRegistryRecord::*Identical)(const FCommonInventoryRegistryRecord&) const = &FCommonInventoryRegistryRecord::HasIdenticalData;
 
 		// If possible, try using a faster version.
@@ -619,26 +1716,153 @@ void FCommonInventoryRegistryState::DiffRecords(const FCommonInventoryRegistrySt
 
 		TArray<FPrimaryAssetId, TInlineAllocator<256>> PendingRemoveRecords;
 
-		for (const FCommonInventoryRegistryRecord& FirstRecord : FirstState->GetRecords())
+		// Both states are sorted, so a single merge pass is enough.
+		for (int32 Idx = 0, BaseIdx = 0; Idx < DataContainer.Num() && BaseIdx < InBaseState.DataContainer.Num();)
 		{
-			if (const FCommonInventoryRegistryRecord* const SecondRecord = SecondState->GetRecordPtr(FirstRecord.GetPrimaryAssetId()))
+			const FCommonInventoryRegistryRecord& Record = DataContainer[Idx];
+			const FCommonInventoryRegistryRecord& BaseRecord = InBaseState.DataContainer[BaseIdx];
+
+			if (Record < BaseRecord)
+			{
+				++Idx;
+			}
+			else if (BaseRecord < Record)
+			{
+				++BaseIdx;
+			}
+			else
 			{
-				if ((SecondRecord->*Identical)(FirstRecord))
+				if ((BaseRecord.*Identical)(Record))
 				{
-					PendingRemoveRecords.Emplace(FirstRecord.GetPrimaryAssetId());
+					PendingRemoveRecords.Emplace(Record.GetPrimaryAssetId());
 				}
+
+				++Idx;
+				++BaseIdx;
 			}
 		}
 
-		// Per element removal could be very slow.
 		if (PendingRemoveRecords.Num() == GetRecordsNum())
 		{
 			Reset();
 		}
-		else
+		else if (!PendingRemoveRecords.IsEmpty())
+		{
+			// Compact and fixup once instead of per record.
+			ApplyDelta(/* InUpserts */ {}, PendingRemoveRecords);
+		}
+	}
+}
+
+// Packs a lowercase trigram into a single key.
+static uint64 MakeNameTrigram(const TCHAR* InChars)
+{
+	return (uint64(InChars[0]) << 42) | (uint64(InChars[1]) << 21) | uint64(InChars[2]);
+}
+
+const FCommonInventoryRegistryState::FNameSearchIndex& FCommonInventoryRegistryState::GetNameSearchIndex() const
+{
+	check(IsInGameThread());
+
+	if (NameSearchIndex.IsEmpty() && !DataContainer.IsEmpty())
+	{
+		COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryRegistryState::GetNameSearchIndex);
+
+		NameSearchIndex.LowerNames.Reserve(DataContainer.Num());
+		Algo::Transform(DataContainer, NameSearchIndex.LowerNames, [](const FCommonInventoryRegistryRecord& InRecord) { return InRecord.GetPrimaryAssetName().ToString().ToLower(); });
+
+		NameSearchIndex.SortedIndices.Reserve(DataContainer.Num());
+
+		for (TConstEnumerateRef<FString> LowerName : EnumerateRange(NameSearchIndex.LowerNames))
 		{
-			Algo::ForEach(PendingRemoveRecords, [this](FPrimaryAssetId InPrimaryAssetId) { verify(RemoveData(InPrimaryAssetId)); });
+			NameSearchIndex.SortedIndices.Add(LowerName.GetIndex());
+
+			// Postings are added in the registry order, so they remain sorted.
+			for (int32 CharIdx = 0; CharIdx + 3 <= LowerName->Len(); ++CharIdx)
+			{
+				TArray<int32>& Postings = NameSearchIndex.Trigrams.FindOrAdd(MakeNameTrigram(**LowerName + CharIdx));
+
+				if (Postings.IsEmpty() || Postings.Last() != LowerName.GetIndex())
+				{
+					Postings.Add(LowerName.GetIndex());
+				}
+			}
 		}
+
+		Algo::SortBy(NameSearchIndex.SortedIndices, [this](int32 InIndex) -> const FString& { return NameSearchIndex.LowerNames[InIndex]; });
+	}
+
+	return NameSearchIndex;
+}
+
+void FCommonInventoryRegistryState::FindRecordsByNameSubstring(FStringView InSubstring, TArray<const FCommonInventoryRegistryRecord*>& OutRecords, int32 MaxResults /* = MAX_int32 */) const
+{
+	const FNameSearchIndex& SearchIndex = GetNameSearchIndex();
+	const FString LowerSubstring = FString(InSubstring).ToLower();
+
+	auto TryAddRecord = [&](int32 InIndex)
+		{
+			if (SearchIndex.LowerNames[InIndex].Contains(LowerSubstring, ESearchCase::CaseSensitive))
+			{
+				OutRecords.Add(&DataContainer[InIndex]);
+			}
+		};
+
+	const int32 MaxNum = OutRecords.Num() + MaxResults;
+
+	if (LowerSubstring.Len() >= 3)
+	{
+		const TArray<int32>* Candidates = nullptr;
+
+		// Verify only the names sharing the rarest trigram.
+		for (int32 CharIdx = 0; CharIdx + 3 <= LowerSubstring.Len(); ++CharIdx)
+		{
+			const TArray<int32>* const Postings = SearchIndex.Trigrams.Find(MakeNameTrigram(*LowerSubstring + CharIdx));
+
+			if (!Postings)
+			{
+				return;
+			}
+
+			if (!Candidates || Postings->Num() < Candidates->Num())
+			{
+				Candidates = Postings;
+			}
+		}
+
+		for (int32 Idx = 0; Idx < Candidates->Num() && OutRecords.Num() < MaxNum; ++Idx)
+		{
+			TryAddRecord((*Candidates)[Idx]);
+		}
+	}
+	else
+	{
+		// Too short to use trigrams, but still avoids converting names on each query.
+		for (int32 Idx = 0; Idx < SearchIndex.LowerNames.Num() && OutRecords.Num() < MaxNum; ++Idx)
+		{
+			TryAddRecord(Idx);
+		}
+	}
+}
+
+void FCommonInventoryRegistryState::FindRecordsByNamePrefix(FStringView InPrefix, TArray<const FCommonInventoryRegistryRecord*>& OutRecords, int32 MaxResults /* = MAX_int32 */) const
+{
+	const FNameSearchIndex& SearchIndex = GetNameSearchIndex();
+	const FString LowerPrefix = FString(InPrefix).ToLower();
+	const int32 MaxNum = OutRecords.Num() + MaxResults;
+
+	auto ProjectName = [&SearchIndex](int32 InIndex) -> const FString& { return SearchIndex.LowerNames[InIndex]; };
+
+	for (int32 Idx = Algo::LowerBoundBy(SearchIndex.SortedIndices, LowerPrefix, ProjectName); Idx < SearchIndex.SortedIndices.Num() && OutRecords.Num() < MaxNum; ++Idx)
+	{
+		const int32 RecordIdx = SearchIndex.SortedIndices[Idx];
+
+		if (!SearchIndex.LowerNames[RecordIdx].StartsWith(LowerPrefix, ESearchCase::CaseSensitive))
+		{
+			break;
+		}
+
+		OutRecords.Add(&DataContainer[RecordIdx]);
 	}
 }
 
@@ -678,6 +1902,70 @@ void FCommonInventoryRegistryState::Dump() const
 #endif // !(UE_BUILD_SHIPPING || UE_BUILD_TEST)
 }
 
+FCommonInventoryRegistryState::FMemoryStats FCommonInventoryRegistryState::GetMemoryStats() const
+{
+	// Mirrors the recommended payload size of FCommonItem, larger payloads are allocated on the heap.
+	constexpr int32 PayloadInlineSize = 24;
+
+	FMemoryStats Stats;
+	Stats.DataContainerBytes = DataContainer.GetAllocatedSize();
+	Stats.LookupBytes = DataMap.GetAllocatedSize() + NameMap.GetAllocatedSize() + Archetypes.GetAllocatedSize() + RepLayouts.GetAllocatedSize();
+	Stats.IndexBytes = MaxStackSizes.GetAllocatedSize() + DefaultPayloadTypes.GetAllocatedSize() + TagIndex.GetAllocatedSize() + FreeCustomData.GetAllocatedSize();
+
+#if WITH_EDITOR
+	Stats.IndexBytes += SearchableNames.GetAllocatedSize();
+#endif
+	Stats.IndexBytes += NameSearchIndex.LowerNames.GetAllocatedSize() + NameSearchIndex.SortedIndices.GetAllocatedSize() + NameSearchIndex.Trigrams.GetAllocatedSize();
+
+	for (const auto& [Tag, TagBits] : TagIndex)
+	{
+		Stats.IndexBytes += TagBits.GetAllocatedSize();
+	}
+
+	for (const auto& [ScriptStruct, FreeSlots] : FreeCustomData)
+	{
+		Stats.IndexBytes += FreeSlots.GetAllocatedSize();
+	}
+
+	for (const FString& LowerName : NameSearchIndex.LowerNames)
+	{
+		Stats.IndexBytes += LowerName.GetAllocatedSize();
+	}
+
+	for (const auto& [Trigram, TrigramIndices] : NameSearchIndex.Trigrams)
+	{
+		Stats.IndexBytes += TrigramIndices.GetAllocatedSize();
+	}
+
+	for (int32 Idx = 0; Idx < CustomDataContainer.Num(); ++Idx)
+	{
+		if (const UScriptStruct* const ScriptStruct = CustomDataContainer[Idx].GetScriptStruct())
+		{
+			Stats.CustomDataBytes += ScriptStruct->GetStructureSize();
+		}
+	}
+
+	for (const FCommonInventoryRegistryRecord& Record : DataContainer)
+	{
+		SIZE_T RecordBytes = sizeof(FCommonInventoryRegistryRecord) + Record.SharedData.GameplayTags.GetGameplayTagArray().GetAllocatedSize();
+
+		if (const UScriptStruct* const PayloadStruct = Record.DefaultPayload.GetScriptStruct())
+		{
+			RecordBytes += PayloadStruct->GetStructureSize();
+			++(PayloadStruct->GetStructureSize() <= PayloadInlineSize ? Stats.NumInlinePayloads : Stats.NumHeapPayloads);
+		}
+
+		if (const UScriptStruct* const CustomDataStruct = Record.CustomData.GetScriptStruct())
+		{
+			RecordBytes += CustomDataStruct->GetStructureSize();
+		}
+
+		Stats.ArchetypeBytes.FindOrAdd(Record.GetPrimaryAssetType()) += RecordBytes;
+	}
+
+	return Stats;
+}
+
 /************************************************************************/
 /* FCommonInventoryRedirects                                            */
 /************************************************************************/
@@ -809,19 +2097,28 @@ static void LoadRedirectsFromConfig(TMap<FName, FName>& OutTypeRedirects, TMap<F
 {
 	check(IsInGameThread());
 
-	TMap<FName, FName> TypeRedirects, NameRedirects;
 	const UCommonInventorySettings* const Settings = UCommonInventorySettings::Get();
-	ResolveRedirectionMap(GenerateRedirectionMap(Settings->PrimaryAssetTypeRedirects), TypeRedirects);
-	ResolveRedirectionMap(GenerateRedirectionMap(Settings->PrimaryAssetNameRedirects), NameRedirects);
+	ResolveRedirectionMap(GenerateRedirectionMap(Settings->PrimaryAssetTypeRedirects), OutTypeRedirects);
+	ResolveRedirectionMap(GenerateRedirectionMap(Settings->PrimaryAssetNameRedirects), OutNameRedirects);
+}
 
-#if	WITH_EDITOR
-	const UE::TScopeLock Lock(RedirectsCriticalSection);
-#endif
+// Maps final values onto all the old values resolving into them.
+static TMap<FName, TArray<FName>> GenerateRedirectSources(const TMap<FName, FName>& InResolvedRedirects)
+{
+	TMap<FName, TArray<FName>> RedirectSources;
+	RedirectSources.Reserve(InResolvedRedirects.Num());
+
+	for (const auto [OldValue, NewValue] : InResolvedRedirects)
+	{
+		RedirectSources.FindOrAdd(NewValue).Add(OldValue);
+	}
 
-	OutTypeRedirects = MoveTemp(TypeRedirects);
-	OutNameRedirects = MoveTemp(NameRedirects);
+	return RedirectSources;
 }
 
+// Bounds the memory of resolved FPrimaryAssetIds, e.g. when loading old save games with many unknown ids.
+static constexpr int32 MAX_RESOLVED_REDIRECT_IDS = 16384;
+
 FCommonInventoryRedirects& FCommonInventoryRedirects::Get()
 {
 	static FCommonInventoryRedirects Instance;
@@ -829,8 +2126,11 @@ FCommonInventoryRedirects& FCommonInventoryRedirects::Get()
 }
 
 FCommonInventoryRedirects::FCommonInventoryRedirects()
+	: ResolvedIdsReferenced(MakeUnique<std::atomic<bool>[]>(MAX_RESOLVED_REDIRECT_IDS))
 {
-	LoadRedirectsFromConfig(TypeRedirectionMap, NameRedirectionMap);
+	TMap<FName, FName> TypeRedirects, NameRedirects;
+	LoadRedirectsFromConfig(TypeRedirects, NameRedirects);
+	SetRedirects(MoveTemp(TypeRedirects), MoveTemp(NameRedirects));
 }
 
 #if WITH_EDITOR
@@ -839,12 +2139,58 @@ void FCommonInventoryRedirects::ForceRefresh()
 {
 	if (GIsEditor && !GIsPlayInEditorWorld)
 	{
-		LoadRedirectsFromConfig(TypeRedirectionMap, NameRedirectionMap);
+		TMap<FName, FName> TypeRedirects, NameRedirects;
+		LoadRedirectsFromConfig(TypeRedirects, NameRedirects);
+		SetRedirects(MoveTemp(TypeRedirects), MoveTemp(NameRedirects));
 	}
 }
 
 #endif // WITH_EDITOR
 
+SIZE_T FCommonInventoryRedirects::GetAllocatedSize() const
+{
+	SIZE_T AllocatedSize = TypeRedirectionMap.GetAllocatedSize() + NameRedirectionMap.GetAllocatedSize();
+	AllocatedSize += TypeRedirectSources.GetAllocatedSize() + NameRedirectSources.GetAllocatedSize();
+
+	for (const TMap<FName, TArray<FName>>* const RedirectSources : { &TypeRedirectSources, &NameRedirectSources })
+	{
+		for (const auto& [NewValue, OldValues] : *RedirectSources)
+		{
+			AllocatedSize += OldValues.GetAllocatedSize();
+		}
+	}
+
+	AllocatedSize += MAX_RESOLVED_REDIRECT_IDS * sizeof(std::atomic<bool>);
+
+	const FReadScopeLock ReadLock(ResolvedIdsLock);
+	return AllocatedSize + ResolvedIds.GetAllocatedSize() + ResolvedIdSlots.GetAllocatedSize();
+}
+
+void FCommonInventoryRedirects::SetRedirects(TMap<FName, FName>&& InTypeRedirects, TMap<FName, FName>&& InNameRedirects)
+{
+	LLM_SCOPE_BYTAG(CommonInventory);
+
+	TMap<FName, TArray<FName>> TypeSources = GenerateRedirectSources(InTypeRedirects);
+	TMap<FName, TArray<FName>> NameSources = GenerateRedirectSources(InNameRedirects);
+
+	{
+#if	WITH_EDITOR
+		const UE::TScopeLock Lock(RedirectsCriticalSection);
+#endif
+
+		TypeRedirectionMap = MoveTemp(InTypeRedirects);
+		NameRedirectionMap = MoveTemp(InNameRedirects);
+		TypeRedirectSources = MoveTemp(TypeSources);
+		NameRedirectSources = MoveTemp(NameSources);
+		bHasRedirects = !TypeRedirectionMap.IsEmpty() || !NameRedirectionMap.IsEmpty();
+	}
+
+	const FWriteScopeLock WriteLock(ResolvedIdsLock);
+	ResolvedIds.Reset();
+	ResolvedIdSlots.Reset();
+	ResolvedIdsClockHand = 0;
+}
+
 bool FCommonInventoryRedirects::IsStale(FPrimaryAssetType InPrimaryAssetType) const
 {
 	const uint32 TypeHash = decltype(TypeRedirectionMap)::KeyFuncsType::GetKeyHash(InPrimaryAssetType);
@@ -887,6 +2233,74 @@ bool FCommonInventoryRedirects::TryRedirect(FPrimaryAssetType& InPrimaryAssetTyp
 }
 
 bool FCommonInventoryRedirects::TryRedirect(FPrimaryAssetId& InPrimaryAssetId) const
+{
+	if (!bHasRedirects || !InPrimaryAssetId.IsValid())
+	{
+		return false;
+	}
+
+	{
+		const FReadScopeLock ReadLock(ResolvedIdsLock);
+
+		if (const int32* const Slot = ResolvedIdSlots.Find(InPrimaryAssetId))
+		{
+			ResolvedIdsReferenced[*Slot].store(true, std::memory_order_relaxed);
+
+			if (const FPrimaryAssetId& ResolvedId = ResolvedIds[*Slot].ResolvedId; ResolvedId.IsValid())
+			{
+				InPrimaryAssetId = ResolvedId;
+				return true;
+			}
+
+			return false;
+		}
+	}
+
+	const FPrimaryAssetId OriginalId = InPrimaryAssetId;
+	const bool bIsRedirected = TryRedirectUncached(InPrimaryAssetId);
+
+	CacheResolvedId(OriginalId, bIsRedirected ? InPrimaryAssetId : FPrimaryAssetId());
+	return bIsRedirected;
+}
+
+void FCommonInventoryRedirects::CacheResolvedId(FPrimaryAssetId InOriginalId, FPrimaryAssetId InResolvedId) const
+{
+	const FWriteScopeLock WriteLock(ResolvedIdsLock);
+
+	// Another thread might have resolved the same id in the meantime.
+	if (ResolvedIdSlots.Contains(InOriginalId))
+	{
+		return;
+	}
+
+	int32 Slot = ResolvedIds.Num();
+
+	if (Slot < MAX_RESOLVED_REDIRECT_IDS)
+	{
+		ResolvedIds.Add({ InOriginalId, InResolvedId });
+	}
+	else
+	{
+		// Hot ids survive the sweep, so a burst of one-off ids from old save games only recycles the cold entries.
+		// The write lock excludes lookups, so the hand stops within a single revolution.
+		while (ResolvedIdsReferenced[ResolvedIdsClockHand].exchange(false, std::memory_order_relaxed))
+		{
+			ResolvedIdsClockHand = (ResolvedIdsClockHand + 1) % MAX_RESOLVED_REDIRECT_IDS;
+		}
+
+		Slot = ResolvedIdsClockHand;
+		ResolvedIdsClockHand = (ResolvedIdsClockHand + 1) % MAX_RESOLVED_REDIRECT_IDS;
+
+		ResolvedIdSlots.Remove(ResolvedIds[Slot].OriginalId);
+		ResolvedIds[Slot] = { InOriginalId, InResolvedId };
+	}
+
+	// New ids start cold and become hot on the first hit.
+	ResolvedIdsReferenced[Slot].store(false, std::memory_order_relaxed);
+	ResolvedIdSlots.Add(InOriginalId, Slot);
+}
+
+bool FCommonInventoryRedirects::TryRedirectUncached(FPrimaryAssetId& InPrimaryAssetId) const
 {
 	bool bIsDirty = false;
 	const uint32 TypeHash = decltype(TypeRedirectionMap)::KeyFuncsType::GetKeyHash(InPrimaryAssetId.PrimaryAssetType);
@@ -919,7 +2333,7 @@ bool FCommonInventoryRedirects::HasTypeRedirects(FPrimaryAssetType InPrimaryAsse
 	const UE::TScopeLock Lock(RedirectsCriticalSection);
 #endif
 
-	return TypeRedirectionMap.ContainsByHash(TypeHash, InPrimaryAssetType) || Algo::FindBy(TypeRedirectionMap, InPrimaryAssetType, &TTuple<FName, FName>::Value) != nullptr;
+	return TypeRedirectionMap.ContainsByHash(TypeHash, InPrimaryAssetType) || TypeRedirectSources.ContainsByHash(TypeHash, InPrimaryAssetType);
 }
 
 bool FCommonInventoryRedirects::HasNameRedirects(FName InPrimaryAssetName) const
@@ -930,51 +2344,43 @@ bool FCommonInventoryRedirects::HasNameRedirects(FName InPrimaryAssetName) const
 	const UE::TScopeLock Lock(RedirectsCriticalSection);
 #endif
 
-	return NameRedirectionMap.ContainsByHash(NameHash, InPrimaryAssetName) || Algo::FindBy(NameRedirectionMap, InPrimaryAssetName, &TTuple<FName, FName>::Value) != nullptr;
+	return NameRedirectionMap.ContainsByHash(NameHash, InPrimaryAssetName) || NameRedirectSources.ContainsByHash(NameHash, InPrimaryAssetName);
 }
 
 void FCommonInventoryRedirects::TraversePermutations(FPrimaryAssetId InPrimaryAssetId, TFunctionRef<bool(FPrimaryAssetId)> InPredicate) const
 {
 	check(IsInGameThread());
 
+	static const TArray<FName> NoSources;
+	const TArray<FName>* const OldNames = NameRedirectSources.Find(InPrimaryAssetId.PrimaryAssetName);
+	const TArray<FName>* const OldTypes = TypeRedirectSources.Find(InPrimaryAssetId.PrimaryAssetType);
+
 	// First, traverse names with the given type.
-	for (const auto [OldName, NewName] : NameRedirectionMap)
+	for (const FName OldName : OldNames ? *OldNames : NoSources)
 	{
-		if (NewName == InPrimaryAssetId.PrimaryAssetName)
+		if (!InPredicate({ InPrimaryAssetId.PrimaryAssetType, OldName }))
 		{
-			if (!InPredicate({ InPrimaryAssetId.PrimaryAssetType, OldName }))
-			{
-				return;
-			}
+			return;
 		}
 	}
 
 	// Then, traverse types with the given name.
-	for (const auto [OldType, NewType] : TypeRedirectionMap)
+	for (const FName OldType : OldTypes ? *OldTypes : NoSources)
 	{
-		if (NewType == InPrimaryAssetId.PrimaryAssetType)
+		if (!InPredicate({ OldType, InPrimaryAssetId.PrimaryAssetName }))
 		{
-			if (!InPredicate({ OldType, InPrimaryAssetId.PrimaryAssetName }))
-			{
-				return;
-			}
+			return;
 		}
 	}
 
 	// Finally, permute types and names.
-	for (const auto [OldType, NewType] : TypeRedirectionMap)
+	for (const FName OldType : OldTypes ? *OldTypes : NoSources)
 	{
-		if (NewType == InPrimaryAssetId.PrimaryAssetType)
+		for (const FName OldName : OldNames ? *OldNames : NoSources)
 		{
-			for (auto [OldName, NewName] : NameRedirectionMap)
+			if (!InPredicate({ OldType, OldName }))
 			{
-				if (NewName == InPrimaryAssetId.PrimaryAssetName)
-				{
-					if (!InPredicate({ OldType, OldName }))
-					{
-						return;
-					}
-				}
+				return;
 			}
 		}
 	}
@@ -1149,17 +2555,43 @@ public:
 
 	virtual FArchive& operator<<(UObject*& Object) override
 	{
-		// Recursively serialize objects to reach all available nodes.
+		// Recursively visit referenced objects to reach all available nodes.
 		if (Object && !Context.VisitedObjects.Contains(Object))
 		{
-			const TGuardValue ObjectGuard(Context.CurrentObject, Object);
-			Context.VisitedObjects.Add(Object);
-			Object->Serialize(*this);
+			PropagateObject(Object);
 		}
 
 		return *this;
 	}
 
+	/** Visits only the properties which can hold items instead of serializing the whole object. Instanced subobjects are visited through their references. */
+	void PropagateObject(UObject* Object)
+	{
+		const TConstArrayView<const FProperty*> Schema = FCommonInventoryDefaultsPropagator::Get().GetPropagationSchema(Object->GetClass());
+		Context.VisitedObjects.Add(Object);
+
+		if (!Schema.IsEmpty())
+		{
+			const TGuardValue ObjectGuard(Context.CurrentObject, Object);
+			FStructuredArchiveFromArchive StructuredArchive(*this);
+			FStructuredArchive::FStream Stream = StructuredArchive.GetSlot().EnterStream();
+
+			for (const FProperty* const Property : Schema)
+			{
+#if UE_VERSION_OLDER_THAN(5, 5, 0)
+				const int32 ArrayDim = Property->ArrayDim;
+#else
+				const int32 ArrayDim = Property->GetArrayDim();
+#endif
+
+				for (int32 Idx = 0; Idx < ArrayDim; ++Idx)
+				{
+					Property->SerializeItem(Stream.EnterElement(), Property->ContainerPtrToValuePtr<void>(Object, Idx), nullptr);
+				}
+			}
+		}
+	}
+
 	virtual FString GetArchiveName() const override
 	{
 		return TEXT("CommonInventoryDefaultsPropagation");
@@ -1208,9 +2640,12 @@ void FCommonInventoryDefaultsPropagator::PropagateRegistryDefaults(FContext& InC
 			{
 				COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryDefaultsPropagator::Propagation);
 
-				for (UObject* Object : Objects)
+				for (UObject* const Object : Objects)
 				{
-					Ar << Object;
+					if (!InContext.VisitedObjects.Contains(Object))
+					{
+						Ar.PropagateObject(Object);
+					}
 				}
 			}
 
@@ -1219,6 +2654,27 @@ void FCommonInventoryDefaultsPropagator::PropagateRegistryDefaults(FContext& InC
 	}
 }
 
+// Objects aren't serialized as a whole anymore, so nested objects of worlds are gathered explicitly.
+static void GatherWorldObjects(UWorld* InWorld, TArray<UObject*>& OutObjects)
+{
+	OutObjects.Emplace(InWorld);
+
+	for (ULevel* const Level : InWorld->GetLevels())
+	{
+		if (Level)
+		{
+			OutObjects.Emplace(Level);
+			GetObjectsWithOuter(Level, OutObjects, /* bIncludeNestedObjects */ true, RF_NoFlags, EInternalObjectFlags::Garbage | EInternalObjectFlags::Async);
+		}
+	}
+
+	if (UGameInstance* const GameInstance = InWorld->GetGameInstance())
+	{
+		OutObjects.Emplace(GameInstance);
+		GetObjectsWithOuter(GameInstance, OutObjects, /* bIncludeNestedObjects */ true, RF_NoFlags, EInternalObjectFlags::Garbage | EInternalObjectFlags::Async);
+	}
+}
+
 bool FCommonInventoryDefaultsPropagator::GatherObjectsForPropagation(const FContext& InContext, TArray<UObject*>& OutObjects)
 {
 	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryDefaultsPropagator::GatherObjectsForPropagation);
@@ -1231,21 +2687,24 @@ bool FCommonInventoryDefaultsPropagator::GatherObjectsForPropagation(const FCont
 		{
 			checkf(GEngine, TEXT("FCommonInventoryDefaultsPropagator: GEngine should be valid during objects gathering."));
 
-			// Serialize active worlds.
+#if WITH_EDITOR
+			FlushPendingReferences();
+#endif
+
+			// Serialize active worlds. Objects spawned at runtime are constructed from templates and never reach the index.
 			for (const FWorldContext& WorldContext : GEngine->GetWorldContexts())
 			{
 				if (UWorld* const World = WorldContext.World())
 				{
 					if (WorldContext.WorldType == EWorldType::Game || WorldContext.WorldType == EWorldType::PIE)
 					{
-						OutObjects.Emplace(World);
-						OutObjects.Emplace(World->GetGameInstance());
+						GatherWorldObjects(World, OutObjects);
 					}
 #if WITH_EDITOR
-					// Don't modify the editor world during PIE.
-					if (!GIsPlayInEditorWorld && WorldContext.WorldType == EWorldType::Editor)
+					// Don't modify the editor world during PIE. Indexed editor worlds are reached through the index.
+					if (!GIsPlayInEditorWorld && WorldContext.WorldType == EWorldType::Editor && !IsPackageIndexed(World->GetPackage()->GetFName()))
 					{
-						OutObjects.Emplace(World);
+						GatherWorldObjects(World, OutObjects);
 					}
 #endif
 				}
@@ -1254,15 +2713,38 @@ bool FCommonInventoryDefaultsPropagator::GatherObjectsForPropagation(const FCont
 			// Don't modify the original assets during PIE.
 			if (!GIsPlayInEditorWorld)
 			{
-				TArray<FAssetData> Referencers;
+				TArray<FPrimaryAssetId> RecordIds;
+				RecordIds.Reserve(InContext.OriginalRegistryState.GetRecords().Num());
 
 				for (const FCommonInventoryRegistryRecord& OriginalRecord : InContext.OriginalRegistryState.GetRecords())
 				{
-					CommonInventory::GetReferencers(OriginalRecord.GetPrimaryAssetId(), Referencers, /* bRecursively */ true);
+#if WITH_EDITOR
+					// Visit only the objects holding the item instead of whole packages.
+					GatherIndexedObjects(OriginalRecord.GetPrimaryAssetId(), OutObjects);
+#endif
+
+					RecordIds.Emplace(OriginalRecord.GetPrimaryAssetId());
+				}
 
-					for (const FAssetData& AssetData : Referencers)
+				// A single pass over the asset registry for all the records. Packages referencing multiple records are visited once.
+				TMap<FPrimaryAssetId, TArray<FAssetData>> Referencers;
+				CommonInventory::GetReferencers(RecordIds, Referencers, /* bRecursively */ true);
+
+				TSet<FName> VisitedPackages;
+
+				for (const TPair<FPrimaryAssetId, TArray<FAssetData>>& RecordReferencers : Referencers)
+				{
+					for (const FAssetData& AssetData : RecordReferencers.Value)
 					{
-						if (AssetData.IsAssetLoaded())
+#if WITH_EDITOR
+						if (IsPackageIndexed(AssetData.PackageName))
+						{
+							continue;
+						}
+#endif
+
+						// Packages loaded before the index was created.
+						if (bool bIsAlreadyVisited = false; AssetData.IsAssetLoaded() && (VisitedPackages.Add(AssetData.PackageName, &bIsAlreadyVisited), !bIsAlreadyVisited))
 						{
 							GetObjectsWithOuter(
 								AssetData.GetPackage(),
@@ -1273,8 +2755,6 @@ bool FCommonInventoryDefaultsPropagator::GatherObjectsForPropagation(const FCont
 							);
 						}
 					}
-
-					Referencers.Reset();
 				}
 			}
 		}
@@ -1282,3 +2762,354 @@ bool FCommonInventoryDefaultsPropagator::GatherObjectsForPropagation(const FCont
 
 	return !OutObjects.IsEmpty();
 }
+
+TConstArrayView<const FProperty*> FCommonInventoryDefaultsPropagator::GetPropagationSchema(const UStruct* InStruct)
+{
+	check(IsInGameThread());
+
+#if WITH_EDITOR
+	// Reinstanced types and reloaded modules might change the layout.
+	if (!OnObjectsReinstancedHandle.IsValid())
+	{
+		OnObjectsReinstancedHandle = FCoreUObjectDelegates::OnObjectsReinstanced.AddLambda([this](const TMap<UObject*, UObject*>&) { InvalidatePropagationSchemas(); });
+		OnReloadCompleteHandle = FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([this](EReloadCompleteReason) { InvalidatePropagationSchemas(); });
+	}
+#endif
+
+	if (const TArray<const FProperty*>* const Schema = PropagationSchemas.Find(InStruct))
+	{
+		return *Schema;
+	}
+
+	TArray<const FProperty*> Schema;
+	TSet<const UStruct*> VisitingStructs{ InStruct };
+
+	for (TFieldIterator<FProperty> It(InStruct, EFieldIterationFlags::IncludeSuper); It; ++It)
+	{
+		if (CanHoldItems(*It, VisitingStructs))
+		{
+			Schema.Add(*It);
+		}
+	}
+
+	return PropagationSchemas.Add(InStruct, MoveTemp(Schema));
+}
+
+void FCommonInventoryDefaultsPropagator::InvalidatePropagationSchemas()
+{
+	PropagationSchemas.Empty();
+}
+
+bool FCommonInventoryDefaultsPropagator::CanHoldItems(const FProperty* InProperty, TSet<const UStruct*>& InVisitingStructs)
+{
+	if (const FStructProperty* const StructProperty = CastField<FStructProperty>(InProperty))
+	{
+		return CanHoldItems(StructProperty->Struct, InVisitingStructs);
+	}
+	else if (const FArrayProperty* const ArrayProperty = CastField<FArrayProperty>(InProperty))
+	{
+		return CanHoldItems(ArrayProperty->Inner, InVisitingStructs);
+	}
+	else if (const FSetProperty* const SetProperty = CastField<FSetProperty>(InProperty))
+	{
+		return CanHoldItems(SetProperty->ElementProp, InVisitingStructs);
+	}
+	else if (const FMapProperty* const MapProperty = CastField<FMapProperty>(InProperty))
+	{
+		return CanHoldItems(MapProperty->KeyProp, InVisitingStructs) || CanHoldItems(MapProperty->ValueProp, InVisitingStructs);
+	}
+	else if (const FOptionalProperty* const OptionalProperty = CastField<FOptionalProperty>(InProperty))
+	{
+		return CanHoldItems(OptionalProperty->GetValueProperty(), InVisitingStructs);
+	}
+	else if (InProperty->IsA<FObjectPropertyBase>())
+	{
+		// Instanced subobjects aren't necessarily outered to the holder and their class is only known at runtime, so they are followed through the reference.
+		return InProperty->HasAnyPropertyFlags(CPF_InstancedReference | CPF_PersistentInstance);
+	}
+
+	return false;
+}
+
+bool FCommonInventoryDefaultsPropagator::CanHoldItems(const UStruct* InStruct, TSet<const UStruct*>& InVisitingStructs)
+{
+	// Items serialize through the registry, and instanced structs might hold anything.
+	if (InStruct->IsChildOf(FCommonItem::StaticStruct()) || InStruct->IsChildOf(FCommonInventoryItem::StaticStruct())
+		|| InStruct->IsChildOf(FInstancedStruct::StaticStruct()) || InStruct->IsChildOf(FVariadicStruct::StaticStruct()))
+	{
+		return true;
+	}
+
+	if (const TArray<const FProperty*>* const Schema = PropagationSchemas.Find(InStruct))
+	{
+		return !Schema->IsEmpty();
+	}
+
+	bool bIsAlreadyVisiting = false;
+	InVisitingStructs.Add(InStruct, &bIsAlreadyVisiting);
+
+	if (bIsAlreadyVisiting)
+	{
+		return false;
+	}
+
+	for (TFieldIterator<FProperty> It(InStruct, EFieldIterationFlags::IncludeSuper); It; ++It)
+	{
+		if (CanHoldItems(*It, InVisitingStructs))
+		{
+			InVisitingStructs.Remove(InStruct);
+			return true;
+		}
+	}
+
+	InVisitingStructs.Remove(InStruct);
+	return false;
+}
+
+#if WITH_EDITOR
+
+// The object being indexed by IndexObject(). Only accessed from the game thread.
+static UObject* CurrentIndexedObject = nullptr;
+
+struct FCommonInventoryReferenceIndexArchive final : public FArchiveUObject
+{
+	FCommonInventoryReferenceIndexArchive()
+	{
+		ArIsObjectReferenceCollector = true;
+		SetShouldSkipCompilingAssets(true);
+		ArShouldSkipBulkData = true;
+	}
+
+	virtual FString GetArchiveName() const override
+	{
+		return TEXT("CommonInventoryReferenceIndex");
+	}
+};
+
+void FCommonInventoryDefaultsPropagator::RecordItemReference(FArchive& Ar, FPrimaryAssetId InPrimaryAssetId)
+{
+	UObject* Object = nullptr;
+	bool bIsPersistent = false;
+
+	if (IsInGameThread() && CurrentIndexedObject)
+	{
+		Object = CurrentIndexedObject;
+	}
+	else if (const FContext* const Context = GetContextFromArchive(Ar))
+	{
+		Object = Context->CurrentObject;
+	}
+	else if (const FUObjectSerializeContext* const SerializeContext = Ar.GetSerializeContext())
+	{
+		// Loading and saving packages visit every object, which makes the package fully indexed.
+		Object = SerializeContext->SerializedObject;
+		bIsPersistent = Ar.IsPersistent() && !Ar.IsTransacting();
+	}
+
+	if (!Object || !InPrimaryAssetId.IsValid())
+	{
+		return;
+	}
+
+	const FName IndexedPackage = bIsPersistent ? Object->GetPackage()->GetFName() : NAME_None;
+
+	if (IsInGameThread())
+	{
+		AddItemReference(Object, InPrimaryAssetId);
+
+		if (!IndexedPackage.IsNone())
+		{
+			IndexedPackages.Add(IndexedPackage);
+		}
+	}
+	else
+	{
+		// Loading threads don't contend with each other, the game thread picks the references up before using the index.
+		PendingReferences.Enqueue({ Object, InPrimaryAssetId, IndexedPackage });
+	}
+}
+
+void FCommonInventoryDefaultsPropagator::AddItemReference(FObjectKey InObject, FPrimaryAssetId InPrimaryAssetId)
+{
+	if (auto& PrimaryAssetIds = ObjectReferences.FindOrAdd(InObject); !PrimaryAssetIds.Contains(InPrimaryAssetId))
+	{
+		PrimaryAssetIds.Add(InPrimaryAssetId);
+		ReferenceIndex.FindOrAdd(InPrimaryAssetId).Add(InObject);
+	}
+}
+
+void FCommonInventoryDefaultsPropagator::RemoveItemReferences(FObjectKey InObject)
+{
+	TArray<FPrimaryAssetId, TInlineAllocator<2>> PrimaryAssetIds;
+
+	if (ObjectReferences.RemoveAndCopyValue(InObject, PrimaryAssetIds))
+	{
+		for (const FPrimaryAssetId& PrimaryAssetId : PrimaryAssetIds)
+		{
+			if (TSet<FObjectKey>* const Objects = ReferenceIndex.Find(PrimaryAssetId); Objects && (Objects->Remove(InObject), Objects->IsEmpty()))
+			{
+				ReferenceIndex.Remove(PrimaryAssetId);
+			}
+		}
+	}
+}
+
+void FCommonInventoryDefaultsPropagator::FlushPendingReferences()
+{
+	check(IsInGameThread());
+
+	FPendingItemReference Reference;
+
+	while (PendingReferences.Dequeue(Reference))
+	{
+		AddItemReference(Reference.Object, Reference.PrimaryAssetId);
+
+		if (!Reference.IndexedPackage.IsNone())
+		{
+			IndexedPackages.Add(Reference.IndexedPackage);
+		}
+	}
+}
+
+void FCommonInventoryDefaultsPropagator::PurgeStaleReferences()
+{
+	COMMON_INVENTORY_SCOPED_TRACE(FCommonInventoryDefaultsPropagator::PurgeStaleReferences);
+
+	FlushPendingReferences();
+
+	TArray<FObjectKey> StaleObjects;
+
+	for (const TPair<FObjectKey, TArray<FPrimaryAssetId, TInlineAllocator<2>>>& ObjectReference : ObjectReferences)
+	{
+		if (ObjectReference.Key.ResolveObjectPtr() == nullptr)
+		{
+			StaleObjects.Add(ObjectReference.Key);
+		}
+	}
+
+	Algo::ForEach(StaleObjects, [this](FObjectKey InObject) { RemoveItemReferences(InObject); });
+
+	// Reloaded packages are recorded again.
+	for (auto It = IndexedPackages.CreateIterator(); It; ++It)
+	{
+		if (FindObjectFast<UPackage>(nullptr, *It) == nullptr)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+void FCommonInventoryDefaultsPropagator::IndexObject(UObject* InObject)
+{
+	check(IsInGameThread());
+
+	if (InObject)
+	{
+		TArray<UObject*> Objects{ InObject };
+		GetObjectsWithOuter(InObject, Objects, /* bIncludeNestedObjects */ true, RF_NoFlags, EInternalObjectFlags::Garbage);
+
+		FlushPendingReferences();
+		FCommonInventoryReferenceIndexArchive Ar;
+
+		for (UObject* const Object : Objects)
+		{
+			// Items replaced by the edit must not keep the object in the index.
+			RemoveItemReferences(Object);
+
+			const TGuardValue ObjectGuard(CurrentIndexedObject, Object);
+			Object->Serialize(Ar);
+		}
+	}
+}
+
+void FCommonInventoryDefaultsPropagator::StartReferenceIndexing()
+{
+	// Editor changes are transacted rather than saved, so the edited objects are re-indexed.
+	OnObjectPropertyChangedHandle = FCoreUObjectDelegates::OnObjectPropertyChanged.AddLambda([this](UObject* InObject, FPropertyChangedEvent& PropertyChangedEvent)
+		{
+			// The edited property is usually a leaf within FCommonItem, so the change is matched by the member of the object which owns it.
+			const FProperty* const MemberProperty = PropertyChangedEvent.MemberProperty ? PropertyChangedEvent.MemberProperty : PropertyChangedEvent.Property;
+
+			if (InObject && (!MemberProperty || GetPropagationSchema(InObject->GetClass()).Contains(MemberProperty)))
+			{
+				IndexObject(InObject);
+			}
+		});
+
+	// Undo, redo and edits made inside transactions without PostEditChangeProperty() don't broadcast property changes.
+	OnObjectTransactedHandle = FCoreUObjectDelegates::OnObjectTransacted.AddLambda([this](UObject* InObject, const FTransactionObjectEvent& InTransactionEvent)
+		{
+			if (InObject && (InTransactionEvent.GetEventType() == ETransactionObjectEventType::UndoRedo || InTransactionEvent.GetEventType() == ETransactionObjectEventType::Finalized))
+			{
+				IndexObject(InObject);
+			}
+		});
+
+	// Any other edit, e.g. a paste or an import, dirties the package, so its holders are gathered by the fallback scan until the next save.
+	OnPackageMarkedDirtyHandle = UPackage::PackageMarkedDirtyEvent.AddLambda([this](UPackage* InPackage, bool bWasDirty)
+		{
+			if (InPackage)
+			{
+				IndexedPackages.Remove(InPackage->GetFName());
+			}
+		});
+
+	OnPostGarbageCollectHandle = FCoreUObjectDelegates::GetPostGarbageCollect().AddRaw(this, &FCommonInventoryDefaultsPropagator::PurgeStaleReferences);
+
+	// Placed actors are constructed from templates.
+	if (GEngine)
+	{
+		OnLevelActorAddedHandle = GEngine->OnLevelActorAdded().AddLambda([this](AActor* InActor)
+			{
+				IndexObject(InActor);
+			});
+	}
+}
+
+void FCommonInventoryDefaultsPropagator::StopReferenceIndexing()
+{
+	FCoreUObjectDelegates::OnObjectPropertyChanged.Remove(OnObjectPropertyChangedHandle);
+	FCoreUObjectDelegates::OnObjectTransacted.Remove(OnObjectTransactedHandle);
+	UPackage::PackageMarkedDirtyEvent.Remove(OnPackageMarkedDirtyHandle);
+	FCoreUObjectDelegates::GetPostGarbageCollect().Remove(OnPostGarbageCollectHandle);
+	FCoreUObjectDelegates::OnObjectsReinstanced.Remove(OnObjectsReinstancedHandle);
+	FCoreUObjectDelegates::ReloadCompleteDelegate.Remove(OnReloadCompleteHandle);
+	OnObjectsReinstancedHandle.Reset();
+	OnReloadCompleteHandle.Reset();
+	InvalidatePropagationSchemas();
+
+	if (GEngine)
+	{
+		GEngine->OnLevelActorAdded().Remove(OnLevelActorAddedHandle);
+	}
+
+	FlushPendingReferences();
+	ReferenceIndex.Empty();
+	ObjectReferences.Empty();
+	IndexedPackages.Empty();
+}
+
+bool FCommonInventoryDefaultsPropagator::GatherIndexedObjects(FPrimaryAssetId InPrimaryAssetId, TArray<UObject*>& OutObjects) const
+{
+	if (const TSet<FObjectKey>* const Objects = ReferenceIndex.Find(InPrimaryAssetId))
+	{
+		for (const FObjectKey& ObjectKey : *Objects)
+		{
+			if (UObject* const Object = ObjectKey.ResolveObjectPtr(); Object && IsValid(Object))
+			{
+				OutObjects.Add(Object);
+			}
+		}
+
+		return true;
+	}
+
+	return false;
+}
+
+bool FCommonInventoryDefaultsPropagator::IsPackageIndexed(FName InPackageName) const
+{
+	return IndexedPackages.Contains(InPackageName);
+}
+
+#endif // WITH_EDITOR
@@ -18,17 +18,23 @@
 
 #if WITH_EDITOR
 #include "Algo/Find.h"
+#include "Algo/ForEach.h"
 #include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
 #include "CommonInventorySettings.h"
 #include "Engine/AssetManagerSettings.h"
+#include "HAL/FileManager.h"
 #include "Misc/PackageName.h"
+#include "Misc/Paths.h"
 #include "Misc/RedirectCollector.h"
+#include "UObject/Package.h"
 #endif // WITH_EDITOR
 
 #include UE_INLINE_GENERATED_CPP_BY_NAME(AssetManagerDataSource)
 
 UAssetManagerDataSource::UAssetManagerDataSource()
 	: bKeepLoadedAssets(false)
+	, bUseIncrementalRefresh(true)
 	, bIsPendingRefresh(false)
 	, bIsPendingCook(false)
 	, bIsRefreshing(false)
@@ -54,6 +60,14 @@ void UAssetManagerDataSource::PostInitialize()
 {
 	RefreshAssetManagerTypeInfoList();
 
+#if WITH_EDITOR
+	// Hashes are only meaningful along with the loaded development registry.
+	if (RegistryBridge->WasLoaded())
+	{
+		LoadPackageHashes();
+	}
+#endif
+
 	if (!RegistryBridge->WasLoaded())
 	{
 		ForceRefresh(/* bSynchronous */ true);
@@ -82,6 +96,8 @@ void UAssetManagerDataSource::Deinitialize()
 {
 #if WITH_EDITOR
 	GetMutableDefault<UAssetManagerSettings>()->OnSettingChanged().RemoveAll(this);
+	FlushQueuedChanges();
+	SavePackageHashes();
 #endif
 	CancelPendingRefresh();
 	Super::Deinitialize();
@@ -91,6 +107,11 @@ void UAssetManagerDataSource::ForceRefresh(bool bSynchronous /* = false */)
 {
 	if (CanRefreshRegistry())
 	{
+#if WITH_EDITOR
+		// Config changes have to reach the asset manager before the scan.
+		FlushQueuedChanges();
+#endif
+
 		if (!IsPendingRefresh())
 		{
 			PreloadHandle = PreloadPrimaryAssets();
@@ -110,6 +131,10 @@ void UAssetManagerDataSource::ForceRefresh(bool bSynchronous /* = false */)
 
 void UAssetManagerDataSource::FlushPendingRefresh()
 {
+#if WITH_EDITOR
+	FlushQueuedChanges();
+#endif
+
 	if (IsPendingRefresh())
 	{
 		if (PreloadHandle->IsLoadingInProgress())
@@ -257,8 +282,32 @@ TSharedPtr<FStreamableHandle> UAssetManagerDataSource::PreloadPrimaryAssets()
 		}, EAllowShrinking::No);
 	}
 
+	// Load only the changed definitions if the registry is in sync with package hashes.
+	PendingRemovals.Reset();
+	bIsIncrementalRefresh = !bIsPendingCook && DiffPrimaryAssets(FoundPrimaryAssets, PendingRemovals);
+
+	if (!bIsIncrementalRefresh)
+	{
+		PackageHashes.Reset();
+	}
+
+	const bool bHasPendingChanges = bIsIncrementalRefresh;
+#else
+	const bool bHasPendingChanges = false;
 #endif // WITH_EDITOR
 
+	PendingRecords.Reset();
+	PendingRecordData.Reset();
+	ResolvePrimaryAssets(FoundPrimaryAssets);
+
+	// Everything is resolved without loading.
+	if (FoundPrimaryAssets.IsEmpty() && (bHasPendingChanges || !PendingRecords.IsEmpty()))
+	{
+		const TGuardValue RefreshingGuard(bIsRefreshing, true);
+		CommitRecords(PendingRecords);
+		return nullptr;
+	}
+
 	TSharedPtr<FStreamableHandle> StreamableHandle;
 
 	if (!FoundPrimaryAssets.IsEmpty())
@@ -286,23 +335,24 @@ void UAssetManagerDataSource::BulkRefresh()
 		PreloadHandle->GetLoadedCount(LoadedNum, RequestedNum);
 
 		TArray<FCommonInventoryRegistryRecord, TInlineAllocator<256>> RegistryRecords;
-		RegistryRecords.Reserve(LoadedNum);
+		RegistryRecords.Reserve(LoadedNum + PendingRecords.Num());
+		RegistryRecords.Append(PendingRecords);
 
 		// Populate registry records.
-		PreloadHandle->ForEachLoadedAsset([&RegistryRecords](UObject* LoadedAsset)
+		PreloadHandle->ForEachLoadedAsset([this, &RegistryRecords](UObject* LoadedAsset)
 		{
 			// This will fail with data only blueprint assets.
 			if (UCommonItemDefinition* const Definition = CastChecked<UCommonItemDefinition>(LoadedAsset))
 			{
 				RegistryRecords.Emplace(*Definition);
+#if WITH_EDITOR
+				UpdatePackageHash(Definition);
+#endif
 			}
 		});
 
 		// Finally, update the registry.
-		if (ensure(RegistryBridge))
-		{
-			RegistryBridge->ResetRecords(RegistryRecords);
-		}
+		CommitRecords(RegistryRecords);
 
 		// Check if we should keep loaded assets.
 		if (!bKeepLoadedAssets)
@@ -314,6 +364,45 @@ void UAssetManagerDataSource::BulkRefresh()
 	}
 }
 
+void UAssetManagerDataSource::CommitRecords(TConstArrayView<FCommonInventoryRegistryRecord> InRecords)
+{
+	if (ensure(RegistryBridge))
+	{
+#if WITH_EDITOR
+		if (bIsIncrementalRefresh)
+		{
+			if (!InRecords.IsEmpty())
+			{
+				RegistryBridge->AppendRecords(InRecords);
+			}
+
+			if (!PendingRemovals.IsEmpty())
+			{
+				RegistryBridge->RemoveRecords(PendingRemovals);
+				Algo::ForEach(PendingRemovals, [this](const FPrimaryAssetId& RemovedAsset) { PackageHashes.Remove(RemovedAsset); });
+				PendingRemovals.Reset();
+			}
+		}
+		else
+#endif
+		{
+			RegistryBridge->ResetRecords(InRecords);
+		}
+	}
+
+#if WITH_EDITOR
+	// Hashes of definitions from the full reset are complete now.
+	bHasPackageHashes = bHasPackageHashes || !bIsIncrementalRefresh;
+
+	// Persist right away, so a crash doesn't leave hashes of an older registry state behind.
+	SavePackageHashes();
+#endif
+
+	// Views are copied by the registry.
+	PendingRecords.Reset();
+	PendingRecordData.Reset();
+}
+
 void UAssetManagerDataSource::ScanPrimaryAssetPaths(TArrayView<FPrimaryAssetTypeInfo> TypeInfoList)
 {
 	// We will slightly stall the editor startup by scanning the necessary types.
@@ -386,8 +475,9 @@ void UAssetManagerDataSource::AppendTypeInfoList(FCommonInventoryTypeInfo& InTyp
 		InTypeInfo.SpecificAssets.Emplace(MoveTemp(OriginalPath));
 	}
 
-	TryUpdateDefaultConfigFile();
-	RefreshAssetManagerTypeInfoList();
+	// Rescanning is expensive, so the type infos are refreshed once per flush.
+	bIsTypeInfoListDirty = true;
+	ScheduleQueuedChangesFlush();
 }
 
 void UAssetManagerDataSource::OnAssetCreated(UCommonItemDefinition* InItemDefinition)
@@ -425,8 +515,7 @@ void UAssetManagerDataSource::OnAssetCreated(UCommonItemDefinition* InItemDefini
 					TArray<FSoftObjectPath>({ InItemDefinition->GetPathName() })
 				);
 
-				TryUpdateDefaultConfigFile();
-				RefreshAssetManagerTypeInfoList();
+				bIsTypeInfoListDirty = true;
 			}
 			else
 #endif // !UE_VERSION_OLDER_THAN(5, 4, 0)
@@ -437,7 +526,9 @@ void UAssetManagerDataSource::OnAssetCreated(UCommonItemDefinition* InItemDefini
 
 		if (bCanAppend)
 		{
-			RegistryBridge->AppendRecords({ FCommonInventoryRegistryRecord(*InItemDefinition) });
+			// The package isn't saved yet, so the next refresh will reload it.
+			PackageHashes.Remove(InItemDefinition->GetPrimaryAssetId());
+			QueueDefinition(InItemDefinition, /* bIsNew */ true);
 		}
 	}
 }
@@ -449,11 +540,16 @@ void UAssetManagerDataSource::OnAssetRemoved(const FAssetData& InRemovedAsset)
 	if (InRemovedAsset.IsValid() && CanRefreshRegistry())
 	{
 		const FPrimaryAssetId PrimaryAssetId = InRemovedAsset.GetPrimaryAssetId();
+		const FSoftObjectPath AssetPath = InRemovedAsset.GetSoftObjectPath();
 
-		if (const FCommonInventoryRegistryRecord* const Record = RegistryBridge->GetRegistryRecord(PrimaryAssetId))
+		// The definition might be removed before its creation is flushed.
+		if (const FQueuedDefinition* const QueuedDefinition = QueuedDefinitions.Find(PrimaryAssetId); QueuedDefinition && QueuedDefinition->Definition.IsValid() && FSoftObjectPath(QueuedDefinition->Definition.Get()) == AssetPath)
 		{
-			const FSoftObjectPath AssetPath = InRemovedAsset.GetSoftObjectPath();
+			QueuedDefinitions.Remove(PrimaryAssetId);
+		}
 
+		if (const FCommonInventoryRegistryRecord* const Record = RegistryBridge->GetRegistryRecord(PrimaryAssetId))
+		{
 			// Otherwise, duplicates will result in the removal of the original data.
 			if (Record->AssetPath == AssetPath)
 			{
@@ -468,8 +564,7 @@ void UAssetManagerDataSource::OnAssetRemoved(const FAssetData& InRemovedAsset)
 					if (TypeInfo->SpecificAssets.Remove(AssetPath) > 0)
 					{
 						// Reset scan paths.
-						RefreshAssetManagerTypeInfoList();
-						TryUpdateDefaultConfigFile();
+						bIsTypeInfoListDirty = true;
 					}
 				}
 
@@ -483,13 +578,15 @@ void UAssetManagerDataSource::OnAssetRemoved(const FAssetData& InRemovedAsset)
 					//We are not touching type redirects here.
 					if (FCommonInventoryRedirects::CleanupRedirects(Settings->PrimaryAssetNameRedirects, PrimaryAssetId.PrimaryAssetName))
 					{
-						FCommonInventoryRedirects::Get().ForceRefresh();
-						Settings->TryUpdateDefaultConfigFile();
+						bAreRedirectsDirty = true;
 					}
 				}
 
 				// Finally notify the registry.
-				RegistryBridge->RemoveRecords({ PrimaryAssetId });
+				PackageHashes.Remove(PrimaryAssetId);
+				QueuedDefinitions.Remove(PrimaryAssetId);
+				QueuedRemovals.Add(PrimaryAssetId);
+				ScheduleQueuedChangesFlush();
 			}
 		}
 	}
@@ -507,6 +604,9 @@ void UAssetManagerDataSource::OnAssetRenamed(UCommonItemDefinition* InItemDefini
 		{
 			const FPrimaryAssetId NewPrimaryAssetId = InItemDefinition->GetPrimaryAssetId();
 
+			// It was actually a rename and not a move, unless the new name is already taken.
+			const bool bIsRenamed = NewPrimaryAssetId != OldPrimaryAssetId && !RegistryBridge->GetRegistryRecord(NewPrimaryAssetId) && !QueuedDefinitions.Contains(NewPrimaryAssetId);
+
 #if !UE_VERSION_OLDER_THAN(5, 4, 0)
 
 			// Fixup a path if it is from SpecificAssets.
@@ -517,19 +617,22 @@ void UAssetManagerDataSource::OnAssetRenamed(UCommonItemDefinition* InItemDefini
 				TypeInfo->SpecificAssets.Remove(OldObjectPath);
 				AppendTypeInfoList(*TypeInfo, InItemDefinition);
 
-				TryUpdateDefaultConfigFile();
-				RefreshAssetManagerTypeInfoList();
+				bIsTypeInfoListDirty = true;
 			}
 
 #endif // !UE_VERSION_OLDER_THAN(5, 4, 0)
 
+			PackageHashes.Remove(OldPrimaryAssetId);
+			PackageHashes.Remove(NewPrimaryAssetId);
+
 			// Synchronize FPrimaryAssetId inside the definition.
 			InItemDefinition->Modify(/* bAlwaysMarkDirty */ false);
 			InItemDefinition->SharedData.PrimaryAssetId = InItemDefinition->GetPrimaryAssetId();
 
-			// This will add a new record if it was actually a rename and not a move.
-			if (RegistryBridge->AppendRecords({ FCommonInventoryRegistryRecord(*InItemDefinition) }) > 0)
+			if (bIsRenamed)
 			{
+				QueueDefinition(InItemDefinition, /* bIsNew */ true);
+
 				// For now, we will always create a redirector, solving the following problems:
 				// 1. How to avoid data loss in players' saves.
 				// 2. How to avoid data loss in large teams with VCS. One developer renames items, another creates dependencies on old ones.
@@ -540,8 +643,7 @@ void UAssetManagerDataSource::OnAssetRenamed(UCommonItemDefinition* InItemDefini
 
 					if (FCommonInventoryRedirects::AppendRedirects(Settings->PrimaryAssetNameRedirects, OldPrimaryAssetId.PrimaryAssetName, NewPrimaryAssetId.PrimaryAssetName, true))
 					{
-						FCommonInventoryRedirects::Get().ForceRefresh();
-						Settings->TryUpdateDefaultConfigFile();
+						bAreRedirectsDirty = true;
 					}
 					else
 					{
@@ -549,8 +651,14 @@ void UAssetManagerDataSource::OnAssetRenamed(UCommonItemDefinition* InItemDefini
 					}
 				}
 
-				// Finally, remove the old record and run the propagator.
-				verify(RegistryBridge->RemoveRecords({ OldPrimaryAssetId }));
+				// Finally, remove the old record along with the upsert, so the propagator runs once.
+				QueuedDefinitions.Remove(OldPrimaryAssetId);
+				QueuedRemovals.Add(OldPrimaryAssetId);
+			}
+			else if (NewPrimaryAssetId == OldPrimaryAssetId)
+			{
+				// A move keeps the id, but the record has to follow the new AssetPath, which is a part of HasIdenticalData().
+				QueueDefinition(InItemDefinition, /* bIsNew */ false);
 			}
 		}
 	}
@@ -562,21 +670,228 @@ void UAssetManagerDataSource::RefreshItemDefinition(UCommonItemDefinition* InIte
 
 	if (InItemDefinition && CanRefreshRegistry())
 	{
-		UAssetManager::Get().RefreshAssetData(InItemDefinition);
+		QueueDefinition(InItemDefinition, /* bIsNew */ false);
+	}
+}
+
+void UAssetManagerDataSource::QueueDefinition(UCommonItemDefinition* InItemDefinition, bool bIsNew)
+{
+	// New definitions are appended regardless of the later refreshes.
+	FQueuedDefinition& QueuedDefinition = QueuedDefinitions.FindOrAdd(InItemDefinition->GetPrimaryAssetId());
+	QueuedDefinition.Definition = InItemDefinition;
+	QueuedDefinition.bIsNew |= bIsNew;
+
+	ScheduleQueuedChangesFlush();
+}
+
+void UAssetManagerDataSource::ScheduleQueuedChangesFlush()
+{
+	if (!QueuedChangesTickerHandle.IsValid())
+	{
+		QueuedChangesTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateWeakLambda(this, [this](float)
+		{
+			QueuedChangesTickerHandle.Reset();
+			FlushQueuedChanges();
+			return false;
+		}));
+	}
+}
+
+void UAssetManagerDataSource::FlushQueuedChanges()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(QueuedChangesTickerHandle);
+	QueuedChangesTickerHandle.Reset();
+
+	// Keep the changes until the registry can be refreshed again, e.g. after PIE.
+	if (!HasQueuedChanges() || !CanRefreshRegistry())
+	{
+		return;
+	}
+
+	COMMON_INVENTORY_SCOPED_TRACE(UAssetManagerDataSource::FlushQueuedChanges);
+
+	if (bIsTypeInfoListDirty)
+	{
+		bIsTypeInfoListDirty = false;
+		TryUpdateDefaultConfigFile();
+		RefreshAssetManagerTypeInfoList();
+	}
+
+	// Redirects have to be up to date before the propagation.
+	if (bAreRedirectsDirty)
+	{
+		bAreRedirectsDirty = false;
+		FCommonInventoryRedirects::Get().ForceRefresh();
+
+		if (UCommonInventorySettings* const Settings = UCommonInventorySettings::GetMutable())
+		{
+			Settings->TryUpdateDefaultConfigFile();
+		}
+	}
+
+	TArray<FCommonInventoryRegistryRecord> Upserts;
+	Upserts.Reserve(QueuedDefinitions.Num());
+
+	for (const TPair<FPrimaryAssetId, FQueuedDefinition>& QueuedDefinition : QueuedDefinitions)
+	{
+		UCommonItemDefinition* const Definition = QueuedDefinition.Value.Definition.Get();
+
+		// Definitions renamed again since are queued under their new ids.
+		if (!Definition || Definition->GetPrimaryAssetId() != QueuedDefinition.Key)
+		{
+			continue;
+		}
+
+		if (QueuedDefinition.Value.bIsNew)
+		{
+			Upserts.Emplace(*Definition);
+			continue;
+		}
+
+		UAssetManager::Get().RefreshAssetData(Definition);
 
 		// Check if registered.
-		if (UAssetManager::Get().GetPrimaryAssetIdForObject(InItemDefinition).IsValid())
+		if (UAssetManager::Get().GetPrimaryAssetIdForObject(Definition).IsValid())
 		{
-			if (const FCommonInventoryRegistryRecord* const OriginalRecord = RegistryBridge->GetRegistryRecord(InItemDefinition->GetPrimaryAssetId()))
+			if (const FCommonInventoryRegistryRecord* const OriginalRecord = RegistryBridge->GetRegistryRecord(QueuedDefinition.Key))
 			{
 				// Don't trigger the OnPostRefresh event unless necessary.
-				if (const FCommonInventoryRegistryRecord NewRecord(*InItemDefinition); !NewRecord.HasIdenticalData(*OriginalRecord))
+				if (FCommonInventoryRegistryRecord NewRecord(*Definition); !NewRecord.HasIdenticalData(*OriginalRecord))
 				{
-					RegistryBridge->AppendRecords({ NewRecord });
+					// The saved package might not match the record anymore.
+					PackageHashes.Remove(QueuedDefinition.Key);
+					Upserts.Emplace(MoveTemp(NewRecord));
 				}
 			}
 		}
 	}
+
+	const TArray<FPrimaryAssetId> Removes = QueuedRemovals.Array();
+	QueuedDefinitions.Reset();
+	QueuedRemovals.Reset();
+
+	if (!Upserts.IsEmpty() || !Removes.IsEmpty())
+	{
+		RegistryBridge->ApplyRecords(Upserts, Removes);
+	}
+}
+
+bool UAssetManagerDataSource::DiffPrimaryAssets(TArray<FPrimaryAssetId>& InOutPrimaryAssets, TArray<FPrimaryAssetId>& OutRemovedAssets) const
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UAssetManagerDataSource::DiffPrimaryAssets);
+
+	if (!bUseIncrementalRefresh || !bHasPackageHashes || !RegistryBridge)
+	{
+		return false;
+	}
+
+	UAssetManager& AssetManager = UAssetManager::Get();
+	const IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	TSet<FPrimaryAssetId> FoundPrimaryAssets;
+	FoundPrimaryAssets.Reserve(InOutPrimaryAssets.Num());
+
+	InOutPrimaryAssets.RemoveAllSwap([&](const FPrimaryAssetId& InPrimaryAssetId)
+	{
+		FoundPrimaryAssets.Add(InPrimaryAssetId);
+
+		const FSoftObjectPath AssetPath = AssetManager.GetPrimaryAssetPath(InPrimaryAssetId);
+		const FCommonInventoryRegistryRecord* const Record = RegistryBridge->GetRegistryRecord(InPrimaryAssetId);
+		const FIoHash* const PackageHash = PackageHashes.Find(InPrimaryAssetId);
+
+		if (!Record || !PackageHash || Record->AssetPath != AssetPath)
+		{
+			return false;
+		}
+
+		// Unsaved changes aren't reflected in the asset registry.
+		if (const UPackage* const Package = FindPackage(nullptr, *AssetPath.GetLongPackageName()); Package && Package->IsDirty())
+		{
+			return false;
+		}
+
+		const TOptional<FAssetPackageData> PackageData = AssetRegistry.GetAssetPackageDataCopy(AssetPath.GetLongPackageFName());
+		return PackageData.IsSet() && PackageData->GetPackageSavedHash() == *PackageHash;
+	}, EAllowShrinking::No);
+
+	for (const FCommonInventoryRegistryRecord& Record : RegistryBridge->GetRegistryRecords())
+	{
+		if (!FoundPrimaryAssets.Contains(Record.GetPrimaryAssetId()))
+		{
+			OutRemovedAssets.Add(Record.GetPrimaryAssetId());
+		}
+	}
+
+	return true;
+}
+
+void UAssetManagerDataSource::UpdatePackageHash(const UCommonItemDefinition* InItemDefinition)
+{
+	UpdatePackageHash(InItemDefinition->GetPrimaryAssetId(), InItemDefinition->GetPackage()->GetFName());
+}
+
+void UAssetManagerDataSource::UpdatePackageHash(const FPrimaryAssetId& InPrimaryAssetId, FName InPackageName)
+{
+	const UPackage* const Package = FindPackage(nullptr, *InPackageName.ToString());
+
+	if (const TOptional<FAssetPackageData> PackageData = IAssetRegistry::GetChecked().GetAssetPackageDataCopy(InPackageName); PackageData.IsSet() && !(Package && Package->IsDirty()))
+	{
+		PackageHashes.Add(InPrimaryAssetId, PackageData->GetPackageSavedHash());
+	}
+	else
+	{
+		PackageHashes.Remove(InPrimaryAssetId);
+	}
+}
+
+FString UAssetManagerDataSource::GetPackageHashesFilename()
+{
+	return FPaths::Combine(FPaths::ProjectIntermediateDir(), TEXT("DevelopmentInventoryRegistryHashes.bin"));
+}
+
+void UAssetManagerDataSource::LoadPackageHashes()
+{
+	if (const TUniquePtr<FArchive> Reader = TUniquePtr<FArchive>(IFileManager::Get().CreateFileReader(*GetPackageHashesFilename())))
+	{
+		uint32 RegistryChecksum = 0;
+		*Reader << RegistryChecksum;
+
+		// The development registry might have been saved from another state, e.g. after a crash.
+		if (Reader->IsError() || RegistryChecksum != RegistryBridge->GetRegistryChecksum())
+		{
+			COMMON_INVENTORY_LOG(Log, "UAssetManagerDataSource: Package hashes don't match the loaded registry state, falling back to the full refresh.");
+			return;
+		}
+
+		*Reader << PackageHashes;
+		bHasPackageHashes = !Reader->IsError();
+
+		if (!bHasPackageHashes)
+		{
+			PackageHashes.Reset();
+		}
+	}
+}
+
+void UAssetManagerDataSource::SavePackageHashes() const
+{
+	if (!GIsEditor || IsRunningCommandlet() || !Traits.bSupportsDevelopmentCooking)
+	{
+		return;
+	}
+
+	if (bHasPackageHashes && RegistryBridge)
+	{
+		if (const TUniquePtr<FArchive> Writer = TUniquePtr<FArchive>(IFileManager::Get().CreateFileWriter(*GetPackageHashesFilename())))
+		{
+			uint32 RegistryChecksum = RegistryBridge->GetRegistryChecksum();
+			*Writer << RegistryChecksum;
+			*Writer << const_cast<TMap<FPrimaryAssetId, FIoHash>&>(PackageHashes);
+		}
+	}
+	else
+	{
+		IFileManager::Get().Delete(*GetPackageHashesFilename(), /* RequireExists */ false, /* EvenReadOnly */ true, /* Quiet */ true);
+	}
 }
 
 void UAssetManagerDataSource::OnCookStarted()
@@ -0,0 +1,73 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "InventoryRegistry/DataSources/AssetRegistryTagsDataSource.h"
+
+#include "CommonInventoryLog.h"
+#include "CommonInventoryTrace.h"
+#include "CommonItemDefinition.h"
+
+#include "AssetRegistry/AssetData.h"
+#include "Engine/AssetManager.h"
+
+#if WITH_EDITOR
+#include "UObject/Package.h"
+#endif // WITH_EDITOR
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(AssetRegistryTagsDataSource)
+
+void UAssetRegistryTagsDataSource::ResolvePrimaryAssets(TArray<FPrimaryAssetId>& InOutPrimaryAssets)
+{
+	COMMON_INVENTORY_SCOPED_TRACE(UAssetRegistryTagsDataSource::ResolvePrimaryAssets);
+
+	const UAssetManager& AssetManager = UAssetManager::Get();
+	const int32 RequestedNum = InOutPrimaryAssets.Num();
+
+	PendingRecords.Reserve(RequestedNum);
+	PendingRecordData.Reserve(RequestedNum * 2);
+
+	InOutPrimaryAssets.RemoveAllSwap([this, &AssetManager](const FPrimaryAssetId& InPrimaryAssetId)
+	{
+		FAssetData AssetData;
+		FString TagValue;
+
+		if (!AssetManager.GetPrimaryAssetData(InPrimaryAssetId, AssetData) || !AssetData.GetTagValue(UCommonItemDefinition::RegistryDataTagName, TagValue))
+		{
+			return false;
+		}
+
+#if WITH_EDITOR
+
+		// Tags don't reflect unsaved changes.
+		if (const UPackage* const Package = FindPackage(nullptr, *AssetData.PackageName.ToString()); Package && Package->IsDirty())
+		{
+			return false;
+		}
+
+#endif // WITH_EDITOR
+
+		FCommonItemSharedData SharedData;
+		FInstancedStruct DefaultItemPayload;
+		FInstancedStruct RegistryCustomData;
+
+		// The definition might have been renamed or saved with a different tag version.
+		if (!UCommonItemDefinition::ImportRegistryDataTag(TagValue, SharedData, DefaultItemPayload, RegistryCustomData) || SharedData.PrimaryAssetId != InPrimaryAssetId)
+		{
+			return false;
+		}
+
+		// Struct memory is heap allocated, so views remain valid while the storage grows.
+		const FInstancedStruct& StoredPayload = PendingRecordData.Emplace_GetRef(MoveTemp(DefaultItemPayload));
+		const FInstancedStruct& StoredCustomData = PendingRecordData.Emplace_GetRef(MoveTemp(RegistryCustomData));
+
+		FCommonInventoryRegistryRecord& Record = PendingRecords.Emplace_GetRef(SharedData, StoredPayload, StoredCustomData);
+		Record.AssetPath = AssetData.GetSoftObjectPath();
+
+#if WITH_EDITOR
+		UpdatePackageHash(InPrimaryAssetId, AssetData.PackageName);
+#endif
+
+		return true;
+	}, EAllowShrinking::No);
+
+	COMMON_INVENTORY_LOG(Verbose, "UAssetRegistryTagsDataSource: Resolved %d out of %d definition(s) from asset registry tags.", PendingRecords.Num(), RequestedNum);
+}
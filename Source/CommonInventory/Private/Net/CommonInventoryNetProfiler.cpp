@@ -0,0 +1,159 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "Net/CommonInventoryNetProfiler.h"
+
+#include "CommonInventoryLog.h"
+
+#include "Algo/Sort.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/ScopeLock.h"
+
+DEFINE_STAT(STAT_CommonInventory_NetSerializeItem);
+DEFINE_STAT(STAT_CommonInventory_NetSerializeItemPayload);
+DEFINE_STAT(STAT_CommonInventory_NetDeltaSerialize);
+
+#if COMMON_INVENTORY_WITH_NET_PROFILER
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Items Sent"), STAT_CommonInventory_ItemsSent, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Items Received"), STAT_CommonInventory_ItemsReceived, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RepIndex Bits"), STAT_CommonInventory_RepIndexBits, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Checksum Bits"), STAT_CommonInventory_ChecksumBits, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Payload Bits"), STAT_CommonInventory_PayloadBits, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("State Delta Bits"), STAT_CommonInventory_StateDeltaBits, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Default Payloads"), STAT_CommonInventory_DefaultPayloads, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Native Payloads"), STAT_CommonInventory_NativePayloads, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Delta Payloads"), STAT_CommonInventory_DeltaPayloads, STATGROUP_CommonInventoryNet);
+DECLARE_DWORD_COUNTER_STAT(TEXT("RepLayout Payloads"), STAT_CommonInventory_RepLayoutPayloads, STATGROUP_CommonInventoryNet);
+
+TRACE_DECLARE_INT_COUNTER(CommonInventoryNet_RepIndexBits, TEXT("CommonInventory/Net/RepIndexBits"));
+TRACE_DECLARE_INT_COUNTER(CommonInventoryNet_ChecksumBits, TEXT("CommonInventory/Net/ChecksumBits"));
+TRACE_DECLARE_INT_COUNTER(CommonInventoryNet_PayloadBits, TEXT("CommonInventory/Net/PayloadBits"));
+TRACE_DECLARE_INT_COUNTER(CommonInventoryNet_StateDeltaBits, TEXT("CommonInventory/Net/StateDeltaBits"));
+
+namespace CommonInventory::Net
+{
+	static bool bProfileArchetypes = false;
+	static FAutoConsoleVariableRef CVarProfileArchetypes(
+		TEXT("CommonInventory.Net.ProfileArchetypes"),
+		bProfileArchetypes,
+		TEXT("Whether to accumulate bits and serialization time of replicated items per archetype. Use CommonInventory.Net.DumpProfile to print the results."),
+		ECVF_Cheat
+	);
+
+	/** Accumulated bits of replicated items of the same archetype. */
+	struct FArchetypeNetStats
+	{
+		int64 NumItems = 0;
+		int64 RepIndexBits = 0;
+		int64 ChecksumBits = 0;
+		int64 PayloadBits = 0;
+		int64 NumPayloads[static_cast<int32>(EPayloadPath::Num)] = {};
+		uint64 IdentityCycles = 0;
+		uint64 PayloadCycles = 0;
+
+		int64 GetTotalBits() const { return RepIndexBits + ChecksumBits + PayloadBits; }
+	};
+
+	// Replication might run on multiple threads.
+	static FCriticalSection ArchetypeStatsLock;
+	static TMap<FPrimaryAssetType, FArchetypeNetStats> ArchetypeStats;
+
+	void RecordItemIdentity(FArchive& Ar, FPrimaryAssetType InArchetype, int64 InRepIndexBits, int64 InChecksumBits, uint64 InCycles)
+	{
+		if (Ar.IsSaving())
+		{
+			INC_DWORD_STAT(STAT_CommonInventory_ItemsSent);
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_CommonInventory_ItemsReceived);
+		}
+
+		INC_DWORD_STAT_BY(STAT_CommonInventory_RepIndexBits, InRepIndexBits);
+		INC_DWORD_STAT_BY(STAT_CommonInventory_ChecksumBits, InChecksumBits);
+		TRACE_COUNTER_ADD(CommonInventoryNet_RepIndexBits, InRepIndexBits);
+		TRACE_COUNTER_ADD(CommonInventoryNet_ChecksumBits, InChecksumBits);
+
+		if (bProfileArchetypes)
+		{
+			const FScopeLock Lock(&ArchetypeStatsLock);
+			FArchetypeNetStats& Stats = ArchetypeStats.FindOrAdd(InArchetype);
+			++Stats.NumItems;
+			Stats.RepIndexBits += InRepIndexBits;
+			Stats.ChecksumBits += InChecksumBits;
+			Stats.IdentityCycles += InCycles;
+		}
+	}
+
+	void RecordItemPayload(FArchive& Ar, FPrimaryAssetType InArchetype, int64 InPayloadBits, EPayloadPath InPayloadPath, uint64 InCycles)
+	{
+		INC_DWORD_STAT_BY(STAT_CommonInventory_PayloadBits, InPayloadBits);
+		TRACE_COUNTER_ADD(CommonInventoryNet_PayloadBits, InPayloadBits);
+
+		switch (InPayloadPath)
+		{
+		case EPayloadPath::Default: INC_DWORD_STAT(STAT_CommonInventory_DefaultPayloads); break;
+		case EPayloadPath::Native: INC_DWORD_STAT(STAT_CommonInventory_NativePayloads); break;
+		case EPayloadPath::Delta: INC_DWORD_STAT(STAT_CommonInventory_DeltaPayloads); break;
+		case EPayloadPath::RepLayout: INC_DWORD_STAT(STAT_CommonInventory_RepLayoutPayloads); break;
+		default: break;
+		}
+
+		if (bProfileArchetypes)
+		{
+			const FScopeLock Lock(&ArchetypeStatsLock);
+			FArchetypeNetStats& Stats = ArchetypeStats.FindOrAdd(InArchetype);
+			Stats.PayloadBits += InPayloadBits;
+			++Stats.NumPayloads[static_cast<int32>(InPayloadPath)];
+			Stats.PayloadCycles += InCycles;
+		}
+	}
+
+	void RecordStateDelta(int64 InDeltaBits)
+	{
+		INC_DWORD_STAT_BY(STAT_CommonInventory_StateDeltaBits, InDeltaBits);
+		TRACE_COUNTER_ADD(CommonInventoryNet_StateDeltaBits, InDeltaBits);
+	}
+
+	static void ExecDumpProfile()
+	{
+		TArray<TPair<FPrimaryAssetType, FArchetypeNetStats>> SortedStats;
+
+		{
+			const FScopeLock Lock(&ArchetypeStatsLock);
+			SortedStats = ArchetypeStats.Array();
+			ArchetypeStats.Reset();
+		}
+
+		if (SortedStats.IsEmpty())
+		{
+			COMMON_INVENTORY_LOG(Display, "Nothing to dump. Make sure CommonInventory.Net.ProfileArchetypes is enabled.");
+			return;
+		}
+
+		Algo::SortBy(SortedStats, [](const auto& InPair) { return InPair.Value.GetTotalBits(); }, TGreater());
+
+		COMMON_INVENTORY_LOG(Display, "Archetype, Items, AvgBits, RepIndexBits, ChecksumBits, PayloadBits, Default, Native, Delta, RepLayout, AvgUs, IdentityMs, PayloadMs");
+
+		for (const auto& [Archetype, Stats] : SortedStats)
+		{
+			const double IdentityMs = FPlatformTime::ToMilliseconds64(Stats.IdentityCycles);
+			const double PayloadMs = FPlatformTime::ToMilliseconds64(Stats.PayloadCycles);
+
+			COMMON_INVENTORY_LOG(Display, "%s, %lld, %.2f, %lld, %lld, %lld, %lld, %lld, %lld, %lld, %.3f, %.3f, %.3f", *Archetype.ToString(), Stats.NumItems,
+				Stats.NumItems > 0 ? static_cast<double>(Stats.GetTotalBits()) / Stats.NumItems : 0.0, Stats.RepIndexBits, Stats.ChecksumBits, Stats.PayloadBits,
+				Stats.NumPayloads[static_cast<int32>(EPayloadPath::Default)], Stats.NumPayloads[static_cast<int32>(EPayloadPath::Native)],
+				Stats.NumPayloads[static_cast<int32>(EPayloadPath::Delta)], Stats.NumPayloads[static_cast<int32>(EPayloadPath::RepLayout)],
+				Stats.NumItems > 0 ? (IdentityMs + PayloadMs) * 1000.0 / Stats.NumItems : 0.0, IdentityMs, PayloadMs);
+		}
+	}
+
+	static FAutoConsoleCommand CVarDumpProfile(
+		TEXT("CommonInventory.Net.DumpProfile"),
+		TEXT("Dumps bits and serialization time of replicated items per archetype accumulated since the last dump."),
+		FConsoleCommandDelegate::CreateStatic(ExecDumpProfile),
+		ECVF_Cheat
+	);
+}
+
+#endif // COMMON_INVENTORY_WITH_NET_PROFILER
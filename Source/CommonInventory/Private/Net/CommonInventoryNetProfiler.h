@@ -0,0 +1,138 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "CommonInventoryTrace.h"
+
+#include "HAL/CriticalSection.h"
+#include "HAL/PlatformTime.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Stats/Stats.h"
+#include "UObject/PrimaryAssetId.h"
+
+// Whether replicated items are profiled. 'stat CommonInventoryNet' and -trace=Counters,CommonInventory display the results.
+#ifndef COMMON_INVENTORY_WITH_NET_PROFILER
+#define COMMON_INVENTORY_WITH_NET_PROFILER (!UE_BUILD_SHIPPING)
+#endif
+
+DECLARE_STATS_GROUP(TEXT("CommonInventoryNet"), STATGROUP_CommonInventoryNet, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("NetSerializeItem"), STAT_CommonInventory_NetSerializeItem, STATGROUP_CommonInventoryNet, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("NetSerializeItemPayload"), STAT_CommonInventory_NetSerializeItemPayload, STATGROUP_CommonInventoryNet, );
+DECLARE_CYCLE_STAT_EXTERN(TEXT("NetDeltaSerialize"), STAT_CommonInventory_NetDeltaSerialize, STATGROUP_CommonInventoryNet, );
+
+#if COMMON_INVENTORY_WITH_NET_PROFILER
+
+namespace CommonInventory::Net
+{
+	/** How the payload of the item has been serialized. */
+	enum class EPayloadPath : uint8
+	{
+		None,		// The item doesn't have a payload.
+		Default,	// The payload matches the defaults and was reduced to a single bit.
+		Native,		// STRUCT_NetSerializeNative.
+		Delta,		// Only the properties different from the defaults.
+		RepLayout,	// The full payload through FRepLayout.
+
+		Num
+	};
+
+	/**
+	 * Registers the bit archive for the scope, so the functions which only receive FArchive can measure it.
+	 * Only callers which own the concrete FBitWriter or FBitReader are able to register it.
+	 */
+	class FScopedBitArchive : public FNoncopyable
+	{
+	public:
+
+		FScopedBitArchive(const FBitWriter* InWriter, const FBitReader* InReader)
+			: Writer(InWriter), Reader(InReader), OuterScope(CurrentScope)
+		{
+			CurrentScope = this;
+		}
+
+		~FScopedBitArchive()
+		{
+			CurrentScope = OuterScope;
+		}
+
+		/** Returns the current position of the registered archive in bits. */
+		int64 GetPosBits() const { return Writer ? Writer->GetNumBits() : Reader ? Reader->GetPosBits() : 0; }
+
+		/** Returns the innermost scope which registered the archive if any. */
+		static const FScopedBitArchive* Find(const FArchive& Ar)
+		{
+			for (const FScopedBitArchive* Scope = CurrentScope; Scope; Scope = Scope->OuterScope)
+			{
+				if (Scope->Writer == &Ar || Scope->Reader == &Ar)
+				{
+					return Scope;
+				}
+			}
+
+			return nullptr;
+		}
+
+	private:
+
+		const FBitWriter* Writer = nullptr;
+		const FBitReader* Reader = nullptr;
+		const FScopedBitArchive* OuterScope = nullptr;
+
+		static inline thread_local const FScopedBitArchive* CurrentScope = nullptr;
+	};
+
+	/** Returns the current position of the archive in bits. Bit archives are only measured if registered by FScopedBitArchive, anything else by its byte position if any. */
+	inline int64 GetArchivePosBits(FArchive& Ar)
+	{
+		if (const FScopedBitArchive* const Scope = FScopedBitArchive::Find(Ar))
+		{
+			return Scope->GetPosBits();
+		}
+
+		return FMath::Max<int64>(Ar.Tell(), 0) * 8;
+	}
+
+	/** Records bits and cycles of the item identity, i.e. RepIndex and the optional checksum. */
+	void RecordItemIdentity(FArchive& Ar, FPrimaryAssetType InArchetype, int64 InRepIndexBits, int64 InChecksumBits, uint64 InCycles);
+
+	/** Records bits and cycles of the item payload. */
+	void RecordItemPayload(FArchive& Ar, FPrimaryAssetType InArchetype, int64 InPayloadBits, EPayloadPath InPayloadPath, uint64 InCycles);
+
+	/** Records bits of the whole state delta. */
+	void RecordStateDelta(int64 InDeltaBits);
+
+	/** Measures the payload serialization, which has multiple exits. */
+	struct FScopedPayloadProfile
+	{
+		FScopedPayloadProfile(FArchive& InAr, FPrimaryAssetType InArchetype)
+			: Ar(InAr), Archetype(InArchetype), StartBits(GetArchivePosBits(InAr)), StartCycles(FPlatformTime::Cycles64())
+		{
+		}
+
+		~FScopedPayloadProfile()
+		{
+			RecordItemPayload(Ar, Archetype, GetArchivePosBits(Ar) - StartBits, PayloadPath, FPlatformTime::Cycles64() - StartCycles);
+		}
+
+		FArchive& Ar;
+		FPrimaryAssetType Archetype;
+		int64 StartBits = 0;
+		uint64 StartCycles = 0;
+		EPayloadPath PayloadPath = EPayloadPath::None;
+	};
+}
+
+#define COMMON_INVENTORY_NET_PROFILE_PAYLOAD(Ar, Archetype) CommonInventory::Net::FScopedPayloadProfile PayloadProfile(Ar, Archetype)
+#define COMMON_INVENTORY_NET_PROFILE_PAYLOAD_PATH(Path) PayloadProfile.PayloadPath = CommonInventory::Net::EPayloadPath::Path
+#define COMMON_INVENTORY_NET_PROFILE_BIT_ARCHIVE(Writer, Reader) const CommonInventory::Net::FScopedBitArchive BitArchiveProfile(Writer, Reader)
+
+#else
+
+#define COMMON_INVENTORY_NET_PROFILE_PAYLOAD(Ar, Archetype)
+#define COMMON_INVENTORY_NET_PROFILE_PAYLOAD_PATH(Path)
+#define COMMON_INVENTORY_NET_PROFILE_BIT_ARCHIVE(Writer, Reader)
+
+#endif // COMMON_INVENTORY_WITH_NET_PROFILER
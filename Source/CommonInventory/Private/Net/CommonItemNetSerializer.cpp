@@ -0,0 +1,557 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "HAL/Platform.h"
+
+#if UE_WITH_IRIS
+
+#include "CommonInventoryTypes.h"
+#include "Engine/NetSerialization.h"
+#include "InventoryRegistry/CommonInventoryRegistry.h"
+#include "Net/CommonInventoryNetProfiler.h"
+
+#include "Iris/ReplicationState/PropertyNetSerializerInfoRegistry.h"
+#include "Iris/Serialization/NetBitStreamReader.h"
+#include "Iris/Serialization/NetBitStreamUtil.h"
+#include "Iris/Serialization/NetBitStreamWriter.h"
+#include "Iris/Serialization/NetSerializationContext.h"
+#include "Iris/Serialization/NetSerializer.h"
+#include "Iris/Serialization/NetSerializerDelegates.h"
+#include "Math/UnrealMathUtility.h"
+
+namespace UE::Net
+{
+
+struct FCommonItemNetSerializerConfig : public FNetSerializerConfig
+{
+};
+
+/**
+ * Iris serializer for FCommonItem.
+ * 
+ * The item is quantized into RepIndex and the payload bits produced by the registry net serialization.
+ * Payloads identical to the registry defaults are reduced to a single bit.
+ */
+struct FCommonItemNetSerializer
+{
+	static constexpr uint32 Version = 0;
+	static constexpr bool bHasDynamicState = true;
+
+	// Guards against malformed streams, the recommended payload size is much lower.
+	static constexpr uint32 MaxPayloadBitCount = 1u << 16;
+
+	struct FQuantizedType
+	{
+		uint32* PayloadData;
+		uint32 PayloadWordCapacity;
+		uint32 PayloadBitCount;
+		uint32 RepIndex;
+		uint32 Checksum;
+		bool bHasChecksum;
+		bool bHasDefaultPayload;
+	};
+
+	typedef FCommonItem SourceType;
+	typedef FQuantizedType QuantizedType;
+	typedef FCommonItemNetSerializerConfig ConfigType;
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+	static void SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args);
+	static void DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args);
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+	static void CloneDynamicState(FNetSerializationContext& Context, const FNetCloneDynamicStateArgs& Args);
+	static void FreeDynamicState(FNetSerializationContext& Context, const FNetFreeDynamicStateArgs& Args);
+
+public: // Shared with FCommonItemStackNetSerializer
+
+	static void WriteItem(FNetSerializationContext& Context, const QuantizedType& Value);
+	static void ReadItem(FNetSerializationContext& Context, QuantizedType& Value);
+	static void WriteItemDelta(FNetSerializationContext& Context, const QuantizedType& Value, const QuantizedType& PrevValue);
+	static void ReadItemDelta(FNetSerializationContext& Context, QuantizedType& Value, const QuantizedType& PrevValue);
+	static void QuantizeItem(const SourceType& Source, QuantizedType& Target);
+	static void DequantizeItem(const QuantizedType& Source, SourceType& Target);
+	static bool IsEqualItem(const QuantizedType& Lhs, const QuantizedType& Rhs);
+	static void CopyItem(const QuantizedType& Source, QuantizedType& Target);
+	static void FreeItem(QuantizedType& Value);
+
+private:
+
+	static void ReservePayload(QuantizedType& Value, uint32 InBitCount);
+};
+
+/**
+ * Iris serializer for FCommonItemStack.
+ */
+struct FCommonItemStackNetSerializer
+{
+	static constexpr uint32 Version = 0;
+	static constexpr bool bHasDynamicState = true;
+
+	struct FQuantizedType
+	{
+		FCommonItemNetSerializer::QuantizedType CommonItem;
+		int32 StackSize;
+	};
+
+	typedef FCommonItemStack SourceType;
+	typedef FQuantizedType QuantizedType;
+	typedef FCommonItemNetSerializerConfig ConfigType;
+	static const ConfigType DefaultConfig;
+
+	static void Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args);
+	static void Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args);
+	static void SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args);
+	static void DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args);
+	static void Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args);
+	static void Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args);
+	static bool IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args);
+	static bool Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args);
+	static void CloneDynamicState(FNetSerializationContext& Context, const FNetCloneDynamicStateArgs& Args);
+	static void FreeDynamicState(FNetSerializationContext& Context, const FNetFreeDynamicStateArgs& Args);
+};
+
+UE_NET_IMPLEMENT_SERIALIZER(FCommonItemNetSerializer);
+UE_NET_IMPLEMENT_SERIALIZER(FCommonItemStackNetSerializer);
+
+const FCommonItemNetSerializer::ConfigType FCommonItemNetSerializer::DefaultConfig;
+const FCommonItemStackNetSerializer::ConfigType FCommonItemStackNetSerializer::DefaultConfig;
+
+/************************************************************************/
+/* FCommonItemNetSerializer                                             */
+/************************************************************************/
+
+void FCommonItemNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	WriteItem(Context, *reinterpret_cast<const QuantizedType*>(Args.Source));
+}
+
+void FCommonItemNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	ReadItem(Context, *reinterpret_cast<QuantizedType*>(Args.Target));
+}
+
+void FCommonItemNetSerializer::SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args)
+{
+	WriteItemDelta(Context, *reinterpret_cast<const QuantizedType*>(Args.Source), *reinterpret_cast<const QuantizedType*>(Args.Prev));
+}
+
+void FCommonItemNetSerializer::DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args)
+{
+	ReadItemDelta(Context, *reinterpret_cast<QuantizedType*>(Args.Target), *reinterpret_cast<const QuantizedType*>(Args.Prev));
+}
+
+void FCommonItemNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	QuantizeItem(*reinterpret_cast<const SourceType*>(Args.Source), *reinterpret_cast<QuantizedType*>(Args.Target));
+}
+
+void FCommonItemNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	DequantizeItem(*reinterpret_cast<const QuantizedType*>(Args.Source), *reinterpret_cast<SourceType*>(Args.Target));
+}
+
+bool FCommonItemNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized)
+	{
+		return IsEqualItem(*reinterpret_cast<const QuantizedType*>(Args.Source0), *reinterpret_cast<const QuantizedType*>(Args.Source1));
+	}
+
+	return *reinterpret_cast<const SourceType*>(Args.Source0) == *reinterpret_cast<const SourceType*>(Args.Source1);
+}
+
+bool FCommonItemNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	return !Source.IsValid() || UCommonInventoryRegistry::Get().ContainsRecord(Source.GetPrimaryAssetId());
+}
+
+void FCommonItemNetSerializer::CloneDynamicState(FNetSerializationContext& Context, const FNetCloneDynamicStateArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+
+	// The target is a shallow copy of the source at this point.
+	Target.PayloadData = nullptr;
+	Target.PayloadWordCapacity = 0;
+	CopyItem(*reinterpret_cast<const QuantizedType*>(Args.Source), Target);
+}
+
+void FCommonItemNetSerializer::FreeDynamicState(FNetSerializationContext& Context, const FNetFreeDynamicStateArgs& Args)
+{
+	FreeItem(*reinterpret_cast<QuantizedType*>(Args.Source));
+}
+
+void FCommonItemNetSerializer::WriteItem(FNetSerializationContext& Context, const QuantizedType& Value)
+{
+	FNetBitStreamWriter* const Writer = Context.GetBitStreamWriter();
+
+	// Reuse the same encoding as the legacy net serialization.
+	Writer->WriteBits(Value.RepIndex, static_cast<uint32>(UCommonInventoryRegistry::Get().GetRegistryState().GetRepIndexEncodingBitsNum()));
+
+#if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+	if (Writer->WriteBool(Value.bHasChecksum))
+	{
+		Writer->WriteBits(Value.Checksum, 32);
+	}
+#endif
+
+	if (!Writer->WriteBool(Value.bHasDefaultPayload))
+	{
+		WritePackedUint32(Writer, Value.PayloadBitCount);
+		Writer->WriteBitStream(Value.PayloadData, /* SrcBitOffset */ 0, Value.PayloadBitCount);
+	}
+}
+
+void FCommonItemNetSerializer::ReadItem(FNetSerializationContext& Context, QuantizedType& Value)
+{
+	FNetBitStreamReader* const Reader = Context.GetBitStreamReader();
+
+	Value.RepIndex = Reader->ReadBits(static_cast<uint32>(UCommonInventoryRegistry::Get().GetRegistryState().GetRepIndexEncodingBitsNum()));
+
+#if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+	Value.bHasChecksum = Reader->ReadBool();
+	Value.Checksum = Value.bHasChecksum ? Reader->ReadBits(32) : 0;
+#else
+	Value.bHasChecksum = false;
+	Value.Checksum = 0;
+#endif
+
+	if ((Value.bHasDefaultPayload = Reader->ReadBool()) == true)
+	{
+		Value.PayloadBitCount = 0;
+		return;
+	}
+
+	const uint32 PayloadBitCount = ReadPackedUint32(Reader);
+
+	if (PayloadBitCount > MaxPayloadBitCount)
+	{
+		Context.SetError(GNetError_InvalidValue);
+		return;
+	}
+
+	ReservePayload(Value, PayloadBitCount);
+	Reader->ReadBitStream(Value.PayloadData, PayloadBitCount);
+}
+
+void FCommonItemNetSerializer::WriteItemDelta(FNetSerializationContext& Context, const QuantizedType& Value, const QuantizedType& PrevValue)
+{
+	// Unchanged items are reduced to a single bit.
+	if (!Context.GetBitStreamWriter()->WriteBool(IsEqualItem(Value, PrevValue)))
+	{
+		WriteItem(Context, Value);
+	}
+}
+
+void FCommonItemNetSerializer::ReadItemDelta(FNetSerializationContext& Context, QuantizedType& Value, const QuantizedType& PrevValue)
+{
+	if (Context.GetBitStreamReader()->ReadBool())
+	{
+		CopyItem(PrevValue, Value);
+	}
+	else
+	{
+		ReadItem(Context, Value);
+	}
+}
+
+void FCommonItemNetSerializer::QuantizeItem(const SourceType& Source, QuantizedType& Target)
+{
+	const UCommonInventoryRegistry& Registry = UCommonInventoryRegistry::Get();
+	const FCommonInventoryRegistryRecord* const RegistryRecord = Registry.GetRegistryRecord(Source.GetPrimaryAssetId());
+
+	Target.RepIndex = RegistryRecord ? RegistryRecord->RepIndex : CommonInventory::INVALID_REPLICATION_INDEX;
+	Target.Checksum = 0;
+	Target.bHasChecksum = false;
+	Target.PayloadBitCount = 0;
+	Target.bHasDefaultPayload = true;
+
+#if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+	// Archetypes are verified by UCommonInventoryRegistryHandshake, so only a sample of items carry the record checksum.
+	if (RegistryRecord && CommonInventory::ShouldSampleNetworkChecksum())
+	{
+		Target.Checksum = RegistryRecord->GetChecksum();
+		Target.bHasChecksum = true;
+	}
+#endif
+
+	// Records without default payload never replicate one.
+	if (!RegistryRecord || !RegistryRecord->DefaultPayload.IsValid())
+	{
+		return;
+	}
+
+	const FConstStructView DefaultPayload = RegistryRecord->DefaultPayload;
+	const FVariadicStruct& Payload = Source.GetPayload();
+
+	// Unsynchronized payloads are reset to the defaults on the receiving side.
+	if (!ensureMsgf(Payload.GetScriptStruct() == DefaultPayload.GetScriptStruct(), TEXT("FCommonItemNetSerializer: Quantizing unsynchronized payload for '%s'."), *Source.GetPrimaryAssetId().ToString()))
+	{
+		return;
+	}
+
+	if (DefaultPayload.GetScriptStruct()->CompareScriptStruct(Payload.GetMemory(), DefaultPayload.GetMemory(), PPF_None))
+	{
+		return;
+	}
+
+	// Plain bit archives skip FNames, while net archives without UPackageMap fall back to UPackageMap::StaticSerializeName().
+	FNetBitWriter PayloadWriter(/* InPackageMap */ nullptr, /* InMaxBits */ 256);
+	bool bSuccess = true;
+	FCommonInventoryRegistryNetSerializationContext SerializationContext{ Source.GetPrimaryAssetId(), bSuccess };
+	SerializationContext.RegistryRecord = RegistryRecord;
+
+	// Saving doesn't modify the synchronized payload.
+	COMMON_INVENTORY_NET_PROFILE_BIT_ARCHIVE(&PayloadWriter, /* InReader */ nullptr);
+	Registry.NetSerializeItemPayload(PayloadWriter, const_cast<FVariadicStruct&>(Payload), SerializationContext);
+
+	if (bSuccess && !PayloadWriter.IsError() && PayloadWriter.GetNumBits() <= MaxPayloadBitCount)
+	{
+		Target.bHasDefaultPayload = false;
+		Target.PayloadBitCount = static_cast<uint32>(PayloadWriter.GetNumBits());
+		ReservePayload(Target, Target.PayloadBitCount);
+		FMemory::Memcpy(Target.PayloadData, PayloadWriter.GetData(), PayloadWriter.GetNumBytes());
+	}
+}
+
+void FCommonItemNetSerializer::DequantizeItem(const QuantizedType& Source, SourceType& Target)
+{
+	const UCommonInventoryRegistry& Registry = UCommonInventoryRegistry::Get();
+	const FCommonInventoryRegistryRecord* const RegistryRecord = Registry.GetRegistryState().GetRecordFromReplication(Source.RepIndex);
+
+	if (!RegistryRecord)
+	{
+		ensureMsgf(Source.RepIndex == CommonInventory::INVALID_REPLICATION_INDEX, TEXT("Failed to match RepIndex %u with any FPrimaryAssetId."), Source.RepIndex);
+		Target.Reset();
+		return;
+	}
+
+#if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+	ensureMsgf(!Source.bHasChecksum || Source.Checksum == RegistryRecord->GetChecksum(), TEXT("Network checksum mismatch encountered for '%s': Local(%#x), Remote(%#x)."), *RegistryRecord->GetPrimaryAssetId().ToString(), RegistryRecord->GetChecksum(), Source.Checksum);
+#endif
+
+	if (Target.GetPrimaryAssetId() != RegistryRecord->GetPrimaryAssetId())
+	{
+		Target = FCommonItem(RegistryRecord->GetPrimaryAssetId(), FCommonItem::DeferPayloadInit);
+	}
+
+	if (Source.bHasDefaultPayload)
+	{
+		Target.ResetItem();
+	}
+	else
+	{
+		FNetBitReader PayloadReader(/* InPackageMap */ nullptr, reinterpret_cast<uint8*>(Source.PayloadData), Source.PayloadBitCount);
+		bool bSuccess = true;
+		FCommonInventoryRegistryNetSerializationContext SerializationContext{ RegistryRecord->GetPrimaryAssetId(), bSuccess };
+		SerializationContext.RegistryRecord = RegistryRecord;
+		COMMON_INVENTORY_NET_PROFILE_BIT_ARCHIVE(/* InWriter */ nullptr, &PayloadReader);
+		Registry.NetSerializeItemPayload(PayloadReader, Target.GetMutablePayload(), SerializationContext);
+
+		if (!bSuccess || PayloadReader.IsError())
+		{
+			Target.ResetItem();
+		}
+	}
+}
+
+bool FCommonItemNetSerializer::IsEqualItem(const QuantizedType& Lhs, const QuantizedType& Rhs)
+{
+	// The sampled checksum doesn't affect the item.
+	if (Lhs.RepIndex != Rhs.RepIndex || Lhs.bHasDefaultPayload != Rhs.bHasDefaultPayload || Lhs.PayloadBitCount != Rhs.PayloadBitCount)
+	{
+		return false;
+	}
+
+	if (Lhs.PayloadBitCount == 0)
+	{
+		return true;
+	}
+
+	// The trailing bits are guaranteed to be zeroed.
+	return FMemory::Memcmp(Lhs.PayloadData, Rhs.PayloadData, FMath::DivideAndRoundUp(Lhs.PayloadBitCount, 32u) * sizeof(uint32)) == 0;
+}
+
+void FCommonItemNetSerializer::CopyItem(const QuantizedType& Source, QuantizedType& Target)
+{
+	if (&Source != &Target)
+	{
+		Target.RepIndex = Source.RepIndex;
+		Target.Checksum = Source.Checksum;
+		Target.bHasChecksum = Source.bHasChecksum;
+		Target.bHasDefaultPayload = Source.bHasDefaultPayload;
+		Target.PayloadBitCount = Source.PayloadBitCount;
+
+		if (Source.PayloadBitCount > 0)
+		{
+			ReservePayload(Target, Source.PayloadBitCount);
+			FMemory::Memcpy(Target.PayloadData, Source.PayloadData, FMath::DivideAndRoundUp(Source.PayloadBitCount, 32u) * sizeof(uint32));
+		}
+	}
+}
+
+void FCommonItemNetSerializer::FreeItem(QuantizedType& Value)
+{
+	FMemory::Free(Value.PayloadData);
+	Value.PayloadData = nullptr;
+	Value.PayloadWordCapacity = 0;
+	Value.PayloadBitCount = 0;
+}
+
+void FCommonItemNetSerializer::ReservePayload(QuantizedType& Value, uint32 InBitCount)
+{
+	const uint32 WordCount = FMath::DivideAndRoundUp(InBitCount, 32u);
+
+	if (WordCount > Value.PayloadWordCapacity)
+	{
+		Value.PayloadData = static_cast<uint32*>(FMemory::Realloc(Value.PayloadData, WordCount * sizeof(uint32), alignof(uint32)));
+		Value.PayloadWordCapacity = WordCount;
+	}
+
+	// Keep the trailing bits zeroed for comparison.
+	if (WordCount > 0)
+	{
+		Value.PayloadData[WordCount - 1] = 0;
+	}
+}
+
+/************************************************************************/
+/* FCommonItemStackNetSerializer                                        */
+/************************************************************************/
+
+// Matches the legacy FCommonItemStack::NetSerialize() encoding.
+static void WriteStackSize(FNetBitStreamWriter* Writer, int32 StackSize)
+{
+	Writer->WriteBool(StackSize < 0);
+	WritePackedUint32(Writer, StackSize < 0 ? static_cast<uint32>(-int64(StackSize)) : static_cast<uint32>(StackSize));
+}
+
+static int32 ReadStackSize(FNetBitStreamReader* Reader)
+{
+	const bool bIsNegative = Reader->ReadBool();
+	const uint32 Absolute = ReadPackedUint32(Reader);
+	return bIsNegative ? -static_cast<int32>(Absolute) : static_cast<int32>(Absolute);
+}
+
+void FCommonItemStackNetSerializer::Serialize(FNetSerializationContext& Context, const FNetSerializeArgs& Args)
+{
+	const QuantizedType& Source = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	FCommonItemNetSerializer::WriteItem(Context, Source.CommonItem);
+	WriteStackSize(Context.GetBitStreamWriter(), Source.StackSize);
+}
+
+void FCommonItemStackNetSerializer::Deserialize(FNetSerializationContext& Context, const FNetDeserializeArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	FCommonItemNetSerializer::ReadItem(Context, Target.CommonItem);
+	Target.StackSize = ReadStackSize(Context.GetBitStreamReader());
+}
+
+void FCommonItemStackNetSerializer::SerializeDelta(FNetSerializationContext& Context, const FNetSerializeDeltaArgs& Args)
+{
+	const QuantizedType& Source = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	const QuantizedType& Prev = *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FCommonItemNetSerializer::WriteItemDelta(Context, Source.CommonItem, Prev.CommonItem);
+
+	// Stack sizes change more frequently than items.
+	if (!Context.GetBitStreamWriter()->WriteBool(Source.StackSize == Prev.StackSize))
+	{
+		WriteStackSize(Context.GetBitStreamWriter(), Source.StackSize);
+	}
+}
+
+void FCommonItemStackNetSerializer::DeserializeDelta(FNetSerializationContext& Context, const FNetDeserializeDeltaArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	const QuantizedType& Prev = *reinterpret_cast<const QuantizedType*>(Args.Prev);
+	FCommonItemNetSerializer::ReadItemDelta(Context, Target.CommonItem, Prev.CommonItem);
+	Target.StackSize = Context.GetBitStreamReader()->ReadBool() ? Prev.StackSize : ReadStackSize(Context.GetBitStreamReader());
+}
+
+void FCommonItemStackNetSerializer::Quantize(FNetSerializationContext& Context, const FNetQuantizeArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+	FCommonItemNetSerializer::QuantizeItem(Source.CommonItem, Target.CommonItem);
+	Target.StackSize = Source.StackSize;
+}
+
+void FCommonItemStackNetSerializer::Dequantize(FNetSerializationContext& Context, const FNetDequantizeArgs& Args)
+{
+	const QuantizedType& Source = *reinterpret_cast<const QuantizedType*>(Args.Source);
+	SourceType& Target = *reinterpret_cast<SourceType*>(Args.Target);
+	FCommonItemNetSerializer::DequantizeItem(Source.CommonItem, Target.CommonItem);
+	Target.StackSize = Source.StackSize;
+}
+
+bool FCommonItemStackNetSerializer::IsEqual(FNetSerializationContext& Context, const FNetIsEqualArgs& Args)
+{
+	if (Args.bStateIsQuantized)
+	{
+		const QuantizedType& Lhs = *reinterpret_cast<const QuantizedType*>(Args.Source0);
+		const QuantizedType& Rhs = *reinterpret_cast<const QuantizedType*>(Args.Source1);
+		return Lhs.StackSize == Rhs.StackSize && FCommonItemNetSerializer::IsEqualItem(Lhs.CommonItem, Rhs.CommonItem);
+	}
+
+	return *reinterpret_cast<const SourceType*>(Args.Source0) == *reinterpret_cast<const SourceType*>(Args.Source1);
+}
+
+bool FCommonItemStackNetSerializer::Validate(FNetSerializationContext& Context, const FNetValidateArgs& Args)
+{
+	const SourceType& Source = *reinterpret_cast<const SourceType*>(Args.Source);
+	return !Source.CommonItem.IsValid() || UCommonInventoryRegistry::Get().ContainsRecord(Source.CommonItem.GetPrimaryAssetId());
+}
+
+void FCommonItemStackNetSerializer::CloneDynamicState(FNetSerializationContext& Context, const FNetCloneDynamicStateArgs& Args)
+{
+	QuantizedType& Target = *reinterpret_cast<QuantizedType*>(Args.Target);
+
+	// The target is a shallow copy of the source at this point.
+	Target.CommonItem.PayloadData = nullptr;
+	Target.CommonItem.PayloadWordCapacity = 0;
+	FCommonItemNetSerializer::CopyItem(reinterpret_cast<const QuantizedType*>(Args.Source)->CommonItem, Target.CommonItem);
+}
+
+void FCommonItemStackNetSerializer::FreeDynamicState(FNetSerializationContext& Context, const FNetFreeDynamicStateArgs& Args)
+{
+	FCommonItemNetSerializer::FreeItem(reinterpret_cast<QuantizedType*>(Args.Source)->CommonItem);
+}
+
+/************************************************************************/
+/* Registration                                                         */
+/************************************************************************/
+
+static const FName PropertyNetSerializerRegistry_NAME_CommonItem("CommonItem");
+static const FName PropertyNetSerializerRegistry_NAME_CommonItemStack("CommonItemStack");
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_CommonItem, FCommonItemNetSerializer);
+UE_NET_IMPLEMENT_NAMED_STRUCT_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_CommonItemStack, FCommonItemStackNetSerializer);
+
+// Replaces the last resort serializer, which falls back to NetSerialize().
+class FCommonItemNetSerializerRegistryDelegates final : private FNetSerializerRegistryDelegates
+{
+public:
+
+	virtual ~FCommonItemNetSerializerRegistryDelegates()
+	{
+		UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_CommonItem);
+		UE_NET_UNREGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_CommonItemStack);
+	}
+
+private:
+
+	virtual void OnPreFreezeNetSerializerRegistry() override
+	{
+		UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_CommonItem);
+		UE_NET_REGISTER_NETSERIALIZER_INFO(PropertyNetSerializerRegistry_NAME_CommonItemStack);
+	}
+};
+
+static FCommonItemNetSerializerRegistryDelegates CommonItemNetSerializerRegistryDelegates;
+
+} // namespace UE::Net
+
+#endif // UE_WITH_IRIS
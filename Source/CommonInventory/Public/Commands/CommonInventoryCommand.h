@@ -11,6 +11,8 @@ class AActor;
 class FArchive;
 class UCommonInventoryComponent;
 
+struct FCommonInventoryState;
+
 /** Command execution polices. */
 enum class ECommonInventoryCommandExecutionPolicy
 {
@@ -18,11 +20,12 @@ enum class ECommonInventoryCommandExecutionPolicy
 	Predictive,		// Only the server and local clients can initiate a command.
 };
 
-/**  */
+/** Command execution results. */
 enum class ECommonInventoryCommandExecutionResult
 {
-	Success,	// 
-	Failure,	// 
+	Success,	// The command has been executed.
+	Failure,	// The command has been rejected.
+	Queued,		// The command is waiting for the server.
 };
 
 /**
@@ -48,6 +51,20 @@ struct FCommonInventoryCommandExecutionContext
 	/**  */
 	UPROPERTY()
 	FVariadicStruct CommandPayload;
+
+	/** Whether the command has been received from an autonomous proxy, so the components must be checked against AuthOwner. */
+	bool bIsRemoteRequest = false;
+};
+
+/**
+ * Commands with a typed payload, declared as FPayload along with non-virtual CanExecuteTyped() and ExecuteTyped().
+ * FCommonInventoryCommandController::ExecuteCommand<T>() calls them directly on the server, so the payload is never type-erased there.
+ */
+template<typename T>
+concept CCommonInventoryTypedCommand = requires(const T& Command, FCommonInventoryCommandExecutionContext& ExecutionContext, const typename T::FPayload& Payload)
+{
+	{ Command.CanExecuteTyped(ExecutionContext, Payload) } -> std::same_as<ECommonInventoryCommandExecutionResult>;
+	{ Command.ExecuteTyped(ExecutionContext, Payload) } -> std::same_as<ECommonInventoryCommandExecutionResult>;
 };
 
 /**
@@ -60,6 +77,26 @@ class COMMONINVENTORY_API UCommonInventoryCommand : public UObject
 
 	UCommonInventoryCommand();
 
+public:
+
+	/** Returns who can initiate the command. */
+	ECommonInventoryCommandExecutionPolicy GetExecutionPolicy() const { return ExecutionPolicy; }
+
+	/** Whether the command accesses anything beyond the components from the context, so it can't be executed on workers. Non-native commands always require it. */
+	bool RequiresGameThread() const { return bRequiresGameThread || !GetClass()->HasAnyClassFlags(CLASS_Native); }
+
+	/** Returns the stable id sent instead of the class, which is a hash of the class path. Zero if the class isn't a native non-abstract command. */
+	static uint32 GetCommandId(const UClass* InCommandClass);
+
+	/** Returns the default object of the native command by its id, or nullptr. */
+	static const UCommonInventoryCommand* FindCommandById(uint32 InCommandId);
+
+	/** Returns the checksum of all the native command ids, which the server and the client compare at the registry handshake. */
+	static uint32 GetCommandTableChecksum();
+
+	/** Rebuilds the command ids on the next use, e.g. once a module with new native commands is loaded. */
+	static void InvalidateCommandTable();
+
 public: // Interface
 
 	/**  */
@@ -71,12 +108,22 @@ public: // Interface
 	/**  */
 	virtual ECommonInventoryCommandExecutionResult Execute(FCommonInventoryCommandExecutionContext& ExecutionContext) const;
 
-	/**  */
+	/** Optional. Mispredicted slots are restored automatically through FCommonInventoryPredictionScope. */
 	virtual ECommonInventoryCommandExecutionResult Rollback(FCommonInventoryCommandExecutionContext& ExecutionContext) const;
-	// @TODO: Theoretically we can automatically track changes and reapply them instead of requiring to implement Rollback().
+
+protected:
+
+	/** Returns the state of the component to mutate, or nullptr. */
+	static FCommonInventoryState* GetMutableInventoryState(UCommonInventoryComponent* InComponent);
+
+	/** Whether the command may mutate the component. Remote requests are limited by UCommonInventoryComponent::CanBeAccessedBy(). */
+	static bool CanAccessInventory(const FCommonInventoryCommandExecutionContext& ExecutionContext, const UCommonInventoryComponent* InComponent);
 
 protected:
 
 	/**  */
 	ECommonInventoryCommandExecutionPolicy ExecutionPolicy;
+
+	/** Commands are executed on the game thread unless they clear it, which is only safe if they touch nothing but the source and target components. */
+	bool bRequiresGameThread = true;
 };
@@ -3,20 +3,39 @@
 #pragma once
 
 #include "Commands/CommonInventoryCommand.h"
+#include "CommonInventoryState.h"
+#include "Delegates/Delegate.h"
+#include "Templates/SubclassOf.h"
+#include "UObject/WeakObjectPtr.h"
 
 #include "CommonInventoryCommandController.generated.h"
 
 /**
- * 
+ * A single command sent from the client to the server.
  */
 USTRUCT()
 struct FCommonInventoryCommandBunch
 {
 	GENERATED_BODY()
 
-	/**  */
+	/** Returns the command to execute, or nullptr if it isn't known or can't be instantiated. */
+	COMMONINVENTORY_API const UCommonInventoryCommand* ResolveCommand() const;
+
+	/** Stable id of the native command class, see UCommonInventoryCommand::GetCommandId(). */
+	UPROPERTY()
+	uint32 CommandId = 0;
+
+	/** Non-native commands, e.g. blueprints, are sent by class instead of CommandId. */
 	UPROPERTY()
 	TSubclassOf<UCommonInventoryCommand> CommandClass;
+
+	/**  */
+	UPROPERTY()
+	TObjectPtr<UCommonInventoryComponent> SourceComponent = nullptr;
+
+	/**  */
+	UPROPERTY()
+	TObjectPtr<UCommonInventoryComponent> TargetComponent = nullptr;
 	
 	/**  */
 	UPROPERTY()
@@ -26,7 +45,7 @@ struct FCommonInventoryCommandBunch
 	UPROPERTY()
 	float Timestamp = 0.f;
 
-	/**  */
+	/** Sequence number derived from FCommonInventoryCommandBatch::FirstCmdSeq on the wire. */
 	UPROPERTY(NotReplicated)
 	uint32 CmdSeq = 0;
 
@@ -35,6 +54,40 @@ struct FCommonInventoryCommandBunch
 	uint32 CmdFrame = 0;
 };
 
+/**
+ * Commands accumulated between flushes and sent in a single RPC.
+ */
+USTRUCT()
+struct FCommonInventoryCommandBatch
+{
+	GENERATED_BODY()
+
+	/** Sequence number of the first bunch. Following bunches are numbered consecutively. */
+	UPROPERTY()
+	uint32 FirstCmdSeq = 0;
+
+	/**  */
+	UPROPERTY()
+	TArray<FCommonInventoryCommandBunch> Bunches;
+};
+
+/**
+ * Coalesced server response for a batch.
+ */
+USTRUCT()
+struct FCommonInventoryCommandAck
+{
+	GENERATED_BODY()
+
+	/** The last executed sequence number. All the previous commands are acknowledged as well. */
+	UPROPERTY()
+	uint32 LastCmdSeq = 0;
+
+	/** Sequence numbers of commands rejected by the server. Empty in the common case. */
+	UPROPERTY()
+	TArray<uint32> RejectedCmdSeqs;
+};
+
 // Problems that GAS's prediction implementation is trying to solve:
 // "Can I do this?" Basic protocol for prediction.
 // "Undo" How to undo side effects when a prediction fails.
@@ -53,23 +106,120 @@ struct FCommonInventoryCommandBunch
 // https://vercidium.com/blog/lag-compensation/
 
 /**
+ * Executes commands on the server and queues commands on autonomous proxies.
  * 
+ * Queued commands are flushed as a single batch each CommandQueueFlushRate and executed by the server in the sequence order.
+ * The server responds with a single coalesced acknowledgment per batch.
+ * 
+ * Predictive commands are also executed locally while slots are captured into a fixed-size ring buffer keyed by CmdSeq.
+ * Acknowledged predictions are confirmed, while a rejection restores the slots and replays the later predictions.
  */
 struct COMMONINVENTORY_API FCommonInventoryCommandController
 {
 	FCommonInventoryCommandController(const AActor* InAuthorizedOwner);
 
-	/**  */
-	template<typename T, typename... Args>
-	ECommonInventoryCommandExecutionResult ExecuteCommand(Args... InArgs)
+	/** Executes the command on the server or queues it for the server on autonomous proxies. */
+	template<typename T> requires (!CCommonInventoryTypedCommand<T>)
+	ECommonInventoryCommandExecutionResult ExecuteCommand(UCommonInventoryComponent* InSourceComponent, UCommonInventoryComponent* InTargetComponent = nullptr, FVariadicStruct InPayload = FVariadicStruct())
 	{
 		static_assert(std::derived_from<T, UCommonInventoryCommand>);
 
-		return ECommonInventoryCommandExecutionResult::Failure;
+		return ExecuteCommand(T::StaticClass(), InSourceComponent, InTargetComponent, MoveTemp(InPayload));
 	}
 
+	/** Executes the typed command on the server without type erasure or virtual calls, or queues it for the server on autonomous proxies. */
+	template<CCommonInventoryTypedCommand T>
+	ECommonInventoryCommandExecutionResult ExecuteCommand(UCommonInventoryComponent* InSourceComponent, UCommonInventoryComponent* InTargetComponent = nullptr, typename T::FPayload InPayload = typename T::FPayload())
+	{
+		static_assert(std::derived_from<T, UCommonInventoryCommand>);
+
+		if (AuthOwner->HasAuthority())
+		{
+			FCommonInventoryCommandExecutionContext ExecutionContext = MakeExecutionContext(InSourceComponent, InTargetComponent);
+			const T& Command = *GetDefault<T>();
+
+			// Qualified calls are bound statically.
+			if (Command.T::CanExecuteTyped(ExecutionContext, InPayload) != ECommonInventoryCommandExecutionResult::Success)
+			{
+				return ECommonInventoryCommandExecutionResult::Failure;
+			}
+
+			return Command.T::ExecuteTyped(ExecutionContext, InPayload);
+		}
+
+		// Predictions are replayed and sent to the server, so the payload has to be stored.
+		return ExecuteCommand(T::StaticClass(), InSourceComponent, InTargetComponent, FVariadicStruct::Make(MoveTemp(InPayload)));
+	}
+
+	/** Executes the command on the server or queues it for the server on autonomous proxies. */
+	ECommonInventoryCommandExecutionResult ExecuteCommand(TSubclassOf<UCommonInventoryCommand> InCommandClass, UCommonInventoryComponent* InSourceComponent, UCommonInventoryComponent* InTargetComponent, FVariadicStruct InPayload);
+
+public: // Networking
+
+	/** [Client] Whether any commands are waiting for the next flush. */
+	bool HasQueuedCommands() const { return !QueuedCommands.IsEmpty(); }
+
+	/** [Client] Moves queued commands into the batch. Returns false if there is nothing to send. */
+	bool FlushQueuedCommands(FCommonInventoryCommandBatch& OutBatch);
+
+	/** [Server] Executes the batch in the sequence order. Returns false if the batch violates the protocol. */
+	bool ExecuteBatch(const FCommonInventoryCommandBatch& InBatch, FCommonInventoryCommandAck& OutAck);
+
+	/** [Client] Handles the server response. */
+	void AcknowledgeCommands(const FCommonInventoryCommandAck& InAck);
+
+	/** [Client] Called once the first command is queued after a flush. Allows the owner to schedule the next flush. */
+	FSimpleDelegate OnCommandQueued;
+
+private:
+
+	FCommonInventoryCommandExecutionContext MakeExecutionContext(UCommonInventoryComponent* InSourceComponent, UCommonInventoryComponent* InTargetComponent) const;
+
+	ECommonInventoryCommandExecutionResult ExecuteCommandInternal(const UCommonInventoryCommand& InCommand, FCommonInventoryCommandExecutionContext& InContext) const;
+
+	/** A locally executed command waiting for the server. */
+	struct FPredictedCommand
+	{
+		const UCommonInventoryCommand* Command = nullptr;
+		TWeakObjectPtr<UCommonInventoryComponent> SourceComponent;
+		TWeakObjectPtr<UCommonInventoryComponent> TargetComponent;
+		FVariadicStruct CommandPayload;
+
+		/** Slots before the prediction in the capture order. */
+		TArray<FCommonInventoryPredictedSlot> Snapshots;
+
+		/** Zero if the entry is free. */
+		uint32 CmdSeq = 0;
+	};
+
+	/** Maximum number of unacknowledged predictions. Must be a power of two. */
+	static constexpr uint32 PredictionBufferSize = 32;
+
+	FPredictedCommand& GetPredictedCommand(uint32 InCmdSeq) { return PredictionBuffer[InCmdSeq & (PredictionBufferSize - 1)]; }
+
+	/** Executes the command locally and captures the slots. */
+	bool Predict(FPredictedCommand& InPrediction);
+
+	/** Restores the captured slots in the reverse order. */
+	void Undo(FPredictedCommand& InPrediction);
+
 private:
 
 	/** Raw pointer to the authorized owner. */
 	const AActor* AuthOwner = nullptr;
+
+	/** Commands waiting for the next flush. */
+	TArray<FCommonInventoryCommandBunch> QueuedCommands;
+
+	/** [Client] The next sequence number to assign. */
+	uint32 NextCmdSeq = 1;
+
+	/** [Client] The last sequence number acknowledged by the server. */
+	uint32 LastAckedCmdSeq = 0;
+
+	/** [Server] The last executed sequence number. */
+	uint32 LastExecutedCmdSeq = 0;
+
+	/** [Client] Ring buffer of unacknowledged predictions. Entries are reused without reallocation. */
+	TArray<FPredictedCommand> PredictionBuffer;
 };
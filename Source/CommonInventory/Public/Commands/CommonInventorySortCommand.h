@@ -0,0 +1,44 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "Commands/CommonInventoryCommand.h"
+
+#include "CommonInventorySortCommand.generated.h"
+
+/**
+ * Payload of UCommonInventorySortCommand.
+ */
+USTRUCT(meta = (Hidden))
+struct FCommonInventorySortCommandPayload
+{
+	GENERATED_BODY()
+
+	/** Whether to merge stacks with identical payloads up to MaxStackSize. */
+	UPROPERTY()
+	bool bMergeStacks = true;
+};
+
+/**
+ * Sorts and stacks items of the source component as a single predicted command. See FCommonInventoryState::SortItems().
+ */
+UCLASS(Hidden)
+class COMMONINVENTORY_API UCommonInventorySortCommand : public UCommonInventoryCommand
+{
+	GENERATED_BODY()
+
+	UCommonInventorySortCommand();
+
+public: // Typed
+
+	using FPayload = FCommonInventorySortCommandPayload;
+
+	ECommonInventoryCommandExecutionResult CanExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const;
+	ECommonInventoryCommandExecutionResult ExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const;
+
+public: // Interface
+
+	virtual void InitializePayload(FVariadicStruct& OutPayload) const override;
+	virtual ECommonInventoryCommandExecutionResult CanExecute(FCommonInventoryCommandExecutionContext& ExecutionContext) const override;
+	virtual ECommonInventoryCommandExecutionResult Execute(FCommonInventoryCommandExecutionContext& ExecutionContext) const override;
+};
@@ -0,0 +1,48 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "Commands/CommonInventoryCommand.h"
+
+#include "CommonInventoryTransferCommand.generated.h"
+
+/**
+ * Payload of UCommonInventoryTransferCommand.
+ */
+USTRUCT(meta = (Hidden))
+struct FCommonInventoryTransferCommandPayload
+{
+	GENERATED_BODY()
+
+	/** Unique slots of the source component to move. */
+	UPROPERTY()
+	TArray<int32> SourceSlots;
+
+	/** Amounts per slot, or empty to move whole stacks. */
+	UPROPERTY()
+	TArray<int32> Amounts;
+};
+
+/**
+ * Moves items from the source component into the target component as a single predicted command. See FCommonInventoryState::TransferItems().
+ */
+UCLASS(Hidden)
+class COMMONINVENTORY_API UCommonInventoryTransferCommand : public UCommonInventoryCommand
+{
+	GENERATED_BODY()
+
+	UCommonInventoryTransferCommand();
+
+public: // Typed
+
+	using FPayload = FCommonInventoryTransferCommandPayload;
+
+	ECommonInventoryCommandExecutionResult CanExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const;
+	ECommonInventoryCommandExecutionResult ExecuteTyped(FCommonInventoryCommandExecutionContext& ExecutionContext, const FPayload& Payload) const;
+
+public: // Interface
+
+	virtual void InitializePayload(FVariadicStruct& OutPayload) const override;
+	virtual ECommonInventoryCommandExecutionResult CanExecute(FCommonInventoryCommandExecutionContext& ExecutionContext) const override;
+	virtual ECommonInventoryCommandExecutionResult Execute(FCommonInventoryCommandExecutionContext& ExecutionContext) const override;
+};
@@ -0,0 +1,135 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "Containers/Array.h"
+#include "UObject/PrimaryAssetId.h"
+
+#include "CommonInventoryGrid.generated.h"
+
+/**
+ * Shape of a spatial item within a bounding rectangle of up to 8x8 cells.
+ * Items use the footprint found in their RegistryCustomData, custom data types can derive from it. Items without one occupy a single cell.
+ *
+ * @Note: The anchor is the top-left cell, so it must be a part of the shape.
+ */
+USTRUCT(BlueprintType)
+struct COMMONINVENTORY_API FCommonInventoryFootprint
+{
+	GENERATED_BODY()
+
+	FCommonInventoryFootprint() = default;
+
+	FCommonInventoryFootprint(uint8 InWidth, uint8 InHeight, uint64 InShape = 0)
+		: Width(InWidth), Height(InHeight), Shape(InShape)
+	{
+	}
+
+	bool operator==(const FCommonInventoryFootprint&) const = default;
+
+public:
+
+	/** The maximum width and height of a footprint. */
+	static constexpr int32 MaxExtent = 8;
+
+	/** Returns the footprint of the item from the registry. */
+	static FCommonInventoryFootprint FindForItem(FPrimaryAssetId InPrimaryAssetId);
+
+	/** Whether the footprint has a valid size and an anchor. */
+	bool IsValid() const;
+
+	/** Returns the row-major occupancy bitmap, where bit (Row * MaxExtent + Column) marks an occupied cell. */
+	uint64 GetBits() const;
+
+	/** Returns the occupancy of the row, where bit N marks an occupied column N. */
+	uint8 GetRowBits(int32 InRow) const { return static_cast<uint8>(GetBits() >> (InRow * MaxExtent)); }
+
+	/** Returns the number of occupied cells. */
+	int32 GetNumCells() const { return FMath::CountBits(GetBits()); }
+
+public:
+
+	/** The number of columns of the bounding rectangle. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Footprint", meta = (ClampMin = 1, ClampMax = 8))
+	uint8 Width = 1;
+
+	/** The number of rows of the bounding rectangle. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Footprint", meta = (ClampMin = 1, ClampMax = 8))
+	uint8 Height = 1;
+
+	/** Optional shape within the bounding rectangle as a bitmap from GetBits(). Zero occupies the whole rectangle. */
+	UPROPERTY(EditAnywhere, Category = "Footprint")
+	uint64 Shape = 0;
+};
+
+/**
+ * Occupancy bitmap of a spatial inventory, where each row of up to 64 cells is a single word.
+ * Fit tests are a few word-wise operations per row of the footprint, regardless of the grid width.
+ * Cells covered by an item refer to its anchor cell, so any cell can be resolved into the item.
+ */
+class COMMONINVENTORY_API FCommonInventoryGrid
+{
+public:
+
+	/** The maximum number of columns. */
+	static constexpr int32 MaxWidth = 64;
+
+	/** Allocates empty cells. */
+	void Initialize(int32 InWidth, int32 InHeight);
+
+	/** Frees all the cells. */
+	void Reset();
+
+	/** Returns the number of columns. */
+	int32 GetWidth() const { return Width; }
+
+	/** Returns the number of rows. */
+	int32 GetHeight() const { return Height; }
+
+	/** Returns the number of cells. */
+	int32 Num() const { return Width * Height; }
+
+	/** Returns the number of cells not covered by any item. */
+	int32 GetNumFreeCells() const { return NumFreeCells; }
+
+	/** Whether the cell is covered by any item. */
+	bool IsOccupied(int32 InCell) const { return (Rows[InCell / Width] >> (InCell % Width)) & 1; }
+
+	/** Returns the anchor cell of the item covering the cell, or INDEX_NONE. */
+	int32 GetAnchor(int32 InCell) const { return Anchors.IsValidIndex(InCell) ? Anchors[InCell] : INDEX_NONE; }
+
+	/** Whether the footprint anchored at the cell is within the grid and doesn't overlap any item except the one anchored at InIgnoredAnchor. */
+	bool CanPlace(const FCommonInventoryFootprint& InFootprint, int32 InCell, int32 InIgnoredAnchor = INDEX_NONE) const;
+
+	/** Returns the lowest cell the footprint can be anchored at, or INDEX_NONE. */
+	int32 FindFirstFit(const FCommonInventoryFootprint& InFootprint) const;
+
+	/** Covers cells of the footprint anchored at the cell. The footprint must fit. */
+	void Place(const FCommonInventoryFootprint& InFootprint, int32 InCell);
+
+	/** Frees cells of the item anchored at the cell. Doesn't depend on the footprint, which might have changed since the placement. */
+	void Remove(int32 InAnchor);
+
+private:
+
+	/** Returns the occupancy of the footprint row shifted to the column. */
+	static uint64 GetRowMask(const FCommonInventoryFootprint& InFootprint, int32 InRow, int32 InColumn) { return static_cast<uint64>(InFootprint.GetRowBits(InRow)) << InColumn; }
+
+	/** Whether the footprint anchored at the cell is within the grid. */
+	bool IsWithinBounds(const FCommonInventoryFootprint& InFootprint, int32 InCell) const;
+
+	/** Sets anchors of the cells covered by the footprint. */
+	void SetAnchors(const FCommonInventoryFootprint& InFootprint, int32 InCell, int32 InAnchor);
+
+private:
+
+	/** Occupancy of each row. Bits beyond the width are always set. */
+	TArray<uint64> Rows;
+
+	/** Anchor cells of the covering items. */
+	TArray<int32> Anchors;
+
+	int32 Width = 0;
+	int32 Height = 0;
+	int32 NumFreeCells = 0;
+};
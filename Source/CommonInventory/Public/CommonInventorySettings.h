@@ -86,6 +86,10 @@ public: //Inventory Registry
 	UPROPERTY(Config, EditDefaultsOnly, Category = "InventoryRegistry", meta = (ConfigRestartRequired = true))
 	bool bRegisterNetworkCustomVersion = true;
 
+	/** Whether the cooked registry state should be loaded on a worker thread while the engine continues initialization. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "InventoryRegistry", meta = (ConfigRestartRequired = true))
+	bool bLoadRegistryAsynchronously = false;
+
 #if WITH_EDITORONLY_DATA
 
 	/** Whether to validate complying of names with the naming convention pattern. */
@@ -120,6 +124,60 @@ public: // Networking
 	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking")
 	int32 InventoryCapacityLimit = 256;
 
+	/** The number of slots sent per net update to a connection which has just become relevant to an inventory. Zero sends all the slots at once. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking", meta = (ClampMin = 0))
+	int32 InitialSyncItemsPerUpdate = 64;
+
+	/** Paced initial syncs speed up to deliver all the slots within this time. Zero disables the limit. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking", meta = (Units = "s", ClampMin = 0))
+	float InitialSyncLatencyBudget = 1.f;
+
+	/** Whether the server executes commands touching disjoint inventories on task graph workers. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking")
+	bool bExecuteCommandsInParallel = true;
+
+	/** Builds with network checksums verify archetypes once per connection. Additionally sends the record checksum with every Nth replicated item. Zero disables per-item sampling. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking", meta = (ClampMin = 0))
+	int32 NetworkChecksumSamplingInterval = 64;
+
+public: // Prefetching
+
+	/** Responsible for registering connections to inventories with ECommonInventoryReplicationMode::Auto ahead of interaction. */
+	UPROPERTY(Config, EditDefaultsOnly, NoClear, Category = "Networking|Prefetching", meta = (MetaClass = "/Script/CommonInventory.CommonInventoryPrefetcher", ConfigRestartRequired = true))
+	FSoftClassPath PrefetcherClassName = FSoftClassPath(TEXT("/Script/CommonInventory.CommonInventoryPrefetcher"));
+
+	/** How often the prefetcher re-scores inventories for each player. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (Units = "s", ClampMin = 0.05))
+	float PrefetchUpdateInterval = .25f;
+
+	/** Inventories beyond this distance from the player viewpoint aren't prefetched unless recently interacted with. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (Units = "cm", ClampMin = 0))
+	float PrefetchRadius = 1500.f;
+
+	/** Half-angle of the view cone which prioritizes inventories in front of the player. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (Units = "deg", ClampMin = 0, ClampMax = 180))
+	float PrefetchViewConeAngle = 45.f;
+
+	/** How long an interaction with an inventory keeps boosting its score. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (Units = "s", ClampMin = 0))
+	float PrefetchInteractionMemory = 30.f;
+
+	/** The estimated number of bytes the prefetcher is allowed to initiate per second for each connection. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (Units = "Bytes", ClampMin = 1))
+	int32 PrefetchBandwidthBudget = 4096;
+
+	/** The estimated number of bytes of an occupied slot used to charge the bandwidth budget. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (Units = "Bytes", ClampMin = 1))
+	int32 PrefetchBytesPerItem = 16;
+
+	/** The maximum number of inventories prefetched for a single connection at the same time. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (ClampMin = 0))
+	int32 MaxPrefetchedInventories = 8;
+
+	/** How long a prefetched inventory stays registered after it stops being relevant. */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Networking|Prefetching", meta = (Units = "s", ClampMin = 0))
+	float PrefetchEvictionDelay = 5.f;
+
 public:
 
 	virtual FName GetCategoryName() const override { return NAME_Game; }
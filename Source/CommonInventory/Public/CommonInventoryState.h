@@ -3,12 +3,28 @@
 #pragma once
 
 #include "Containers/Array.h"
+#include "Containers/BitArray.h"
+#include "Containers/Map.h"
+#include "Containers/SparseArray.h"
+#include "CommonInventoryGrid.h"
 #include "CommonInventoryTypes.h"
 #include "Net/Serialization/FastArraySerializer.h"
+#include "Templates/Function.h"
+#include "Templates/SharedPointer.h"
+#include "UObject/ObjectKey.h"
 #include "UObject/PrimaryAssetId.h"
 
 #include "CommonInventoryState.generated.h"
 
+class FCommonInventoryStateSnapshot;
+class UCommonInventoryRegistry;
+
+struct FCommonInventoryAggregates;
+struct FCommonInventoryPredictedSlot;
+struct FCommonInventoryRegistryRecord;
+struct FCommonInventoryState;
+struct FCommonInventoryStateChangeTracker;
+
 /**
  * Internal item implementation for UCommonInventoryComponent.
  *
@@ -43,6 +59,9 @@ public:
 	/** Whether the item redirects onto another item. */
 	bool IsRedirector() const { return PrimaryAssetId == FCommonInventoryRedirectorItem::GetPrimaryAssetId(); }
 
+	/** Whether the slot doesn't hold any item. */
+	bool IsEmpty() const { return !PrimaryAssetId.IsValid(); }
+
 	/**  */
 	int32 GetOffset() const { return ReplicationID; }
 
@@ -53,6 +72,22 @@ public: // StructOpsTypeTraits
 
 	COMMONINVENTORY_API bool Serialize(FArchive& Ar);
 	COMMONINVENTORY_API bool NetSerialize(FArchive& Ar, UPackageMap*, bool& bOutSuccess);
+
+private:
+
+	friend struct FCommonInventoryState;
+
+	// Empty slots reuse StackSize as an intrusive link to the next empty slot, which keeps the item within 64 bytes.
+	int32 GetNextFreeSlot() const { return StackSize; }
+	void SetNextFreeSlot(int32 InSlot) { StackSize = InSlot; }
+
+	/** Resets the slot to the empty state. */
+	void Empty()
+	{
+		StackSize = 0;
+		PrimaryAssetId = FPrimaryAssetId();
+		ItemPayload.Reset();
+	}
 };
 
 template<>
@@ -62,8 +97,8 @@ struct TStructOpsTypeTraits<FCommonInventoryItem> : public TStructOpsTypeTraitsB
 	{
 		WithCopy = true,
 		//WithIdenticalViaEquality = true,
-		//WithSerializer = true,
-		//WithNetSerializer = true,
+		WithSerializer = true,
+		WithNetSerializer = true,
 		WithNetSharedSerialization = true, // By definition, can't contain data per connection.
 	};
 };
@@ -84,6 +119,7 @@ enum class ECommonInventoryStateFlags : uint16
 	Automatic		= 1 << 0, // The Chunk will implicitly reserve capacity when it's exhausted.
 	StackUnlimited	= 1 << 1, // Ignore MaxStackSize restrictions.
 	NoDuplicates	= 1 << 2, // Disallow duplicates.
+	Spatial			= 1 << 3, // Items occupy footprints on a grid, see FCommonInventoryState::InitializeSpatial().
 
 	All			= (1 << 8) - 1,
 };
@@ -102,26 +138,236 @@ struct COMMONINVENTORY_API FCommonInventoryState : public FFastArraySerializer
 
 public:
 
-	/**  */
-	void Initialize(uint32 InInitialCapacity);
+	/** Allocates InInitialCapacity empty slots. */
+	void Initialize(uint32 InInitialCapacity, ECommonInventoryStateFlags InFlags = ECommonInventoryStateFlags::NoFlags);
 
-	/**  */
+	/** Allocates a grid of InWidth x InHeight empty cells, where each cell is a slot. The spatial state can't grow automatically. */
+	void InitializeSpatial(int32 InWidth, int32 InHeight, ECommonInventoryStateFlags InFlags = ECommonInventoryStateFlags::NoFlags);
+
+	/** Releases all the slots. */
 	void Deinitialize();
 
+public: // Slots
+
+	/** Returns the number of occupied slots. */
+	int32 Num() const { return static_cast<int32>(Size); }
+
+	/** Returns the number of allocated slots. */
+	int32 GetCapacity() const { return static_cast<int32>(Capacity); }
+
+	/** Whether all the slots are occupied and the state can't grow. */
+	bool IsFull() const { return IsSpatial() ? Grid.GetNumFreeCells() == 0 : FreeSlot == INDEX_NONE && !EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::Automatic); }
+
+	/** Returns the item in the slot. The stack size of empty slots is meaningless. */
+	const FCommonInventoryItem& GetItem(int32 InSlot) const { return Items[InSlot]; }
+
+	/** Returns all the slots including empty ones. */
+	TConstArrayView<FCommonInventoryItem> GetItems() const { return Items; }
+
+	/** Whether any slot holds the item. */
+	bool ContainsItem(FPrimaryAssetId InPrimaryAssetId) const { return SlotIndex.Contains(InPrimaryAssetId); }
+
+	/** Returns the first slot holding the item or INDEX_NONE. */
+	int32 FindItem(FPrimaryAssetId InPrimaryAssetId) const;
+
+	/** Returns all slots holding the item in no particular order. */
+	TConstArrayView<int32> FindItems(FPrimaryAssetId InPrimaryAssetId) const;
+
+	/** Returns the first slot holding the item that can accept more items according to MaxStackSize, or INDEX_NONE. */
+	int32 FindNonFullStack(FPrimaryAssetId InPrimaryAssetId) const;
+
+	/** [Server, Predictive] Places the item into a free slot in O(1) without shifting other slots, or the first fit in the spatial mode. Returns INDEX_NONE if the state is full or disallows duplicates. */
+	int32 AddItem(const FCommonItem& InItem, int32 InStackSize);
+
+	/** [Server, Predictive] Empties the slot in O(1). The slot is reused by the next addition. */
+	bool RemoveItem(int32 InSlot);
+
+	/** [Server, Predictive] Changes the stack size of the occupied slot. */
+	bool SetStackSize(int32 InSlot, int32 InStackSize);
+
+	/**
+	 * [Server, Predictive] Sorts items by the registry order of archetypes and names, and optionally merges stacks with identical payloads up to MaxStackSize.
+	 * Payloads of the same item are grouped in the slot order. The layout is computed in a single pass and only changed slots are dirtied.
+	 * Items are packed into the lowest slots, or placed at first fits in the spatial mode. Returns false without any changes if the items can't be laid out.
+	 */
+	bool SortItems(bool bMergeStacks = true);
+
+	/** Whether the slots can be moved into the target state, see TransferItems(). */
+	bool CanTransferItems(const FCommonInventoryState& InTarget, TConstArrayView<int32> InSourceSlots, TConstArrayView<int32> InAmounts = TConstArrayView<int32>()) const;
+
+	/**
+	 * [Server, Predictive] Moves the amounts of the slots into the target state, filling its stacks with identical payloads first. Whole stacks are moved if InAmounts is empty.
+	 * Capacity, stacking and duplicates are validated against both states up front, so either everything is moved or nothing. The target grows at most once.
+	 */
+	bool TransferItems(FCommonInventoryState& InTarget, TConstArrayView<int32> InSourceSlots, TConstArrayView<int32> InAmounts = TConstArrayView<int32>());
+
+	/** [Server] Reserves at least InCapacity slots. */
+	void Reserve(int32 InCapacity);
+
+	/**
+	 * [Client] Restores the slot captured by FCommonInventoryPredictionScope. Predicted mutations are local, so the server never resends an unchanged slot.
+	 * If replication has updated the slot since the capture, the replicated item is already in place and the slot is kept as is.
+	 */
+	void RestoreSlot(const FCommonInventoryPredictedSlot& InSnapshot);
+
+	/** [Client] Returns the counter of replicated updates, which stamps the captured and the replicated slots. */
+	uint32 GetReplicationRevision() const { return ReplicationRevision; }
+
+	/** [Client] Whether the initial sync is still in progress and only some of the slots have arrived. */
+	bool IsPartiallySynced() const { return Items.Num() < NumSyncedSlotsExpected; }
+
+	/** [Client] Returns the initial sync progress in the range [0, 1]. */
+	float GetSyncProgress() const { return NumSyncedSlotsExpected > 0 ? FMath::Min(static_cast<float>(Items.Num()) / NumSyncedSlotsExpected, 1.f) : 1.f; }
+
+	/** [Server] Whether any connection is still in the paced initial sync. */
+	bool HasPendingInitialSync() const { return !InitialSyncCursors.IsEmpty(); }
+
+	/** Sets the tracker fed by mutations and replication. The tracker must outlive the state. */
+	void SetChangeTracker(FCommonInventoryStateChangeTracker* InChangeTracker) { ChangeTracker = InChangeTracker; }
+
+	/** Sets the aggregates fed by mutations and replication, which are rebuilt from the current slots. The aggregates must outlive the state. */
+	void SetAggregates(FCommonInventoryAggregates* InAggregates);
+
+	/** Sets the callback invoked whenever the state is marked for replication, e.g. to mark push-model properties dirty. Might be called on workers. */
+	void SetOnReplicationDirty(FSimpleDelegate&& InDelegate) { OnReplicationDirty = MoveTemp(InDelegate); }
+
+	/** Captures an immutable snapshot of the slots, which can be serialized on any thread. Chunks unchanged since the previous snapshot are shared with it. */
+	TSharedRef<const FCommonInventoryStateSnapshot, ESPMode::ThreadSafe> MakeSnapshot() const;
+
+	/**
+	 * Saves a compact self-describing handoff, e.g. across seamless travel or to another server of the cluster.
+	 * Items are encoded as RepIndices if InTargetChecksum from UCommonInventoryRegistry::GetHandoffChecksum() of the destination matches the local one, otherwise by names.
+	 */
+	bool SaveHandoff(TArray<uint8>& OutData, uint32 InTargetChecksum) const;
+
+	/** Restores the slots from SaveHandoff(), replacing the current ones. */
+	bool LoadHandoff(TConstArrayView<uint8> InData);
+
+public: // Spatial
+
+	/** Whether items occupy footprints on a grid. */
+	bool IsSpatial() const { return EnumHasAnyFlags(InternalFlags, ECommonInventoryStateFlags::Spatial); }
+
+	/** Returns the occupancy of the spatial grid. Slots are cells in the row-major order. */
+	const FCommonInventoryGrid& GetGrid() const { return Grid; }
+
+	/** Returns the slot holding the item which covers the cell, or INDEX_NONE. Only anchor cells hold items, covered cells remain empty. */
+	int32 GetAnchorSlot(int32 InCell) const { return IsSpatial() ? Grid.GetAnchor(InCell) : (Items.IsValidIndex(InCell) && !Items[InCell].IsEmpty() ? InCell : INDEX_NONE); }
+
+	/** Whether the item can be anchored at the cell. Cells covered by InIgnoredSlot are considered free, e.g. to move the item. */
+	bool CanPlaceItem(FPrimaryAssetId InPrimaryAssetId, int32 InCell, int32 InIgnoredSlot = INDEX_NONE) const;
+
+	/** Returns the lowest cell the item can be anchored at, or INDEX_NONE. */
+	int32 FindFirstFit(FPrimaryAssetId InPrimaryAssetId) const;
+
+	/** [Server, Predictive] Anchors the item at the cell. Returns INDEX_NONE if the footprint doesn't fit or the state disallows duplicates. */
+	int32 AddItemAt(const FCommonItem& InItem, int32 InStackSize, int32 InCell);
+
+	/** [Server, Predictive] Moves the item into another cell, which may overlap its current footprint. */
+	bool MoveItem(int32 InSlot, int32 InCell);
+
+	/** [Server, Predictive] Packs items towards the lowest cells with larger footprints first. Only moved items are dirtied. Returns false without any changes if the items don't fit. */
+	bool CompactGrid();
+
 public: // StructOpsTypeTraits
 
 	bool Serialize(FArchive& Ar);
 
-	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms);
+
+	/** Limits items written for connections in the initial sync. */
+	template<typename Type, typename SerializerType>
+	static bool ShouldWriteFastArrayItem(const Type& Item, const bool bIsWritingOnClient)
 	{
-		return FFastArraySerializer::FastArrayDeltaSerialize<FCommonInventoryItem, FCommonInventoryState>(Items, DeltaParms, *this);
+		return FFastArraySerializer::ShouldWriteFastArrayItem<Type, SerializerType>(Item, bIsWritingOnClient) && IsWithinInitialSyncWindow(Item);
 	}
 
 	// FFastArraySerializer.
-	void PostReplicatedReceive(FFastArraySerializer::FPostReplicatedReceiveParameters PostReceivedParameters) {}
-	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize) {}
-	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize) {}
-	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize) {}
+	void PostReplicatedReceive(FFastArraySerializer::FPostReplicatedReceiveParameters PostReceivedParameters);
+	void PostReplicatedAdd(const TArrayView<int32> AddedIndices, int32 FinalSize);
+	void PreReplicatedRemove(const TArrayView<int32> RemovedIndices, int32 FinalSize);
+	void PostReplicatedChange(const TArrayView<int32> ChangedIndices, int32 FinalSize);
+
+private:
+
+	/** A single move of TransferItems(). */
+	struct FTransferStep
+	{
+		int32 SourceSlot = INDEX_NONE;
+		int32 Amount = 0;
+
+		/** The existing stack of the target, or INDEX_NONE. */
+		int32 TargetSlot = INDEX_NONE;
+
+		/** The stack created by the transfer, or INDEX_NONE. */
+		int32 NewStack = INDEX_NONE;
+	};
+
+	/** Validated moves of TransferItems(). */
+	struct FTransferPlan
+	{
+		TArray<FTransferStep, TInlineAllocator<16>> Steps;
+
+		/** Cells of the new stacks in the spatial target, or INDEX_NONE. */
+		TArray<int32, TInlineAllocator<16>> NewStackCells;
+
+		/** The capacity the target has to grow to. */
+		int32 RequiredCapacity = 0;
+	};
+
+	/** Validates the transfer against both states and plans the moves. */
+	bool PlanTransfer(const FCommonInventoryState& InTarget, TConstArrayView<int32> InSourceSlots, TConstArrayView<int32> InAmounts, FTransferPlan& OutPlan) const;
+
+	/** Appends empty slots and pushes them into the free list. */
+	void Grow(int32 InCapacity);
+
+	/** Serializes the slots as a table of unique items followed by compact rows. */
+	bool SerializeBulk(FArchive& Ar);
+	static bool SerializeBulkRows(FArchive& Ar, const UCommonInventoryRegistry& InRegistry, int32 InNumItems, TFunctionRef<FCommonInventoryItem&(int32)> InGetItem, const uint32* InHandoffChecksum = nullptr);
+
+	/** Restores the grid and the derived data once the slots are loaded. */
+	void PostLoadItems(FArchive& Ar, uint16 InGridWidth);
+
+	/** Rebuilds the free list, SlotIndex and Size from Items. */
+	void RebuildSlots();
+
+	/** Forces the next snapshot to copy every chunk, e.g. once the items were rewritten in place. */
+	void MarkSnapshotDirty() const { DirtySnapshotChunks.Init(true, DirtySnapshotChunks.Num()); }
+
+	/** Rebuilds the free list from empty slots. */
+	void RebuildFreeList();
+
+	/** Updates the free list, SlotIndex, Size and the grid for the slots added or changed by replication. */
+	void UpdateReplicatedSlots();
+
+	/** Rebuilds the occupancy of the spatial grid from anchored items. */
+	void RebuildGrid();
+
+	/** Pushes the empty slot into the free list. */
+	void PushFreeSlot(int32 InSlot);
+
+	/** Unlinks the empty slot from the free list. */
+	void UnlinkFreeSlot(int32 InSlot);
+
+	/** Stamps the slots updated by replication with a new revision. */
+	void StampReplicatedSlots(TConstArrayView<int32> InSlots, int32 InFinalSize);
+
+	/** Marks the slot dirty in the tracker and updates the aggregates if any. */
+	void NotifySlotChanged(int32 InSlot);
+
+	/** Reevaluates the aggregates from all the slots, e.g. once the number of slots has changed. */
+	void RebuildAggregates();
+
+	/** Hide FFastArraySerializer versions, so each mutation notifies the owner as well. */
+	void MarkItemDirty(FFastArraySerializerItem& InItem) { FFastArraySerializer::MarkItemDirty(InItem); OnReplicationDirty.ExecuteIfBound(); }
+	void MarkArrayDirty() { FFastArraySerializer::MarkArrayDirty(); OnReplicationDirty.ExecuteIfBound(); }
+
+	/** Whether the item is within the window of the connection being written. */
+	static bool IsWithinInitialSyncWindow(const FCommonInventoryItem& InItem);
+
+	/** Maintains SlotIndex and IndexedSlotIds. */
+	void AddToSlotIndex(FPrimaryAssetId InPrimaryAssetId, int32 InSlot);
+	void RemoveFromSlotIndex(FPrimaryAssetId InPrimaryAssetId, int32 InSlot);
 
 private:
 
@@ -143,6 +389,59 @@ private:
 	/**  */
 	UPROPERTY()
 	ECommonInventoryStateFlags InternalFlags = ECommonInventoryStateFlags::NoFlags;
+
+	/** Head of the intrusive list of empty slots. Not replicated. */
+	int32 FreeSlot = INDEX_NONE;
+
+	/** Occupancy of the spatial grid. Each side initializes its size, the occupancy is rebuilt from items. Not replicated. */
+	FCommonInventoryGrid Grid;
+
+	/** Maps items to the occupied slots for duplicate and stacking queries. Not replicated. */
+	TMap<FPrimaryAssetId, TArray<int32, TInlineAllocator<2>>> SlotIndex;
+
+	/** The id each slot is indexed under in SlotIndex, as replicated updates don't provide previous values. Not replicated. */
+	TArray<FPrimaryAssetId> IndexedSlotIds;
+
+	/** Optional journal of changes. Not replicated. */
+	FCommonInventoryStateChangeTracker* ChangeTracker = nullptr;
+
+	/** Optional running totals over the slots. Not replicated. */
+	FCommonInventoryAggregates* Aggregates = nullptr;
+
+	/** Called whenever the state is marked for replication. Not replicated. */
+	FSimpleDelegate OnReplicationDirty;
+
+	/** Paced initial sync of a connection. */
+	struct FInitialSyncCursor
+	{
+		int32 NumSyncedSlots = 0;
+		double StartTime = 0.0;
+	};
+
+	/** Connections which haven't received all the slots yet. Not replicated. */
+	TMap<TObjectKey<UPackageMap>, FInitialSyncCursor> InitialSyncCursors;
+
+	/** The number of slots the server had at the last update. Not replicated. */
+	int32 NumSyncedSlotsExpected = 0;
+
+	/** The last captured snapshot and its chunks changed since then. Not replicated. */
+	mutable TSharedPtr<const FCommonInventoryStateSnapshot, ESPMode::ThreadSafe> LastSnapshot;
+	mutable TBitArray<> DirtySnapshotChunks;
+
+	/** The counter of replicated updates and the revision each slot was last replicated at. Not replicated. */
+	uint32 ReplicationRevision = 0;
+	TArray<uint32> ReplicatedSlotRevisions;
+
+	/** Slots added or changed by replication since the last update. Not replicated. */
+	TArray<int32> PendingReplicatedSlots;
+
+	/** Whether replication has removed slots, which shifts the remaining ones, so the slots must be rebuilt. */
+	bool bIsSlotsDirty = false;
+
+	/** Whether replication has removed slots, so their contributions must be reevaluated. */
+	bool bIsAggregatesDirty = false;
+
+	friend class FCommonInventoryStateSnapshot;
 };
 
 template<>
@@ -150,32 +449,246 @@ struct TStructOpsTypeTraits<FCommonInventoryState> : public TStructOpsTypeTraits
 {
 	enum
 	{
-		//WithSerializer = true,
+		WithSerializer = true,
 		WithNetDeltaSerializer = true,
 		WithNetSharedSerialization = true,
 	};
 };
 
-/**  */
-enum class ECommonInventoryStateEventType
+/**
+ * Immutable copy of FCommonInventoryState, e.g. for serializing inventories on a worker thread without blocking gameplay.
+ * Slots are stored in shared chunks, so taking a snapshot only copies chunks which have changed since the previous one.
+ */
+class COMMONINVENTORY_API FCommonInventoryStateSnapshot
+{
+public:
+
+	/** The number of slots per chunk. */
+	static constexpr int32 ChunkSize = 64;
+
+	/** Returns the number of slots including empty ones. */
+	int32 Num() const { return NumItems; }
+
+	/** Returns the flags of the state. */
+	ECommonInventoryStateFlags GetFlags() const { return InternalFlags; }
+
+	/** Returns the item in the slot. */
+	const FCommonInventoryItem& GetItem(int32 InSlot) const { return (*Chunks[InSlot / ChunkSize])[InSlot % ChunkSize]; }
+
+	/** Saves the snapshot, which can be loaded back with FCommonInventoryState::Serialize(). Can be called from any thread. */
+	bool Serialize(FArchive& Ar) const;
+
+private:
+
+	friend struct FCommonInventoryState;
+
+	using FChunk = TArray<FCommonInventoryItem>;
+
+	TArray<TSharedRef<const FChunk, ESPMode::ThreadSafe>> Chunks;
+
+	int32 NumItems = 0;
+
+	int32 GridWidth = 0;
+
+	ECommonInventoryStateFlags InternalFlags = ECommonInventoryStateFlags::NoFlags;
+};
+
+/** Pre-mutation copy of a slot captured during a predicted command. */
+struct FCommonInventoryPredictedSlot
+{
+	FCommonInventoryState* State = nullptr;
+	int32 Slot = INDEX_NONE;
+	FCommonInventoryItem Item;
+
+	/** FCommonInventoryState::GetReplicationRevision() at the capture. */
+	uint32 ReplicationRevision = 0;
+};
+
+/**
+ * Captures slots of any FCommonInventoryState before their first mutation within the scope.
+ * Allows clients to roll back mispredicted commands without implementing UCommonInventoryCommand::Rollback().
+ * Must only be used on the game thread.
+ */
+class COMMONINVENTORY_API FCommonInventoryPredictionScope : public FNoncopyable
+{
+public:
+
+	explicit FCommonInventoryPredictionScope(TArray<FCommonInventoryPredictedSlot>& InSnapshots);
+	~FCommonInventoryPredictionScope();
+
+	/** Captures the slot if there is an active scope. */
+	static void CaptureSlot(FCommonInventoryState& InState, int32 InSlot);
+
+private:
+
+	TArray<FCommonInventoryPredictedSlot>& Snapshots;
+	FCommonInventoryPredictionScope* const PreviousScope;
+};
+
+/** Types of events reported by FCommonInventoryStateChangeTracker. */
+enum class ECommonInventoryStateEventType : uint8
 {
 	ItemAdded,
 	ItemRemoved,
 	ItemUpdated,
 };
 
+/** A contiguous range of slots affected by the same event. */
+struct FCommonInventoryStateChangeRange
+{
+	ECommonInventoryStateEventType EventType = ECommonInventoryStateEventType::ItemUpdated;
+	int32 FirstSlot = INDEX_NONE;
+	int32 NumSlots = 0;
+};
+
 /**
- * 
+ * A batch of coalesced events passed to the listeners.
  */
 struct FCommonInventoryStateChangeTrackerContext
 {
+	FCommonInventoryStateChangeTrackerContext(const FCommonInventoryState& InState, TConstArrayView<FCommonInventoryStateChangeRange> InRanges)
+		: State(InState), Ranges(InRanges)
+	{
+	}
+
+	/** The state after all the changes. */
+	const FCommonInventoryState& State;
 
+	/** Ranges sorted by slots. Each slot appears at most once. */
+	TConstArrayView<FCommonInventoryStateChangeRange> Ranges;
 };
 
 /**
- * 
+ * Coalesces changes of FCommonInventoryState into a single journal, which is broadcasted once per flush.
+ * Event types are derived from the slot occupancy at the previous flush, so multiple changes of the same slot
+ * are reported as a single event: e.g. an item added and removed in the same frame isn't reported at all.
+ */
+struct COMMONINVENTORY_API FCommonInventoryStateChangeTracker
+{
+	DECLARE_MULTICAST_DELEGATE_OneParam(FOnStateChanged, const FCommonInventoryStateChangeTrackerContext&);
+
+	FCommonInventoryStateChangeTracker() = default;
+
+	// The state keeps a pointer to the tracker.
+	UE_NONCOPYABLE(FCommonInventoryStateChangeTracker);
+
+public:
+
+	/** Records a change of the slot. Duplicates are ignored. */
+	void MarkSlotDirty(int32 InSlot);
+
+	/** Whether there are any changes pending flush. */
+	bool HasPendingChanges() const { return !DirtySlots.IsEmpty(); }
+
+	/** Broadcasts the pending changes and resets the journal. */
+	void Flush(const FCommonInventoryState& InState);
+
+	/** Forgets all the changes and the known occupancy. */
+	void Reset();
+
+	/** Register a listener called once per flush. */
+	FDelegateHandle Register_OnStateChanged(FOnStateChanged::FDelegate&& Delegate) { return OnStateChangedDelegate.Add(MoveTemp(Delegate)); }
+
+	/** Remove a previously registered listener. */
+	void Unregister_OnStateChanged(FDelegateHandle Handle) { OnStateChangedDelegate.Remove(Handle); }
+
+	/** Called once the first change is recorded after a flush. Allows the owner to schedule the next flush. */
+	FSimpleDelegate OnChangesPending;
+
+private:
+
+	/** Delegate for broadcasting batched changes. */
+	FOnStateChanged OnStateChangedDelegate;
+
+	/** Slots changed since the last flush in the recording order. */
+	TArray<int32> DirtySlots;
+
+	/** Fast lookup for DirtySlots. */
+	TBitArray<> DirtySlotsMask;
+
+	/** Slot occupancy at the last flush. */
+	TBitArray<> OccupiedSlots;
+
+	/** Reused journal storage. */
+	TArray<FCommonInventoryStateChangeRange> Journal;
+};
+
+/** Evaluates the contribution of a non-empty slot to an aggregate. The record belongs to the item. */
+using FCommonInventoryAggregateEvaluator = TFunction<double(const FCommonInventoryItem&, const FCommonInventoryRegistryRecord&)>;
+
+/**
+ * Running totals over the slots of FCommonInventoryState, e.g. the carried weight or the number of items with a tag.
+ * Each aggregate keeps the contribution of every slot, so a change costs a single evaluation per aggregate instead of a full scan,
+ * and the registry record is looked up once per change regardless of the number of aggregates.
+ *
+ * @Note: Contributions are kept in fixed point with a resolution of 1 / FixedPointScale, so totals updated by deltas never drift from a rebuild.
  */
-struct FCommonInventoryStateChangeTracker
+struct COMMONINVENTORY_API FCommonInventoryAggregates
 {
+	FCommonInventoryAggregates() = default;
+
+	// The state keeps a pointer to the aggregates.
+	UE_NONCOPYABLE(FCommonInventoryAggregates);
+
+public:
+
+	/** Registers an aggregate evaluated from the current slots. Returns its id, or INDEX_NONE for an unbound evaluator. */
+	int32 Register(const FCommonInventoryState& InState, FCommonInventoryAggregateEvaluator&& InEvaluator);
+
+	/** Removes a previously registered aggregate. */
+	void Unregister(int32 InAggregateId);
+
+	/** The number of fixed point steps per unit. */
+	static constexpr double FixedPointScale = 1 << 16;
+
+	/** Returns the current total of the aggregate, or zero for an unknown id. */
+	double GetValue(int32 InAggregateId) const { return Aggregates.IsValidIndex(InAggregateId) ? Aggregates[InAggregateId].Value / FixedPointScale : 0.0; }
+
+	/** Whether there are no aggregates to update. */
+	bool IsEmpty() const { return Aggregates.IsEmpty(); }
+
+	/** Reevaluates the contribution of the slot to each aggregate. */
+	void UpdateSlot(const FCommonInventoryState& InState, int32 InSlot);
+
+	/** Reevaluates all the aggregates from scratch, e.g. once the registry records have changed. */
+	void Rebuild(const FCommonInventoryState& InState);
+
+	/** Removes all the aggregates. */
+	void Reset() { Aggregates.Empty(); }
+
+public: // Evaluators
+
+	/** The number of the item, i.e. the sum of its stacks. */
+	static FCommonInventoryAggregateEvaluator CountItem(FPrimaryAssetId InPrimaryAssetId);
+
+	/** The number of items of the archetype. */
+	static FCommonInventoryAggregateEvaluator CountArchetype(FPrimaryAssetType InArchetype);
+
+	/** The number of items with the tag, where parent tags match their children. */
+	static FCommonInventoryAggregateEvaluator CountTag(FGameplayTag InTag);
+
+	/** The sum of a numeric field of RegistryCustomData multiplied by the stack size, e.g. the weight. Items with other custom data don't contribute. */
+	static FCommonInventoryAggregateEvaluator SumCustomDataField(const UScriptStruct* InCustomDataType, FName InPropertyName);
+
+private:
+
+	struct FAggregate
+	{
+		FCommonInventoryAggregateEvaluator Evaluator;
+
+		/** The fixed point contribution of each slot. Grown lazily. */
+		TArray<int64> SlotValues;
+
+		/** The sum of SlotValues. */
+		int64 Value = 0;
+	};
+
+	/** Evaluates the fixed point contribution of the item. */
+	static int64 Evaluate(const FAggregate& InAggregate, const FCommonInventoryItem& InItem, const FCommonInventoryRegistryRecord& InRecord)
+	{
+		return FMath::RoundToInt64(InAggregate.Evaluator(InItem, InRecord) * FixedPointScale);
+	}
 
+	/** Registered aggregates, ids are stable. */
+	TSparseArray<FAggregate> Aggregates;
 };
@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "HAL/LowLevelMemTracker.h"
 #include "Trace/Trace.h"
 #include "ProfilingDebugging/CpuProfilerTrace.h"
 
@@ -13,3 +14,6 @@ UE_TRACE_CHANNEL_EXTERN(CommonInventoryChannel, COMMONINVENTORY_API);
 
 // Bookmark.
 #define COMMON_INVENTORY_BOOKMARK(Name, ...) if constexpr (UE_TRACE_CHANNELEXPR_IS_ENABLED(CommonInventoryChannel)) { TRACE_BOOKMARK(TEXT(Name), ##__VA_ARGS__) }
+
+// Memory tracking. -llm
+LLM_DECLARE_TAG_API(CommonInventory, COMMONINVENTORY_API);
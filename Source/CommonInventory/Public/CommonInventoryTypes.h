@@ -20,6 +20,8 @@ class FArchive;
 class UPackageMap;
 
 struct FAssetIdentifier;
+struct FCommonInventoryRegistryRecord;
+struct FCommonItemHandle;
 struct FCommonItemSharedData;
 struct FSoftObjectPath;
 
@@ -42,7 +44,6 @@ struct FCommonItem
 {
 	GENERATED_BODY()
 
-	//@TODO: Implement Iris.NetSerializer. Refs: GameplayTagNetSerializer, InstancedStructNetSerializer.
 	//@TODO: Maybe replace FPrimaryAssetId/FPrimaryAssetType with FCommonItemId/FCommonItemArchetype.
 	//@TODO: Add pin customization for MakeCommonItem(FPrimaryAssetId).
 
@@ -87,10 +88,7 @@ struct FCommonItem
 	friend class FCommonItemPayloadBuilder;
 
 	/** Constructs a searchable name from type and name that can be used to find out dependencies through the IAssetRegistry. */
-	static FAssetIdentifier MakeSearchableName(FPrimaryAssetId InPrimaryAssetId)
-	{
-		return FAssetIdentifier(FCommonItem::StaticStruct(), FName(InPrimaryAssetId.ToString()));
-	}
+	COMMONINVENTORY_API static FAssetIdentifier MakeSearchableName(FPrimaryAssetId InPrimaryAssetId);
 
 public: // Data
 
@@ -152,6 +150,9 @@ public: // Shared Data
 	/** [[Not Thread Safe]] Returns asset path from the registry. */
 	COMMONINVENTORY_API FSoftObjectPath GetAssetPath() const;
 
+	/** [[Not Thread Safe]] Returns the registry record through the cached handle, which is rebound if stale. Useful in tight loops. */
+	COMMONINVENTORY_API const FCommonInventoryRegistryRecord* GetRegistryRecord(FCommonItemHandle& InOutHandle) const;
+
 public: // Utility
 
 	/** Resets payload to the default state from the registry. */
@@ -190,6 +191,9 @@ public: // StructOpsTypeTraits
 
 private:
 
+	/** Returns the name cached by the registry, or builds one for unregistered ids. */
+	static FName FindSearchableName(FPrimaryAssetId InPrimaryAssetId);
+
 	/** Optional payload object synchronized with the default payload from the registry. */
 	UPROPERTY(EditAnywhere, Category = "CommonItem")
 	FVariadicStruct Payload;
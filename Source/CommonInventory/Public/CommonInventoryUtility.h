@@ -3,10 +3,13 @@
 #pragma once
 
 #include "Containers/Array.h"
+#include "Containers/ArrayView.h"
+#include "Containers/Map.h"
 #include "UObject/PrimaryAssetId.h"
 #include "VariadicStruct.h"
 
 struct FAssetData;
+struct FXxHash64Builder;
 
 class FString;
 class FText;
@@ -22,6 +25,15 @@ namespace CommonInventory
 	/** Returns all assets referencing FPrimaryAssetId within FCommonItem. Recursive gathering requires type and name history depth permutations. */
 	COMMONINVENTORY_API bool GetReferencers(FPrimaryAssetId InPrimaryAssetId, TArray<FAssetData>& OutReferencers, bool bRecursively = false, bool bUnloadedOnly = false);
 
+	/**
+	 * Batched version of GetReferencers() for bulk renames and removals. Permutations are expanded at once and searchable names shared between them are queried once,
+	 * while the referencing packages are resolved in a single asset registry query. Only referenced FPrimaryAssetIds are added to the map.
+	 */
+	COMMONINVENTORY_API bool GetReferencers(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TMap<FPrimaryAssetId, TArray<FAssetData>>& OutReferencers, bool bRecursively = false, bool bUnloadedOnly = false);
+
+	/** Batched version of HasReferencers(). Returns FPrimaryAssetIds which are referenced. */
+	COMMONINVENTORY_API bool HasReferencers(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TArray<FPrimaryAssetId>& OutReferencedIds, bool bRecursively = false, bool bUnloadedOnly = false);
+
 	/** Exports a generic script struct wrapper as text. */
 	template<VariadicStruct::CScriptStructWrapper T>
 	FString ExportScriptStruct(const T& InStructWrapper, bool bExportStructValue = true)
@@ -43,6 +55,16 @@ namespace CommonInventory
 		return TEXT("None");
 	}
 
+	/** Deterministically hashes a script struct by walking its properties. Stable across platforms and processes, unlike the raw memory. */
+	COMMONINVENTORY_API void HashScriptStruct(FXxHash64Builder& InOutBuilder, const UScriptStruct* InScriptStruct, const void* InStructMemory);
+
+	/** Deterministically hashes a generic script struct wrapper including its type. */
+	template<VariadicStruct::CScriptStructWrapper T>
+	void HashScriptStruct(FXxHash64Builder& InOutBuilder, const T& InStructWrapper)
+	{
+		HashScriptStruct(InOutBuilder, InStructWrapper.GetScriptStruct(), InStructWrapper.GetMemory());
+	}
+
 #if WITH_EDITOR
 
 	/** Conditionally validates the name against a pattern from the config. */
@@ -2,6 +2,9 @@
 
 #pragma once
 
+#include "CommonInventoryState.h"
+#include "Containers/BitArray.h"
+#include "Templates/Function.h"
 #include "Templates/SharedPointer.h"
 #include "UObject/WeakObjectPtr.h"
 
@@ -10,28 +13,37 @@
 class UCommonInventoryComponent;
 
 /**
- * 
+ * Filtering and sorting parameters of FCommonInventoryView.
  */
 USTRUCT(/* BlueprintType, */ meta = (Hidden))
 struct COMMONINVENTORY_API FCommonInventoryTraversingParams
 {
 	GENERATED_BODY()
 
-	/**  */
+	/** Predicate for sorting items. Items are ordered by slots if unset. */
+	using FSortPredicate = TFunction<bool(const FCommonInventoryItem& Lhs, const FCommonInventoryItem& Rhs)>;
+
+	/** Whether the item passes the filters. */
+	bool PassesFilter(const FCommonInventoryItem& InItem) const;
+
+	/** Whether to include slots without items. */
 	//UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
 	bool bIncludeEmptyItems = false;
 
-	/**  */
+	/** Whether to include redirector items. */
 	//UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
 	bool bIncludeRedirects = false;
 
-	/**  */
+	/** Only includes items of the archetypes if not empty. */
 	//UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
 	TSet<FPrimaryAssetType> ArchetypesFilter;
 
-	/**  */
+	/** Only includes items with the payload derived from the type if set. */
 	//UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Parameters")
 	TObjectPtr<const UScriptStruct> PayloadFilter;
+
+	/** Optional stable ordering of items. */
+	FSortPredicate SortPredicate;
 };
 
 /**
@@ -44,20 +56,65 @@ struct COMMONINVENTORY_API FCommonItemView
 };
 
 /**
+ * A filtered and sorted view of UCommonInventoryComponent.
  * 
+ * The view is an index permutation of inventory slots, so items are never copied.
+ * It materializes lazily on the first access and then follows batched changes of the inventory incrementally.
+ * Accessing the view on the game thread flushes changes of the current frame, so mutations are visible immediately. Access from other threads may lag until the next tick.
+ * Copies of the view share the same state.
  */
 USTRUCT(/* BlueprintType, */ meta = (Hidden))
 struct COMMONINVENTORY_API FCommonInventoryView
 {
 	GENERATED_BODY()
 
-	// Add filtering, sorting, enumeration, etc.
 	// Create custom BP node for iterating.
 	// https://www.gamedev.net/tutorials/programming/engines-and-middleware/improving-ue4-blueprint-usability-with-custom-nodes-r5694/
 
-	struct FStateData
+	FCommonInventoryView() = default;
+	FCommonInventoryView(const UCommonInventoryComponent* InComponent, const FCommonInventoryTraversingParams& InParams);
+
+public:
+
+	/** Whether the view is bound to an existing inventory. */
+	bool IsValid() const { return SharedState.IsValid() && SharedState->OriginalComponent.IsValid(); }
+
+	/** Returns the number of items in the view. */
+	int32 Num() const { return GetSlots().Num(); }
+
+	/** Returns inventory slots in the view order. */
+	TConstArrayView<int32> GetSlots() const;
+
+	/** Returns the item at the view index. */
+	const FCommonInventoryItem& GetItem(int32 InIndex) const;
+
+	/** Forces the view to be rebuilt on the next access, e.g. after changing the sorting criteria. */
+	void Invalidate();
+
+private:
+
+	struct FStateData : public TSharedFromThis<FStateData>
 	{
-		TWeakObjectPtr<UCommonInventoryComponent> OriginalComponent;
+		~FStateData();
+
+		void Refresh();
+		void Rebuild(const FCommonInventoryState& InState);
+		void InsertSlot(const FCommonInventoryState& InState, int32 InSlot);
+		void OnStateChanged(const FCommonInventoryStateChangeTrackerContext& InContext);
+
+		TWeakObjectPtr<const UCommonInventoryComponent> OriginalComponent;
+		FCommonInventoryTraversingParams Params;
+
+		/** Inventory slots in the view order. */
+		TArray<int32> Permutation;
+
+		/** Slots changed since the last refresh. */
+		TArray<int32> PendingSlots;
+		TBitArray<> PendingSlotsMask;
+
+		FDelegateHandle OnStateChangedHandle;
+		int32 CachedCapacity = 0;
+		bool bNeedsRebuild = true;
 	};
 
 	TSharedPtr<FStateData> SharedState;
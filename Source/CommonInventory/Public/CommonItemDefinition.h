@@ -5,6 +5,7 @@
 #include "CommonInventoryTypes.h"
 #include "Engine/DataAsset.h"
 #include "InstancedStruct.h"
+#include "Misc/EngineVersionComparison.h"
 #include "CommonItemDefinition.generated.h"
 
 /**
@@ -37,12 +38,29 @@ public:
 	UPROPERTY(EditDefaultsOnly, Category = "Registry Data")
 	FInstancedStruct RegistryCustomData;
 
+public: // Registry Tags
+
+	/** Hidden asset registry tag holding SharedData, DefaultItemPayload and RegistryCustomData. @see UAssetRegistryTagsDataSource. */
+	static COMMONINVENTORY_API const FName RegistryDataTagName;
+
+	/** Encodes the registry data into the RegistryDataTagName tag value. */
+	COMMONINVENTORY_API FString ExportRegistryDataTag() const;
+
+	/** Decodes the registry data from the RegistryDataTagName tag value. Returns false if the value is malformed or outdated. */
+	static COMMONINVENTORY_API bool ImportRegistryDataTag(const FString& InTagValue, FCommonItemSharedData& OutSharedData, FInstancedStruct& OutDefaultItemPayload, FInstancedStruct& OutRegistryCustomData);
+
 public: // Overrides
 
 	COMMONINVENTORY_API virtual void PostInitProperties() override;
 	COMMONINVENTORY_API virtual bool IsPostLoadThreadSafe() const override { return true; }
 	COMMONINVENTORY_API virtual bool NeedsLoadForTargetPlatform(const ITargetPlatform* TargetPlatform) const override final { return true; }
 
+#if UE_VERSION_OLDER_THAN(5, 4, 0)
+	COMMONINVENTORY_API virtual void GetAssetRegistryTags(TArray<FAssetRegistryTag>& OutTags) const override;
+#else
+	COMMONINVENTORY_API virtual void GetAssetRegistryTags(FAssetRegistryTagsContext Context) const override;
+#endif
+
 #if WITH_EDITOR
 	COMMONINVENTORY_API virtual void PreSave(FObjectPreSaveContext ObjectSaveContext) override;
 	COMMONINVENTORY_API virtual EDataValidationResult IsDataValid(FDataValidationContext& Context) const override;
@@ -4,9 +4,13 @@
 
 #include "Components/ActorComponent.h"
 #include "CommonInventoryState.h"
+#include "Engine/TimerHandle.h"
 #include "CommonInventoryView.h"
 #include "Templates/UniquePtr.h"
 
+#include <atomic>
+
+#include "Commands/CommonInventoryCommandController.h"
 #include "CommonInventoryComponent.generated.h"
 
 class APlayerController;
@@ -22,7 +26,7 @@ enum class ECommonInventoryReplicationMode : uint8
 	Public		UMETA(ToolTip = "Replicated to all relevant connections. Not recommended for large inventories or under bandwidth limited conditions."),
 	Protected	UMETA(ToolTip = "Replicated only to manually registered connections. Recommended for non-player entities."),
 	Private		UMETA(ToolTip = "Replicated only to the owning connection. Recommended for player owned entities."),
-	Auto		UMETA(ToolTip = "Replicated only to automatically registered connections by the prefetcher."),
+	Auto		UMETA(ToolTip = "Replicated only to connections automatically registered by UCommonInventoryPrefetcher ahead of interaction."),
 };
 
 /**
@@ -40,10 +44,71 @@ class COMMONINVENTORY_API UCommonInventoryComponent : public UActorComponent
 
 public:
 
-	/** Creates a non-intrusive copy of the inventory that supports filtering, sorting, etc. */
+	/** Returns the underlying storage. */
+	const FCommonInventoryState& GetInventoryState() const { return InventoryState; }
+
+	/** Creates a non-intrusive view of the inventory that supports filtering, sorting, etc. */
 	//UFUNCTION(BlueprintCallable, Category = "CommonInventory|View")
 	FCommonInventoryView MakeInventoryView(const FCommonInventoryTraversingParams& TraversingParams) const;
 
+	/** [Client] Returns the initial sync progress in the range [0, 1], which allows rendering slots that have already arrived. */
+	UFUNCTION(BlueprintPure, Category = "CommonInventory|Networking")
+	float GetInventorySyncProgress() const { return InventoryState.GetSyncProgress(); }
+
+public: // Events
+
+	/** Register a listener called once per frame with all the changes of the inventory. */
+	FDelegateHandle Register_OnInventoryChanged(FCommonInventoryStateChangeTracker::FOnStateChanged::FDelegate&& Delegate)
+	{
+		return ChangeTracker.Register_OnStateChanged(MoveTemp(Delegate));
+	}
+
+	/** Remove a previously registered listener. */
+	void Unregister_OnInventoryChanged(FDelegateHandle Handle)
+	{
+		ChangeTracker.Unregister_OnStateChanged(Handle);
+	}
+
+	/** Broadcasts the changes of the frame right away instead of on the next tick, so readers observe them synchronously. Game thread only. */
+	void FlushPendingInventoryChanges()
+	{
+		if (ChangeTracker.HasPendingChanges())
+		{
+			FlushInventoryChanges();
+		}
+	}
+
+public: // Aggregates
+
+	/** Registers a running total over the slots, e.g. from FCommonInventoryAggregates::CountTag(). Updated with each change, including replicated ones. Returns its id or INDEX_NONE. */
+	int32 RegisterInventoryAggregate(FCommonInventoryAggregateEvaluator&& Evaluator)
+	{
+		return Aggregates.Register(InventoryState, MoveTemp(Evaluator));
+	}
+
+	/** Remove a previously registered aggregate. */
+	void UnregisterInventoryAggregate(int32 AggregateId)
+	{
+		Aggregates.Unregister(AggregateId);
+	}
+
+	/** Returns the current total of the aggregate without visiting the slots. */
+	double GetInventoryAggregate(int32 AggregateId) const
+	{
+		return Aggregates.GetValue(AggregateId);
+	}
+
+public: // Handoff
+
+	/** [Server] Saves the inventory for a handoff to the server with the registry checksum, e.g. across seamless travel or a cross-server transfer. See FCommonInventoryState::SaveHandoff(). */
+	bool SaveInventoryHandoff(TArray<uint8>& OutData, uint32 TargetRegistryChecksum) const
+	{
+		return InventoryState.SaveHandoff(OutData, TargetRegistryChecksum);
+	}
+
+	/** [Server] Restores the inventory from SaveInventoryHandoff(), replacing the current slots. */
+	bool LoadInventoryHandoff(TConstArrayView<uint8> Data);
+
 public: // Server Only
 
 	/** [Server] */
@@ -54,6 +119,19 @@ public: // Server Only
 	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category="CommonInventory|Networking")
 	void UnregisterInventoryListener(const APlayerController* PlayerController);
 
+	/** [Server] Whether the player is registered as a listener. */
+	UFUNCTION(BlueprintCallable, BlueprintAuthorityOnly, Category="CommonInventory|Networking")
+	bool IsInventoryListener(const APlayerController* PlayerController) const;
+
+	/** [Server] Whether the listener id from UCommonInventoryReplication is registered. */
+	bool IsInventoryListenerId(int32 InListenerId) const { return Listeners.IsValidIndex(InListenerId) && Listeners[InListenerId]; }
+
+	/** [Server] Unregisters all the listeners. */
+	void UnregisterAllInventoryListeners();
+
+	/** [Server] Whether commands received from the actor may mutate the inventory. By default, only the owning connection and registered listeners are allowed. */
+	virtual bool CanBeAccessedBy(const AActor* InAuthOwner) const;
+
 public: // Overrides
 
 //	virtual void OnRegister() override;
@@ -67,14 +145,44 @@ public: // Overrides
 //	virtual void PreNetReceive() override;
 //	virtual void PostNetReceive() override;
 //	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags) override;
-//	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
+	virtual void PreReplication(IRepChangedPropertyTracker& ChangedPropertyTracker) override;
 	virtual ELifetimeCondition GetReplicationCondition() const override;
 	virtual bool GetComponentClassCanReplicate() const override;
 
-protected:
+public: // Commands
 
+	/** Returns the command controller for the server and autonomous proxies. */
 	FCommonInventoryCommandController* GetCommandController() const;
 
+protected:
+
+	/** Sends queued commands to the server in a single batch. */
+	void FlushCommandQueue();
+
+	UFUNCTION(Server, Reliable)
+	void ServerExecuteCommands(const FCommonInventoryCommandBatch& Batch);
+
+	UFUNCTION(Client, Reliable)
+	void ClientAcknowledgeCommands(const FCommonInventoryCommandAck& Ack);
+
+	/** Acknowledges the executed batch or disconnects the player for violating the protocol. */
+	void CommitCommandBatch(bool bIsExecuted, const FCommonInventoryCommandAck& Ack);
+
+	friend class UCommonInventoryCommand;
+	friend class UCommonInventoryCommandScheduler;
+
+	/** Broadcasts changes accumulated during the frame. */
+	void FlushInventoryChanges();
+
+	/** [Server] Marks InventoryState dirty for the push model and wakes the owner up. */
+	void MarkInventoryStateDirty();
+
+	/** [Server] Wakes the owner up, which goes dormant again once the inventory is idle for DormancyIdleDelay. */
+	void WakeOwnerFromDormancy();
+
+	/** [Server] Puts the owner into dormancy if the inventory has been idle long enough, or checks again later. */
+	void UpdateOwnerDormancy();
+
 protected:
 
 	//UPROPERTY(EditAnywhere, Category = "Common Inventory")
@@ -88,16 +196,64 @@ protected:
 	UPROPERTY(EditAnywhere, Category = "Initialization")
 	bool bIsAutomatic = false;
 
+	/** Enables the spatial mode with a grid of up to 64 columns, which replaces DefaultCapacity and bIsAutomatic. */
+	UPROPERTY(EditAnywhere, Category = "Initialization", meta = (ClampMin = 0))
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
 	/** All supported replication modes of the inventory. */
 	UPROPERTY(EditAnywhere, Category = "Networking")
 	ECommonInventoryReplicationMode ReplicationMode;
 
+	/**
+	 * Puts the owner into DORM_DormantAll while the inventory is idle, so it's skipped by the net driver until the next mutation or listener registration.
+	 * Dormancy applies to the whole actor, so it's only suitable for owners without any other frequently replicated state, e.g. containers.
+	 */
+	UPROPERTY(EditAnywhere, Category = "Networking")
+	bool bDormantWhileIdle = false;
+
+	/** Seconds without mutations after which the owner goes dormant. */
+	UPROPERTY(EditAnywhere, Category = "Networking", meta = (ClampMin = 0, EditCondition = "bDormantWhileIdle"))
+	float DormancyIdleDelay = 5.f;
+
 private:
 
 	/**  */
 	UPROPERTY(Replicated)
 	FCommonInventoryState InventoryState;
 
+	/** Journal of changes fed by InventoryState. */
+	FCommonInventoryStateChangeTracker ChangeTracker;
+
+	/** Running totals fed by InventoryState. */
+	FCommonInventoryAggregates Aggregates;
+
+	/** Rebuilds the aggregates once the registry records have changed. */
+	FDelegateHandle RegistryPostRefreshHandle;
+
 	/**  */
 	mutable TUniquePtr<FCommonInventoryCommandController> CommandController;
+
+	/** Pending flush of the command queue. */
+	FTimerHandle CommandQueueFlushHandle;
+
+	/** Pending dormancy check of the owner. */
+	FTimerHandle DormancyHandle;
+
+	/** The world time of the last mutation. */
+	double LastMutationTime = 0.0;
+
+	/** Whether dirtying from workers has been forwarded to the game thread. */
+	std::atomic<bool> bHasPendingStateDirty = false;
+
+	/** The name template for NetGroups of inventories. */
+	static inline const FName ListenersNetGroupName = FName(TEXT("CommonInventoryListeners"));
+
+	/** The NetGroup only this inventory belongs to. Listeners are included into it. */
+	FName ListenersNetGroup;
+
+	/** Registered listeners indexed by ids from UCommonInventoryReplication. Membership and access checks test the bits, relevancy is up to the NetGroup. */
+	TBitArray<> Listeners;
+
+	/** Listeners registered before BeginPlay, when the NetGroup doesn't exist yet. */
+	TArray<TWeakObjectPtr<const APlayerController>> PendingListeners;
 };
@@ -6,24 +6,43 @@
 #include "InventoryRegistry/CommonInventoryRegistryDataSource.h"
 #include "InventoryRegistry/CommonInventoryRegistryTypes.h"
 
+#include "Containers/Ticker.h"
 #include "Engine/AssetManagerTypes.h"
 #include "HAL/CriticalSection.h"
 #include "Subsystems/EngineSubsystem.h"
+#include "Tasks/Task.h"
+#include "Templates/RefCounting.h"
 #include "UObject/PrimaryAssetId.h"
+
 #include "CommonInventoryRegistry.generated.h"
 
 #ifndef COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
 #define COMMON_INVENTORY_WITH_NETWORK_CHECKSUM (!(UE_BUILD_SHIPPING || UE_BUILD_TEST))
 #endif
 
+#if COMMON_INVENTORY_WITH_NETWORK_CHECKSUM
+namespace CommonInventory
+{
+	// Whether the next replicated item should carry its record checksum. Archetypes are verified once per connection instead.
+	COMMONINVENTORY_API bool ShouldSampleNetworkChecksum();
+}
+#endif
+
+// Whether item payloads are net serialized as a delta against the registry defaults. Must match between clients and servers.
+#ifndef COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING
+#define COMMON_INVENTORY_WITH_DELTA_PAYLOAD_ENCODING 1
+#endif
+
 class UCommonInventoryRegistryDataSource;
+class UPackageMap;
 
 /**
  * A simple registry for storing shared data in a single place and memory block.
  * 
  * Provides various useful utilities including:
- * - Serialization including FPrimaryAssetType/FPrimaryAssetName redirections. Supports the async loading thread.
+ * - Serialization including FPrimaryAssetType/FPrimaryAssetName redirections. Supports lock-free reads from other threads.
  * - Optimized network serialization with desync detection.
+ * - Playback of network replays recorded with another registry state through the RepIndex table embedded into the replay header.
  * - Defaults propagation across reflected types after refreshes.
  * - Tracking dependencies in packages via searchable names.
  * - Optional registry cooking to reduce startup overhead.
@@ -53,11 +72,20 @@ public:
 	static FString GetRegistryFilename();
 	static FString GetDevelopmentRegistryFilename();
 
+	/** Returns the filename for the delta patch applied on top of InventoryRegistry.bin. */
+	static FString GetRegistryPatchFilename();
+
+	/** Returns the filename for the delta patch next to the registry file, so the cook and the runtime agree on it. */
+	static FString GetRegistryPatchFilename(const FString& InRegistryFilename);
+
 public: // Events
 
 	/** Register a delegate to be called once the registry has initialized. */
 	static void CallOrRegister_OnInventoryRegistryInitialized(FSimpleMulticastDelegate::FDelegate&& Delegate);
 
+	/** Blocks until the registry completes the asynchronous load of its state. Returns whether the registry has initialized. */
+	static bool WaitUntilInitialized();
+
 	/** Register a delegate to be called each time the registry is refreshed. */
 	FDelegateHandle Register_OnPostRefresh(FSimpleMulticastDelegate::FDelegate&& Delegate)
 	{
@@ -99,7 +127,7 @@ public: // Data Access
 	/** Returns the registry record pointer from FPrimaryAssetName. */
 	const FCommonInventoryRegistryRecord* FindRegistryRecordFromName(FName InItemName) const
 	{
-		return Algo::FindBy(GetRegistryRecords(), InItemName, &FCommonInventoryRegistryRecord::GetPrimaryAssetName);
+		return RegistryState.GetRecordPtrByName(InItemName);
 	}
 
 	/** Returns all records, or records of the specified type if Archetype is provided. */
@@ -122,11 +150,59 @@ public: // Data Access
 		RegistryState.GetArchetypes(OutArchetypes);
 	}
 
+	/** Returns a handle which resolves the record in O(1) until the registry is rebuilt. */
+	FCommonItemHandle MakeItemHandle(FPrimaryAssetId InPrimaryAssetId) const
+	{
+		return RegistryState.MakeHandle(InPrimaryAssetId);
+	}
+
+	/** Returns the registry record for the handle, or nullptr if the handle is stale. */
+	const FCommonInventoryRegistryRecord* ResolveItemHandle(FCommonItemHandle InHandle) const
+	{
+		return RegistryState.ResolveHandle(InHandle);
+	}
+
+	/** Returns the registry record for the handle, and rebinds the handle to FPrimaryAssetId if it's stale. */
+	const FCommonInventoryRegistryRecord* ResolveItemHandle(FCommonItemHandle& InOutHandle, FPrimaryAssetId InPrimaryAssetId) const
+	{
+		return RegistryState.ResolveHandle(InOutHandle, InPrimaryAssetId);
+	}
+
+	/** Returns MaxStackSize of the record, or 0 if the record doesn't exist. */
+	int32 GetMaxStackSize(FPrimaryAssetId InPrimaryAssetId) const
+	{
+		return RegistryState.GetMaxStackSize(InPrimaryAssetId);
+	}
+
+	/** Returns a dense MaxStackSize column of all records, or records of the specified type if Archetype is provided. Indices match GetRegistryRecords(). */
+	TConstArrayView<int32> GetMaxStackSizes(FPrimaryAssetType InArchetype = FPrimaryAssetType()) const
+	{
+		return RegistryState.GetMaxStackSizes(InArchetype);
+	}
+
+	/** Gathers indices of records which have all the required tags and none of the excluded tags. Indices match GetRegistryRecords(). */
+	void FindRecordsByTags(const FGameplayTagContainer& InRequiredTags, const FGameplayTagContainer& InExcludedTags, TArray<int32>& OutRecordIndices) const
+	{
+		RegistryState.FindRecordsByTags(InRequiredTags, InExcludedTags, OutRecordIndices);
+	}
+
 public: // Item Utils
 
 	/** Resets the item to its default state. */
 	bool ResetItem(FPrimaryAssetId InPrimaryAssetId, FVariadicStruct& InPayload) const;
 
+	/** Makes items in bulk with default payloads. The registry state is pinned once for all the items. Unknown ids produce invalid items. */
+	void MakeItems(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TArrayView<FCommonItem> OutItems) const;
+
+	/** Makes item stacks in bulk, splitting each amount into stacks limited by MaxStackSize. Unknown ids and non-positive amounts are skipped. */
+	void MakeItemStacks(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TConstArrayView<int32> InAmounts, TArray<FCommonItemStack>& OutItemStacks) const;
+
+	/** Resolves record indices, which follow the registry order of archetypes and names, along with MaxStackSizes in bulk. Unknown ids produce INDEX_NONE and zero. */
+	void GetRecordIndices(TConstArrayView<FPrimaryAssetId> InPrimaryAssetIds, TArrayView<int32> OutRecordIndices, TArrayView<int32> OutMaxStackSizes) const;
+
+	/** Returns the cached searchable name of the record, or NAME_None if the record doesn't exist. See FCommonItem::MakeSearchableName(). */
+	FName GetSearchableName(FPrimaryAssetId InPrimaryAssetId) const;
+
 	/** Whether FPrimaryAssetId is synchronized with the payload. */
 	bool ValidateItem(FPrimaryAssetId InPrimaryAssetId, const FVariadicStruct& InPayload) const;
 
@@ -136,27 +212,57 @@ public: // Item Utils
 	/** Serializes FPrimaryAssetId with the payload. */
 	bool SerializeItem(FArchive& Ar, FPrimaryAssetId& InPrimaryAssetId, FVariadicStruct& InPayload) const;
 
+	/**
+	 * Serializes a table of unique FPrimaryAssetIds with batched redirects, which allows to serialize items as compact rows indexing into the table.
+	 * Entries which aren't in the registry are invalidated. InSerializeRows is invoked with the default payloads of the entries while the registry state is pinned.
+	 */
+	bool SerializeItemTable(FArchive& Ar, TArray<FPrimaryAssetId>& InItemTable, TFunctionRef<void(TConstArrayView<FConstStructView>)> InSerializeRows) const;
+
+	/** Returns the checksum the destination of a state handoff should be queried for, see SerializeHandoffItemTable(). */
+	uint32 GetHandoffChecksum() const;
+
+	/**
+	 * Serializes a table of unique FPrimaryAssetIds for a state handoff, e.g. across seamless travel or between servers of a cluster.
+	 * Entries are encoded as RepIndices if InTargetChecksum matches the local registry checksum, so loading skips name lookups and redirects.
+	 * Otherwise, falls back to the name-based encoding of SerializeItemTable(). Loading RepIndices encoded with another registry state fails.
+	 */
+	bool SerializeHandoffItemTable(FArchive& Ar, TArray<FPrimaryAssetId>& InItemTable, uint32 InTargetChecksum, TFunctionRef<void(TConstArrayView<FConstStructView>)> InSerializeRows) const;
+
 	/** Propagates new defaults from the registry. */
 	void PropagateItemDefaults(const FCommonInventoryDefaultsPropagator::FContext& InContext, FPrimaryAssetId& InPrimaryAssetId, FVariadicStruct& InPayload) const;
 
-	/** Efficiently serializes FPrimaryAssetId. For a payload serialization use the returned context. */
-	FCommonInventoryRegistryNetSerializationContext NetSerializeItem(FArchive& Ar, FPrimaryAssetId& InPrimaryAssetId, bool& bOutSuccess) const;
+	/** Efficiently serializes FPrimaryAssetId. For a payload serialization use the returned context. The package map allows resolving items of replays. */
+	FCommonInventoryRegistryNetSerializationContext NetSerializeItem(FArchive& Ar, FPrimaryAssetId& InPrimaryAssetId, bool& bOutSuccess, UPackageMap* InPackageMap = nullptr) const;
 
 	/** Efficiently serializes the item payload with the context returned from NetSerializeItem(). */
 	void NetSerializeItemPayload(FArchive& Ar, FVariadicStruct& InPayload, FCommonInventoryRegistryNetSerializationContext& InContext) const;
 
+public: // Replays
+
+	/** Appends the registry checksum and the RepIndex table to the header of a replay being recorded. */
+	void WriteReplayHeader(TArray<FString>& OutGameSpecificData) const;
+
+	/** Reads the header of a replay being played. Replays recorded with another registry state resolve items through the embedded RepIndex table. */
+	bool ProcessReplayHeader(const TArray<FString>& InGameSpecificData, FString& OutError);
+
+	/** Whether the replay being played resolves items through its own RepIndex table. */
+	bool HasReplayItemTable() const { return !ReplayItemTable.IsEmpty(); }
+
 public: // Registry Utils
 
 	/** Returns the registry data source. */
 	UCommonInventoryRegistryDataSource* GetDataSource() const { return DataSource; }
 
-	/** Returns the internal registry state. */
+	/** Returns the internal registry state. Must only be accessed from the game thread. */
 	const FCommonInventoryRegistryState& GetRegistryState() const { return RegistryState; }
 
+	/** Pins the latest published snapshot of the registry state, which can be safely read from any thread. Refreshes are published once per frame, so it might lag behind GetRegistryState() until the next tick. */
+	TRefCountPtr<const FCommonInventoryRegistrySnapshot> PinRegistrySnapshot() const;
+
 	/** Force refresh the registry state. */
 	void ForceRefresh(bool bSynchronous = false);
 
-	/** Flushes any pending refreshes. */
+	/** Flushes any pending refreshes along with the snapshot publication. */
 	void FlushPendingRefresh();
 
 	/** Cancels any pending refreshes. */
@@ -168,6 +274,12 @@ public: // Registry Utils
 	/** Whether refreshing is in progress. */
 	bool IsRefreshing() const;
 
+	/** Returns the number of bytes held by the published snapshot. Previous snapshots are released by their last readers. */
+	SIZE_T GetSnapshotsAllocatedSize() const;
+
+	/** Returns the peak number of bytes held by the registry states during refreshes. Only tracked in non-shipping builds with CommonInventory.TrackRefreshMemory. */
+	SIZE_T GetPeakRefreshBytes() const { return PeakRefreshBytes; }
+
 #if WITH_EDITOR
 
 	/** Whether the registry is in the cooking mode. */
@@ -179,7 +291,7 @@ public: // Registry Utils
 	/** Put the registry back into the base mode. */
 	void OnCookFinished();
 
-	/** Write the cooked registry state into the file. */
+	/** Write the cooked registry state into the file, along with its delta next to it if -InventoryRegistryPatchBase=<InventoryRegistry.bin> is specified. */
 	void WriteForCook(const ITargetPlatform* InTargetPlatform, const FString& InFilename);
 
 	/** Reports any issues into the log. */
@@ -196,20 +308,33 @@ private:
 	//~ End UEngineSubsystem Interface
 
 	void PostInitialize();
-	bool TryLoadFromFile();
+	void CompleteInitialization();
+	bool TryLoadFromFile(FCommonInventoryRegistryState& OutRegistryState) const;
+
+	bool ShouldLoadAsynchronously() const;
+	void BeginAsyncLoad();
+	void CompleteAsyncLoad();
 
 	void CheckDataSourceContractViolation() const;
 
 	//~ Begin ICommonInventoryRegistryBridge Interface
 	virtual int32 AppendRecords(TConstArrayView<FCommonInventoryRegistryRecord> InRecords) override;
 	virtual int32 RemoveRecords(TConstArrayView<FPrimaryAssetId> InRecordIds) override;
+	virtual FCommonInventoryRegistryState::FDeltaStats ApplyRecords(TConstArrayView<FCommonInventoryRegistryRecord> InUpserts, TConstArrayView<FPrimaryAssetId> InRemoves) override;
 	virtual void ResetRecords(TConstArrayView<FCommonInventoryRegistryRecord> InRecords) override;
 	virtual bool WasLoaded() const override { return bWasLoaded; }
+	virtual uint32 GetRegistryChecksum() const override { return RegistryState.GetChecksum(); }
 	//~ End ICommonInventoryRegistryBridge Interface
 
 	void OnPostRefresh(FCommonInventoryDefaultsPropagationContext& InPropagationContext);
 	void ConditionallyUpdateNetworkChecksum();
 
+	void RegisterReplayDelegates();
+	void UnregisterReplayDelegates();
+
+	void PublishRegistrySnapshot();
+	void SchedulePublishRegistrySnapshot();
+
 private:
 
 	/** The data source responsible for gathering and managing data. */
@@ -220,8 +345,20 @@ private:
 	UPROPERTY()
 	FCommonInventoryRegistryState RegistryState;
 
-	/** The RegistryState guard for supporting the async loading thread. */
-	mutable FCriticalSection CriticalSection;
+	/** The latest snapshot of RegistryState published for other threads. */
+	TRefCountPtr<const FCommonInventoryRegistrySnapshot> CurrentSnapshot;
+
+	/** Only guards adding a reference to CurrentSnapshot against its replacement, so readers never touch a released snapshot. */
+	mutable FRWLock CurrentSnapshotLock;
+
+	/** Ticker coalescing publications of the frame into a single copy of RegistryState. */
+	FTSTicker::FDelegateHandle PublishSnapshotTickerHandle;
+
+	/** The state being loaded on a worker thread. Empty if failed to load. */
+	UE::Tasks::TTask<TUniquePtr<FCommonInventoryRegistryState>> AsyncLoadTask;
+
+	/** Ticker for completing the initialization deferred by the asynchronous load. */
+	FTSTicker::FDelegateHandle AsyncLoadTickerHandle;
 
 	/** Delegate for broadcasting registry updates. */
 	FSimpleMulticastDelegate PostRefreshDelegate;
@@ -229,6 +366,21 @@ private:
 	/** Cached data source traits from CDO. */
 	FCommonInventoryRegistryDataSourceTraits DataSourceTraits;
 
+	/**
+	 * Items of the replay being played in the RepIndex order, if it was recorded with another registry state. Empty otherwise.
+	 * Items are resolved by FPrimaryAssetId, so the table survives refreshes, scrubbing and checkpoint loads without any fixup.
+	 */
+	TArray<FPrimaryAssetId> ReplayItemTable;
+
+	/** Number of bits to encode RepIndex of the replay being played. */
+	int64 ReplayRepIndexEncodingBitsNum = 0;
+
+	/** Handle of the replay header writer. */
+	FDelegateHandle WriteReplayHeaderHandle;
+
+	/** Peak number of bytes held by the live state, snapshots and the propagation context during refreshes. */
+	SIZE_T PeakRefreshBytes = 0;
+
 	/** Whether the registry was loaded from disk. */
 	bool bWasLoaded = false;
 
@@ -27,12 +27,18 @@ public:
 	/** Removes records from the registry. */
 	virtual int32 RemoveRecords(TConstArrayView<FPrimaryAssetId> InRecordIds) = 0;
 
+	/** Removes and then upserts records as a single change, which is propagated once. */
+	virtual FCommonInventoryRegistryState::FDeltaStats ApplyRecords(TConstArrayView<FCommonInventoryRegistryRecord> InUpserts, TConstArrayView<FPrimaryAssetId> InRemoves) = 0;
+
 	/** Full resets the registry state. */
 	virtual void ResetRecords(TConstArrayView<FCommonInventoryRegistryRecord> InRecords) = 0;
 
 	/** Whether the registry was successfully loaded from disk. */
 	virtual bool WasLoaded() const = 0;
 
+	/** Returns the checksum of the current registry state. */
+	virtual uint32 GetRegistryChecksum() const = 0;
+
 #if WITH_EDITOR
 
 	/** Whether the registry is in the cooking mode. */
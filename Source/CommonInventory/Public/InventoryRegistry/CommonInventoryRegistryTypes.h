@@ -10,17 +10,35 @@
 #include "Containers/Array.h"
 #include "Containers/ArrayView.h"
 #include "Containers/Map.h"
+#include "Containers/Queue.h"
 #include "Delegates/Delegate.h"
+#include "HAL/CriticalSection.h"
 #include "InstancedStructContainer.h"
 #include "StructView.h"
 #include "Templates/Function.h"
+#include "Templates/RefCounting.h"
+#include "Templates/SharedPointer.h"
 #include "Templates/UnrealTemplate.h"
+#include "UObject/ObjectKey.h"
 #include "UObject/PrimaryAssetId.h"
 #include "CommonInventoryRegistryTypes.generated.h"
 
+// Whether record checksums hash reflected property values directly instead of their exported text.
+// Must match between clients and servers, as it affects the network checksum.
+#ifndef COMMON_INVENTORY_WITH_BINARY_CHECKSUM
+#define COMMON_INVENTORY_WITH_BINARY_CHECKSUM 1
+#endif
+
 class FArchive;
+class FCustomVersionContainer;
+class FRepLayout;
 struct FCommonInventoryRedirector;
 
+namespace UE::Net
+{
+	struct FCommonItemNetSerializer;
+}
+
 namespace CommonInventory
 {
 	// Reserved index for invalid items.
@@ -83,9 +101,12 @@ public:
 	/** Replication index. */
 	uint32 RepIndex = CommonInventory::INVALID_REPLICATION_INDEX;
 
+	/** Cached RepLayout of default payload, unless it uses native net serialization. Shared between records of the same type. */
+	TSharedPtr<FRepLayout> PayloadRepLayout;
+
 private:
 
-	/** Cached Crc32 hash. */
+	/** Cached hash, see COMMON_INVENTORY_WITH_BINARY_CHECKSUM. */
 	mutable uint32 Checksum = 0;
 
 public:
@@ -132,6 +153,43 @@ public:
 	COMMONINVENTORY_API void Dump() const;
 };
 
+/**
+ * A cached reference to a registry record, which resolves in O(1) without hashing FPrimaryAssetId.
+ * Handles are bound to the registry generation and become stale once records are rebuilt, e.g. after a refresh.
+ * 
+ * @see UCommonInventoryRegistry::MakeItemHandle(), UCommonInventoryRegistry::ResolveItemHandle().
+ */
+struct FCommonItemHandle
+{
+	FCommonItemHandle() = default;
+
+	bool operator==(const FCommonItemHandle&) const = default;
+	bool operator!=(const FCommonItemHandle&) const = default;
+
+	/** Whether the handle has been bound to a record. Stale handles are still set. */
+	bool IsSet() const { return RecordIndex != INDEX_NONE; }
+
+	/** Unbinds the handle. */
+	void Reset() { *this = FCommonItemHandle(); }
+
+private:
+
+	friend struct FCommonInventoryRegistryState;
+
+	FCommonItemHandle(int32 InRecordIndex, uint32 InGeneration)
+		: RecordIndex(InRecordIndex)
+		, Generation(InGeneration)
+	{
+		// Do nothing.
+	}
+
+	/** Index of the record in the registry. */
+	int32 RecordIndex = INDEX_NONE;
+
+	/** Generation of the registry the handle was made with. */
+	uint32 Generation = 0;
+};
+
 /**
  * Internal representation of the registry state.
  */
@@ -144,8 +202,10 @@ struct FCommonInventoryRegistryState
 
 	FCommonInventoryRegistryState() = default;
 	FCommonInventoryRegistryState(FCommonInventoryRegistryState&& Other) = default;
-	FCommonInventoryRegistryState(const FCommonInventoryRegistryState& Other) = default;
-	FCommonInventoryRegistryState& operator=(const FCommonInventoryRegistryState& Other) = default;
+
+	// Cached views must point into our own container.
+	COMMONINVENTORY_API FCommonInventoryRegistryState(const FCommonInventoryRegistryState& Other);
+	COMMONINVENTORY_API FCommonInventoryRegistryState& operator=(const FCommonInventoryRegistryState& Other);
 
 #if UE_VERSION_OLDER_THAN(5, 5, 0)
 	// Prior to 5.5.0, FInstancedStructContainer had a broken move-assignment operator.
@@ -165,6 +225,21 @@ public: // Management
 	/** Removes data from the state. */
 	COMMONINVENTORY_API bool RemoveData(FPrimaryAssetId PrimaryAssetId);
 
+	/** Summary of the changes made by ApplyDelta(). */
+	struct FDeltaStats
+	{
+		int32 NumAdded = 0;
+		int32 NumUpdated = 0;
+		int32 NumRemoved = 0;
+	};
+
+	/**
+	 * Updates existing data or creates a new one, and removes data from the state in a single pass.
+	 * Removals are applied before upserts, so FPrimaryAssetId present in both ends up upserted.
+	 * Unlike AppendData()/RemoveData(), the secondary data is fixed up only once.
+	 */
+	COMMONINVENTORY_API FDeltaStats ApplyDelta(TConstArrayView<FCommonInventoryRegistryRecord> InUpserts, TConstArrayView<FPrimaryAssetId> InRemoves = TConstArrayView<FPrimaryAssetId>());
+
 public: // Access
 
 	/** Whether the registry contains any data. */
@@ -190,10 +265,10 @@ public: // Access
 		return nullptr;
 	}
 
-	/** Returns the registry record pointer from RepIndex. */
-	const FCommonInventoryRegistryRecord* GetRecordFromReplication(uint32 RepIndex) const
+	/** Returns the registry record pointer for FPrimaryAssetName. Names are expected to be unique across archetypes. */
+	const FCommonInventoryRegistryRecord* GetRecordPtrByName(FName PrimaryAssetName) const
 	{
-		if (const int32* const Idx = ReplicationMap.Find(RepIndex))
+		if (const int32* const Idx = NameMap.Find(PrimaryAssetName))
 		{
 			return &DataContainer[*Idx];
 		}
@@ -201,6 +276,18 @@ public: // Access
 		return nullptr;
 	}
 
+	/** Returns the registry record pointer from RepIndex. RepIndex is dense and directly maps onto DataContainer. */
+	const FCommonInventoryRegistryRecord* GetRecordFromReplication(uint32 RepIndex) const
+	{
+		// The unsigned subtraction wraps INVALID_REPLICATION_INDEX around, so a single bounds check is enough.
+		if (const uint32 Idx = RepIndex - /* Invalid */ 1; Idx < static_cast<uint32>(DataContainer.Num()))
+		{
+			return &DataContainer.GetData()[Idx];
+		}
+
+		return nullptr;
+	}
+
 	/** Returns the total number of records, or the number of records of the specified type if Archetype is provided. */
 	int32 GetRecordsNum(FPrimaryAssetType InArchetype = FPrimaryAssetType()) const
 	{
@@ -233,6 +320,24 @@ public: // Access
 		return MakeArrayView(DataContainer);
 	}
 
+	/** Returns the index of the record in GetRecords() and the hot columns, or INDEX_NONE. */
+	int32 GetRecordIndex(FPrimaryAssetId PrimaryAssetId) const
+	{
+		const int32* const Idx = DataMap.Find(PrimaryAssetId);
+		return Idx ? *Idx : INDEX_NONE;
+	}
+
+	/** Returns the searchable name built once per record, or NAME_None if the record doesn't exist. Always NAME_None outside of the editor. */
+	FName GetSearchableName(FPrimaryAssetId PrimaryAssetId) const
+	{
+#if WITH_EDITOR
+		const int32 Idx = GetRecordIndex(PrimaryAssetId);
+		return Idx != INDEX_NONE ? SearchableNames[Idx] : NAME_None;
+#else
+		return NAME_None;
+#endif
+	}
+
 	/** Returns all record ids, or record ids of the specified type if Archetype is provided. */
 	template<typename Allocator>
 	void GetRecordIds(TArray<FPrimaryAssetId, Allocator>& OutRecordIds, FPrimaryAssetType InArchetype = FPrimaryAssetType()) const
@@ -250,14 +355,82 @@ public: // Access
 		Algo::Transform(Archetypes, OutArchetypes, &FArchetypeGroup::PrimaryAssetType);
 	}
 
+public: // Handles
+
+	/** Returns the generation, which changes whenever records are rebuilt. Unique across all states. */
+	uint32 GetGeneration() const { return Generation; }
+
+	/** Returns a handle to the record, or an unset handle if the record doesn't exist. */
+	FCommonItemHandle MakeHandle(FPrimaryAssetId PrimaryAssetId) const
+	{
+		const int32 Idx = GetRecordIndex(PrimaryAssetId);
+		return Idx != INDEX_NONE ? FCommonItemHandle(Idx, Generation) : FCommonItemHandle();
+	}
+
+	/** Returns the record pointer for the handle, or nullptr if the handle is stale or unset. */
+	const FCommonInventoryRegistryRecord* ResolveHandle(FCommonItemHandle InHandle) const
+	{
+		if (InHandle.Generation == Generation && DataContainer.IsValidIndex(InHandle.RecordIndex))
+		{
+			return &DataContainer.GetData()[InHandle.RecordIndex];
+		}
+
+		return nullptr;
+	}
+
+	/** Returns the record pointer for the handle, and rebinds the handle to FPrimaryAssetId if it's stale or unset. */
+	const FCommonInventoryRegistryRecord* ResolveHandle(FCommonItemHandle& InOutHandle, FPrimaryAssetId PrimaryAssetId) const
+	{
+		if (const FCommonInventoryRegistryRecord* const Record = ResolveHandle(InOutHandle); Record && Record->GetPrimaryAssetId() == PrimaryAssetId)
+		{
+			return Record;
+		}
+
+		InOutHandle = MakeHandle(PrimaryAssetId);
+		return ResolveHandle(InOutHandle);
+	}
+
+public: // Bulk Access
+
+	/** Returns MaxStackSize of the record, or 0 if the record doesn't exist. */
+	int32 GetMaxStackSize(FPrimaryAssetId PrimaryAssetId) const
+	{
+		const int32 Idx = GetRecordIndex(PrimaryAssetId);
+		return Idx != INDEX_NONE ? MaxStackSizes[Idx] : 0;
+	}
+
+	/** Returns a dense MaxStackSize column of all records, or records of the specified type if Archetype is provided. Indices match GetRecords(). */
+	TConstArrayView<int32> GetMaxStackSizes(FPrimaryAssetType InArchetype = FPrimaryAssetType()) const
+	{
+		return GetColumn(MaxStackSizes, InArchetype);
+	}
+
+	/** Returns a dense DefaultPayload type column of all records, or records of the specified type if Archetype is provided. Indices match GetRecords(). */
+	TConstArrayView<const UScriptStruct*> GetDefaultPayloadTypes(FPrimaryAssetType InArchetype = FPrimaryAssetType()) const
+	{
+		return GetColumn(DefaultPayloadTypes, InArchetype);
+	}
+
+	/**
+	 * Gathers indices of records which have all the required tags and none of the excluded tags in the registry order. Indices match GetRecords().
+	 * Tags are matched the same way as FGameplayTagContainer::HasTag(), so parent tags match their children.
+	 */
+	COMMONINVENTORY_API void FindRecordsByTags(const FGameplayTagContainer& InRequiredTags, const FGameplayTagContainer& InExcludedTags, TArray<int32>& OutRecordIndices) const;
+
 public: // Utils
 
+	/** [Game Thread] Builds RepLayouts of payload types without native net serialization, e.g. after the state was loaded on a worker. */
+	COMMONINVENTORY_API void RefreshRepLayouts();
+
 	/** Returns number of bits to encode RepIndex. */
 	int64 GetRepIndexEncodingBitsNum() const { return RepIndexEncodingBitsNum; }
 
 	/** Returns a lazily calculated Crc32 checksum excluding metadata. Can be used to validate network compatibility, etc. */
 	COMMONINVENTORY_API uint32 GetChecksum() const;
 
+	/** Returns a lazily calculated checksum of records of the specified type. Returns 0 if the archetype isn't registered. */
+	COMMONINVENTORY_API uint32 GetArchetypeChecksum(FPrimaryAssetType InArchetype) const;
+
 	/** Writes the state directly into a file. */
 	COMMONINVENTORY_API bool SaveToFile(const FString& Filename, bool bIsCooking = false);
 
@@ -270,12 +443,65 @@ public: // Utils
 	/** Reads the state from FArchive. */
 	COMMONINVENTORY_API bool LoadState(FArchive& Ar, bool bIsCooked = false);
 
+	/** Returns the header checksum of the file the state was last loaded from or saved into, which keys delta patches. */
+	uint32 GetFileChecksum() const { return FileChecksum; }
+
+	/** Writes records upserted and removed relative to the base state, which must have been loaded from or saved into a file. */
+	COMMONINVENTORY_API bool SaveDeltaToFile(const FString& Filename, const FCommonInventoryRegistryState& InBaseState) const;
+
+	/** Applies the delta patch if it was made against the file the state was loaded from. */
+	COMMONINVENTORY_API bool ApplyDeltaFromFile(const FString& Filename);
+
 	/** Removes all the records identical to the records from the base state. */
 	COMMONINVENTORY_API void DiffRecords(const FCommonInventoryRegistryState& InBaseState);
 
 	/** Dumps the internal registry state into the log. */
 	COMMONINVENTORY_API void Dump() const;
 
+public: // Memory
+
+	/** Memory breakdown of the state. */
+	struct FMemoryStats
+	{
+		/** Records including their inline data. */
+		SIZE_T DataContainerBytes = 0;
+
+		/** Default payloads and custom data. */
+		SIZE_T CustomDataBytes = 0;
+
+		/** DataMap, NameMap, archetype groups and RepLayouts. */
+		SIZE_T LookupBytes = 0;
+
+		/** Hot columns, TagIndex, free custom data slots and the name search index. */
+		SIZE_T IndexBytes = 0;
+
+		/** The number of default payloads which fit into FVariadicStruct without dynamic allocation, and which don't. */
+		int32 NumInlinePayloads = 0;
+		int32 NumHeapPayloads = 0;
+
+		/** Bytes of records with their tags, default payloads and custom data per archetype. */
+		TMap<FPrimaryAssetType, SIZE_T> ArchetypeBytes;
+
+		SIZE_T GetTotalBytes() const { return DataContainerBytes + CustomDataBytes + LookupBytes + IndexBytes; }
+	};
+
+	/** Gathers the memory breakdown. Sizes of default payloads and custom data are estimated from their struct sizes. */
+	COMMONINVENTORY_API FMemoryStats GetMemoryStats() const;
+
+public: // Search
+
+	/**
+	 * Gathers records which FPrimaryAssetName contains the substring (case-insensitive) in the registry order.
+	 * Lazily builds the search index, so it should only be used on the game thread and never on published snapshots.
+	 */
+	COMMONINVENTORY_API void FindRecordsByNameSubstring(FStringView InSubstring, TArray<const FCommonInventoryRegistryRecord*>& OutRecords, int32 MaxResults = MAX_int32) const;
+
+	/**
+	 * Gathers records which FPrimaryAssetName starts with the prefix (case-insensitive) in the lexical order.
+	 * Lazily builds the search index, so it should only be used on the game thread and never on published snapshots.
+	 */
+	COMMONINVENTORY_API void FindRecordsByNamePrefix(FStringView InPrefix, TArray<const FCommonInventoryRegistryRecord*>& OutRecords, int32 MaxResults = MAX_int32) const;
+
 protected:
 
 	/** A struct wrapper over a group of records of the same type. */
@@ -287,6 +513,29 @@ protected:
 		mutable uint32 Checksum = 0;
 	};
 
+	/** Returns the range of the column matching the archetype group, records of the same type are stored contiguously. */
+	template<typename T>
+	TConstArrayView<T> GetColumn(const TArray<T>& InColumn, FPrimaryAssetType InArchetype) const
+	{
+		if (InArchetype.IsValid())
+		{
+			if (const FArchetypeGroup* const TypeGroup = FindArchetypeGroup(InArchetype))
+			{
+				return MakeArrayView(InColumn.GetData() + TypeGroup->Begin, TypeGroup->Offset);
+			}
+
+			return TConstArrayView<T>();
+		}
+
+		return MakeArrayView(InColumn);
+	}
+
+	/** Refreshes hot columns of the record from DataContainer. */
+	void RefreshHotColumns(int32 InRecordIndex);
+
+	/** Sets or clears the record bit for the tags and their parents in TagIndex. */
+	void IndexRecordTags(int32 InRecordIndex, const FGameplayTagContainer& InTags, bool bIsIndexed);
+
 	const FArchetypeGroup* FindArchetypeGroup(FPrimaryAssetType PrimaryAssetType) const
 	{
 		return Algo::FindBy(Archetypes, PrimaryAssetType, &FArchetypeGroup::PrimaryAssetType);
@@ -297,9 +546,46 @@ protected:
 		return Algo::FindBy(Archetypes, PrimaryAssetType, &FArchetypeGroup::PrimaryAssetType);
 	}
 
-	void FixupDependencies(bool bMigrateArchetypeChecksum = false);
+	/** Lazily built index for searching records by name, mostly used by tooling. */
+	struct FNameSearchIndex
+	{
+		/** Lowercase names in the registry order. */
+		TArray<FString> LowerNames;
+
+		/** LowerNames indices in the lexical order. */
+		TArray<int32> SortedIndices;
+
+		/** Maps lowercase trigrams to LowerNames indices in the registry order. */
+		TMap<uint64, TArray<int32>> Trigrams;
+
+		bool IsEmpty() const { return LowerNames.IsEmpty(); }
+		void Reset() { LowerNames.Empty(); SortedIndices.Empty(); Trigrams.Empty(); }
+	};
+
+	const FNameSearchIndex& GetNameSearchIndex() const;
+
+	/** Rebuilds mappings, views and indices derived from DataContainer. Cooked states can keep TagIndex loaded as-is. RepLayouts are only built on the game thread. */
+	void FixupDependencies(bool bMigrateArchetypeChecksum = false, bool bKeepTagIndex = false);
+
+	/** Copies data into a free slot of the same type, or appends a new one. Returns the slot index. */
+	int32 AddCustomData(FConstStructView InStructView);
+
+	/** Marks the slot as free without shifting subsequent slots, so indices and views remain stable. */
 	void RemoveCustomData(int32 InCustomDataIndex);
 
+	/** Removes free slots and remaps indices of records. Invalidates views held outside of the state. */
+	void CompactCustomData();
+
+	/** Compacts CustomDataContainer if free slots make up a significant part of it. */
+	void ConditionalCompactCustomData();
+
+	/** Refreshes DefaultPayload and CustomData views from indices. */
+	void RefreshCustomDataViews();
+
+	void SaveMappedState(FArchive& Ar, FCustomVersionContainer& OutVersionContainer);
+	bool LoadMappedState(TConstArrayView64<uint8> InSerializedState, const FCustomVersionContainer& InVersionContainer, uint32 InVersion, uint32& OutCookedChecksum);
+	bool LoadSerializedState(TConstArrayView64<uint8> InSerializedState, const FCustomVersionContainer& InVersionContainer, uint32 InChecksum, uint32 InVersion, bool bIsCooked);
+
 private:
 
 	/** Storage for registry records with metadata. */
@@ -310,20 +596,66 @@ private:
 	UPROPERTY()
 	FInstancedStructContainer CustomDataContainer;
 
+	/** Hot columns mirroring DataContainer, which allow bulk queries to skip the rest of the record data. */
+	TArray<int32> MaxStackSizes;
+	TArray<const UScriptStruct*> DefaultPayloadTypes;
+
+	/** Maps gameplay tags, including parents of explicit tags, onto bitsets over record indices. */
+	TMap<FGameplayTag, TArray<uint64>> TagIndex;
+
+	/** Free CustomDataContainer slots grouped by type, which are reused until the container is compacted. */
+	TMap<const UScriptStruct*, TArray<int32>> FreeCustomData;
+
+	/** Total number of free CustomDataContainer slots. */
+	int32 NumFreeCustomData = 0;
+
 	/** FPrimaryAssetType related data. */
 	TArray<FArchetypeGroup, TInlineAllocator<12>> Archetypes;
 
 	/** Maps FPrimaryAssetIds to DataContainer indices. */
 	TMap<FPrimaryAssetId, int32> DataMap;
 
-	/** Maps RepIndex to DataContainer indices. */
-	TMap<uint32, int32> ReplicationMap;
+	/** Maps FPrimaryAssetNames to DataContainer indices. */
+	TMap<FName, int32> NameMap;
+
+	/** Lazily built name search index. */
+	mutable FNameSearchIndex NameSearchIndex;
+
+#if WITH_EDITOR
+	/** Searchable names mirroring DataContainer, so saving items doesn't build strings. */
+	TArray<FName> SearchableNames;
+#endif
+
+	/** RepLayouts of payload types without native net serialization. */
+	TMap<const UScriptStruct*, TSharedPtr<FRepLayout>> RepLayouts;
 
 	/** Number of bits to encode RepIndex. */
 	int64 RepIndexEncodingBitsNum = 0;
 
+	/** Bumped in FixupDependencies() to invalidate FCommonItemHandle. */
+	uint32 Generation = 0;
+
 	/** Crc32 checksum excluding metadata. */
 	mutable uint32 Checksum = 0;
+
+	/** Header checksum of the file the state was last loaded from or saved into. */
+	uint32 FileChecksum = 0;
+};
+
+/**
+ * Immutable ref-counted copy of the registry state, published for lock-free reads outside of the game thread.
+ */
+struct FCommonInventoryRegistrySnapshot final : public FThreadSafeRefCountedObject
+{
+	explicit FCommonInventoryRegistrySnapshot(const FCommonInventoryRegistryState& InRegistryState)
+		: RegistryState(InRegistryState)
+	{
+		// Prime lazily calculated checksums, so readers never write into the shared state.
+		RegistryState.GetChecksum();
+	}
+
+	/** The actual state, which is never modified after the publication. */
+	const FCommonInventoryRegistryState RegistryState;
 };
 
 /**
@@ -365,6 +697,9 @@ public:
 	/** Whether FPrimaryAssetName has any redirects. */
 	COMMONINVENTORY_API bool HasNameRedirects(FName InPrimaryAssetName) const;
 
+	/** Returns the number of bytes allocated by the redirection maps and caches. */
+	COMMONINVENTORY_API SIZE_T GetAllocatedSize() const;
+
 	/**
 	 * Traverses over permutations of type and name redirects.
 	 * Without timestamps, it is impossible to reconstruct the original redirection chain.
@@ -390,8 +725,42 @@ private:
 
 	FCommonInventoryRedirects();
 
+	/** Replaces the redirection maps and rebuilds the derived caches. */
+	void SetRedirects(TMap<FName, FName>&& InTypeRedirects, TMap<FName, FName>&& InNameRedirects);
+
+	/** Redirects FPrimaryAssetId through the redirection maps, bypassing ResolvedIds. */
+	bool TryRedirectUncached(FPrimaryAssetId& InPrimaryAssetId) const;
+
+	/** Collapsed redirects, which map old values directly onto final values. */
 	TMap<FName, FName> TypeRedirectionMap;
 	TMap<FName, FName> NameRedirectionMap;
+
+	/** Reverse redirects, which map final values onto all the old values. */
+	TMap<FName, TArray<FName>> TypeRedirectSources;
+	TMap<FName, TArray<FName>> NameRedirectSources;
+
+	/** Adds a resolved FPrimaryAssetId, evicting the first entry not hit since the last sweep once the cache is full. */
+	void CacheResolvedId(FPrimaryAssetId InOriginalId, FPrimaryAssetId InResolvedId) const;
+
+	struct FResolvedIdEntry
+	{
+		FPrimaryAssetId OriginalId;
+
+		/** Ids known not to redirect are stored as invalid ids. */
+		FPrimaryAssetId ResolvedId;
+	};
+
+	/** Bounded cache of resolved FPrimaryAssetIds with clock eviction. */
+	mutable TArray<FResolvedIdEntry> ResolvedIds;
+	mutable TMap<FPrimaryAssetId, int32> ResolvedIdSlots;
+
+	/** Set by lookups under the read lock and cleared by the clock hand, one per cache slot. */
+	TUniquePtr<std::atomic<bool>[]> ResolvedIdsReferenced;
+	mutable int32 ResolvedIdsClockHand = 0;
+	mutable FRWLock ResolvedIdsLock;
+
+	/** Whether there are any redirects, which allows to skip lookups entirely. */
+	bool bHasRedirects = false;
 };
 
 /**
@@ -472,10 +841,90 @@ public: // Core
 	/** Gathers objects for defaults propagation. */
 	COMMONINVENTORY_API bool GatherObjectsForPropagation(const FContext& InContext, TArray<UObject*>& OutObjects);
 
+	/** Returns top-level properties of the type which can hold items, including nested structs, containers and instanced object references. The schema is cached. */
+	COMMONINVENTORY_API TConstArrayView<const FProperty*> GetPropagationSchema(const UStruct* InStruct);
+
+	/** Drops cached schemas, e.g. after types were reinstanced. */
+	COMMONINVENTORY_API void InvalidatePropagationSchemas();
+
+#if WITH_EDITOR
+
+public: // Reference Index
+
+	/** Records the object being serialized by the archive as a holder of the item. Called from FCommonItem::Serialize on any thread. */
+	COMMONINVENTORY_API void RecordItemReference(FArchive& Ar, FPrimaryAssetId InPrimaryAssetId);
+
+	/** Re-indexes items held by the object and its subobjects. */
+	COMMONINVENTORY_API void IndexObject(UObject* InObject);
+
+	/** Starts tracking editor changes, which don't go through persistent serialization. */
+	void StartReferenceIndexing();
+	void StopReferenceIndexing();
+
+#endif
+
 private:
 
 	FCommonInventoryDefaultsPropagator() = default;
 
+	/** Whether the property can hold items. Visiting breaks recursive types. */
+	bool CanHoldItems(const FProperty* InProperty, TSet<const UStruct*>& InVisitingStructs);
+	bool CanHoldItems(const UStruct* InStruct, TSet<const UStruct*>& InVisitingStructs);
+
+	/** Cached schemas. Keys don't dangle after types are garbage collected. */
+	TMap<FObjectKey, TArray<const FProperty*>> PropagationSchemas;
+
+#if WITH_EDITOR
+
+	FDelegateHandle OnObjectsReinstancedHandle;
+	FDelegateHandle OnReloadCompleteHandle;
+
+	/** Gathers indexed objects holding the item. Returns false if there were no hits. */
+	bool GatherIndexedObjects(FPrimaryAssetId InPrimaryAssetId, TArray<UObject*>& OutObjects) const;
+
+	/** Whether all the items in the package were recorded during its load or save. */
+	bool IsPackageIndexed(FName InPackageName) const;
+
+	/** Maintain the index. Only called from the game thread. */
+	void AddItemReference(FObjectKey InObject, FPrimaryAssetId InPrimaryAssetId);
+	void RemoveItemReferences(FObjectKey InObject);
+
+	/** Moves references recorded on other threads into the index. */
+	void FlushPendingReferences();
+
+	/** Drops garbage collected objects and unloaded packages from the index. */
+	void PurgeStaleReferences();
+
+	/** A reference recorded on a loading thread. */
+	struct FPendingItemReference
+	{
+		FObjectKey Object;
+		FPrimaryAssetId PrimaryAssetId;
+
+		/** The package of the object if it's being loaded or saved as a whole. */
+		FName IndexedPackage;
+	};
+
+	/** References recorded on other threads, as packages are loaded on the async loading thread. */
+	TQueue<FPendingItemReference, EQueueMode::Mpsc> PendingReferences;
+
+	/** Loaded objects holding items. Game thread only. */
+	TMap<FPrimaryAssetId, TSet<FObjectKey>> ReferenceIndex;
+
+	/** Items held by each indexed object, so re-indexing and garbage collection drop their entries. Game thread only. */
+	TMap<FObjectKey, TArray<FPrimaryAssetId, TInlineAllocator<2>>> ObjectReferences;
+
+	/** Packages which were fully serialized since the index was created and haven't been dirtied since. Game thread only. */
+	TSet<FName> IndexedPackages;
+
+	FDelegateHandle OnObjectPropertyChangedHandle;
+	FDelegateHandle OnObjectTransactedHandle;
+	FDelegateHandle OnPackageMarkedDirtyHandle;
+	FDelegateHandle OnLevelActorAddedHandle;
+	FDelegateHandle OnPostGarbageCollectHandle;
+
+#endif
+
 	FGatherObjectsOverrideDelegate GatherObjectsOverrideDelegate;
 	FDefaultsPropagationDelegate PreDefaultsPropagationDelegate;
 	FDefaultsPropagationDelegate PostDefaultsPropagationDelegate;
@@ -492,6 +941,8 @@ struct FCommonInventoryRegistryNetSerializationContext
 {
 private:
 	friend class UCommonInventoryRegistry;
+	friend struct UE::Net::FCommonItemNetSerializer;
+	friend struct FCommonInventoryTestAccess; // Automation tests in CommonInventoryTests.
 	FCommonInventoryRegistryNetSerializationContext(FPrimaryAssetId InPrimaryAssetId, bool& bOutSuccess)
 		: PrimaryAssetId(InPrimaryAssetId), bOutSuccess(bOutSuccess)
 	{
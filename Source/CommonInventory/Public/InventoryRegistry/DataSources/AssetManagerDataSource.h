@@ -3,14 +3,20 @@
 #pragma once
 
 #include "InventoryRegistry/CommonInventoryRegistryDataSource.h"
+#include "InventoryRegistry/CommonInventoryRegistryTypes.h"
 
 #include "Containers/Array.h"
 #include "Containers/ArrayView.h"
+#include "Containers/Map.h"
 #include "Containers/Set.h"
+#include "Containers/Ticker.h"
 #include "Engine/AssetManagerTypes.h"
+#include "InstancedStruct.h"
+#include "IO/IoHash.h"
 #include "Templates/SharedPointer.h"
 #include "UObject/NameTypes.h"
 #include "UObject/SoftObjectPtr.h"
+#include "UObject/WeakObjectPtrTemplates.h"
 
 #include "AssetManagerDataSource.generated.h"
 
@@ -61,6 +67,8 @@ class COMMONINVENTORY_API UAssetManagerDataSource : public UCommonInventoryRegis
 {
 	GENERATED_BODY()
 
+protected:
+
 	UAssetManagerDataSource();
 
 public: // Overrides
@@ -88,13 +96,19 @@ public:
 
 #if WITH_EDITOR
 	
-	// IAssetRegistry callbacks.
+	// IAssetRegistry callbacks. Changes are queued and committed to the registry once per frame, see FlushQueuedChanges().
 	virtual void OnAssetCreated(UCommonItemDefinition* InItemDefinition);
 	virtual void OnAssetRemoved(const FAssetData& InRemovedAsset);
 	virtual void OnAssetRenamed(UCommonItemDefinition* InItemDefinition, const FSoftObjectPath& OldObjectPath, bool& bOutRedirectorFailed);
 
 	virtual void RefreshItemDefinition(UCommonItemDefinition* InItemDefinition);
 
+	/** Commits the queued changes of definitions as a single registry update, so bulk imports and moves are propagated only once. */
+	void FlushQueuedChanges();
+
+	/** Whether any changes of definitions are waiting for the flush. */
+	bool HasQueuedChanges() const { return !QueuedDefinitions.IsEmpty() || !QueuedRemovals.IsEmpty() || bIsTypeInfoListDirty || bAreRedirectsDirty; }
+
 #endif // WITH_EDITOR
 
 protected:
@@ -103,8 +117,32 @@ protected:
 	virtual TSharedPtr<FStreamableHandle> PreloadPrimaryAssets();
 	virtual void ScanPrimaryAssetPaths(TArrayView<FPrimaryAssetTypeInfo> TypeInfoList);
 
+	/** Allows to build records without loading assets. Resolved assets should be removed from the list and their records added to PendingRecords. */
+	virtual void ResolvePrimaryAssets(TArray<FPrimaryAssetId>& InOutPrimaryAssets) {}
+
+	/** Passes the refreshed records to the registry, either as a full reset or as an incremental change. */
+	void CommitRecords(TConstArrayView<FCommonInventoryRegistryRecord> InRecords);
+
 #if WITH_EDITOR
 	void AppendTypeInfoList(FCommonInventoryTypeInfo& InTypeInfo, const UCommonItemDefinition* InItemDefinition);
+
+	/** Filters out definitions whose packages haven't changed since they were added to the registry and collects removed ones. Returns false if a full refresh is required. */
+	virtual bool DiffPrimaryAssets(TArray<FPrimaryAssetId>& InOutPrimaryAssets, TArray<FPrimaryAssetId>& OutRemovedAssets) const;
+
+	/** Queues the definition for the next flush, which builds its record. Only registered definitions are refreshed unless it's new. */
+	void QueueDefinition(UCommonItemDefinition* InItemDefinition, bool bIsNew);
+
+	/** Schedules FlushQueuedChanges() for the next tick. */
+	void ScheduleQueuedChangesFlush();
+
+	/** Remembers the package hash of the loaded definition for further diffs. */
+	void UpdatePackageHash(const UCommonItemDefinition* InItemDefinition);
+	void UpdatePackageHash(const FPrimaryAssetId& InPrimaryAssetId, FName InPackageName);
+
+	/** Package hashes are persisted along with the development registry state, and only loaded if the registry checksum still matches. */
+	static FString GetPackageHashesFilename();
+	void LoadPackageHashes();
+	void SavePackageHashes() const;
 #endif // WITH_EDITOR
 
 protected:
@@ -122,10 +160,60 @@ protected:
 	/** Assets loaded since the last refresh. */
 	TSharedPtr<FStreamableHandle> PreloadHandle;
 	
+	/** Records resolved without loading assets, which are committed along with the loaded ones. */
+	TArray<FCommonInventoryRegistryRecord> PendingRecords;
+
+	/** Storage for default payloads and custom data viewed by PendingRecords. */
+	TArray<FInstancedStruct> PendingRecordData;
+
 	/** Whether we should keep loaded assets. */
 	UPROPERTY(Config)
 	bool bKeepLoadedAssets;
 
+	/** Whether refreshes should only load definitions which have changed on disk since the last refresh. Editor only. */
+	UPROPERTY(Config)
+	bool bUseIncrementalRefresh;
+
+#if WITH_EDITORONLY_DATA
+
+	/** Saved package hashes of definitions in the registry. */
+	TMap<FPrimaryAssetId, FIoHash> PackageHashes;
+
+	/** Records to remove once the pending incremental refresh completes. */
+	TArray<FPrimaryAssetId> PendingRemovals;
+
+	/** Whether the pending refresh only carries changes. */
+	bool bIsIncrementalRefresh = false;
+
+	/** Definition queued for the next flush. */
+	struct FQueuedDefinition
+	{
+		TWeakObjectPtr<UCommonItemDefinition> Definition;
+
+		/** Whether the record is appended even if the asset manager isn't aware of the definition yet. */
+		bool bIsNew = false;
+	};
+
+	/** Definitions which records are rebuilt at the next flush. */
+	TMap<FPrimaryAssetId, FQueuedDefinition> QueuedDefinitions;
+
+	/** Records removed at the next flush, before upserting the queued definitions. */
+	TSet<FPrimaryAssetId> QueuedRemovals;
+
+	/** Pending flush of the queued changes. */
+	FTSTicker::FDelegateHandle QueuedChangesTickerHandle;
+
+	/** Whether the config and the asset manager type infos have to be refreshed at the next flush. */
+	bool bIsTypeInfoListDirty = false;
+
+	/** Whether the redirects and their config have to be refreshed at the next flush. */
+	bool bAreRedirectsDirty = false;
+
+	/** Whether PackageHashes matches the loaded registry state. */
+	bool bHasPackageHashes = false;
+
+#endif // WITH_EDITORONLY_DATA
+
 	/** Mainly used because of GStreamableDelegateDelayFrames. */
 	bool bIsPendingRefresh;
 
@@ -0,0 +1,25 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "InventoryRegistry/DataSources/AssetManagerDataSource.h"
+
+#include "AssetRegistryTagsDataSource.generated.h"
+
+/**
+ * A persistent data source that builds registry records from asset registry tags exported by UCommonItemDefinition,
+ * which avoids loading definitions at startup. Falls back to loading definitions with missing or outdated tags.
+ * 
+ * @see UCommonItemDefinition::RegistryDataTagName.
+ */
+UCLASS(Config = Game, DefaultConfig)
+class COMMONINVENTORY_API UAssetRegistryTagsDataSource : public UAssetManagerDataSource
+{
+	GENERATED_BODY()
+
+	UAssetRegistryTagsDataSource() = default;
+
+protected: // Overrides
+
+	virtual void ResolvePrimaryAssets(TArray<FPrimaryAssetId>& InOutPrimaryAssets) override;
+};
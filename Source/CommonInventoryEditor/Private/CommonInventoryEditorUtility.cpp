@@ -93,7 +93,7 @@ namespace CommonInventoryEditor
 				return false;
 			}
 
-			if (Algo::FindBy(UCommonInventoryRegistry::Get().GetRegistryRecords(), NewName, &FCommonInventoryRegistryRecord::GetPrimaryAssetName))
+			if (UCommonInventoryRegistry::Get().FindRegistryRecordFromName(NewName))
 			{
 				if (OutErrorMessage)
 				{
@@ -0,0 +1,91 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "CommonInventoryValidateCommandlet.h"
+#include "CommonItemDefinition.h"
+#include "InventoryRegistry/CommonInventoryRegistry.h"
+
+#include "Algo/Count.h"
+#include "AssetRegistry/AssetData.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Async/ParallelFor.h"
+#include "Misc/DataValidation.h"
+#include "Misc/Parse.h"
+
+#include UE_INLINE_GENERATED_CPP_BY_NAME(CommonInventoryValidateCommandlet)
+
+DEFINE_LOG_CATEGORY_STATIC(LogCommonInventoryValidate, Log, All);
+
+UCommonInventoryValidateCommandlet::UCommonInventoryValidateCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UCommonInventoryValidateCommandlet::Main(const FString& Params)
+{
+	IAssetRegistry& AssetRegistry = IAssetRegistry::GetChecked();
+	AssetRegistry.SearchAllAssets(/* bSynchronousSearch */ true);
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssetsByClass(UCommonItemDefinition::StaticClass()->GetClassPathName(), Assets, /* bSearchSubClasses */ true);
+
+	// Loading must happen on the game thread.
+	TArray<const UCommonItemDefinition*> Definitions;
+	Definitions.Reserve(Assets.Num());
+
+	for (const FAssetData& AssetData : Assets)
+	{
+		if (const UCommonItemDefinition* const Definition = Cast<UCommonItemDefinition>(AssetData.GetAsset()))
+		{
+			Definitions.Add(Definition);
+		}
+		else
+		{
+			UE_LOG(LogCommonInventoryValidate, Error, TEXT("Failed to load '%s'."), *AssetData.GetObjectPathString());
+		}
+	}
+
+	// Definitions don't depend on each other, so each one is validated into its own context.
+	TArray<FDataValidationContext> Contexts;
+	Contexts.SetNum(Definitions.Num());
+
+	TArray<EDataValidationResult> Results;
+	Results.SetNum(Definitions.Num());
+
+	const EParallelForFlags Flags = FParse::Param(*Params, TEXT("SingleThreaded")) ? EParallelForFlags::ForceSingleThread : EParallelForFlags::None;
+
+	ParallelFor(Definitions.Num(), [&Definitions, &Contexts, &Results](int32 Idx)
+	{
+		Results[Idx] = Definitions[Idx]->IsDataValid(Contexts[Idx]);
+	}, Flags);
+
+	// Report in a deterministic order.
+	for (int32 Idx = 0; Idx < Definitions.Num(); ++Idx)
+	{
+		for (const FDataValidationContext::FIssue& Issue : Contexts[Idx].GetIssues())
+		{
+			if (Issue.Severity == EMessageSeverity::Error)
+			{
+				UE_LOG(LogCommonInventoryValidate, Error, TEXT("%s: %s"), *GetPathNameSafe(Definitions[Idx]), *Issue.Message.ToString());
+			}
+			else
+			{
+				UE_LOG(LogCommonInventoryValidate, Warning, TEXT("%s: %s"), *GetPathNameSafe(Definitions[Idx]), *Issue.Message.ToString());
+			}
+		}
+	}
+
+	// The registry should have picked up the loaded definitions by now.
+	if (UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr())
+	{
+		Registry->FlushPendingRefresh();
+		Registry->ReportInvariantViolation();
+	}
+
+	const int32 NumFailed = Algo::Count(Results, EDataValidationResult::Invalid) + (Assets.Num() - Definitions.Num());
+	UE_LOG(LogCommonInventoryValidate, Display, TEXT("Validated %d CommonItemDefinitions, %d failed."), Assets.Num(), NumFailed);
+
+	return NumFailed > 0 ? 1 : 0;
+}
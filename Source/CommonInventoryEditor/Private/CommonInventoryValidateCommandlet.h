@@ -0,0 +1,24 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "Commandlets/Commandlet.h"
+#include "CommonInventoryValidateCommandlet.generated.h"
+
+/**
+ * Validates all CommonItemDefinitions and reports invariant violations of the registry state.
+ * Definitions are loaded on the game thread and validated in parallel, so large projects don't have to go through the whole data validation.
+ *
+ * Usage: -run=CommonInventoryValidate [-SingleThreaded]
+ */
+UCLASS()
+class UCommonInventoryValidateCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+	UCommonInventoryValidateCommandlet();
+
+public: //Overrides
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -14,9 +14,18 @@ public class CommonInventoryTests : ModuleRules
 			{
                 "Core",
                 "CoreUObject",
+                "Engine",
                 "CommonInventory",
+                "VariadicStruct",
+                "GameplayTags",
 
             }
 		);
+
+        // StructUtils were migrated to CoreUObject in 5.5.0.
+        if (Target.Version.MajorVersion == 5 && Target.Version.MinorVersion < 5)
+        {
+            PrivateDependencyModuleNames.Add("StructUtils");
+        }
 	}
 }
@@ -0,0 +1,342 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "CommonInventoryTypes.h"
+#include "InventoryRegistry/CommonInventoryRegistry.h"
+#include "InventoryRegistry/CommonInventoryRegistryTypes.h"
+
+#include "Algo/Transform.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Math/IntPoint.h"
+#include "Math/Vector.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/BitReader.h"
+#include "Serialization/BitWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+//
+// Benchmarks are filtered as performance tests and can be run with:
+// -ExecCmds="Automation RunTests CommonInventory.Benchmarks; Quit"
+//
+// Results are appended to Saved/Automation/CommonInventoryBenchmarks.csv, so they can be compared between plugin updates.
+//
+
+namespace CommonInventory::Benchmarks
+{
+	static constexpr int32 NumArchetypes = 8;
+
+	/** Payload values referenced by synthetic records through FConstStructView. */
+	static const FVector DefaultVectorPayload = FVector(1.0, 2.0, 3.0);
+	static const FIntPoint DefaultPointPayload = FIntPoint(4, 5);
+
+	/** Makes a synthetic registry with InNumRecords records spread across archetypes and payload types. */
+	static TArray<FCommonInventoryRegistryRecord> MakeRecords(int32 InNumRecords)
+	{
+		TArray<FCommonInventoryRegistryRecord> Records;
+		Records.Reserve(InNumRecords);
+
+		for (int32 Idx = 0; Idx < InNumRecords; ++Idx)
+		{
+			FCommonItemSharedData SharedData;
+			SharedData.PrimaryAssetId = FPrimaryAssetId(FPrimaryAssetType(FName(TEXT("BenchmarkArchetype"), Idx % NumArchetypes)), FName(TEXT("BenchmarkItem"), Idx));
+			SharedData.MaxStackSize = 1 + Idx % 100;
+
+			FConstStructView DefaultPayload;
+
+			switch (Idx % 3)
+			{
+			case 0: DefaultPayload = FConstStructView(TBaseStructure<FVector>::Get(), reinterpret_cast<const uint8*>(&DefaultVectorPayload)); break;
+			case 1: DefaultPayload = FConstStructView(TBaseStructure<FIntPoint>::Get(), reinterpret_cast<const uint8*>(&DefaultPointPayload)); break;
+			default: break; // Without payload.
+			}
+
+			Records.Emplace(SharedData, DefaultPayload);
+		}
+
+		return Records;
+	}
+
+	/** Returns the number of iterations, so every benchmark takes a comparable amount of time regardless of the registry size. */
+	static int32 GetNumIterations(int32 InNumRecords, int32 InBudget = 100'000)
+	{
+		return FMath::Clamp(InBudget / FMath::Max(InNumRecords, 1), 1, 100);
+	}
+
+	/** Appends rows to the CSV file shared by all benchmarks. */
+	class FBenchmarkReport
+	{
+	public:
+
+		explicit FBenchmarkReport(FAutomationTestBase& InTest)
+			: Test(InTest)
+		{
+		}
+
+		~FBenchmarkReport()
+		{
+			if (Rows.IsEmpty())
+			{
+				return;
+			}
+
+			const FString Filename = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("Automation"), TEXT("CommonInventoryBenchmarks.csv"));
+
+			if (!FPaths::FileExists(Filename))
+			{
+				Rows.Insert(TEXT("Timestamp,Benchmark,NumRecords,NumIterations,TotalMs,AverageUs"), 0);
+			}
+
+			FFileHelper::SaveStringArrayToFile(Rows, *Filename, FFileHelper::EEncodingOptions::AutoDetect, &IFileManager::Get(), FILEWRITE_Append);
+		}
+
+		/** Runs InFunc InNumIterations times and records the elapsed time. InSetup runs before each iteration and isn't measured. */
+		template<typename SetupType, typename FuncType>
+		void Run(const TCHAR* InName, int32 InNumRecords, int32 InNumIterations, SetupType&& InSetup, FuncType&& InFunc)
+		{
+			double ElapsedSeconds = 0.0;
+
+			for (int32 Iteration = 0; Iteration < InNumIterations; ++Iteration)
+			{
+				InSetup();
+
+				const double StartSeconds = FPlatformTime::Seconds();
+				InFunc();
+				ElapsedSeconds += FPlatformTime::Seconds() - StartSeconds;
+			}
+
+			const double TotalMs = ElapsedSeconds * 1000.0;
+			const double AverageUs = ElapsedSeconds * 1'000'000.0 / InNumIterations;
+
+			Rows.Add(FString::Printf(TEXT("%s,%s,%d,%d,%.3f,%.3f"), *Timestamp, InName, InNumRecords, InNumIterations, TotalMs, AverageUs));
+			Test.AddInfo(FString::Printf(TEXT("%s (%d records): %.3f us per iteration."), InName, InNumRecords, AverageUs));
+		}
+
+		template<typename FuncType>
+		void Run(const TCHAR* InName, int32 InNumRecords, int32 InNumIterations, FuncType&& InFunc)
+		{
+			Run(InName, InNumRecords, InNumIterations, [] {}, Forward<FuncType>(InFunc));
+		}
+
+	private:
+
+		FAutomationTestBase& Test;
+		const FString Timestamp = FDateTime::UtcNow().ToIso8601();
+		TArray<FString> Rows;
+	};
+}
+
+/************************************************************************/
+/* Registry State                                                       */
+/************************************************************************/
+
+IMPLEMENT_COMPLEX_AUTOMATION_TEST(FCommonInventoryRegistryStateBenchmark, "CommonInventory.Benchmarks.RegistryState",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+void FCommonInventoryRegistryStateBenchmark::GetTests(TArray<FString>& OutBeautifiedNames, TArray<FString>& OutTestCommands) const
+{
+	for (const int32 NumRecords : { 1'000, 10'000, 100'000 })
+	{
+		OutBeautifiedNames.Add(FString::Printf(TEXT("%d Records"), NumRecords));
+		OutTestCommands.Add(FString::FromInt(NumRecords));
+	}
+}
+
+bool FCommonInventoryRegistryStateBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace CommonInventory::Benchmarks;
+
+	const int32 NumRecords = FCString::Atoi(*Parameters);
+	const int32 NumIterations = GetNumIterations(NumRecords);
+	const TArray<FCommonInventoryRegistryRecord> Records = MakeRecords(NumRecords);
+
+	FBenchmarkReport Report(*this);
+	FCommonInventoryRegistryState State;
+
+	Report.Run(TEXT("Reset"), NumRecords, NumIterations, [&State, &Records]
+		{
+			State.Reset(Records);
+		});
+
+	if (!TestEqual(TEXT("Number of records after Reset()"), State.GetRecordsNum(), NumRecords))
+	{
+		return false;
+	}
+
+	// Incremental updates fix up the secondary data per call, so only a slice of the registry is touched.
+	const int32 NumIncrementalRecords = FMath::Min(NumRecords, 100);
+
+	Report.Run(TEXT("RemoveData"), NumRecords, NumIterations, [&State, &Records] { State.Reset(Records); }, [&State, &Records, NumIncrementalRecords]
+		{
+			for (int32 Idx = 0; Idx < NumIncrementalRecords; ++Idx)
+			{
+				State.RemoveData(Records[Idx].GetPrimaryAssetId());
+			}
+		});
+
+	Report.Run(TEXT("AppendData"), NumRecords, NumIterations, [&State, &Records, NumIncrementalRecords] { State.Reset(MakeArrayView(Records).RightChop(NumIncrementalRecords)); }, [&State, &Records, NumIncrementalRecords]
+		{
+			for (int32 Idx = 0; Idx < NumIncrementalRecords; ++Idx)
+			{
+				State.AppendData(Records[Idx]);
+			}
+		});
+
+	// The checksum is cached, so the state is reset before each iteration.
+	Report.Run(TEXT("GetChecksum"), NumRecords, NumIterations, [&State, &Records] { State.Reset(Records); }, [&State]
+		{
+			State.GetChecksum();
+		});
+
+	for (const bool bIsCooking : { false, true })
+	{
+		TArray<uint8> SerializedState;
+
+		Report.Run(bIsCooking ? TEXT("SaveState (Cooked)") : TEXT("SaveState"), NumRecords, NumIterations, [&SerializedState] { SerializedState.Reset(); }, [&State, &SerializedState, bIsCooking]
+			{
+				FMemoryWriter Writer(SerializedState, /* bIsPersistent */ true);
+				State.SaveState(Writer, bIsCooking);
+			});
+
+		FCommonInventoryRegistryState LoadedState;
+		bool bIsLoaded = true;
+
+		Report.Run(bIsCooking ? TEXT("LoadState (Cooked)") : TEXT("LoadState"), NumRecords, NumIterations, [&LoadedState, &SerializedState, &bIsLoaded, bIsCooking]
+			{
+				FMemoryReader Reader(SerializedState, /* bIsPersistent */ true);
+				bIsLoaded &= LoadedState.LoadState(Reader, bIsCooking);
+			});
+
+		TestTrue(FString::Printf(TEXT("LoadState(bIsCooked = %d) succeeds"), bIsCooking), bIsLoaded);
+		TestEqual(FString::Printf(TEXT("LoadState(bIsCooked = %d) matches the checksum"), bIsCooking), LoadedState.GetChecksum(), State.GetChecksum());
+	}
+
+	// Most ids don't redirect, so the lookups mostly hit the negative cache after the first pass.
+	Report.Run(TEXT("TryRedirect"), NumRecords, NumIterations, [&Records]
+		{
+			const FCommonInventoryRedirects& Redirects = FCommonInventoryRedirects::Get();
+
+			for (const FCommonInventoryRegistryRecord& Record : Records)
+			{
+				FPrimaryAssetId PrimaryAssetId = Record.GetPrimaryAssetId();
+				Redirects.TryRedirect(PrimaryAssetId);
+			}
+		});
+
+	// Receivers resolve RepIndex per item. Replicated items arrive in no particular order, so the records are visited with a prime stride.
+	static constexpr int64 RepIndexStride = 7919;
+	TArray<uint32> RepIndices;
+	RepIndices.Reserve(NumRecords);
+
+	for (int32 Idx = 0; Idx < NumRecords; ++Idx)
+	{
+		RepIndices.Add(State.GetRecords()[static_cast<int32>(Idx * RepIndexStride % NumRecords)].RepIndex);
+	}
+
+	// The hash map used to resolve RepIndex before it became a direct index into the records.
+	TMap<uint32, int32> ReplicationMap;
+	ReplicationMap.Reserve(NumRecords);
+
+	for (int32 Idx = 0; Idx < NumRecords; ++Idx)
+	{
+		ReplicationMap.Add(State.GetRecords()[Idx].RepIndex, Idx);
+	}
+
+	int32 NumResolvedByMap = 0;
+	int32 NumResolved = 0;
+
+	Report.Run(TEXT("GetRecordFromReplication (Map)"), NumRecords, NumIterations, [&State, &RepIndices, &ReplicationMap, &NumResolvedByMap]
+		{
+			const TArrayView<const FCommonInventoryRegistryRecord> RecordsView = State.GetRecords();
+
+			for (const uint32 RepIndex : RepIndices)
+			{
+				if (const int32* const Idx = ReplicationMap.Find(RepIndex); Idx && RecordsView[*Idx].SharedData.MaxStackSize > 0)
+				{
+					++NumResolvedByMap;
+				}
+			}
+		});
+
+	Report.Run(TEXT("GetRecordFromReplication"), NumRecords, NumIterations, [&State, &RepIndices, &NumResolved]
+		{
+			for (const uint32 RepIndex : RepIndices)
+			{
+				if (const FCommonInventoryRegistryRecord* const Record = State.GetRecordFromReplication(RepIndex); Record && Record->SharedData.MaxStackSize > 0)
+				{
+					++NumResolved;
+				}
+			}
+		});
+
+	TestEqual(TEXT("GetRecordFromReplication() resolves all indices"), NumResolved, NumRecords * NumIterations);
+	TestEqual(TEXT("GetRecordFromReplication() matches the map"), NumResolved, NumResolvedByMap);
+
+	return true;
+}
+
+/************************************************************************/
+/* Net Serialization                                                    */
+/************************************************************************/
+
+// NetSerializeItem() works against the live registry, so the round trips use the records of the running project.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCommonInventoryNetSerializationBenchmark, "CommonInventory.Benchmarks.NetSerializeItem",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::PerfFilter)
+
+bool FCommonInventoryNetSerializationBenchmark::RunTest(const FString& Parameters)
+{
+	using namespace CommonInventory::Benchmarks;
+
+	const UCommonInventoryRegistry* const Registry = UCommonInventoryRegistry::GetPtr();
+
+	if (!Registry || !Registry->GetRegistryState().HasRecords())
+	{
+		AddInfo(TEXT("InventoryRegistry doesn't have any records to benchmark."));
+		return true;
+	}
+
+	TArray<FCommonItem> Items;
+	Algo::Transform(Registry->GetRegistryState().GetRecords(), Items, [](const FCommonInventoryRegistryRecord& InRecord) { return FCommonItem(InRecord.GetPrimaryAssetId()); });
+
+	const int32 NumRecords = Items.Num();
+	const int32 NumIterations = GetNumIterations(NumRecords);
+
+	FBenchmarkReport Report(*this);
+	int64 NumBits = 0;
+	bool bOutSuccess = true;
+
+	Report.Run(TEXT("NetSerializeItem (RoundTrip)"), NumRecords, NumIterations, [&Items, &NumBits, &bOutSuccess]
+		{
+			FBitWriter Writer(/* InMaxBits */ 0, /* AllowResize */ true);
+
+			for (FCommonItem& Item : Items)
+			{
+				bool bIsSerialized = true;
+				Item.NetSerialize(Writer, nullptr, bIsSerialized);
+				bOutSuccess &= bIsSerialized;
+			}
+
+			NumBits = Writer.GetNumBits();
+			FBitReader Reader(Writer.GetData(), Writer.GetNumBits());
+			FCommonItem ReceivedItem;
+
+			for (int32 Idx = 0; Idx < Items.Num(); ++Idx)
+			{
+				bool bIsSerialized = true;
+				ReceivedItem.NetSerialize(Reader, nullptr, bIsSerialized);
+				bOutSuccess &= bIsSerialized && !Reader.IsError();
+			}
+		});
+
+	TestTrue(TEXT("NetSerialize round trips succeed"), bOutSuccess);
+	AddInfo(FString::Printf(TEXT("NetSerializeItem: %.2f bits per item on average."), static_cast<double>(NumBits) / NumRecords));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,84 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "CommonInventoryTestTypes.h"
+#include "CommonInventoryTypes.h"
+#include "InventoryRegistry/CommonInventoryRegistry.h"
+#include "InventoryRegistry/CommonInventoryRegistryTypes.h"
+
+#include "Engine/NetSerialization.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Grants the tests access to the registry internals. */
+struct FCommonInventoryTestAccess
+{
+	static bool NetSerializeItemPayload(FArchive& Ar, FVariadicStruct& InPayload, const FCommonInventoryRegistryRecord& InRecord)
+	{
+		bool bOutSuccess = true;
+		FCommonInventoryRegistryNetSerializationContext SerializationContext{ InRecord.GetPrimaryAssetId(), bOutSuccess };
+		SerializationContext.RegistryRecord = &InRecord;
+		UCommonInventoryRegistry::Get().NetSerializeItemPayload(Ar, InPayload, SerializationContext);
+		return bOutSuccess && !Ar.IsError();
+	}
+};
+
+/************************************************************************/
+/* Payload                                                              */
+/************************************************************************/
+
+// The Iris serializer quantizes payloads through net archives without UPackageMap, which must keep names intact.
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCommonInventoryNamePayloadTest, "CommonInventory.NetSerialization.NamePayload",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FCommonInventoryNamePayloadTest::RunTest(const FString& Parameters)
+{
+	const FCommonInventoryTestNamePayload DefaultPayload;
+
+	FCommonItemSharedData SharedData;
+	SharedData.PrimaryAssetId = FPrimaryAssetId(TEXT("TestArchetype"), TEXT("TestItem"));
+
+	// Records are fixed up by the state, which also prepares the RepLayout.
+	FCommonInventoryRegistryState State;
+	State.Reset({ FCommonInventoryRegistryRecord(SharedData, FConstStructView::Make(DefaultPayload)) });
+	const FCommonInventoryRegistryRecord* const Record = State.GetRecordPtr(SharedData.PrimaryAssetId);
+
+	if (!TestNotNull(TEXT("Test record"), Record))
+	{
+		return false;
+	}
+
+	auto RoundTrip = [this, Record](const TCHAR* InWhat, const FCommonInventoryTestNamePayload& InValue)
+		{
+			FVariadicStruct Payload;
+			Payload.InitializeAs(FCommonInventoryTestNamePayload::StaticStruct(), reinterpret_cast<const uint8*>(&InValue));
+
+			FNetBitWriter Writer(/* InPackageMap */ nullptr, /* InMaxBits */ 256);
+			TestTrue(FString::Printf(TEXT("%s is written"), InWhat), FCommonInventoryTestAccess::NetSerializeItemPayload(Writer, Payload, *Record));
+
+			FVariadicStruct ReceivedPayload;
+			FNetBitReader Reader(/* InPackageMap */ nullptr, Writer.GetData(), Writer.GetNumBits());
+			TestTrue(FString::Printf(TEXT("%s is read"), InWhat), FCommonInventoryTestAccess::NetSerializeItemPayload(Reader, ReceivedPayload, *Record));
+
+			if (TestEqual(FString::Printf(TEXT("%s type"), InWhat), ReceivedPayload.GetScriptStruct(), FCommonInventoryTestNamePayload::StaticStruct()))
+			{
+				const FCommonInventoryTestNamePayload& Received = *reinterpret_cast<const FCommonInventoryTestNamePayload*>(ReceivedPayload.GetMemory());
+				TestEqual(FString::Printf(TEXT("%s Name"), InWhat), Received.Name, InValue.Name);
+				TestEqual(FString::Printf(TEXT("%s Count"), InWhat), Received.Count, InValue.Count);
+				TestEqual(FString::Printf(TEXT("%s Names"), InWhat), Received.Names, InValue.Names);
+			}
+		};
+
+	FCommonInventoryTestNamePayload DeltaPayload;
+	DeltaPayload.Name = TEXT("ChangedName");
+	DeltaPayload.Count = 3;
+	RoundTrip(TEXT("Delta payload"), DeltaPayload);
+
+	FCommonInventoryTestNamePayload FullPayload = DeltaPayload;
+	FullPayload.Names = { TEXT("First"), TEXT("Second") };
+	RoundTrip(TEXT("RepLayout payload"), FullPayload);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,107 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#include "CommonInventoryTestTypes.h"
+#include "InventoryRegistry/CommonInventoryRegistry.h"
+#include "InventoryRegistry/CommonInventoryRegistryTypes.h"
+
+#include "Misc/AutomationTest.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/************************************************************************/
+/* Instanced Subobjects                                                 */
+/************************************************************************/
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCommonInventoryInstancedSubobjectPropagationTest, "CommonInventory.Propagation.InstancedSubobject",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FCommonInventoryInstancedSubobjectPropagationTest::RunTest(const FString& Parameters)
+{
+	FCommonInventoryDefaultsPropagator& Propagator = FCommonInventoryDefaultsPropagator::Get();
+	const TConstArrayView<const FProperty*> Schema = Propagator.GetPropagationSchema(UCommonInventoryTestHolder::StaticClass());
+
+	TestTrue(TEXT("Instanced references are in the schema"), Schema.Contains(UCommonInventoryTestHolder::StaticClass()->FindPropertyByName(GET_MEMBER_NAME_CHECKED(UCommonInventoryTestHolder, Subobject))));
+	TestFalse(TEXT("Plain references aren't in the schema"), Schema.Contains(UCommonInventoryTestHolder::StaticClass()->FindPropertyByName(GET_MEMBER_NAME_CHECKED(UCommonInventoryTestHolder, Reference))));
+
+	// The subobject isn't outered to the holder, so it's only reachable through the reference.
+	UCommonInventoryTestHolder* const Holder = NewObject<UCommonInventoryTestHolder>(GetTransientPackage());
+	UCommonInventoryTestSubobject* const Subobject = NewObject<UCommonInventoryTestSubobject>(GetTransientPackage());
+	UCommonInventoryTestSubobject* const Reference = NewObject<UCommonInventoryTestSubobject>(GetTransientPackage());
+	Holder->Subobject = Subobject;
+	Holder->Reference = Reference;
+
+	Propagator.Bind_OnGatherObjectsOverride(FCommonInventoryDefaultsPropagator::FGatherObjectsOverrideDelegate::CreateLambda([Holder](const FCommonInventoryDefaultsPropagator::FContext&, TArray<UObject*>& OutObjects, bool& bOutSkipGathering)
+		{
+			OutObjects.Add(Holder);
+			bOutSkipGathering = true;
+		}));
+
+	FCommonInventoryDefaultsPropagator::FContext Context;
+	Propagator.PropagateRegistryDefaults(Context);
+	Propagator.Unbind_OnGatherObjectsOverride();
+
+	TestTrue(TEXT("The holder is visited"), Context.VisitedObjects.Contains(Holder));
+	TestTrue(TEXT("The instanced subobject is visited"), Context.VisitedObjects.Contains(Subobject));
+	TestFalse(TEXT("The plain reference isn't visited"), Context.VisitedObjects.Contains(Reference));
+
+	return true;
+}
+
+/************************************************************************/
+/* Snapshots                                                            */
+/************************************************************************/
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCommonInventorySnapshotPropagationTest, "CommonInventory.Propagation.Snapshot",
+	EAutomationTestFlags::EditorContext | EAutomationTestFlags::ClientContext | EAutomationTestFlags::ServerContext | EAutomationTestFlags::EngineFilter)
+
+bool FCommonInventorySnapshotPropagationTest::RunTest(const FString& Parameters)
+{
+	// Payloads are only rewritten through the registry.
+	if (!UCommonInventoryRegistry::GetPtr())
+	{
+		AddWarning(TEXT("InventoryRegistry isn't available."));
+		return true;
+	}
+
+	// The item is only known to the original registry, so the propagation removes it.
+	const FPrimaryAssetId RemovedItemId(FPrimaryAssetType("CommonInventoryTest"), FName("RemovedItem"));
+	FCommonItemSharedData SharedData;
+	SharedData.PrimaryAssetId = RemovedItemId;
+
+	FCommonInventoryDefaultsPropagator::FContext Context;
+	Context.OriginalRegistryState.AppendData(FCommonInventoryRegistryRecord(SharedData));
+
+	UCommonInventoryTestStateHolder* const Holder = NewObject<UCommonInventoryTestStateHolder>(GetTransientPackage());
+	Holder->State.Initialize(/* InInitialCapacity */ 4);
+	const int32 Slot = Holder->State.AddItem(FCommonItem(RemovedItemId), /* InStackSize */ 1);
+
+	if (!TestNotEqual(TEXT("The item is added"), Slot, INDEX_NONE))
+	{
+		return false;
+	}
+
+	const TSharedRef<const FCommonInventoryStateSnapshot, ESPMode::ThreadSafe> PrevSnapshot = Holder->State.MakeSnapshot();
+
+	FCommonInventoryDefaultsPropagator& Propagator = FCommonInventoryDefaultsPropagator::Get();
+	Propagator.Bind_OnGatherObjectsOverride(FCommonInventoryDefaultsPropagator::FGatherObjectsOverrideDelegate::CreateLambda([Holder](const FCommonInventoryDefaultsPropagator::FContext&, TArray<UObject*>& OutObjects, bool& bOutSkipGathering)
+		{
+			OutObjects.Add(Holder);
+			bOutSkipGathering = true;
+		}));
+
+	Propagator.PropagateRegistryDefaults(Context);
+	Propagator.Unbind_OnGatherObjectsOverride();
+
+	const TSharedRef<const FCommonInventoryStateSnapshot, ESPMode::ThreadSafe> NextSnapshot = Holder->State.MakeSnapshot();
+
+	TestTrue(TEXT("The item is removed from the state"), Holder->State.GetItem(Slot).IsEmpty());
+	TestFalse(TEXT("The previous snapshot keeps the item"), PrevSnapshot->GetItem(Slot).IsEmpty());
+	TestNotEqual(TEXT("A new snapshot is taken"), &NextSnapshot.Get(), &PrevSnapshot.Get());
+	TestTrue(TEXT("The new snapshot doesn't share the stale chunk"), NextSnapshot->GetItem(Slot).IsEmpty());
+	TestFalse(TEXT("The item is removed from the slot index"), Holder->State.ContainsItem(RemovedItemId));
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,77 @@
+// Copyright 2025 Ivan Baktenkov. All Rights Reserved.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CommonInventoryState.h"
+#include "CommonInventoryTypes.h"
+#include "UObject/Object.h"
+
+#include "CommonInventoryTestTypes.generated.h"
+
+/**
+ * Payload with names, which require a net archive to be serialized.
+ */
+USTRUCT()
+struct FCommonInventoryTestNamePayload
+{
+	GENERATED_BODY()
+
+	/** Takes the delta path. */
+	UPROPERTY()
+	FName Name;
+
+	/** Takes the delta path. */
+	UPROPERTY()
+	int32 Count = 0;
+
+	/** Forces the RepLayout path once changed. */
+	UPROPERTY()
+	TArray<FName> Names;
+};
+
+/**
+ * Instanced subobject holding an item.
+ */
+UCLASS(EditInlineNew)
+class UCommonInventoryTestSubobject : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	FCommonItem Item;
+};
+
+/**
+ * Holds items only through instanced subobjects.
+ */
+UCLASS()
+class UCommonInventoryTestHolder : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY(Instanced)
+	TObjectPtr<UCommonInventoryTestSubobject> Subobject;
+
+	/** Plain references are never followed. */
+	UPROPERTY()
+	TObjectPtr<UCommonInventoryTestSubobject> Reference;
+};
+
+/**
+ * Holds items through an inventory state.
+ */
+UCLASS()
+class UCommonInventoryTestStateHolder : public UObject
+{
+	GENERATED_BODY()
+
+public:
+
+	UPROPERTY()
+	FCommonInventoryState State;
+};